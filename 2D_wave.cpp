@@ -1,261 +1,149 @@
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
-#include <glm/glm.hpp>
+#include "wave2d.h"
 
-#include <iostream>
-#include <string>
-#include <vector>
-#include <cmath>
-
-#include "em_common.h"
-#include "shader_utils.h"
-#include "camera.h"
-
-// ── Window ──
-constexpr int WIDTH  = 1280;
-constexpr int HEIGHT = 720;
-
-// ── Grid ──
-constexpr int NX = 512;
-constexpr int NY = 512;
-constexpr int GRID_SIZE = NX * NY;
-
-// ── Simulation ──
-constexpr int   STEPS_PER_FRAME = 4;
-constexpr float SOURCE_FREQ     = 0.04f;  // normalized (wavelength ~ 25 cells)
-constexpr float SOURCE_AMP      = 1.0f;
-
-// ── Globals ──
-Camera2D camera;
+// 2D entry point: window, key handling and headless / CPU runs around
+// the Engine in wave2d.h
+using namespace wave2d;
 
 // ─────────────────────────────────────────────────────────────────────────────
-// Engine — owns all OpenGL state, following kavan010/black_hole architecture
+// Keyboard handler — camera keys plus simulation controls
 // ─────────────────────────────────────────────────────────────────────────────
-struct Engine {
-    GLFWwindow* window = nullptr;
-
-    // Programs
-    GLuint computeProgram = 0;
-    GLuint renderProgram  = 0;
-
-    // SSBOs (field data lives on the GPU)
-    GLuint ezSSBO = 0;
-    GLuint hxSSBO = 0;
-    GLuint hySSBO = 0;
-
-    // UBO
-    GLuint simParamsUBO = 0;
-
-    // Fullscreen quad
-    GLuint quadVAO = 0;
-    GLuint quadVBO = 0;
-
-    // Cached uniform locations — render program
-    GLint loc_nx           = -1;
-    GLint loc_ny           = -1;
-    GLint loc_field_scale  = -1;
-    GLint loc_view_center  = -1;
-    GLint loc_view_zoom    = -1;
-    GLint loc_aspect_ratio = -1;
-
-    // Cached uniform locations — compute program
-    GLint loc_updateStep = -1;
-
-    // ── Initialisation ──────────────────────────────────────────────────────
-
-    void init() {
-        initWindow();
-        initShaders();
-        initBuffers();
-        initQuad();
-        cacheUniformLocations();
-    }
-
-    void initWindow() {
-        if (!glfwInit()) {
-            std::cerr << "Failed to initialise GLFW\n";
-            exit(EXIT_FAILURE);
-        }
-
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-        window = glfwCreateWindow(WIDTH, HEIGHT, "EM Wave - 2D FDTD", nullptr, nullptr);
-        if (!window) {
-            std::cerr << "Failed to create GLFW window\n";
-            glfwTerminate();
-            exit(EXIT_FAILURE);
-        }
-        glfwMakeContextCurrent(window);
-        glfwSwapInterval(1);  // vsync
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    camera.processKey(key, scancode, action, mods);
+    if (action != GLFW_PRESS) return;
+
+    if (key == GLFW_KEY_ESCAPE)
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
+    else if (key == GLFW_KEY_F5)
+        reloadScene = true;
+    else if (key == GLFW_KEY_LEFT_BRACKET)
+        shownLayer = std::max(shownLayer - 1, 0);
+    else if (key == GLFW_KEY_RIGHT_BRACKET)
+        ++shownLayer;  // clamped to the batch by the engine
+    else if (key == GLFW_KEY_TAB && !scene.media.empty()) {
+        movedObject = (movedObject + 1) % int(scene.media.size());
+        std::cout << "Move: object " << movedObject << " (" << scene.media[movedObject].spec
+                  << ") selected\n";
+    } else if (key == GLFW_KEY_J || key == GLFW_KEY_L)
+        nudge[0] += key == GLFW_KEY_L ? 1 : -1;
+    else if (key == GLFW_KEY_I || key == GLFW_KEY_K)
+        nudge[1] += key == GLFW_KEY_I ? 1 : -1;
+}
 
-        glewExperimental = GL_TRUE;
-        if (glewInit() != GLEW_OK) {
-            std::cerr << "Failed to initialise GLEW\n";
-            exit(EXIT_FAILURE);
+// ─────────────────────────────────────────────────────────────────────────────
+// Headless batch — back-to-back FDTD steps, no render pass, no swap
+// ─────────────────────────────────────────────────────────────────────────────
+void runHeadless(Engine& engine, int steps) {
+    std::cout << "Headless: " << steps << " steps on " << scene.nx << "x" << scene.ny << " grid";
+    if (engine.batch > 1) std::cout << " x " << engine.batch << " scenarios";
+    if (engine.fusedSteps > 0)
+        std::cout << " (fused, " << engine.fusedSteps << " steps/dispatch)";
+    std::cout << "\n";
+
+    glFinish();
+    double start = glfwGetTime();
+
+    // Frames of stepsPerFrame steps, so GPU timers see the same cadence as
+    // the windowed loop
+    for (int t = 0; t < steps; t += scene.stepsPerFrame) {
+        int n = std::min(scene.stepsPerFrame, steps - t);
+        engine.timers.beginFrame();
+        engine.step(t, n);
+        engine.snapshotAfter(t, t + n);
+        engine.statsAfter(t, t + n);
+        engine.timers.endFrame(n);
+        if (engine.halted) {
+            steps = t + n;
+            break;
         }
-
-        std::cout << "OpenGL " << glGetString(GL_VERSION) << "\n";
-        std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
-    }
-
-    void initShaders() {
-        computeProgram = shader::createComputeProgram("shaders/maxwell.comp");
-        renderProgram  = shader::createProgram("shaders/field.vert",
-                                               "shaders/field.frag");
-    }
-
-    void initBuffers() {
-        std::vector<float> zeros(GRID_SIZE, 0.0f);
-
-        auto makeSSBO = [&](GLuint& ssbo, GLuint binding) {
-            glGenBuffers(1, &ssbo);
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
-            glBufferData(GL_SHADER_STORAGE_BUFFER,
-                         GRID_SIZE * sizeof(float),
-                         zeros.data(), GL_DYNAMIC_COPY);
-            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, ssbo);
-        };
-
-        makeSSBO(ezSSBO, 0);  // Ez at binding 0
-        makeSSBO(hxSSBO, 1);  // Hx at binding 1
-        makeSSBO(hySSBO, 2);  // Hy at binding 2
-
-        // SimParams UBO at binding 0 (UBO and SSBO namespaces are separate)
-        glGenBuffers(1, &simParamsUBO);
-        glBindBuffer(GL_UNIFORM_BUFFER, simParamsUBO);
-        glBufferData(GL_UNIFORM_BUFFER, sizeof(SimParams), nullptr,
-                     GL_DYNAMIC_DRAW);
-        glBindBufferBase(GL_UNIFORM_BUFFER, 0, simParamsUBO);
     }
 
-    void initQuad() {
-        // clang-format off
-        float verts[] = {
-        //  pos (xy)       texcoord (uv)
-            -1.f,  1.f,   0.f, 1.f,
-            -1.f, -1.f,   0.f, 0.f,
-             1.f, -1.f,   1.f, 0.f,
-
-            -1.f,  1.f,   0.f, 1.f,
-             1.f, -1.f,   1.f, 0.f,
-             1.f,  1.f,   1.f, 1.f,
-        };
-        // clang-format on
-
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+    glFinish();  // wait for the GPU so the timing covers all queued work
+    double elapsed = glfwGetTime() - start;
 
-        // location 0 — position (vec2)
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE,
-                              4 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-
-        // location 1 — texcoord (vec2)
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE,
-                              4 * sizeof(float),
-                              (void*)(2 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-
-        glBindVertexArray(0);
-    }
-
-    void cacheUniformLocations() {
-        loc_nx           = glGetUniformLocation(renderProgram, "nx");
-        loc_ny           = glGetUniformLocation(renderProgram, "ny");
-        loc_field_scale  = glGetUniformLocation(renderProgram, "field_scale");
-        loc_view_center  = glGetUniformLocation(renderProgram, "view_center");
-        loc_view_zoom    = glGetUniformLocation(renderProgram, "view_zoom");
-        loc_aspect_ratio = glGetUniformLocation(renderProgram, "aspect_ratio");
-
-        loc_updateStep = glGetUniformLocation(computeProgram, "updateStep");
-    }
-
-    // ── Per-frame work ──────────────────────────────────────────────────────
-
-    void uploadSimParams(int timestep) {
-        SimParams p{};
-        p.nx          = NX;
-        p.ny          = NY;
-        p.source_x    = NX / 2;
-        p.source_y    = NY / 2;
-        p.dx          = em::DX;
-        p.dt          = em::DT;
-        p.time        = timestep * em::DT;
-        p.source_freq = SOURCE_FREQ;
-        p.source_amp  = SOURCE_AMP;
-        p.field_scale = 1.0f;
-        p.timestep    = timestep;
-        p._pad0       = 0;
-
-        glBindBuffer(GL_UNIFORM_BUFFER, simParamsUBO);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SimParams), &p);
-    }
-
-    void updateFields(int timestep) {
-        glUseProgram(computeProgram);
-        uploadSimParams(timestep);
-
-        GLuint gx = (NX + 15) / 16;
-        GLuint gy = (NY + 15) / 16;
-
-        // Pass 1 — H field update
-        glUniform1i(loc_updateStep, 0);
-        glDispatchCompute(gx, gy, 1);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-
-        // Pass 2 — E field update + source + absorbing boundary
-        glUniform1i(loc_updateStep, 1);
-        glDispatchCompute(gx, gy, 1);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    }
-
-    void render() {
-        glUseProgram(renderProgram);
-
-        int winW, winH;
-        glfwGetFramebufferSize(window, &winW, &winH);
-        float aspect = (winH > 0) ? static_cast<float>(winW) / winH : 1.0f;
-
-        glUniform1i(loc_nx, NX);
-        glUniform1i(loc_ny, NY);
-        glUniform1f(loc_field_scale, 15.0f);    // amplify for visibility
-        glUniform2f(loc_view_center, camera.center.x, camera.center.y);
-        glUniform1f(loc_view_zoom, camera.zoom);
-        glUniform1f(loc_aspect_ratio, aspect);
-
-        glBindVertexArray(quadVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-    }
+    cli::printThroughput(steps, elapsed, static_cast<long long>(scene.cells()) * engine.batch);
+    if (engine.patch.enabled()) engine.patch.printTiming(elapsed, scene.cells());
+    engine.activeTiles.printStatus();
+    engine.finishStats();
+    engine.fieldStats.printSummary();
+}
 
-    // ── Cleanup ─────────────────────────────────────────────────────────────
+// ─────────────────────────────────────────────────────────────────────────────
+// CPU backend — the same batch on the host solver (cpu_fdtd.h), or the same
+// batch used as a reference for the GPU fields
+// ─────────────────────────────────────────────────────────────────────────────
+void runCpuSteps(cpu::Solver2D& solver, const cli::RunOptions& opts, int layer = 0) {
+    Engine host;  // never init()ed: only supplies materials and parameters
+    host.useCpml          = opts.cpml;
+    host.cpmlParams.width = CPML_WIDTH;
+    host.batch            = opts.batch;
+    host.initCpuSolver(solver, opts.threads, layer);
+
+    std::cout << "CPU: " << opts.steps << " steps on " << scene.nx << "x" << scene.ny
+              << " grid, " << solver.pool.threads() << " threads, " << cpu::isaName() << " x "
+              << cpu::Vec::N << " lanes\n";
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < opts.steps; ++t) solver.step(t);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    cli::printThroughput(opts.steps, elapsed.count(), static_cast<long long>(scene.cells()));
+}
 
-    void cleanup() {
-        glDeleteBuffers(1, &ezSSBO);
-        glDeleteBuffers(1, &hxSSBO);
-        glDeleteBuffers(1, &hySSBO);
-        glDeleteBuffers(1, &simParamsUBO);
-        glDeleteVertexArrays(1, &quadVAO);
-        glDeleteBuffers(1, &quadVBO);
-        glDeleteProgram(computeProgram);
-        glDeleteProgram(renderProgram);
+// Run the GPU batch again on the CPU, one scenario at a time, and check the
+// fields agree
+bool reportCpuMatch(const std::vector<float>& fields, const cli::RunOptions& opts) {
+    std::cout << "\nReference: CPU solver\n";
+    const size_t cells = scene.cells();
+    std::vector<float> reference(fields.size());
+    for (int l = 0; l < opts.batch; ++l) {
+        if (opts.batch > 1) std::cout << "Scenario " << l << ": ";
+        cpu::Solver2D solver;
+        runCpuSteps(solver, opts, l);
+        for (int f = 0; f < 3; ++f)  // buffer-major, as readFields()
+            std::copy_n(solver.fields.begin() + f * cells, cells,
+                        reference.begin() + (f * opts.batch + l) * cells);
     }
-};
+    return cpu::reportMatch(fields, reference, "2D Ez, Hx, Hy");
+}
 
 // ─────────────────────────────────────────────────────────────────────────────
 // main
 // ─────────────────────────────────────────────────────────────────────────────
-int main() {
+int main(int argc, char** argv) {
+    cli::RunOptions opts = cli::parse(argc, argv, cli::APP_2D);
+    int boundaryWidth = opts.cpml ? CPML_WIDTH : 0;
+    if (!config::resolve(defaultScene(), opts, boundaryWidth, false, scene))
+        exit(EXIT_FAILURE);
+
+    if (opts.cpuBackend) {
+        cpu::Solver2D solver;
+        runCpuSteps(solver, opts);
+        return 0;
+    }
+
     Engine engine;
-    engine.init();
+    engine.init(opts);
+
+    if (opts.headless) {
+        runHeadless(engine, opts.steps);
+        engine.reportTimers(opts.profilePath);
+        std::vector<float> fields;
+        if (opts.compareCpu) fields = engine.readFields();
+        bool halted = engine.halted;
+        engine.cleanup();
+        glfwDestroyWindow(engine.window);
+        glfwTerminate();
+
+        if (opts.compareCpu && !reportCpuMatch(fields, opts)) return EXIT_FAILURE;
+        return halted ? EXIT_FAILURE : 0;
+    }
 
     setupCameraCallbacks(engine.window, &camera);
+    glfwSetKeyCallback(engine.window, keyCallback);  // adds F5 to the camera keys
 
     int    timestep    = 0;
+    pacing::Pacer pacer;
+    pacer.start(opts.frameBudgetMs, scene.stepsPerFrame);
+
     double lastFPSTime = glfwGetTime();
     int    frameCount  = 0;
 
@@ -263,13 +151,36 @@ int main() {
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        // Run several FDTD steps per rendered frame
-        for (int i = 0; i < STEPS_PER_FRAME; ++i) {
-            engine.updateFields(timestep);
-            ++timestep;
+        engine.timers.beginFrame();
+
+        // F5: re-read the scene; a new grid size restarts from step 0
+        if (reloadScene) {
+            reloadScene = false;
+            config::Scene next;
+            if (config::resolve(defaultScene(), opts, boundaryWidth, false, next) &&
+                engine.applyScene(next))
+                timestep = 0;
+            pacer.restart(scene.stepsPerFrame);
         }
+        // Tab / J L K I: move the selected medium, repainting only its box
+        if ((nudge[0] || nudge[1]) && movedObject < int(scene.media.size()))
+            engine.moveObject(size_t(movedObject), nudge);
+        nudge[0] = nudge[1] = 0;
+        pacer.beginFrame();
+        int steps = pacer.enabled ? pacer.steps : scene.stepsPerFrame;
+        if (engine.halted) steps = 0;  // watchdog: keep showing the last fields
+
+        // Run several FDTD steps per rendered frame (as many as fit when paced)
+        pacer.beginSolve();
+        engine.step(timestep, steps);
+        pacer.endSolve();
+        engine.snapshotAfter(timestep, timestep + steps);
+        engine.statsAfter(timestep, timestep + steps);
+        timestep += steps;
 
         engine.render();
+        engine.timers.endFrame(steps);
+        pacer.endFrame(steps);
 
         // FPS + timestep counter in title bar
         ++frameCount;
@@ -278,6 +189,15 @@ int main() {
             std::string title = "EM Wave - 2D FDTD | "
                 + std::to_string(frameCount) + " fps | Step "
                 + std::to_string(timestep);
+            if (engine.batch > 1)
+                title += " | Scenario " +
+                         std::to_string(std::clamp(shownLayer, 0, engine.batch - 1) + 1) + "/" +
+                         std::to_string(engine.batch) + " ([ ])";
+            title += " | " + pacer.overlay(now - lastFPSTime);
+            if (engine.fieldStats.enabled)
+                title += " | " + engine.fieldStats.overlay(engine.exposure.scale);
+            if (engine.halted) title += " | HALTED (watchdog)";
+            if (engine.timers.enabled) title += " | " + engine.timers.overlay();
             glfwSetWindowTitle(engine.window, title.c_str());
             frameCount  = 0;
             lastFPSTime = now;
@@ -285,10 +205,18 @@ int main() {
 
         glfwSwapBuffers(engine.window);
         glfwPollEvents();
+
+        if (opts.steps > 0 && timestep >= opts.steps)
+            glfwSetWindowShouldClose(engine.window, GLFW_TRUE);
     }
 
+    engine.reportTimers(opts.profilePath);
+    engine.fieldStats.printSummary();
+    pacer.printSummary();
+    pacer.cleanup();
+    bool halted = engine.halted;
     engine.cleanup();
     glfwDestroyWindow(engine.window);
     glfwTerminate();
-    return 0;
+    return halted ? EXIT_FAILURE : 0;
 }
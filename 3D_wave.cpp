@@ -1,267 +1,8 @@
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
-#include <glm/glm.hpp>
-
-#include <iostream>
-#include <string>
-#include <vector>
-#include <cmath>
-
-#include "em_common.h"
-#include "shader_utils.h"
-#include "camera.h"
-
-// ── Window ──
-constexpr int WIDTH  = 1280;
-constexpr int HEIGHT = 720;
-
-// ── Grid ──
-constexpr int NX = 128;
-constexpr int NY = 128;
-constexpr int NZ = 128;
-constexpr int GRID_SIZE = NX * NY * NZ;
-
-// ── Simulation ──
-constexpr int   STEPS_PER_FRAME = 1;
-constexpr float SOURCE_FREQ     = 0.06f;  // normalized (wavelength ~ 17 cells)
-constexpr float SOURCE_AMP      = 1.0f;
-
-// ── State ──
-Camera3D camera;
-int renderComponent = 2;  // default: Ez
-int sliceAxis       = 0;  // default: XY
-int sliceIndex      = NZ / 2;
-
-const char* componentNames[] = {"Ex", "Ey", "Ez", "|E|", "Hx", "Hy", "Hz"};
-const char* axisNames[]      = {"XY", "XZ", "YZ"};
-
-int getSliceMax() {
-    if (sliceAxis == 0) return NZ - 1;
-    if (sliceAxis == 1) return NY - 1;
-    return NX - 1;
-}
-
-// ─────────────────────────────────────────────────────────────────────────────
-// Engine — owns all OpenGL state, following kavan010/black_hole architecture
-// ─────────────────────────────────────────────────────────────────────────────
-struct Engine {
-    GLFWwindow* window = nullptr;
-
-    // Programs
-    GLuint computeProgram = 0;
-    GLuint renderProgram  = 0;
-
-    // SSBOs (6 field components on the GPU)
-    GLuint ssbo[6] = {};  // Ex, Ey, Ez, Hx, Hy, Hz
-
-    // UBO
-    GLuint simParamsUBO = 0;
-
-    // Fullscreen quad
-    GLuint quadVAO = 0;
-    GLuint quadVBO = 0;
-
-    // Cached uniform locations — render program
-    GLint loc_nx               = -1;
-    GLint loc_ny               = -1;
-    GLint loc_nz               = -1;
-    GLint loc_field_scale      = -1;
-    GLint loc_render_component = -1;
-    GLint loc_slice_axis       = -1;
-    GLint loc_slice_index      = -1;
-    GLint loc_aspect_ratio     = -1;
-
-    // Cached uniform locations — compute program
-    GLint loc_updateStep = -1;
-
-    // ── Initialisation ──────────────────────────────────────────────────────
-
-    void init() {
-        initWindow();
-        initShaders();
-        initBuffers();
-        initQuad();
-        cacheUniformLocations();
-    }
-
-    void initWindow() {
-        if (!glfwInit()) {
-            std::cerr << "Failed to initialise GLFW\n";
-            exit(EXIT_FAILURE);
-        }
-
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-        window = glfwCreateWindow(WIDTH, HEIGHT, "EM Wave - 3D FDTD", nullptr, nullptr);
-        if (!window) {
-            std::cerr << "Failed to create GLFW window\n";
-            glfwTerminate();
-            exit(EXIT_FAILURE);
-        }
-        glfwMakeContextCurrent(window);
-        glfwSwapInterval(1);  // vsync
-
-        glewExperimental = GL_TRUE;
-        if (glewInit() != GLEW_OK) {
-            std::cerr << "Failed to initialise GLEW\n";
-            exit(EXIT_FAILURE);
-        }
-
-        std::cout << "OpenGL " << glGetString(GL_VERSION) << "\n";
-        std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
-    }
-
-    void initShaders() {
-        computeProgram = shader::createComputeProgram("shaders/maxwell3d.comp");
-        renderProgram  = shader::createProgram("shaders/field.vert",
-                                               "shaders/slice3d.frag");
-    }
-
-    void initBuffers() {
-        std::vector<float> zeros(GRID_SIZE, 0.0f);
-
-        for (int i = 0; i < 6; ++i) {
-            glGenBuffers(1, &ssbo[i]);
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo[i]);
-            glBufferData(GL_SHADER_STORAGE_BUFFER,
-                         GRID_SIZE * sizeof(float),
-                         zeros.data(), GL_DYNAMIC_COPY);
-            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, ssbo[i]);
-        }
-
-        // SimParams3D UBO at binding 0
-        glGenBuffers(1, &simParamsUBO);
-        glBindBuffer(GL_UNIFORM_BUFFER, simParamsUBO);
-        glBufferData(GL_UNIFORM_BUFFER, sizeof(SimParams3D), nullptr,
-                     GL_DYNAMIC_DRAW);
-        glBindBufferBase(GL_UNIFORM_BUFFER, 0, simParamsUBO);
-    }
-
-    void initQuad() {
-        // clang-format off
-        float verts[] = {
-        //  pos (xy)       texcoord (uv)
-            -1.f,  1.f,   0.f, 1.f,
-            -1.f, -1.f,   0.f, 0.f,
-             1.f, -1.f,   1.f, 0.f,
-
-            -1.f,  1.f,   0.f, 1.f,
-             1.f, -1.f,   1.f, 0.f,
-             1.f,  1.f,   1.f, 1.f,
-        };
-        // clang-format on
-
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-
-        // location 0 — position (vec2)
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE,
-                              4 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-
-        // location 1 — texcoord (vec2)
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE,
-                              4 * sizeof(float),
-                              (void*)(2 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-
-        glBindVertexArray(0);
-    }
-
-    void cacheUniformLocations() {
-        loc_nx               = glGetUniformLocation(renderProgram, "nx");
-        loc_ny               = glGetUniformLocation(renderProgram, "ny");
-        loc_nz               = glGetUniformLocation(renderProgram, "nz");
-        loc_field_scale      = glGetUniformLocation(renderProgram, "field_scale");
-        loc_render_component = glGetUniformLocation(renderProgram, "render_component");
-        loc_slice_axis       = glGetUniformLocation(renderProgram, "slice_axis");
-        loc_slice_index      = glGetUniformLocation(renderProgram, "slice_index");
-        loc_aspect_ratio     = glGetUniformLocation(renderProgram, "aspect_ratio");
-
-        loc_updateStep = glGetUniformLocation(computeProgram, "updateStep");
-    }
-
-    // ── Per-frame work ──────────────────────────────────────────────────────
-
-    void uploadSimParams(int timestep) {
-        SimParams3D p{};
-        p.nx               = NX;
-        p.ny               = NY;
-        p.nz               = NZ;
-        p.source_x         = NX / 2;
-        p.source_y         = NY / 2;
-        p.source_z         = NZ / 2;
-        p.dx               = em::DX;
-        p.dt               = em::DT_3D;
-        p.time             = timestep * em::DT_3D;
-        p.source_freq      = SOURCE_FREQ;
-        p.source_amp       = SOURCE_AMP;
-        p.field_scale      = 1.0f;
-        p.timestep         = timestep;
-        p.render_component = renderComponent;
-        p.slice_axis       = sliceAxis;
-        p.slice_index      = sliceIndex;
-
-        glBindBuffer(GL_UNIFORM_BUFFER, simParamsUBO);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SimParams3D), &p);
-    }
-
-    void updateFields(int timestep) {
-        glUseProgram(computeProgram);
-        uploadSimParams(timestep);
+#include "wave3d.h"
 
-        GLuint gx = (NX + 7) / 8;
-        GLuint gy = (NY + 7) / 8;
-        GLuint gz = (NZ + 7) / 8;
-
-        // Pass 1 — H field update
-        glUniform1i(loc_updateStep, 0);
-        glDispatchCompute(gx, gy, gz);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-
-        // Pass 2 — E field update + source + absorbing boundary
-        glUniform1i(loc_updateStep, 1);
-        glDispatchCompute(gx, gy, gz);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    }
-
-    void render() {
-        glUseProgram(renderProgram);
-
-        int winW, winH;
-        glfwGetFramebufferSize(window, &winW, &winH);
-        float aspect = (winH > 0) ? static_cast<float>(winW) / winH : 1.0f;
-
-        glUniform1i(loc_nx, NX);
-        glUniform1i(loc_ny, NY);
-        glUniform1i(loc_nz, NZ);
-        glUniform1f(loc_field_scale, 15.0f);
-        glUniform1i(loc_render_component, renderComponent);
-        glUniform1i(loc_slice_axis, sliceAxis);
-        glUniform1i(loc_slice_index, sliceIndex);
-        glUniform1f(loc_aspect_ratio, aspect);
-
-        glBindVertexArray(quadVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-    }
-
-    // ── Cleanup ─────────────────────────────────────────────────────────────
-
-    void cleanup() {
-        for (int i = 0; i < 6; ++i)
-            glDeleteBuffers(1, &ssbo[i]);
-        glDeleteBuffers(1, &simParamsUBO);
-        glDeleteVertexArrays(1, &quadVAO);
-        glDeleteBuffers(1, &quadVBO);
-        glDeleteProgram(computeProgram);
-        glDeleteProgram(renderProgram);
-    }
-};
+// 3D entry point: window, key handling and headless / CPU runs around
+// the Engine in wave3d.h
+using namespace wave3d;
 
 // ─────────────────────────────────────────────────────────────────────────────
 // Keyboard handler (separate from camera, handles simulation controls)
@@ -306,17 +47,310 @@ void keyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int
             renderComponent = (renderComponent + 1) % 7;
             break;
 
+        // Toggle the raymarched volume view: V
+        case GLFW_KEY_V:
+            volumeView = !volumeView;
+            if (volumeView) arrowView = false;
+            break;
+
+        // Toggle the field arrows: A
+        case GLFW_KEY_A:
+            arrowView = !arrowView;
+            if (arrowView) volumeView = false;
+            break;
+
+        // Move a medium live: Tab selects, J/L K/I U/O nudge along x, y, z
+        case GLFW_KEY_TAB:
+            if (scene.media.empty()) break;
+            movedObject = (movedObject + 1) % int(scene.media.size());
+            std::cout << "Move: object " << movedObject << " ("
+                      << scene.media[movedObject].spec << ") selected\n";
+            break;
+        case GLFW_KEY_J: --nudge[0]; break;
+        case GLFW_KEY_L: ++nudge[0]; break;
+        case GLFW_KEY_K: --nudge[1]; break;
+        case GLFW_KEY_I: ++nudge[1]; break;
+        case GLFW_KEY_U: --nudge[2]; break;
+        case GLFW_KEY_O: ++nudge[2]; break;
+
+        // Re-read the scene file (grid size, steps per frame, source)
+        case GLFW_KEY_F5:
+            reloadScene = true;
+            break;
+
+        // Replay: play / pause and frame-by-frame scrubbing
+        case GLFW_KEY_SPACE:
+            replayPlaying = !replayPlaying;
+            break;
+        case GLFW_KEY_RIGHT:
+            replayPlaying = false;
+            ++replayScrub;
+            break;
+        case GLFW_KEY_LEFT:
+            replayPlaying = false;
+            --replayScrub;
+            break;
+
         default:
             break;
     }
 }
 
+// ─────────────────────────────────────────────────────────────────────────────
+// Headless batch — back-to-back FDTD steps, no render pass, no swap
+// ─────────────────────────────────────────────────────────────────────────────
+void runHeadless(Engine& engine, int firstStep, int lastStep) {
+    const char* precisionNames[] = {"fp32", "fp16", "mixed"};
+    int steps = std::max(lastStep - firstStep, 0);
+    std::cout << "Headless: " << steps << " steps on "
+              << scene.nx << "x" << scene.ny << "x" << scene.nz << " grid"
+              << (engine.fused ? " (fused H+E)" : "")
+              << (engine.fieldPrecision != grid::PRECISION_FP32
+                      ? std::string(" (") + precisionNames[engine.fieldPrecision] + " storage)"
+                      : std::string()) << "\n";
+
+    glFinish();
+    double start = glfwGetTime();
+
+    // Frames of stepsPerFrame steps, so GPU timers see the same cadence as
+    // the windowed loop
+    for (int t = firstStep; t < lastStep; t += scene.stepsPerFrame) {
+        int n = std::min(scene.stepsPerFrame, lastStep - t);
+        engine.timers.beginFrame();
+        engine.step(t, n);
+        engine.snapshotAfter(t, t + n);
+        engine.checkpointAfter(t, t + n);
+        engine.statsAfter(t, t + n);
+        engine.timers.endFrame(n);
+        if (engine.halted) {
+            steps = t + n - firstStep;
+            break;
+        }
+    }
+
+    glFinish();  // wait for the GPU so the timing covers all queued work
+    double elapsed = glfwGetTime() - start;
+
+    cli::printThroughput(steps, elapsed, static_cast<long long>(scene.cells()));
+    engine.activeTiles.printStatus();
+    engine.finishStats();
+    engine.fieldStats.printSummary();
+}
+
+// Rerun the same batch with fp32 storage (everything else unchanged) and
+// report how far the reduced-precision fields drifted from it
+void reportPrecisionError(const std::vector<float>& fields, const cli::RunOptions& opts) {
+    const char* labels[] = {"fp32", "fp16", "mixed"};
+
+    cli::RunOptions refOpts = opts;
+    refOpts.precision   = grid::PRECISION_FP32;
+    refOpts.compareFp32 = false;
+    refOpts.snapshotEvery = 0;
+    refOpts.checkpointPath.clear();
+    refOpts.dftProbes.clear();
+    refOpts.ntff = false;
+    refOpts.statsEvery = 0;
+
+    std::cout << "\nReference: " << opts.steps << " steps with fp32 storage\n";
+    Engine ref;
+    ref.init(refOpts);
+    ref.step(0, opts.steps);
+    std::vector<float> refFields = ref.readFields();
+    ref.cleanup();
+    glfwDestroyWindow(ref.window);
+    glfwTerminate();
+
+    precision::printReport(fields, refFields, scene.cells(), labels[opts.precision]);
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// CPU backend — the same batch on the host solver (cpu_fdtd.h), or the same
+// batch used as a reference for the GPU fields
+// ─────────────────────────────────────────────────────────────────────────────
+void runCpuSteps(cpu::Solver3D& solver, const cli::RunOptions& opts) {
+    Engine host;  // never init()ed: only supplies materials and parameters
+    host.useCpml          = opts.cpml;
+    host.cpmlParams.width = CPML_WIDTH;
+    host.initCpuSolver(solver, opts.threads);
+
+    std::cout << "CPU: " << opts.steps << " steps on " << scene.nx << "x" << scene.ny << "x"
+              << scene.nz << " grid, " << solver.pool.threads() << " threads, "
+              << cpu::isaName() << " x " << cpu::Vec::N << " lanes\n";
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < opts.steps; ++t) solver.step(t);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    cli::printThroughput(opts.steps, elapsed.count(), static_cast<long long>(scene.cells()));
+}
+
+// Run the GPU batch again on the CPU and check the fields agree
+bool reportCpuMatch(const std::vector<float>& fields, const cli::RunOptions& opts) {
+    std::cout << "\nReference: CPU solver\n";
+    cpu::Solver3D solver;
+    runCpuSteps(solver, opts);
+    return cpu::reportMatch(fields, solver.fields, "3D Ex..Hz");
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Replay — a recording streamed back through the slice renderer, no solver
+// ─────────────────────────────────────────────────────────────────────────────
+int runReplay(cli::RunOptions opts) {
+    fieldfile::Reader file;
+    if (!file.open(opts.replayPath)) exit(EXIT_FAILURE);
+
+    // The recording fixes the grid; fp32 SoA bricks let decoded chunks
+    // upload as whole bricks
+    const SimParams3D& p = file.header.params;
+    scene.nx         = file.header.dims[0];
+    scene.ny         = file.header.dims[1];
+    scene.nz         = file.header.dims[2];
+    scene.sourceFreq = p.source_freq;
+    scene.sourceAmp  = p.source_amp;
+    opts.fieldLayout   = grid::LAYOUT_SOA;
+    opts.fieldIndex    = grid::INDEX_BRICK;
+    opts.precision     = grid::PRECISION_FP32;
+    opts.fusedSteps    = 0;
+    opts.activeTiles   = false;
+    opts.cpml          = false;
+    opts.snapshotEvery = 0;
+    opts.statsEvery    = 0;
+    opts.headless      = false;
+    opts.dftProbes.clear();
+    opts.ntff = false;
+    opts.fitVram = false;
+    opts.recordPath.clear();
+    sliceIndex = scene.nz / 2;
+
+    Engine engine;
+    engine.init(opts);
+    setupCamera3DCallbacks(engine.window, &camera);
+    glfwSetKeyCallback(engine.window, keyCallback);
+
+    std::cout << "\n=== Replay controls ===\n"
+              << "  Space     : play / pause\n"
+              << "  Left/Right: previous / next frame\n"
+              << "  1/2/3, +/-, C: slice axis, slice plane, component\n"
+              << "  ESC       : quit\n\n";
+
+    const int frames   = int(file.frames.size());
+    int    frame       = 0;
+    int    loaded[4]   = {-1, -1, -1, -1};  // frame, axis, slice, component on the GPU
+    double lastAdvance = glfwGetTime();
+    double lastFPSTime = lastAdvance;
+    int    frameCount  = 0;
+
+    while (!glfwWindowShouldClose(engine.window)) {
+        double now = glfwGetTime();
+        if (replayPlaying && now - lastAdvance >= REPLAY_FRAME_TIME) {
+            frame       = (frame + 1) % frames;
+            lastAdvance = now;
+        }
+        frame       = ((frame + replayScrub) % frames + frames) % frames;
+        replayScrub = 0;
+
+        // Re-stream only when what the slice shows changed
+        int want[4] = {frame, sliceAxis, sliceIndex, renderComponent};
+        bool changed = !std::equal(want, want + 4, loaded);
+        if (changed) {
+            engine.loadReplayFrame(file, frame);
+            std::copy(want, want + 4, loaded);
+        }
+
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        engine.render();
+
+        ++frameCount;
+        if (changed || now - lastFPSTime >= 1.0) {
+            std::string title = "EM Wave - 3D replay | frame "
+                + std::to_string(frame + 1) + "/" + std::to_string(frames) + " | Step "
+                + std::to_string(file.frames[frame].step) + " | "
+                + componentNames[renderComponent] + " "
+                + axisNames[sliceAxis] + " slice="
+                + std::to_string(sliceIndex) + (replayPlaying ? "" : " | paused");
+            glfwSetWindowTitle(engine.window, title.c_str());
+            if (now - lastFPSTime >= 1.0) {
+                frameCount  = 0;
+                lastFPSTime = now;
+            }
+        }
+
+        glfwSwapBuffers(engine.window);
+        glfwPollEvents();
+    }
+
+    engine.cleanup();
+    file.close();
+    glfwDestroyWindow(engine.window);
+    glfwTerminate();
+    return 0;
+}
+
 // ─────────────────────────────────────────────────────────────────────────────
 // main
 // ─────────────────────────────────────────────────────────────────────────────
-int main() {
+int main(int argc, char** argv) {
+    cli::RunOptions opts = cli::parse(argc, argv, cli::APP_3D);
+    if (!opts.replayPath.empty())
+        return runReplay(opts);
+
+    // A restart takes the grid, source and storage variant from the checkpoint
+    checkpoint::Header   restart;
+    std::vector<uint8_t> restartState;
+    if (!opts.restartPath.empty()) {
+        if (!checkpoint::read(opts.restartPath, restart, restartState))
+            exit(EXIT_FAILURE);
+        opts.fieldLayout = grid::FieldLayout(restart.fieldLayout);
+        opts.fieldIndex  = grid::FieldIndex(restart.fieldIndex);
+        opts.precision   = grid::FieldPrecision(restart.fieldPrecision);
+        opts.cpml        = restart.cpml != 0;
+        opts.fusedSteps  = restart.fused ? std::max(opts.fusedSteps, 1) : 0;
+        opts.compareFp32 = false;  // the reference would start from zero fields
+        opts.fitVram     = false;  // nor can the grid shrink
+    }
+
+    int boundaryWidth = opts.cpml ? CPML_WIDTH : 0;
+    if (!config::resolve(defaultScene(), opts, boundaryWidth, true, scene))
+        exit(EXIT_FAILURE);
+    if (!opts.restartPath.empty()) {
+        scene.nx         = restart.dims[0];
+        scene.ny         = restart.dims[1];
+        scene.nz         = restart.dims[2];
+        scene.sourceFreq = restart.sourceFreq;
+        scene.sourceAmp  = restart.sourceAmp;
+    }
+    sliceIndex = scene.nz / 2;
+
+    if (opts.cpuBackend) {
+        cpu::Solver3D solver;
+        runCpuSteps(solver, opts);
+        return 0;
+    }
+
     Engine engine;
-    engine.init();
+    engine.init(opts);
+
+    int timestep = 0;
+    if (!opts.restartPath.empty()) {
+        timestep = engine.restoreCheckpoint(restart, restartState);
+        restartState = {};
+    }
+
+    if (opts.headless) {
+        runHeadless(engine, timestep, opts.steps);
+        engine.reportTimers(opts.profilePath);
+        engine.writeProbes(opts.dftPath, opts.steps);
+        std::vector<float> fields;
+        if (opts.compareFp32 || opts.compareCpu) fields = engine.readFields();
+        bool halted = engine.halted;
+        engine.cleanup();
+        glfwDestroyWindow(engine.window);
+        glfwTerminate();
+
+        if (opts.compareFp32) reportPrecisionError(fields, opts);
+        if (opts.compareCpu && !reportCpuMatch(fields, opts)) return EXIT_FAILURE;
+        return halted ? EXIT_FAILURE : 0;
+    }
 
     // Set up camera callbacks (mouse orbit, scroll zoom)
     setupCamera3DCallbacks(engine.window, &camera);
@@ -325,15 +359,21 @@ int main() {
     glfwSetKeyCallback(engine.window, keyCallback);
 
     std::cout << "\n=== Controls ===\n"
-              << "  Mouse drag: orbit camera (unused in slice mode)\n"
-              << "  Scroll: zoom (unused in slice mode)\n"
+              << "  Mouse drag: orbit camera (volume view)\n"
+              << "  Scroll: zoom (volume view)\n"
               << "  1/2/3: slice axis (XY/XZ/YZ)\n"
               << "  +/-  : move slice plane\n"
               << "  C    : cycle field component\n"
+              << "  V    : toggle volume view\n"
+              << "  A    : toggle arrow view (E, or H for the H components)\n"
               << "  R    : reset camera\n"
+              << "  Tab  : select a medium; J/L K/I U/O move it along x / y / z\n"
+              << "  F5   : reload scene file\n"
               << "  ESC  : quit\n\n";
 
-    int    timestep    = 0;
+    pacing::Pacer pacer;
+    pacer.start(opts.frameBudgetMs, scene.stepsPerFrame);
+
     double lastFPSTime = glfwGetTime();
     int    frameCount  = 0;
 
@@ -341,12 +381,39 @@ int main() {
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        for (int i = 0; i < STEPS_PER_FRAME; ++i) {
-            engine.updateFields(timestep);
-            ++timestep;
+        engine.timers.beginFrame();
+
+        // F5: re-read the scene; a new grid size restarts from step 0
+        if (reloadScene) {
+            reloadScene = false;
+            config::Scene next;
+            if (config::resolve(defaultScene(), opts, boundaryWidth, true, next) &&
+                engine.applyScene(next))
+                timestep = 0;
+            pacer.restart(scene.stepsPerFrame);
         }
+        // Tab / J L K I U O: move the selected medium, repainting only its box
+        if ((nudge[0] || nudge[1] || nudge[2]) && movedObject < int(scene.media.size()))
+            engine.moveObject(size_t(movedObject), nudge);
+        nudge[0] = nudge[1] = nudge[2] = 0;
+        pacer.beginFrame();
+        int steps = pacer.enabled ? pacer.steps : scene.stepsPerFrame;
+        if (engine.halted) steps = 0;  // watchdog: keep showing the last fields
+
+        engine.mirrorComponent = volumeView ? renderComponent : -1;
+        engine.showArrows      = arrowView;
+
+        pacer.beginSolve();
+        engine.step(timestep, steps);
+        pacer.endSolve();
+        engine.snapshotAfter(timestep, timestep + steps);
+        engine.checkpointAfter(timestep, timestep + steps);
+        engine.statsAfter(timestep, timestep + steps);
+        timestep += steps;
 
         engine.render();
+        engine.timers.endFrame(steps);
+        pacer.endFrame(steps);
 
         // FPS + status in title bar
         ++frameCount;
@@ -355,9 +422,16 @@ int main() {
             std::string title = "EM Wave - 3D FDTD | "
                 + std::to_string(frameCount) + " fps | Step "
                 + std::to_string(timestep) + " | "
-                + componentNames[renderComponent] + " "
-                + axisNames[sliceAxis] + " slice="
-                + std::to_string(sliceIndex);
+                + (arrowView ? std::string(renderComponent >= 4 ? "H arrows" : "E arrows")
+                   : componentNames[renderComponent] + std::string(" ")
+                         + (volumeView ? std::string("volume")
+                                       : axisNames[sliceAxis] + std::string(" slice=")
+                                             + std::to_string(sliceIndex)));
+            title += " | " + pacer.overlay(now - lastFPSTime);
+            if (engine.fieldStats.enabled)
+                title += " | " + engine.fieldStats.overlay(engine.exposure.scale);
+            if (engine.halted) title += " | HALTED (watchdog)";
+            if (engine.timers.enabled) title += " | " + engine.timers.overlay();
             glfwSetWindowTitle(engine.window, title.c_str());
             frameCount  = 0;
             lastFPSTime = now;
@@ -365,10 +439,19 @@ int main() {
 
         glfwSwapBuffers(engine.window);
         glfwPollEvents();
+
+        if (opts.steps > 0 && timestep >= opts.steps)
+            glfwSetWindowShouldClose(engine.window, GLFW_TRUE);
     }
 
+    engine.reportTimers(opts.profilePath);
+    engine.writeProbes(opts.dftPath, timestep);
+    engine.fieldStats.printSummary();
+    pacer.printSummary();
+    pacer.cleanup();
+    bool halted = engine.halted;
     engine.cleanup();
     glfwDestroyWindow(engine.window);
     glfwTerminate();
-    return 0;
+    return halted ? EXIT_FAILURE : 0;
 }
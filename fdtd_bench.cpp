@@ -0,0 +1,970 @@
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <iomanip>
+
+#include "em_common.h"
+#include "cli.h"
+#include "config.h"
+#include "wave2d.h"
+#include "wave3d.h"
+
+// ─────────────────────────────────────────────────────────────────────────────
+// fdtd_bench — headless throughput matrix over both solvers, with a check of
+// the fields next to every timing
+//
+// Each case's fields after the run are checked against the fp32 two-pass
+// kernel on the same grid and boundary (the variants only reorder or narrow
+// the same update), and against stored golden checksums and field samples
+// per GPU/driver (--write-golden / --golden). --physics adds analytic
+// references on the 2D solver: the point source's cylindrical wave against
+// |H0(kr)|, and the reflection of each boundary against a grid too large to
+// reflect in time.
+// Any failed check makes the exit status non-zero.
+//
+// The solvers come from wave2d.h / wave3d.h, the same Engines the entry
+// points run.
+// ─────────────────────────────────────────────────────────────────────────────
+
+// ── Matrix defaults ──
+const int SIZES_2D[] = {256, 512, 1024, 2048, 4096};  // cells per axis
+const int SIZES_3D[] = {64, 128, 256, 512};
+constexpr int DEFAULT_WARMUP  = 10;    // steps run before the timed batch
+constexpr int DEFAULT_STEPS   = 100;   // timed steps per case
+constexpr int DEFAULT_MAX_MEM = 3072;  // MB; larger cases are reported as skipped
+
+// ── Field checks ──
+// Relative L2 of a case's fields minus the reference case's, per precision
+constexpr double REF_TOLERANCE_FP32  = 1e-5;
+constexpr double REF_TOLERANCE_FP16  = 2e-2;
+constexpr double REF_TOLERANCE_MIXED = 1e-3;
+constexpr int    GOLDEN_SAMPLES      = 4096;  // field values stored per golden case
+constexpr double GOLDEN_TOLERANCE    = 1e-6;  // relative L2 of the sample difference (and the
+                                              // norm's change): rounding
+constexpr int    REFERENCE_MAX_MB    = 1024;  // host copy kept of the reference fields
+constexpr int    SOURCE_GAP          = 20;    // 2D: cells between the source and the absorber
+
+struct BenchOptions {
+    int         warmup  = DEFAULT_WARMUP;
+    int         steps   = DEFAULT_STEPS;
+    int         maxMemMB = DEFAULT_MAX_MEM;
+    bool        run2d   = true;
+    bool        run3d   = true;
+    bool        quick   = false;  // two smallest sizes per dimension
+    bool        verbose = false;  // keep the engines' init output
+    bool        physics = false;  // analytic checks after the matrix
+    std::string outPath;          // .json (default) or .csv
+    std::string label;            // free-form tag, e.g. a commit or driver version
+    std::string goldenPath;       // checksums to compare against
+    std::string writeGoldenPath;  // checksums to store
+};
+
+// One point of the matrix: the app flags it runs with plus the grid size
+struct Case {
+    bool        is3d = false;
+    int         n    = 0;
+    std::string kernel    = "two-pass";  // two-pass or fused
+    std::string layout    = "soa";
+    std::string index     = "linear";
+    std::string precision = "fp32";
+    std::string workgroup = "";          // empty = kernel default, "auto" = autotuned
+    std::string boundary  = "";          // empty = kernel default
+};
+
+// Field values at fixed positions — a case's record in the golden file
+struct FieldSample {
+    std::vector<size_t> at;     // component-major linear index (readFields order)
+    std::vector<float>  value;
+};
+
+struct Result {
+    Case        c;
+    std::string status = "ok";  // ok or skipped
+    std::string boundary;
+    std::string workgroup;      // as compiled
+    double      estMB     = 0.0;
+    double      wallMs    = 0.0;
+    double      gpuMs     = 0.0;
+    double      mcells    = 0.0;  // wall-clock Mcell-updates/s
+    double      gpuMcells = 0.0;  // GPU-timer Mcell-updates/s
+    double      gbs       = 0.0;  // at the engine's bytes per cell update
+    uint64_t    checksum  = 0;
+    double      l2        = 0.0;
+    FieldSample sample;             // for the golden file
+    double      refError  = -1.0;   // relative L2 against the reference case; -1 none
+    double      refTol    = 0.0;
+    bool        reference = false;  // the case the others of its grid are checked against
+    std::string golden    = "-";    // exact, close, differs, missing or - (no --golden)
+
+    bool passed() const {
+        return status != "ok" || ((refError < 0.0 || refError <= refTol) &&
+                                  golden != "differs" && golden != "missing");
+    }
+};
+
+std::string glRenderer, glVersion, glVendor;
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Matrix
+// ─────────────────────────────────────────────────────────────────────────────
+std::vector<Case> buildMatrix(const BenchOptions& b) {
+    std::vector<Case> cases;
+    int count2d = b.quick ? 2 : int(std::size(SIZES_2D));
+    int count3d = b.quick ? 2 : int(std::size(SIZES_3D));
+
+    for (int i = 0; b.run2d && i < count2d; ++i) {
+        Case c;
+        c.n      = SIZES_2D[i];
+        c.layout = c.index = "-";  // 3D storage options
+        for (const char* wg : {"16x16", "32x8", "8x8", "auto"}) {
+            c.workgroup = wg;
+            cases.push_back(c);
+        }
+        c.workgroup = "";
+        c.kernel    = "fused";
+        cases.push_back(c);
+    }
+
+    for (int i = 0; b.run3d && i < count3d; ++i) {
+        Case base;
+        base.is3d = true;
+        base.n    = SIZES_3D[i];
+
+        for (const char* wg : {"8x8x8", "16x8x4", "32x4x2", "4x4x4", "32x4x1/z8", "8x8x8/smem",
+                               "32x4x1/z8/smem", "auto"}) {
+            Case c = base;
+            c.workgroup = wg;
+            cases.push_back(c);
+        }
+        // Storage variants at the default workgroup
+        const char* storage[][3] = {
+            {"packed", "linear", "fp32"}, {"soa", "brick", "fp32"}, {"soa", "morton", "fp32"},
+            {"packed", "morton", "fp32"}, {"soa", "linear", "fp16"}, {"packed", "linear", "fp16"},
+            {"soa", "linear", "mixed"},
+        };
+        for (auto& s : storage) {
+            Case c = base;
+            c.layout = s[0]; c.index = s[1]; c.precision = s[2];
+            cases.push_back(c);
+        }
+        for (const char* layout : {"soa", "packed"}) {
+            Case c = base;
+            c.kernel = "fused";
+            c.layout = layout;
+            cases.push_back(c);
+        }
+    }
+    return cases;
+}
+
+std::string gridName(const Case& c) {
+    std::string g = std::to_string(c.n) + "x" + std::to_string(c.n);
+    return c.is3d ? g + "x" + std::to_string(c.n) : g;
+}
+
+cli::RunOptions parseArgs(std::vector<std::string> args, cli::App app) {
+    std::vector<char*> argv;
+    for (std::string& a : args) argv.push_back(&a[0]);
+    return cli::parse(int(argv.size()), argv.data(), app);
+}
+
+// The case as an app command line, so cli::parse applies the same
+// adjustments (fused -> sponge, ...) the entry points would
+cli::RunOptions caseOptions(const Case& c, const BenchOptions& b) {
+    std::vector<std::string> args = {"fdtd_bench", "--headless", "--dense",
+                                     "--grid", gridName(c), "--steps", std::to_string(b.steps),
+                                     "--steps-per-frame", std::to_string(b.steps),
+                                     "--stats-every", "0"};
+    if (c.kernel == "fused")  { args.push_back("--fused"); args.push_back(c.is3d ? "1" : "4"); }
+    if (c.workgroup.empty())  args.push_back("--no-autotune");  // the kernel default
+    else if (c.workgroup != "auto") { args.push_back("--workgroup"); args.push_back(c.workgroup); }
+    if (!c.boundary.empty())  { args.push_back("--boundary"); args.push_back(c.boundary); }
+    if (c.is3d) {
+        args.insert(args.end(), {"--layout", c.layout, "--index", c.index,
+                                 "--precision", c.precision});
+        return parseArgs(args, cli::APP_3D);
+    }
+    // 2D: the source SOURCE_GAP cells in from the absorbing layer of the
+    // boundary the case ends up with (fused -> sponge), so the wave is in
+    // the layer within the default steps on every grid and a wrong
+    // boundary update shows up in the fields. From the centre it would
+    // take about n steps to get there.
+    cli::RunOptions opts = parseArgs(args, cli::APP_2D);
+    int width = opts.cpml ? wave2d::CPML_WIDTH : wave2d::SPONGE_WIDTH;
+    args.insert(args.end(), {"--source", std::to_string(width + SOURCE_GAP) + ",c"});
+    return parseArgs(args, cli::APP_2D);
+}
+
+// Rough device footprint: field buffers (twice for the fused ping-pong),
+// material IDs and, with CPML, the psi slabs
+double estimateMB(const Case& c, const cli::RunOptions& opts) {
+    double cells     = c.is3d ? double(c.n) * c.n * c.n : double(c.n) * c.n;
+    double comps     = c.is3d ? 6.0 : 3.0;
+    double compBytes = (c.precision == "fp32") ? 4.0 : 2.0;
+    if (c.layout == "packed") comps = 8.0;  // vec4 E and H
+    double bytes = cells * (comps * compBytes * (opts.fusedSteps > 0 ? 2.0 : 1.0) + 2.0);
+    if (opts.cpml) {
+        int    axes = c.is3d ? 3 : 2;
+        double slab = 2.0 * 10 * (c.is3d ? double(c.n) * c.n : double(c.n));
+        bytes += axes * slab * (c.is3d ? 16.0 : 8.0);
+    }
+    return bytes / (1024.0 * 1024.0);
+}
+
+// FNV-1a over the float bit patterns, in linear cell order for every layout
+uint64_t fieldChecksum(const std::vector<float>& fields) {
+    uint64_t h = 1469598103934665603ull;
+    for (float v : fields) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, 4);
+        for (int k = 0; k < 4; ++k) {
+            h ^= (bits >> (8 * k)) & 0xffu;
+            h *= 1099511628211ull;
+        }
+    }
+    return h;
+}
+
+// About GOLDEN_SAMPLES of the nonzero values (every stride-th), with
+// their positions in the component-major linear order: a permuted,
+// mirrored or swapped field moves values off them even where its norm is
+// unchanged, and taking them where the wave is keeps a small wavefront on
+// a large grid covered. The stride is odd so the samples walk across rows
+// instead of down a column.
+FieldSample fieldSample(const std::vector<float>& fields) {
+    size_t nonzero = 0;
+    for (float v : fields) nonzero += v != 0.0f;
+    size_t stride = std::max<size_t>(nonzero / GOLDEN_SAMPLES, 1) | 1;
+    FieldSample out;
+    for (size_t i = 0, k = 0; i < fields.size(); ++i) {
+        if (fields[i] == 0.0f) continue;
+        if (k++ % stride) continue;
+        out.at.push_back(i);
+        out.value.push_back(fields[i]);
+    }
+    return out;
+}
+
+double fieldNorm(const std::vector<float>& fields) {
+    double sum = 0.0;
+    for (float v : fields) sum += double(v) * v;
+    return std::sqrt(sum);
+}
+
+// Engines print their setup; keep the table readable unless --verbose
+struct QuietCout {
+    std::streambuf* saved = nullptr;
+    explicit QuietCout(bool quiet) { if (quiet) saved = std::cout.rdbuf(nullptr); }
+    ~QuietCout() { if (saved) std::cout.rdbuf(saved); }
+};
+
+// ─────────────────────────────────────────────────────────────────────────────
+// One case: warm-up, timed batch (wall clock around glFinish, plus the GPU
+// timers as one frame), then a readback for the checksum
+// ─────────────────────────────────────────────────────────────────────────────
+void recordRenderer() {
+    if (!glRenderer.empty()) return;
+    glRenderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    glVersion  = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    glVendor   = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+}
+
+template <typename EngineT>
+void runEngine(EngineT& engine, const config::Scene& scene, const BenchOptions& b, Result& r,
+               std::vector<float>* keep) {
+    recordRenderer();
+    r.boundary = engine.useCpml ? "cpml" : "sponge";
+
+    engine.step(0, b.warmup);
+    glFinish();
+
+    double start = glfwGetTime();
+    engine.timers.beginFrame();
+    engine.step(b.warmup, b.steps);
+    engine.timers.endFrame(b.steps);
+    glFinish();
+    r.wallMs = (glfwGetTime() - start) * 1.0e3;
+
+    engine.timers.finish();
+    long long timedSteps = 0;
+    engine.timers.solverTotals(r.gpuMs, timedSteps);
+
+    double cellSteps = double(scene.cells()) * b.steps;
+    r.mcells    = (r.wallMs > 0.0) ? cellSteps / (r.wallMs * 1.0e3) : 0.0;
+    r.gpuMcells = (r.gpuMs > 0.0) ? cellSteps / (r.gpuMs * 1.0e3) : 0.0;
+    double bestMcells = (r.gpuMcells > 0.0) ? r.gpuMcells : r.mcells;
+    r.gbs = bestMcells * 1.0e6 * engine.bytesPerCellUpdate() / 1.0e9;
+
+    std::vector<float> fields = engine.readFields();
+    r.checksum = fieldChecksum(fields);
+    r.l2       = fieldNorm(fields);
+    r.sample   = fieldSample(fields);
+    if (keep) *keep = std::move(fields);
+
+    engine.cleanup();
+    glfwDestroyWindow(engine.window);
+    glfwTerminate();
+}
+
+// `keep` (if set) receives the fields after the run
+Result runCase(const Case& c, const BenchOptions& b, std::vector<float>* keep = nullptr) {
+    Result r;
+    r.c = c;
+
+    QuietCout quiet(!b.verbose);
+    cli::RunOptions opts = caseOptions(c, b);
+    opts.gpuTimers = true;
+    r.estMB = estimateMB(c, opts);
+    if (r.estMB > b.maxMemMB) {
+        r.status = "skipped";
+        return r;
+    }
+
+    if (!c.is3d) {
+        int width = opts.cpml ? wave2d::CPML_WIDTH : 0;
+        if (!config::resolve(wave2d::defaultScene(), opts, width, false, wave2d::scene))
+            exit(EXIT_FAILURE);
+        wave2d::Engine engine;
+        engine.init(opts);
+        r.workgroup = engine.launchShape().name(false);
+        runEngine(engine, wave2d::scene, b, r, keep);
+    } else {
+        int width = opts.cpml ? wave3d::CPML_WIDTH : 0;
+        if (!config::resolve(wave3d::defaultScene(), opts, width, true, wave3d::scene))
+            exit(EXIT_FAILURE);
+        wave3d::Engine engine;
+        engine.init(opts);
+        r.workgroup = engine.launchShape().name(true);
+        runEngine(engine, wave3d::scene, b, r, keep);
+    }
+    if (c.kernel == "fused") r.workgroup = "fixed";  // fused kernels keep their shape
+    return r;
+}
+
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Field checks — each case against the reference case of its grid and
+// boundary, and against the golden checksums
+// ─────────────────────────────────────────────────────────────────────────────
+std::string hex64(uint64_t v) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+    return buf;
+}
+
+double refTolerance(const std::string& precision) {
+    if (precision == "fp16")  return REF_TOLERANCE_FP16;
+    if (precision == "mixed") return REF_TOLERANCE_MIXED;
+    return REF_TOLERANCE_FP32;
+}
+
+// The two-pass kernel on fp32 linear SoA storage: what every variant reorders
+bool isReference(const Case& c) {
+    return c.kernel == "two-pass" && c.precision == "fp32" &&
+           (!c.is3d || (c.layout == "soa" && c.index == "linear"));
+}
+
+// ||fields - reference|| / ||reference||
+double relativeError(const std::vector<float>& fields, const std::vector<float>& reference) {
+    if (fields.size() != reference.size()) return INFINITY;
+    double diff = 0.0, norm = 0.0;
+    for (size_t i = 0; i < fields.size(); ++i) {
+        double d = double(fields[i]) - reference[i];
+        diff += d * d;
+        norm += double(reference[i]) * reference[i];
+    }
+    return norm > 0.0 ? std::sqrt(diff / norm) : (diff > 0.0 ? INFINITY : 0.0);
+}
+
+// Reference fields of the current grid by boundary. A grid's cases run
+// back to back, so only one grid's are held; a boundary no reference case
+// of the matrix used (fused kernels run with the sponge) gets an untimed
+// reference run of its own.
+struct References {
+    std::string grid;
+    std::map<std::string, std::vector<float>> fields;
+
+    void check(Result& r, std::vector<float>& caseFields, const BenchOptions& b) {
+        if (r.status != "ok") return;
+        std::string g = std::string(r.c.is3d ? "3D " : "2D ") + gridName(r.c);
+        if (g != grid) {
+            fields.clear();
+            grid = g;
+        }
+        if (caseFields.size() * sizeof(float) > size_t(REFERENCE_MAX_MB) * 1024 * 1024) return;
+        r.refTol = refTolerance(r.c.precision);
+
+        auto it = fields.find(r.boundary);
+        if (it == fields.end()) {
+            if (isReference(r.c)) {
+                r.refError  = 0.0;
+                r.reference = true;
+                fields[r.boundary] = std::move(caseFields);
+                return;
+            }
+            Case c      = r.c;
+            c.kernel    = "two-pass";
+            c.precision = "fp32";
+            c.workgroup = "";
+            c.boundary  = r.boundary;
+            if (c.is3d) {
+                c.layout = "soa";
+                c.index  = "linear";
+            }
+            std::vector<float> reference;
+            if (runCase(c, b, &reference).status != "ok") return;
+            it = fields.emplace(r.boundary, std::move(reference)).first;
+        }
+        r.refError = relativeError(caseFields, it->second);
+    }
+};
+
+// One line per case:  dim grid kernel layout index precision workgroup
+// boundary steps  checksum l2  sample count and index:value pairs
+// Autotuned cases are keyed "auto": the tuner may pick another shape on
+// the next run, and every shape computes the same update.
+std::string goldenKey(const Result& r, const BenchOptions& b) {
+    const Case&       c  = r.c;
+    const std::string wg = c.workgroup == "auto" ? c.workgroup : r.workgroup;
+    std::ostringstream key;
+    key << (c.is3d ? "3D " : "2D ") << gridName(c) << " " << c.kernel << " " << c.layout << " "
+        << c.index << " " << c.precision << " " << (wg.empty() ? "-" : wg)
+        << " " << r.boundary << " " << b.warmup + b.steps;
+    return key.str();
+}
+
+struct Golden {
+    uint64_t    checksum = 0;
+    double      l2       = 0.0;
+    FieldSample sample;
+};
+
+// `fields` at `at`; empty if one lies outside (another grid)
+std::vector<float> valuesAt(const std::vector<float>& fields, const std::vector<size_t>& at) {
+    std::vector<float> out;
+    for (size_t i : at) {
+        if (i >= fields.size()) return {};
+        out.push_back(fields[i]);
+    }
+    return out;
+}
+
+std::map<std::string, Golden> loadGolden(const std::string& path) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open golden checksums: " << path << "\n";
+        exit(EXIT_FAILURE);
+    }
+    std::map<std::string, Golden> out;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream words(line);
+        std::vector<std::string> w{std::istream_iterator<std::string>(words),
+                                   std::istream_iterator<std::string>()};
+        char*  end   = nullptr;
+        size_t count = 0;
+        Golden g;
+        bool   ok    = w.size() >= 12;
+        if (ok) {
+            g.checksum = std::strtoull(w[9].c_str(), &end, 16);
+            g.l2       = std::atof(w[10].c_str());
+            count      = std::strtoull(w[11].c_str(), nullptr, 10);
+            ok         = !*end && w.size() == 12 + count;
+        }
+        for (size_t i = 0; ok && i < count; ++i) {
+            const char* pair = w[12 + i].c_str();
+            g.sample.at.push_back(std::strtoull(pair, &end, 10));
+            ok = *end == ':';
+            if (ok) g.sample.value.push_back(std::strtof(end + 1, nullptr));
+        }
+        if (!ok) {
+            std::cerr << "Bad golden line in " << path << ": " << line.substr(0, 120) << "\n";
+            exit(EXIT_FAILURE);
+        }
+        std::string key = w[0];
+        for (int i = 1; i < 9; ++i) key += " " + w[i];
+        out[key] = g;
+    }
+    return out;
+}
+
+// exact: same bits; close: the fields at the stored positions and the
+// norm within GOLDEN_TOLERANCE of the stored ones (a compiler or driver
+// reordering the arithmetic); differs: the fields changed; missing: the
+// file has no entry for the case, which fails it rather than letting a
+// stale file pass unchecked
+void checkGolden(Result& r, const std::vector<float>& fields,
+                 const std::map<std::string, Golden>& golden, const BenchOptions& b) {
+    if (r.status != "ok" || b.goldenPath.empty()) return;
+    auto it = golden.find(goldenKey(r, b));
+    if (it == golden.end()) {
+        r.golden = "missing";
+        return;
+    }
+    const Golden& g = it->second;
+    if (g.checksum == r.checksum)
+        r.golden = "exact";
+    else if (std::fabs(r.l2 - g.l2) <= GOLDEN_TOLERANCE * g.l2 &&
+             relativeError(valuesAt(fields, g.sample.at), g.sample.value) <= GOLDEN_TOLERANCE)
+        r.golden = "close";
+    else
+        r.golden = "differs";
+}
+
+bool writeGolden(const std::string& path, const BenchOptions& b, const std::vector<Result>& rows) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open golden output: " << path << "\n";
+        return false;
+    }
+    out << "# fdtd_bench golden fields on " << glRenderer << " (OpenGL " << glVersion << ")\n"
+        << "# dim grid kernel layout index precision workgroup boundary steps checksum l2"
+           " samples index:value...\n";
+    int count = 0;
+    for (const Result& r : rows) {
+        if (r.status != "ok") continue;
+        out << goldenKey(r, b) << " " << hex64(r.checksum) << " " << std::setprecision(17)
+            << r.l2 << " " << r.sample.at.size() << std::setprecision(9);
+        for (size_t i = 0; i < r.sample.at.size(); ++i)
+            out << " " << r.sample.at[i] << ":" << r.sample.value[i];
+        out << "\n";
+        ++count;
+    }
+    std::cout << "Golden: " << count << " cases written to " << path << "\n";
+    return true;
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Physics checks — the 2D solver against analytic references
+//
+// hankel:     a sine point source at the centre of a CPML grid. After the
+//             turn-on transient has left, the amplitude over one period,
+//             averaged per ring, must decay as |H0(kr)| = |J0 - i Y0| from one
+//             wavelength out to the absorber.
+// reflection: a Gaussian pulse next to the low-x boundary, traced at a probe
+//             between it and the boundary, against the same trace on a grid
+//             grown on every side far enough that its own boundary cannot
+//             answer before the trace ends. The difference is everything the
+//             test grid's boundary sent back, in dB of the trace's peak,
+//             reported with the graded profile's own normal-incidence design
+//             value (continuous theory, below what the discretization gives).
+// ─────────────────────────────────────────────────────────────────────────────
+constexpr int    HANKEL_GRID     = 256;
+constexpr int    HANKEL_SETTLE   = 1500;  // steps before the sampled period
+constexpr double HANKEL_LIMIT    = 1.0;   // % worst ring off |H0|
+constexpr int    REFLECT_GRID    = 128;
+constexpr int    REFLECT_PAD     = 160;   // cells added per side for the reference run
+constexpr int    REFLECT_STEPS   = 600;
+constexpr int    REFLECT_SOURCE  = 20;    // cells inside the boundary layer
+constexpr int    REFLECT_PROBE   = 5;
+constexpr double REFLECT_LIMIT_CPML   = -60.0;  // dB
+constexpr double REFLECT_LIMIT_SPONGE = -24.0;
+
+struct PhysicsCheck {
+    std::string name;
+    std::string grid;
+    std::string boundary;
+    std::string unit;
+    double      value  = 0.0;   // must not exceed limit
+    double      limit  = 0.0;
+    double      design = NAN;   // reflection: continuous-theory value
+    double      mcells = 0.0;   // wall clock, readbacks included
+
+    bool passed() const { return value <= limit; }
+};
+
+// `body(engine)` on a 2D engine with the app flags `args`; body returns the
+// steps it ran. Mcell-updates/s of the whole body.
+template <typename Fn>
+double run2d(const std::vector<std::string>& args, const BenchOptions& b, Fn body) {
+    std::vector<std::string> full = {"fdtd_bench", "--headless", "--dense", "--stats-every", "0"};
+    full.insert(full.end(), args.begin(), args.end());
+
+    QuietCout quiet(!b.verbose);
+    cli::RunOptions opts = parseArgs(full, cli::APP_2D);
+    int width = opts.cpml ? wave2d::CPML_WIDTH : 0;
+    if (!config::resolve(wave2d::defaultScene(), opts, width, false, wave2d::scene))
+        exit(EXIT_FAILURE);
+    wave2d::Engine engine;
+    engine.init(opts);
+    recordRenderer();
+
+    double start = glfwGetTime();
+    int    steps = body(engine);
+    glFinish();
+    double ms = (glfwGetTime() - start) * 1.0e3;
+
+    double cellSteps = double(wave2d::scene.cells()) * steps;
+    engine.cleanup();
+    glfwDestroyWindow(engine.window);
+    glfwTerminate();
+    return ms > 0.0 ? cellSteps / (ms * 1.0e3) : 0.0;
+}
+
+// `count` Ez values from cell `first`
+void readEz(const wave2d::Engine& engine, size_t first, size_t count, float* out) {
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, engine.ezSSBO);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, GLintptr(first * sizeof(float)),
+                       GLsizeiptr(count * sizeof(float)), out);
+}
+
+PhysicsCheck hankelCheck(const BenchOptions& b) {
+    const int    n      = HANKEL_GRID;
+    const size_t cells  = size_t(n) * n;
+    const double freq   = wave2d::DEFAULT_SOURCE_FREQ;
+    const int    period = int(std::lround(1.0 / (freq * em::DT)));
+    const double k      = 2.0 * M_PI * freq / em::DX;  // c = 1
+    const int    rMin   = int(std::ceil(1.0 / freq));  // a wavelength out
+    const int    rMax   = n / 2 - wave2d::CPML_WIDTH - 10;
+
+    PhysicsCheck p;
+    p.name     = "hankel";
+    p.grid     = std::to_string(n) + "x" + std::to_string(n);
+    p.boundary = "cpml";
+    p.unit     = "%";
+    p.limit    = HANKEL_LIMIT;
+
+    // Peak-to-peak over one period, which also drops what is left of the
+    // transient's slow tail
+    std::vector<float> lo(cells, INFINITY), hi(cells, -INFINITY), ez(cells);
+    p.mcells = run2d({"--grid", p.grid, "--boundary", "cpml", "--source", "c,c"}, b,
+                     [&](wave2d::Engine& engine) {
+        engine.step(0, HANKEL_SETTLE);
+        for (int t = 0; t < period; ++t) {
+            engine.step(HANKEL_SETTLE + t, 1);
+            readEz(engine, 0, cells, ez.data());
+            for (size_t i = 0; i < cells; ++i) {
+                lo[i] = std::min(lo[i], ez[i]);
+                hi[i] = std::max(hi[i], ez[i]);
+            }
+        }
+        return HANKEL_SETTLE + period;
+    });
+
+    // Amplitude over |H0| per cell, averaged per ring; the rings must agree
+    std::vector<double> sum(rMax + 1, 0.0);
+    std::vector<int>    count(rMax + 1, 0);
+    for (int y = 0; y < n; ++y)
+        for (int x = 0; x < n; ++x) {
+            double r    = std::hypot(double(x - n / 2), double(y - n / 2));
+            int    ring = int(std::lround(r));
+            if (ring < rMin || ring > rMax) continue;
+            double h  = std::hypot(std::cyl_bessel_j(0.0, k * r), std::cyl_neumann(0.0, k * r));
+            size_t i  = size_t(y) * n + x;
+            sum[ring] += 0.5 * (double(hi[i]) - lo[i]) / h;
+            ++count[ring];
+        }
+    double mean = 0.0;
+    for (int ring = rMin; ring <= rMax; ++ring) mean += sum[ring] / count[ring];
+    mean /= double(rMax - rMin + 1);
+    for (int ring = rMin; ring <= rMax; ++ring)
+        p.value = std::max(p.value, 100.0 * std::fabs(sum[ring] / count[ring] / mean - 1.0));
+    if (!(mean > 0.0)) p.value = INFINITY;
+    return p;
+}
+
+PhysicsCheck reflectionCheck(const std::string& boundary, const BenchOptions& b) {
+    const bool cpml  = boundary == "cpml";
+    const int  width = cpml ? wave2d::CPML_WIDTH : wave2d::SPONGE_WIDTH;
+    const int  n     = REFLECT_GRID;
+
+    PhysicsCheck p;
+    p.name     = "reflection";
+    p.grid     = std::to_string(n) + "x" + std::to_string(n);
+    p.boundary = boundary;
+    p.unit     = "dB";
+    p.limit    = cpml ? REFLECT_LIMIT_CPML : REFLECT_LIMIT_SPONGE;
+    // Round trip through the graded layer: exp(-2 integral of sigma), with
+    // CPML's sigmaMax = 0.8 (m + 1) / dx and the sponge's quadratic profile
+    double loss = cpml ? 2.0 * 0.8 * width
+                       : 2.0 * wave2d::SPONGE_SIGMA_MAX * width / 3.0;
+    p.design = 20.0 * std::log10(std::exp(-loss));
+
+    auto trace = [&](int pad, std::vector<float>& out) {
+        int         size   = n + 2 * pad;
+        int         y      = pad + n / 2;
+        int         probe  = pad + width + REFLECT_PROBE;
+        std::string source = std::to_string(pad + width + REFLECT_SOURCE) + "," +
+                             std::to_string(y) + ":wave=gauss";
+        out.assign(REFLECT_STEPS, 0.0f);
+        return run2d({"--grid", std::to_string(size) + "x" + std::to_string(size),
+                      "--boundary", boundary, "--source", source}, b,
+                     [&](wave2d::Engine& engine) {
+            for (int t = 0; t < REFLECT_STEPS; ++t) {
+                engine.step(t, 1);
+                readEz(engine, size_t(y) * size + probe, 1, &out[t]);
+            }
+            return REFLECT_STEPS;
+        });
+    };
+    std::vector<float> test, reference;
+    p.mcells = trace(0, test);
+    trace(REFLECT_PAD, reference);
+
+    double err = 0.0, peak = 0.0;
+    for (int t = 0; t < REFLECT_STEPS; ++t) {
+        err  = std::max(err, std::fabs(double(test[t]) - reference[t]));
+        peak = std::max(peak, std::fabs(double(reference[t])));
+    }
+    p.value = peak > 0.0 ? 20.0 * std::log10(std::max(err / peak, 1e-30)) : INFINITY;
+    return p;
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Output
+// ─────────────────────────────────────────────────────────────────────────────
+// JSON string escaping for the driver strings and label
+std::string quoted(const std::string& s) {
+    std::string out = "\"";
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') out += '\\';
+        if (static_cast<unsigned char>(ch) >= 0x20) out += ch;
+    }
+    return out + "\"";
+}
+
+// pass / FAIL, then the reference error ("ref" for the reference itself)
+// and the golden match
+std::string checkText(const Result& r) {
+    std::string text = r.passed() ? "pass" : "FAIL";
+    if (r.reference) {
+        text += " ref";
+    } else if (r.refError >= 0.0) {
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), " %.1e", r.refError);
+        text += buf;
+    }
+    if (r.golden != "-") text += " golden " + r.golden;
+    return text;
+}
+
+void printRow(const Result& r) {
+    const Case& c = r.c;
+    std::printf("%-2s %-14s %-8s %-6s %-6s %-5s %-14s ", c.is3d ? "3D" : "2D",
+                gridName(c).c_str(), c.kernel.c_str(), c.layout.c_str(), c.index.c_str(),
+                c.precision.c_str(), r.workgroup.empty() ? "-" : r.workgroup.c_str());
+    if (r.status != "ok")
+        std::printf("skipped (~%.0f MB)\n", r.estMB);
+    else
+        std::printf("%10.1f %10.1f %8.2f  %s  %s\n", r.mcells, r.gpuMcells, r.gbs,
+                    hex64(r.checksum).c_str(), checkText(r).c_str());
+    std::fflush(stdout);
+}
+
+void printPhysics(const PhysicsCheck& p) {
+    std::printf("   %-10s %-14s %-8s %10.1f %10.2f %-3s (limit %g", p.name.c_str(), p.grid.c_str(),
+                p.boundary.c_str(), p.mcells, p.value, p.unit.c_str(), p.limit);
+    if (!std::isnan(p.design)) std::printf(", design %.0f", p.design);
+    std::printf(")  %s\n", p.passed() ? "pass" : "FAIL");
+    std::fflush(stdout);
+}
+
+std::string utcTimestamp() {
+    std::time_t now = std::time(nullptr);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return buf;
+}
+
+bool writeResults(const std::string& path, const BenchOptions& b, const std::vector<Result>& rows,
+                  const std::vector<PhysicsCheck>& physics) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open benchmark output: " << path << "\n";
+        return false;
+    }
+    bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+
+    if (csv) {
+        out << "dim,grid,cells,kernel,layout,index,precision,workgroup,boundary,status,"
+               "warmup_steps,steps,wall_ms,gpu_ms,mcells_per_s,gpu_mcells_per_s,gb_per_s,"
+               "checksum,l2,ref_error,golden,check\n";
+        for (const Result& r : rows) {
+            const Case& c = r.c;
+            double cells = c.is3d ? double(c.n) * c.n * c.n : double(c.n) * c.n;
+            out << (c.is3d ? 3 : 2) << "," << gridName(c) << "," << size_t(cells) << ","
+                << c.kernel << "," << c.layout << "," << c.index << "," << c.precision << ","
+                << r.workgroup << "," << r.boundary << "," << r.status << ","
+                << b.warmup << "," << b.steps << "," << r.wallMs << "," << r.gpuMs << ","
+                << r.mcells << "," << r.gpuMcells << "," << r.gbs << ","
+                << (r.status == "ok" ? hex64(r.checksum) : "") << "," << r.l2 << ",";
+            if (r.refError >= 0.0) out << r.refError;
+            out << "," << r.golden << "," << (r.passed() ? "pass" : "fail") << "\n";
+        }
+    } else {
+        out << "{\n  \"schema\": 2,\n  \"label\": " << quoted(b.label)
+            << ",\n  \"date\": " << quoted(utcTimestamp())
+            << ",\n  \"gl_renderer\": " << quoted(glRenderer)
+            << ",\n  \"gl_version\": " << quoted(glVersion)
+            << ",\n  \"gl_vendor\": " << quoted(glVendor)
+            << ",\n  \"warmup_steps\": " << b.warmup << ",\n  \"steps\": " << b.steps
+            << ",\n  \"results\": [";
+        for (size_t i = 0; i < rows.size(); ++i) {
+            const Result& r = rows[i];
+            const Case&   c = r.c;
+            out << (i ? "," : "") << "\n    {\"dim\": " << (c.is3d ? 3 : 2)
+                << ", \"grid\": " << quoted(gridName(c)) << ", \"kernel\": " << quoted(c.kernel)
+                << ", \"layout\": " << quoted(c.layout) << ", \"index\": " << quoted(c.index)
+                << ", \"precision\": " << quoted(c.precision)
+                << ", \"workgroup\": " << quoted(r.workgroup)
+                << ", \"boundary\": " << quoted(r.boundary) << ", \"status\": " << quoted(r.status);
+            if (r.status == "ok") {
+                out << ", \"wall_ms\": " << r.wallMs << ", \"gpu_ms\": " << r.gpuMs
+                    << ", \"mcells_per_s\": " << r.mcells << ", \"gpu_mcells_per_s\": " << r.gpuMcells
+                    << ", \"gb_per_s\": " << r.gbs << ", \"checksum\": " << quoted(hex64(r.checksum))
+                    << ", \"l2\": " << r.l2 << ", \"golden\": " << quoted(r.golden)
+                    << ", \"check\": " << quoted(r.passed() ? "pass" : "fail");
+                if (r.refError >= 0.0)
+                    out << ", \"ref_error\": " << r.refError
+                        << ", \"ref_tolerance\": " << r.refTol;
+            } else {
+                out << ", \"estimated_mb\": " << r.estMB;
+            }
+            out << "}";
+        }
+        out << "\n  ],\n  \"physics\": [";
+        for (size_t i = 0; i < physics.size(); ++i) {
+            const PhysicsCheck& p = physics[i];
+            out << (i ? "," : "") << "\n    {\"check\": " << quoted(p.name)
+                << ", \"grid\": " << quoted(p.grid) << ", \"boundary\": " << quoted(p.boundary)
+                << ", \"mcells_per_s\": " << p.mcells << ", \"value\": " << p.value
+                << ", \"unit\": " << quoted(p.unit) << ", \"limit\": " << p.limit;
+            if (!std::isnan(p.design)) out << ", \"design\": " << p.design;
+            out << ", \"status\": " << quoted(p.passed() ? "pass" : "fail") << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+    std::cout << "Results: " << rows.size() << " cases written to " << path << "\n";
+    return true;
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// main
+// ─────────────────────────────────────────────────────────────────────────────
+void printUsage(const char* exe) {
+    std::cout << "Usage: " << exe << " [options]\n"
+              << "  --out FILE   write results as JSON (default) or CSV (.csv)\n"
+              << "  --steps N    timed steps per case (default " << DEFAULT_STEPS << ")\n"
+              << "  --warmup N   untimed steps before each case (default " << DEFAULT_WARMUP << ")\n"
+              << "  --only D     2d or 3d\n"
+              << "  --quick      two smallest grid sizes per dimension\n"
+              << "  --max-mem MB skip cases estimated above MB of buffers (default "
+              << DEFAULT_MAX_MEM << ")\n"
+              << "  --label S    tag stored with the results (code / driver version)\n"
+              << "  --golden F   compare each case's checksum and field sample with those in F\n"
+              << "  --write-golden F  store this run's checksums and samples in F (per GPU/driver)\n"
+              << "  --physics    run the analytic checks (Hankel decay, boundary reflection)\n"
+              << "  --verbose    keep the engines' setup output\n";
+}
+
+BenchOptions parseBench(int argc, char** argv) {
+    BenchOptions b;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--out") == 0 && i + 1 < argc) {
+            b.outPath = argv[++i];
+        } else if (std::strcmp(arg, "--steps") == 0 && i + 1 < argc) {
+            b.steps = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--warmup") == 0 && i + 1 < argc) {
+            b.warmup = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--only") == 0 && i + 1 < argc) {
+            std::string d = argv[++i];
+            if (d != "2d" && d != "3d") {
+                std::cerr << "--only must be 2d or 3d\n";
+                exit(EXIT_FAILURE);
+            }
+            b.run2d = (d == "2d");
+            b.run3d = (d == "3d");
+        } else if (std::strcmp(arg, "--quick") == 0) {
+            b.quick = true;
+        } else if (std::strcmp(arg, "--max-mem") == 0 && i + 1 < argc) {
+            b.maxMemMB = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--label") == 0 && i + 1 < argc) {
+            b.label = argv[++i];
+        } else if (std::strcmp(arg, "--golden") == 0 && i + 1 < argc) {
+            b.goldenPath = argv[++i];
+        } else if (std::strcmp(arg, "--write-golden") == 0 && i + 1 < argc) {
+            b.writeGoldenPath = argv[++i];
+        } else if (std::strcmp(arg, "--physics") == 0) {
+            b.physics = true;
+        } else if (std::strcmp(arg, "--verbose") == 0) {
+            b.verbose = true;
+        } else if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0) {
+            printUsage(argv[0]);
+            exit(EXIT_SUCCESS);
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            printUsage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (b.steps < 1 || b.warmup < 0) {
+        std::cerr << "--steps must be positive and --warmup non-negative\n";
+        exit(EXIT_FAILURE);
+    }
+    return b;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions b = parseBench(argc, argv);
+    std::vector<Case> cases = buildMatrix(b);
+    std::map<std::string, Golden> golden;
+    if (!b.goldenPath.empty()) golden = loadGolden(b.goldenPath);
+
+    std::cout << "fdtd_bench: " << cases.size() << " cases, " << b.warmup << " warm-up + "
+              << b.steps << " timed steps each\n"
+              << "   grid           kernel   layout index  prec  wg             "
+                 "  Mcells/s  GPU Mc/s     GB/s  checksum          check\n";
+
+    std::vector<Result> rows;
+    References references;
+    int failed = 0;
+    for (const Case& c : cases) {
+        std::vector<float> fields;
+        rows.push_back(runCase(c, b, &fields));
+        checkGolden(rows.back(), fields, golden, b);  // before check() takes the fields
+        references.check(rows.back(), fields, b);
+        printRow(rows.back());
+        if (!rows.back().passed()) ++failed;
+    }
+
+    std::vector<PhysicsCheck> physics;
+    if (b.physics) {
+        std::cout << "Physics checks (2D):\n"
+                  << "   check      grid           boundary   Mcells/s  result\n";
+        auto add = [&](const PhysicsCheck& p) {
+            physics.push_back(p);
+            printPhysics(p);
+            if (!p.passed()) ++failed;
+        };
+        add(hankelCheck(b));
+        add(reflectionCheck("cpml", b));
+        add(reflectionCheck("sponge", b));
+    }
+    std::cout << "Renderer: " << glRenderer << " (OpenGL " << glVersion << ")\n";
+
+    if (!b.outPath.empty() && !writeResults(b.outPath, b, rows, physics))
+        return EXIT_FAILURE;
+    if (!b.writeGoldenPath.empty() && !writeGolden(b.writeGoldenPath, b, rows))
+        return EXIT_FAILURE;
+    if (failed) {
+        std::cerr << failed << " check" << (failed == 1 ? "" : "s") << " failed\n";
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "shader_utils.h"
+
+// Active-tile dispatch for the two-pass kernels. The E pass (built with
+// ACTIVE_TILES, see shaders/active_tiles.glsl) wakes tiles next to nonzero
+// cells in a per-tile mask; shaders/active_tiles.comp compacts the mask into
+// a tile list plus glDispatchComputeIndirect arguments, so each pass runs one
+// workgroup per active tile and skips the quiet region ahead of the wavefront.
+// Tiles never go back to sleep: once the list covers the grid the owner
+// returns to dense dispatch for good. The list is dispatched as rows of
+// `row` groups (no more than GL_MAX_COMPUTE_WORK_GROUP_COUNT in x, which can
+// be as low as 65535), so a large grid spills into groups y; the kernels
+// skip the padding groups of the last row.
+namespace tiles {
+
+constexpr int POLL_INTERVAL = 32;  // steps between active-count readbacks
+
+// Bindings are baked into both the kernels and the compaction program
+inline std::string defines(int maskBinding, int listBinding) {
+    return "#define TILE_MASK_BINDING " + std::to_string(maskBinding) + "\n"
+         + "#define TILE_LIST_BINDING " + std::to_string(listBinding) + "\n";
+}
+
+struct ActiveSet {
+    bool   enabled  = false;
+    int    total    = 0;   // tiles in the grid
+    int    active   = 0;   // count at the last poll
+    int    denseAt  = -1;  // timestep tracking stopped (-1 = still tracking)
+    int    row      = 0;   // dispatch groups in x
+    GLuint program  = 0;
+    GLuint maskSSBO = 0;
+    GLuint listSSBO = 0;   // dispatch args (row, rows, 1, count) + tile indices
+    GLint  loc_tileTotal = -1;
+    GLint  loc_row       = -1;
+
+    // All tiles asleep except `seedTiles` (those holding a source). Call
+    // again after a grid resize: buffers are reallocated, the program kept.
+    void init(int tileCount, const std::vector<int>& seedTiles, int maskBinding,
+              int listBinding) {
+        enabled = true;
+        total   = tileCount;
+        denseAt = -1;
+        if (!program) {
+            program = shader::createComputeProgram("shaders/active_tiles.comp",
+                                                   defines(maskBinding, listBinding));
+            loc_tileTotal = glGetUniformLocation(program, "tileTotal");
+            loc_row       = glGetUniformLocation(program, "row");
+        }
+        GLint maxGroupsX = 65535;
+        glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxGroupsX);
+        row = std::max(std::min(total, int(maxGroupsX)), 1);
+
+        std::vector<GLuint> mask(total, 0u);
+        for (int tile : seedTiles) mask[tile] = 1u;
+        active = int(std::count(mask.begin(), mask.end(), 1u));
+        if (!maskSSBO) glGenBuffers(1, &maskSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, maskSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, mask.size() * sizeof(GLuint),
+                     mask.data(), GL_DYNAMIC_COPY);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, maskBinding, maskSSBO);
+
+        std::vector<GLuint> list(4 + total, 0u);
+        list[0] = GLuint(row);
+        list[2] = 1u;  // groups z
+        if (!listSSBO) glGenBuffers(1, &listSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, listSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, list.size() * sizeof(GLuint),
+                     list.data(), GL_DYNAMIC_COPY);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, listBinding, listSSBO);
+
+        compact();
+        std::cout << "Active tiles: " << total << " tiles, tracking until the "
+                  << "wavefront covers the grid\n";
+    }
+
+    // Rebuild the tile list from the mask the last E pass wrote
+    void compact() {
+        const GLuint reset[3] = {0u, 1u, 0u};  // rows, groups z, count
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, listSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), sizeof(reset), reset);
+
+        glUseProgram(program);
+        glUniform1i(loc_tileTotal, total);
+        glUniform1i(loc_row, row);
+        glDispatchCompute((total + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    }
+
+    // One workgroup per listed tile, on whichever program is bound
+    void dispatch() const {
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, listSSBO);
+        glDispatchComputeIndirect(0);
+    }
+
+    // Occasional readback (it stalls the pipeline) of the active count
+    void poll(int timestep) {
+        if (timestep % POLL_INTERVAL != 0) return;
+
+        GLuint count = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, listSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 3 * sizeof(GLuint), sizeof(GLuint), &count);
+        active = int(count);
+        if (active >= total) stop(timestep);
+    }
+
+    // Back to dense dispatch from `timestep` on
+    void stop(int timestep) {
+        enabled = false;
+        denseAt = timestep;
+    }
+
+    void printStatus() const {
+        if (!program) return;
+        if (denseAt >= 0)
+            std::cout << "Active tiles: dense dispatch from step " << denseAt << "\n";
+        else
+            std::cout << "Active tiles: " << active << " / " << total
+                      << " active at the last poll\n";
+    }
+
+    void cleanup() {
+        glDeleteBuffers(1, &maskSSBO);
+        glDeleteBuffers(1, &listSSBO);
+        glDeleteProgram(program);
+    }
+};
+
+} // namespace tiles
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "colormap.h"
+#include "shader_utils.h"
+
+// Vector view of the 3D solver: E or H as instanced arrows. The instance
+// list is built on the GPU every time the view changes: shaders/arrows3d.comp
+// takes one cell per stride^3 block, drops arrows below a displayed
+// magnitude or outside the camera frustum, and appends the survivors to a
+// compacted instance buffer through an atomic counter that is itself the
+// instanceCount of a glDrawArraysIndirect command. Nothing comes back to the
+// host, and the draw scales with what is visible rather than the grid.
+//
+// World space is the volume view's: the grid centred on the origin with its
+// longest axis one unit long.
+namespace arrows {
+
+constexpr int   INSTANCE_BINDING = 25;     // above the volume occupancy binding
+constexpr int   COMMAND_BINDING  = 26;
+constexpr int   DEFAULT_STRIDE   = 4;      // cells per arrow along each axis
+constexpr float DEFAULT_MIN      = 0.05f;  // displayed magnitude an arrow needs
+constexpr int   SIDES            = 8;      // facets of the shaft and head
+
+// Instance — matches the GLSL `Arrow` struct (std430)
+struct Instance {
+    float posLength[4];     // world position of the tail, w = length
+    float dirMagnitude[4];  // unit direction, w = displayed magnitude
+};
+
+// glDrawArraysIndirect command; instanceCount is the cull pass's counter
+struct DrawCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;
+};
+
+inline std::string defines() {
+    return "#define ARROW_INSTANCE_BINDING " + std::to_string(INSTANCE_BINDING) + "\n"
+         + "#define ARROW_COMMAND_BINDING " + std::to_string(COMMAND_BINDING) + "\n";
+}
+
+// The cull variant for E (field 0) or H (field 1)
+inline std::string defines(int field) {
+    return defines() + "#define ARROW_FIELD " + std::to_string(field) + "\n";
+}
+
+// Unit arrow along +z from the origin: position and normal per vertex
+inline std::vector<float> mesh() {
+    const float SHAFT_R = 0.05f, HEAD_R = 0.14f, HEAD_AT = 0.65f;
+    const float TWO_PI  = 6.2831853f;
+    std::vector<float> v;
+    auto vert = [&](glm::vec3 p, glm::vec3 n) {
+        v.insert(v.end(), {p.x, p.y, p.z, n.x, n.y, n.z});
+    };
+    for (int s = 0; s < SIDES; ++s) {
+        float     a0 = TWO_PI * s / SIDES, a1 = TWO_PI * (s + 1) / SIDES;
+        glm::vec3 r0(std::cos(a0), std::sin(a0), 0.0f), r1(std::cos(a1), std::sin(a1), 0.0f);
+
+        // Shaft side
+        vert(r0 * SHAFT_R, r0);
+        vert(r1 * SHAFT_R, r1);
+        vert(r1 * SHAFT_R + glm::vec3(0, 0, HEAD_AT), r1);
+        vert(r0 * SHAFT_R, r0);
+        vert(r1 * SHAFT_R + glm::vec3(0, 0, HEAD_AT), r1);
+        vert(r0 * SHAFT_R + glm::vec3(0, 0, HEAD_AT), r0);
+
+        // Head base and cone
+        glm::vec3 base(0, 0, HEAD_AT), tip(0, 0, 1), down(0, 0, -1);
+        vert(base, down);
+        vert(r1 * HEAD_R + base, down);
+        vert(r0 * HEAD_R + base, down);
+        float     slope = HEAD_R / (1.0f - HEAD_AT);
+        glm::vec3 n0    = glm::normalize(r0 + glm::vec3(0, 0, slope));
+        glm::vec3 n1    = glm::normalize(r1 + glm::vec3(0, 0, slope));
+        vert(r0 * HEAD_R + base, n0);
+        vert(r1 * HEAD_R + base, n1);
+        vert(tip, glm::normalize(n0 + n1));
+    }
+    return v;
+}
+
+// The six frustum planes of `viewProj` (Gribb-Hartmann), normalized so
+// dot(n, p) + d is a distance: inside is positive
+inline void frustumPlanes(const glm::mat4& viewProj, glm::vec4 out[6]) {
+    glm::vec4 rows[4];
+    for (int r = 0; r < 4; ++r)
+        rows[r] = glm::vec4(viewProj[0][r], viewProj[1][r], viewProj[2][r], viewProj[3][r]);
+    for (int a = 0; a < 3; ++a) {
+        out[2 * a]     = rows[3] + rows[a];
+        out[2 * a + 1] = rows[3] - rows[a];
+    }
+    for (int p = 0; p < 6; ++p) out[p] /= glm::length(glm::vec3(out[p]));
+}
+
+// One cull program (arrows3d.comp); the owner builds them on first use
+struct Kernel {
+    GLuint program = 0;
+
+    // Cached uniform locations
+    GLint loc_nx = -1, loc_ny = -1, loc_nz = -1, loc_near_origin[3] = {-1, -1, -1};
+    GLint loc_arrowDims = -1, loc_stride = -1;
+    GLint loc_fieldScale = -1, loc_minMagnitude = -1, loc_planes = -1, loc_boxHalf = -1;
+    GLint loc_cellSize = -1;
+
+    void init(GLuint prog) {
+        program            = prog;
+        loc_nx             = glGetUniformLocation(program, "nx");
+        loc_ny             = glGetUniformLocation(program, "ny");
+        loc_nz             = glGetUniformLocation(program, "nz");
+        loc_near_origin[0] = glGetUniformLocation(program, "near_x0");
+        loc_near_origin[1] = glGetUniformLocation(program, "near_y0");
+        loc_near_origin[2] = glGetUniformLocation(program, "near_z0");
+        loc_arrowDims      = glGetUniformLocation(program, "arrowDims");
+        loc_stride         = glGetUniformLocation(program, "stride");
+        loc_fieldScale     = glGetUniformLocation(program, "field_scale");
+        loc_minMagnitude   = glGetUniformLocation(program, "minMagnitude");
+        loc_planes         = glGetUniformLocation(program, "planes");
+        loc_boxHalf        = glGetUniformLocation(program, "boxHalf");
+        loc_cellSize       = glGetUniformLocation(program, "cellSize");
+    }
+
+    void cleanup() {
+        glDeleteProgram(program);
+        *this = Kernel();
+    }
+};
+
+struct Field {
+    bool   enabled       = false;
+    int    stride        = DEFAULT_STRIDE;
+    float  minMagnitude  = DEFAULT_MIN;
+    int    dims[3]       = {};
+    int    arrowDims[3]  = {};  // arrows per axis before culling
+    GLuint instanceSSBO  = 0;
+    GLuint commandBuffer = 0;   // DrawCommand, also at COMMAND_BINDING
+    GLuint meshVAO       = 0;
+    GLuint meshVBO       = 0;
+    GLuint program       = 0;   // arrow.vert / arrow.frag
+    GLint  meshVertices  = 0;
+
+    GLint loc_viewProj = -1;
+
+    size_t capacity() const { return size_t(arrowDims[0]) * arrowDims[1] * arrowDims[2]; }
+
+    // Instance storage for a grid of `d` cells. Call again after a resize:
+    // buffers are reallocated, the mesh and draw program kept.
+    void init(const int d[3], int s, float minMag) {
+        stride       = s;
+        minMagnitude = minMag;
+        for (int a = 0; a < 3; ++a) {
+            dims[a]      = d[a];
+            arrowDims[a] = (d[a] + stride - 1) / stride;
+        }
+        if (!program) {
+            program = shader::createProgram("shaders/arrow.vert", "shaders/arrow.frag",
+                                            defines() + colormap::defines());
+            loc_viewProj = glGetUniformLocation(program, "viewProj");
+
+            std::vector<float> verts = mesh();
+            meshVertices = GLint(verts.size() / 6);
+            glGenVertexArrays(1, &meshVAO);
+            glGenBuffers(1, &meshVBO);
+            glBindVertexArray(meshVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+            glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(),
+                         GL_STATIC_DRAW);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+                                  (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+            glBindVertexArray(0);
+        }
+
+        if (!instanceSSBO) glGenBuffers(1, &instanceSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity() * sizeof(Instance), nullptr,
+                     GL_DYNAMIC_COPY);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, instanceSSBO);
+
+        DrawCommand cmd = {GLuint(meshVertices), 0, 0, 0};
+        if (!commandBuffer) glGenBuffers(1, &commandBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(cmd), &cmd, GL_DYNAMIC_COPY);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, commandBuffer);
+        enabled = true;
+
+        std::cout << "Arrows: stride " << stride << ", up to " << capacity() << " of "
+                  << size_t(dims[0]) * dims[1] * dims[2] << " cells, "
+                  << capacity() * sizeof(Instance) / (1024.0 * 1024.0) << " MB of instances\n";
+    }
+
+    // Zero the instance counter and set the per-view uniforms of `k`. The
+    // caller sets the storage uniforms (nx.., near box, z range) and
+    // dispatches, once per field buffer set.
+    void beginCull(const Kernel& k, const glm::mat4& viewProj, float fieldScale) const {
+        const GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI,
+                             offsetof(DrawCommand, instanceCount), sizeof(GLuint), GL_RED_INTEGER,
+                             GL_UNSIGNED_INT, &zero);
+
+        glm::vec4 planes[6];
+        frustumPlanes(viewProj, planes);
+        int   longest = std::max({dims[0], dims[1], dims[2]});
+        float half[3];
+        for (int a = 0; a < 3; ++a) half[a] = 0.5f * dims[a] / longest;
+
+        glUseProgram(k.program);
+        glUniform3i(k.loc_arrowDims, arrowDims[0], arrowDims[1], arrowDims[2]);
+        glUniform1i(k.loc_stride, stride);
+        glUniform1f(k.loc_fieldScale, fieldScale);
+        glUniform1f(k.loc_minMagnitude, minMagnitude);
+        glUniform4fv(k.loc_planes, 6, glm::value_ptr(planes[0]));
+        glUniform3fv(k.loc_boxHalf, 1, half);
+        glUniform1f(k.loc_cellSize, 1.0f / longest);
+    }
+
+    void dispatch() const { glDispatchCompute(GLuint((capacity() + 63) / 64), 1, 1); }
+
+    // Draw the surviving instances; depth testing into the bound target
+    void draw(const glm::mat4& viewProj) const {
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+        glUseProgram(program);
+        glUniformMatrix4fv(loc_viewProj, 1, GL_FALSE, glm::value_ptr(viewProj));
+        glEnable(GL_DEPTH_TEST);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glBindVertexArray(meshVAO);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glDrawArraysIndirect(GL_TRIANGLES, nullptr);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glDisable(GL_DEPTH_TEST);
+    }
+
+    void cleanup() {
+        glDeleteBuffers(1, &instanceSSBO);
+        glDeleteBuffers(1, &commandBuffer);
+        glDeleteBuffers(1, &meshVBO);
+        glDeleteVertexArrays(1, &meshVAO);
+        glDeleteProgram(program);
+        instanceSSBO = commandBuffer = meshVBO = meshVAO = program = 0;
+        enabled = false;
+    }
+};
+
+} // namespace arrows
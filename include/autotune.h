@@ -0,0 +1,215 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Startup choice of the two-pass kernels' launch shape. Each candidate is
+// built and timed for a few steps on the live grid (dense dispatch, the
+// engine's own buffers; the fields are zeroed again afterwards), and the
+// fastest is kept. The choice is stored per renderer string, driver version
+// and grid / storage variant next to the program binaries, so later starts
+// on the same GPU and grid only read it back.
+//
+// Besides the workgroup size, 3D shapes choose
+//   march  cells per invocation along z, WG_Z apart (MARCH_Z): fewer, longer
+//          invocations that stream along the slowest axis
+//   tiled  the neighbour field of the workgroup's block staged in shared
+//          memory with a one-cell halo (TILED_STENCIL), so the six
+//          neighbour reads per cell come from there instead of the buffers
+// Fused kernels keep their fixed shapes (their tiles are sized with the
+// shared windows) and are not tuned.
+namespace autotune {
+
+constexpr int WARMUP_STEPS = 2;   // per candidate, untimed (first-dispatch costs)
+constexpr int TIMED_STEPS  = 8;   // per round
+constexpr int ROUNDS       = 3;   // best round counts
+const char* const CACHE_FILE = "autotune.txt";  // in the shader cache directory
+
+// Launch shape of the two-pass kernels
+struct Shape {
+    int  wg[3] = {1, 1, 1};
+    int  march = 1;
+    bool tiled = false;
+
+    bool operator==(const Shape& o) const {
+        return std::equal(wg, wg + 3, o.wg) && march == o.march && tiled == o.tiled;
+    }
+
+    int invocations() const { return wg[0] * wg[1] * wg[2]; }
+
+    // "32x4x2", "32x4x1/z8/smem" (2D: "32x8")
+    std::string name(bool is3d) const {
+        std::string s = std::to_string(wg[0]) + "x" + std::to_string(wg[1]);
+        if (!is3d) return s;
+        s += "x" + std::to_string(wg[2]);
+        if (march > 1) s += "/z" + std::to_string(march);
+        if (tiled) s += "/smem";
+        return s;
+    }
+
+    // Shared memory of the tiled variant: three floats per cell of the
+    // block plus its halo, `cellsX` cells per invocation along x
+    size_t sharedBytes(int cellsX) const {
+        if (!tiled) return 0;
+        return 3 * sizeof(float) * size_t(wg[0] * cellsX + 1) * (wg[1] + 1) * (wg[2] + 1);
+    }
+};
+
+// `spec` as name() writes it; false on anything else
+inline bool parse(const std::string& spec, Shape& out) {
+    Shape s;
+    std::istringstream in(spec);
+    std::string part;
+    std::getline(in, part, '/');
+    int n = std::sscanf(part.c_str(), "%dx%dx%d", &s.wg[0], &s.wg[1], &s.wg[2]);
+    if (n < 2 || s.wg[0] <= 0 || s.wg[1] <= 0 || s.wg[2] <= 0) return false;
+    while (std::getline(in, part, '/')) {
+        if (part == "smem") {
+            s.tiled = true;
+        } else if (part.size() > 1 && part[0] == 'z') {
+            s.march = std::atoi(part.c_str() + 1);
+            if (s.march < 1) return false;
+        } else {
+            return false;
+        }
+    }
+    out = s;
+    return true;
+}
+
+inline std::vector<Shape> candidates2d() {
+    return {{{16, 16, 1}}, {{32, 8, 1}}, {{64, 4, 1}}, {{8, 8, 1}}, {{32, 16, 1}},
+            {{128, 2, 1}}};
+}
+
+inline std::vector<Shape> candidates3d() {
+    return {
+        {{8, 8, 8}},          {{16, 8, 4}},          {{32, 4, 2}},          {{64, 2, 1}},
+        {{32, 8, 1}},         {{32, 4, 1}, 8},       {{64, 2, 1}, 8},       {{16, 8, 2}, 4},
+        {{8, 8, 8}, 1, true}, {{32, 4, 2}, 1, true}, {{32, 4, 1}, 8, true}, {{16, 16, 1}, 8, true},
+    };
+}
+
+// Whether the device can launch `s` (sizes, invocations, shared memory)
+inline bool launchable(const Shape& s, int cellsX) {
+    GLint invocations = 0, shared = 0, size[3] = {0, 0, 0};
+    glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &invocations);
+    glGetIntegerv(GL_MAX_COMPUTE_SHARED_MEMORY_SIZE, &shared);
+    for (int a = 0; a < 3; ++a) glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, a, &size[a]);
+    for (int a = 0; a < 3; ++a)
+        if (s.wg[a] > size[a]) return false;
+    return s.invocations() <= invocations && s.sharedBytes(cellsX) <= size_t(shared);
+}
+
+// Renderer and driver version: a new GPU or driver tunes again
+inline std::string driverKey() {
+    auto str = [](GLenum name) {
+        const char* s = reinterpret_cast<const char*>(glGetString(name));
+        return std::string(s ? s : "?");
+    };
+    return str(GL_RENDERER) + "\t" + str(GL_VERSION);
+}
+
+// Tab-separated lines: renderer, driver version, variant, shape. `path`
+// empty = nothing persisted.
+struct Cache {
+    std::string path;
+
+    explicit Cache(const std::string& dir) {
+        if (!dir.empty()) path = dir + "/" + CACHE_FILE;
+    }
+
+    bool lookup(const std::string& variant, bool is3d, Shape& out) const {
+        if (path.empty()) return false;
+        std::ifstream in(path);
+        std::string line, want = driverKey() + "\t" + variant + "\t";
+        while (std::getline(in, line))
+            if (line.compare(0, want.size(), want) == 0)
+                return parse(line.substr(want.size()), out) && (is3d || out.wg[2] == 1);
+        return false;
+    }
+
+    // Replaces the variant's line; via a temporary file renamed into place,
+    // as the program binaries
+    void store(const std::string& variant, const Shape& s, bool is3d) const {
+        if (path.empty()) return;
+        std::string want = driverKey() + "\t" + variant + "\t";
+        std::vector<std::string> lines;
+        {
+            std::ifstream in(path);
+            std::string line;
+            while (std::getline(in, line))
+                if (line.compare(0, want.size(), want) != 0) lines.push_back(line);
+        }
+        lines.push_back(want + s.name(is3d));
+
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp);
+            for (const std::string& l : lines) out << l << "\n";
+            if (!out) {
+                std::cerr << "Autotune: failed to write " << path << "\n";
+                return;
+            }
+        }
+        std::filesystem::rename(tmp, path, ec);
+        if (ec) std::cerr << "Autotune: failed to write " << path << "\n";
+    }
+};
+
+// Milliseconds per step of `run(steps)` (which dispatches that many steps),
+// best of ROUNDS after the warm-up
+template <typename RunFn>
+double msPerStep(RunFn run) {
+    run(WARMUP_STEPS);
+    glFinish();
+    double best = 0.0;
+    for (int r = 0; r < ROUNDS; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        run(TIMED_STEPS);
+        glFinish();
+        std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+        double perStep = ms.count() / TIMED_STEPS;
+        best = r == 0 ? perStep : std::min(best, perStep);
+    }
+    return best;
+}
+
+// Fastest of `candidates` by `trial(shape)` (ms per step); the first one
+// (the kernel default) wins ties
+template <typename TrialFn>
+Shape pick(const std::vector<Shape>& candidates, bool is3d, const std::string& variant,
+           TrialFn trial) {
+    std::cout << "Autotune: timing " << candidates.size() << " shapes on " << variant << "\n";
+    Shape  best   = candidates.front();
+    double bestMs = 0.0, defaultMs = 0.0;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        double ms = trial(candidates[i]);
+        char row[64];
+        std::snprintf(row, sizeof(row), "  %-16s %9.3f ms/step\n",
+                      candidates[i].name(is3d).c_str(), ms);
+        std::cout << row;
+        if (i == 0) defaultMs = bestMs = ms;
+        if (ms < bestMs) {
+            best   = candidates[i];
+            bestMs = ms;
+        }
+    }
+    std::cout << "Autotune: " << best.name(is3d) << " (" << bestMs << " ms/step, "
+              << (bestMs > 0.0 ? defaultMs / bestMs : 1.0) << "x the default)\n";
+    return best;
+}
+
+} // namespace autotune
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+
+// Device memory of an Engine: every grid-sized buffer is allocated through
+// one Pool, which zeroes it on the GPU (glClearBufferData, no host staging)
+// and keeps the bytes each subsystem holds. Before anything is allocated
+// the engine's footprint() plans the same buffers as a Budget; checked
+// against the free memory the driver reports (or --vram-mb), an oversized
+// grid fails up front with the plan, or shrinks to the largest that fits
+// with --fit-vram.
+//
+// Buffers stay separate GL objects: the kernels bind whole buffers at fixed
+// bindings and the readbacks, halo copies and indirect draws address them
+// from offset 0, so sub-allocating one arena would mean a range and an
+// offset at every one of those sites for no gain in what is tracked.
+namespace vram {
+
+constexpr double HEADROOM = 0.9;  // share of the free memory a plan may take
+
+#ifndef GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+#ifndef GL_VBO_FREE_MEMORY_ATI
+#define GL_VBO_FREE_MEMORY_ATI 0x87FB
+#endif
+
+enum Use {
+    FIELDS, COEFFS, BOUNDARY, SUBGRID, MEDIA, PROBES, VIEW, STAGING,
+    USE_COUNT
+};
+
+const char* const USE_NAMES[USE_COUNT] = {
+    "fields", "coefficients", "boundary", "refined patch", "dispersive media", "probes",
+    "views", "staging",
+};
+
+inline double toMB(size_t bytes) { return double(bytes) / (1024.0 * 1024.0); }
+
+// " name X MB," per subsystem holding any
+inline void printBytes(const size_t* bytes) {
+    for (int u = 0; u < USE_COUNT; ++u)
+        if (bytes[u]) std::cout << " " << USE_NAMES[u] << " " << toMB(bytes[u]) << " MB,";
+}
+
+inline bool hasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+        if (std::strcmp(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, GLuint(i))),
+                        name) == 0)
+            return true;
+    return false;
+}
+
+// Free device memory in bytes: `overrideMB` when set, else what the driver
+// reports (NVX / ATI meminfo), 0 when it reports nothing
+inline size_t availableBytes(int overrideMB) {
+    if (overrideMB > 0) return size_t(overrideMB) * 1024 * 1024;
+    GLint kb[4] = {0, 0, 0, 0};
+    if (hasExtension("GL_NVX_gpu_memory_info"))
+        glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, kb);
+    else if (hasExtension("GL_ATI_meminfo"))
+        glGetIntegerv(GL_VBO_FREE_MEMORY_ATI, kb);  // [0]: total free KB
+    return kb[0] > 0 ? size_t(kb[0]) * 1024 : 0;
+}
+
+// Zero the whole of the buffer bound to `target`
+inline void clear(GLenum target) {
+    glClearBufferData(target, GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+}
+
+// Planned bytes per subsystem
+struct Budget {
+    size_t bytes[USE_COUNT] = {};
+
+    size_t total() const {
+        size_t t = 0;
+        for (size_t b : bytes) t += b;
+        return t;
+    }
+
+    bool fits(size_t available) const {
+        return available == 0 || double(total()) <= HEADROOM * double(available);
+    }
+
+    void print(const std::string& grid, size_t available) const {
+        std::cout << "Memory plan for " << grid << ":";
+        printBytes(bytes);
+        std::cout << " total " << toMB(total()) << " MB";
+        if (available) std::cout << " of " << toMB(available) << " MB free";
+        std::cout << "\n";
+    }
+};
+
+// Scale of the grid (0, 1] whose plan `plan(scale)` is the largest that
+// fits, by bisection; 0 if not even the smallest does
+template <typename PlanFn>
+double fitScale(size_t available, PlanFn plan) {
+    if (plan(1.0).fits(available)) return 1.0;
+    double lo = 0.0, hi = 1.0;
+    for (int i = 0; i < 40; ++i) {
+        double mid = 0.5 * (lo + hi);
+        (plan(mid).fits(available) ? lo : hi) = mid;
+    }
+    return lo > 0.0 && plan(lo).fits(available) ? lo : 0.0;
+}
+
+struct Pool {
+    struct Entry { Use use; size_t bytes; };
+
+    std::map<GLuint, Entry> buffers;
+    size_t held[USE_COUNT] = {};
+
+    // `bytes` zeroed on the GPU in `buffer` (generated if 0), left bound to
+    // GL_SHADER_STORAGE_BUFFER
+    void alloc(GLuint& buffer, size_t bytes, Use use, GLenum usage = GL_DYNAMIC_COPY) {
+        store(buffer, nullptr, bytes, use, usage);
+        if (bytes) clear(GL_SHADER_STORAGE_BUFFER);
+    }
+
+    // `bytes` from `data` in `buffer`, as alloc
+    void upload(GLuint& buffer, const void* data, size_t bytes, Use use,
+                GLenum usage = GL_STATIC_DRAW) {
+        store(buffer, data, bytes, use, usage);
+    }
+
+    // A buffer a helper allocated itself, at its current size
+    void track(GLuint buffer, Use use) {
+        if (!buffer) return;
+        GLint64 size = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+        account(buffer, use, size_t(size));
+    }
+
+    // Drop a tracked buffer before its helper deletes it
+    void forget(GLuint buffer) {
+        auto it = buffers.find(buffer);
+        if (it == buffers.end()) return;
+        held[it->second.use] -= it->second.bytes;
+        buffers.erase(it);
+    }
+
+    void release(GLuint* list, int n) {
+        for (int i = 0; i < n; ++i) forget(list[i]);
+        glDeleteBuffers(n, list);
+        for (int i = 0; i < n; ++i) list[i] = 0;
+    }
+    void release(GLuint& buffer) { release(&buffer, 1); }
+
+    size_t total() const {
+        size_t t = 0;
+        for (size_t b : held) t += b;
+        return t;
+    }
+
+    void printSummary() const {
+        std::cout << "GPU buffers:";
+        printBytes(held);
+        std::cout << " total " << toMB(total()) << " MB in " << buffers.size() << " buffers\n";
+    }
+
+    void account(GLuint buffer, Use use, size_t bytes) {
+        auto it = buffers.find(buffer);
+        if (it != buffers.end()) held[it->second.use] -= it->second.bytes;
+        buffers[buffer] = {use, bytes};
+        held[use] += bytes;
+    }
+
+    void store(GLuint& buffer, const void* data, size_t bytes, Use use, GLenum usage) {
+        if (!buffer) glGenBuffers(1, &buffer);
+        while (glGetError() != GL_NO_ERROR) {}
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(bytes), data, usage);
+        if (glGetError() == GL_OUT_OF_MEMORY) {
+            std::cerr << "Out of GPU memory allocating " << toMB(bytes) << " MB of "
+                      << USE_NAMES[use] << " (" << toMB(total())
+                      << " MB already held); use a smaller --grid or --fit-vram\n";
+            exit(EXIT_FAILURE);
+        }
+        account(buffer, use, bytes);
+    }
+};
+
+} // namespace vram
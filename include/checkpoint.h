@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Solver checkpoints (.emck) for restarting long 3D runs. The owner copies
+// every buffer that carries state across steps — the field buffers in their
+// storage form, the mixed-precision near box, the CPML psi slabs — back to
+// back into a staging slot of a snapshot::Ring, so a checkpoint costs a few
+// buffer copies on the GPU and disk bandwidth on the writer thread.
+//
+//   Header, section payloads in Header order
+//
+// The sources are a pure function of the timestep, so the step is all the
+// time state there is; together with the buffers it makes a restart
+// bit-exact. The source table itself is not stored, only its hash: a
+// restart must be given the same --source list; likewise the media, whose
+// pole state is a section of its own. Files are written beside the target
+// and renamed over it, so a crash mid-write leaves the previous checkpoint
+// intact.
+namespace checkpoint {
+
+constexpr int MAX_SECTIONS = 16;
+constexpr uint32_t VERSION = 3;  // 2: source table hash, 3: media hash
+
+struct Header {
+    char     magic[4]       = {'E', 'M', 'C', 'K'};
+    uint32_t version        = VERSION;
+    int32_t  step           = 0;   // next timestep to run
+    int32_t  dims[3]        = {};
+    int32_t  fieldLayout    = 0;   // grid::FieldLayout
+    int32_t  fieldIndex     = 0;   // grid::FieldIndex
+    int32_t  fieldPrecision = 0;   // grid::FieldPrecision
+    int32_t  cpml           = 0;   // psi slabs present (else sponge boundary)
+    int32_t  fused          = 0;   // fused H+E path
+    float    sourceFreq     = 0.0f;
+    float    sourceAmp      = 0.0f;
+    uint64_t sourceHash     = 0;   // sources::hash of the source table
+    uint64_t mediumHash     = 0;   // media::hash of the dispersive media
+    int32_t  sections       = 0;
+    uint64_t sectionBytes[MAX_SECTIONS] = {};
+
+    uint64_t payloadBytes() const {
+        uint64_t n = 0;
+        for (int i = 0; i < sections; ++i) n += sectionBytes[i];
+        return n;
+    }
+
+    // Same solver configuration (everything but the step)
+    bool sameSetup(const Header& o) const {
+        return std::memcmp(dims, o.dims, sizeof(dims)) == 0 && fieldLayout == o.fieldLayout &&
+               fieldIndex == o.fieldIndex && fieldPrecision == o.fieldPrecision &&
+               cpml == o.cpml && fused == o.fused && sourceFreq == o.sourceFreq &&
+               sourceAmp == o.sourceAmp && sourceHash == o.sourceHash &&
+               mediumHash == o.mediumHash && sections == o.sections &&
+               std::memcmp(sectionBytes, o.sectionBytes, sizeof(sectionBytes)) == 0;
+    }
+};
+
+// Header + payload to `path` via a temporary file renamed into place
+inline bool write(const std::string& path, const Header& header, const void* data) {
+    std::string tmp = path + ".tmp";
+    size_t bytes = header.payloadBytes();
+
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    bool ok = f && std::fwrite(&header, sizeof(Header), 1, f) == 1 &&
+              std::fwrite(data, 1, bytes, f) == bytes;
+    if (f) ok = (std::fclose(f) == 0) && ok;
+    // rename() does not replace an existing file on Windows
+#ifdef _WIN32
+    if (ok) std::remove(path.c_str());
+#endif
+    ok = ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+    if (!ok) std::cerr << "Failed to write checkpoint " << path << "\n";
+    return ok;
+}
+
+inline bool read(const std::string& path, Header& header, std::vector<uint8_t>& payload) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        std::cerr << "Failed to open checkpoint: " << path << "\n";
+        return false;
+    }
+    bool ok = std::fread(&header, sizeof(Header), 1, f) == 1 &&
+              std::memcmp(header.magic, "EMCK", 4) == 0 && header.version == VERSION &&
+              header.sections >= 0 && header.sections <= MAX_SECTIONS;
+    if (ok) {
+        payload.resize(header.payloadBytes());
+        ok = std::fread(payload.data(), 1, payload.size(), f) == payload.size();
+    }
+    std::fclose(f);
+    if (!ok) std::cerr << path << ": not a checkpoint, or truncated\n";
+    return ok;
+}
+
+} // namespace checkpoint
@@ -0,0 +1,629 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "arrows.h"
+#include "autotune.h"
+#include "dft.h"
+#include "grid.h"
+#include "ntff.h"
+#include "stats.h"
+
+// Command-line handling shared by the simulation entry points
+namespace cli {
+
+struct RunOptions {
+    bool headless   = false;  // hidden window, no vsync, no render pass
+    int  steps      = 0;      // stop after this many FDTD steps (0 = run until closed)
+    int  fusedSteps = 0;      // fused time-stepping: steps per dispatch (0 = two-pass)
+    bool cpml       = true;   // CPML boundary (false = graded conductivity sponge)
+    bool activeTiles = true;  // two-pass: dispatch only tiles the wavefront has reached
+    int  refine[4]   = {0, 0, 0, 0};  // 2D: refined patch X0,Y0,X1,Y1 in coarse nodes (0 = off)
+    int  refineRatio = 2;             // fine cells (and sub-steps) per coarse one
+    int  workgroup[3] = {0, 0, 0};  // two-pass workgroup shape (0 = kernel default)
+    int  marchZ       = 1;          // 3D two-pass: cells per invocation along z
+    bool tiledStencil = false;      // 3D two-pass: neighbours staged in shared memory
+    bool autotune     = true;       // no --workgroup: time the candidate shapes (autotune.h)
+    bool retune       = false;      // ignore the stored choice and time again
+    double frameBudgetMs = 0.0;     // windowed: adapt steps per frame to this frame time (0 = fixed)
+    std::string shaderCache = "shader_cache";  // linked program binaries (empty = off)
+
+    // 3D field storage, compiled into the shaders as FIELD_LAYOUT / FIELD_INDEX /
+    // FIELD_PRECISION
+    grid::FieldLayout    fieldLayout = grid::LAYOUT_SOA;
+    grid::FieldIndex     fieldIndex  = grid::INDEX_LINEAR;
+    grid::FieldPrecision precision   = grid::PRECISION_FP32;
+    bool compareFp32 = false;  // headless: rerun in fp32 and report the field error
+
+    // Host solver (cpu_fdtd.h): run on it instead of the GPU, or check the
+    // GPU fields against it after a headless batch
+    bool cpuBackend = false;
+    int  threads    = 0;      // CPU worker threads (0 = one per hardware thread)
+    bool compareCpu = false;
+
+    // GPU timer queries (gpu_timer.h); a profile path also enables them
+    bool        gpuTimers = false;
+    std::string profilePath;
+
+    // Field snapshots to disk (snapshot.h); 0 = off
+    int         snapshotEvery  = 0;
+    std::string snapshotDir    = "snapshots";
+    bool        snapshotSlice  = false;  // 3D: only the displayed slice plane
+    int         snapshotStride = 1;      // keep every Nth cell per axis
+
+    // 3D chunked field recording of the snapshots / replay of one (fieldfile.h)
+    std::string recordPath;
+    int         recordCodec = 1;      // fieldfile::Codec: 0 raw, 1 lossless, 2 lossy
+    float       recordError = 1e-4f;  // lossy: absolute error bound
+    std::string replayPath;
+
+    // 3D solver checkpoints (checkpoint.h); 0 = off
+    std::string checkpointPath;
+    int         checkpointEvery = 0;
+    std::string restartPath;
+
+    // 3D frequency-domain probes (dft.h); no boxes = off, no frequencies =
+    // the source frequency
+    std::vector<float>    dftFreqs;
+    std::vector<dft::Box> dftProbes;
+    std::string           dftPath = "probes.emdft";
+
+    // 3D far-field pattern from a Huygens box at the DFT frequencies (ntff.h)
+    bool        ntff        = false;
+    int         ntffBox[6]  = {0, 0, 0, 0, 0, 0};  // inclusive X0..Z1 (0 = inside the absorber)
+    int         ntffDirs[2] = {91, 72};            // theta, phi samples
+    int         ntffEvery   = 500;                 // steps between passes (0 = end of run only)
+    std::string ntffPath    = "pattern.csv";
+
+    // 3D vector view (arrows.h): one arrow per stride^3 cells, culled below
+    // a displayed magnitude
+    int   arrowStride = arrows::DEFAULT_STRIDE;
+    float arrowMin    = arrows::DEFAULT_MIN;
+
+    // Live field statistics (stats.h) every statsEvery steps (0 = off): they
+    // drive the auto exposure of the views and the divergence watchdog
+    int   statsEvery     = stats::DEFAULT_EVERY;
+    float exposure       = 0.0f;  // fixed colour scale (0 = auto)
+    float watchdogGrowth = stats::DEFAULT_GROWTH;
+
+    // Scene overrides applied on top of the defaults / scene file (config.h);
+    // zero means "not given"
+    std::string scenePath;
+    int   gridNx        = 0;
+    int   gridNy        = 0;
+    int   gridNz        = 0;
+    int   stepsPerFrame = 0;
+    float sourceFreq    = 0.0f;
+    float sourceAmp     = 0.0f;
+    std::vector<std::string> sources;  // --source specs (sources.h), replacing the scene's
+    std::vector<std::string> media;    // --medium specs (media.h), replacing the scene's
+
+    // 2D: independent scenarios stepped together, one layer each
+    int batch = 1;
+
+    // Device memory plan (buffer_pool.h): free memory in MB when the driver
+    // reports none (0 = ask the driver), and shrink an oversized grid to fit
+    int  vramMB  = 0;
+    bool fitVram = false;
+};
+
+// The entry point parsing the command line: each reads only its own flags
+// and rejects the other's
+enum App { APP_2D, APP_3D };
+
+// Flags that only one entry point reads
+inline const char* const FLAGS_2D[] = {"--refine", "--refine-ratio", "--batch"};
+inline const char* const FLAGS_3D[] = {
+    "--layout",       "--index",        "--precision",  "--compare-fp32",
+    "--snapshot-slice", "--record",     "--record-codec", "--record-error",
+    "--replay",       "--checkpoint",   "--checkpoint-every", "--restart",
+    "--dft-probe",    "--dft-freq",     "--dft-out",    "--ntff",
+    "--ntff-box",     "--ntff-dirs",    "--ntff-every", "--ntff-out",
+    "--arrow-stride", "--arrow-min"};
+
+template <size_t N>
+inline bool listed(const char* const (&flags)[N], const char* arg) {
+    for (const char* f : flags)
+        if (std::strcmp(f, arg) == 0) return true;
+    return false;
+}
+
+inline void printUsage(const char* exe, App app) {
+    const bool is3d = (app == APP_3D);
+    std::cout << "Usage: " << exe << " [options]\n"
+              << "  --headless   run without a visible window or render pass\n"
+              << "  --steps N    stop after N timesteps (default 1000 when headless)\n";
+    if (is3d)
+        std::cout << "  --fused K    fused kernel, H+E per dispatch\n";
+    else
+        std::cout << "  --fused K    fused kernel, K leapfrog steps per dispatch (temporal\n"
+                  << "               blocking, K <= 8)\n";
+    std::cout << "  --boundary B absorbing boundary: cpml (default) or sponge\n"
+              << "  --dense      two-pass: always dispatch the whole grid (no active tiles)\n";
+    if (is3d)
+        std::cout << "  --workgroup W two-pass workgroup shape XxYxZ[/zN][/smem] (N cells per\n"
+                  << "               invocation along z, smem: shared-memory stencil)\n";
+    else
+        std::cout << "  --workgroup W two-pass workgroup shape XxY\n";
+    std::cout << "  --no-autotune keep the kernel default shape instead of the fastest one\n"
+              << "               timed at startup (stored per GPU/driver in the shader cache)\n"
+              << "  --retune     time the shapes again, replacing the stored choice\n"
+              << "  --shader-cache DIR   program binary cache (default shader_cache, off = none)\n";
+    if (is3d)
+        std::cout << "  --layout L   field storage: soa (default) or packed (vec4 E/H)\n"
+                  << "  --index I    cell order: linear (default), brick (8^3) or morton\n"
+                  << "  --precision P field storage: fp32 (default), fp16 or mixed\n"
+                  << "               (mixed keeps the cells around the source in fp32)\n"
+                  << "  --compare-fp32 headless: report the error against an fp32 rerun\n";
+    else
+        std::cout << "  --refine X0,Y0,X1,Y1 refined patch over that coarse box\n"
+                  << "  --refine-ratio R     patch refinement, 2..8 (default 2)\n";
+    std::cout << "  --backend B  solver backend: gpu (default) or cpu (headless only)\n"
+              << "  --threads N  CPU backend worker threads (default: all hardware threads)\n"
+              << "  --compare-cpu headless: check the GPU fields against the CPU solver\n"
+              << "  --gpu-timers time H/E/CPML/render passes on the GPU (title + summary)\n"
+              << "  --profile-out FILE  also write per-frame timings (.csv or .json)\n"
+              << "  --snapshot-every N  write fields to disk every N steps (async)\n"
+              << "  --snapshot-dir DIR  snapshot directory (default snapshots)\n";
+    if (is3d) std::cout << "  --snapshot-slice    dump only the displayed slice plane\n";
+    std::cout << "  --snapshot-stride S keep every S-th cell per axis\n";
+    if (is3d)
+        std::cout << "  --record FILE       record the snapshots into one chunked file\n"
+                  << "  --record-codec C    raw, lossless (default) or lossy\n"
+                  << "  --record-error E    lossy: absolute error bound (default 1e-4)\n"
+                  << "  --replay FILE       play a recording back (Space, Left/Right)\n"
+                  << "  --checkpoint FILE   save the solver state to FILE (async)\n"
+                  << "  --checkpoint-every N  checkpoint interval in steps (default 1000)\n"
+                  << "  --restart FILE      resume a checkpoint bit-exactly; grid, source and\n"
+                  << "                      storage come from FILE (give the same --source\n"
+                  << "                      list), --steps is absolute\n"
+                  << "  --dft-probe X0,Y0,Z0,X1,Y1,Z1  running DFT over that inclusive cell\n"
+                  << "                      box (point, plane or volume; repeatable)\n"
+                  << "  --dft-freq F[,F...] DFT frequencies (default: the source frequency)\n"
+                  << "  --dft-out FILE      phasor output (default probes.emdft)\n"
+                  << "  --ntff              far-field pattern from a Huygens box at the DFT\n"
+                  << "                      frequencies, refined as the run converges\n"
+                  << "  --ntff-box X0,Y0,Z0,X1,Y1,Z1  Huygens box (default: inside the absorber)\n"
+                  << "  --ntff-dirs T,P     theta x phi directions (default 91,72)\n"
+                  << "  --ntff-every N      steps between pattern passes (default 500, 0 = at the end)\n"
+                  << "  --ntff-out FILE     pattern CSV (default pattern.csv)\n"
+                  << "  --arrow-stride N    vector view (A): one arrow per N^3 cells (default 4)\n"
+                  << "  --arrow-min M       hide arrows below displayed magnitude M (default 0.05)\n";
+    std::cout << "  --stats-every N     steps between field statistics (default 10, 0 = off)\n"
+              << "  --exposure S        colour scale of the views: auto (default) or fixed S\n"
+              << "  --watchdog G        halt when the field energy grows G x per sample, 8\n"
+              << "                      samples in a row (default 2, 0 = non-finite only)\n"
+              << "  --scene FILE grid size, steps per frame and source from FILE\n"
+              << "               (F5 re-reads it; a new grid size resets the run)\n"
+              << "  --grid G     grid size " << (is3d ? "NXxNYxNZ" : "NXxNY") << "\n"
+              << "  --vram-mb MB         free GPU memory to plan against (default: as reported\n"
+              << "                       by the driver, unchecked when it reports none)\n"
+              << "  --fit-vram           shrink a grid that does not fit to the largest that does\n"
+              << "  --steps-per-frame N  FDTD steps per rendered frame\n"
+              << "  --frame-budget MS    adapt steps per frame to hold MS per frame\n"
+              << "                       (starts from --steps-per-frame)\n"
+              << "  --source-freq F      source frequency (normalized)\n"
+              << "  --source-amp A       source amplitude\n";
+    if (is3d)
+        std::cout << "  --source SPEC        X,Y,Z[:wave=sine|gauss|mod][:freq=F][:amp=A]\n"
+                  << "                       [:phase=P][:width=W][:delay=D][:pol=x|y|z];\n"
+                  << "                       repeatable (default: a sine at the centre)\n"
+                  << "  --medium SPEC        box:X0,Y0,Z0,X1,Y1,Z1, sphere:X,Y,Z,R,\n"
+                  << "                       wire:X0,Y0,Z0,X1,Y1,Z1,R or\n"
+                  << "                       mesh:X,Y,Z:file=OBJ|STL[:scale=S], then\n";
+    else
+        std::cout << "  --source SPEC        X,Y[:wave=sine|gauss|mod][:freq=F][:amp=A]\n"
+                  << "                       [:phase=P][:width=W][:delay=D][:batch=K];\n"
+                  << "                       repeatable (default: a sine at the centre)\n"
+                  << "  --batch N            step N scenarios at once (sources pick one with batch=K)\n"
+                  << "  --medium SPEC        box:X0,Y0,X1,Y1, sphere:X,Y,R or\n"
+                  << "                       wire:X0,Y0,X1,Y1,R, then\n";
+    std::cout << "                       [:eps=E][:mu=M][:sigma=S][:drude=WP/GAMMA]\n"
+              << "                       [:lorentz=DEPS/W0/DELTA][:chi3=X]; repeatable\n"
+              << "                       (dispersive media run the two-pass fp32 kernels);\n"
+              << "                       live: Tab selects one, "
+              << (is3d ? "J/L K/I U/O" : "J/L K/I") << " move it\n"
+              << "  --help       show this message\n";
+}
+
+inline RunOptions parse(int argc, char** argv, App app) {
+    RunOptions opts;
+    const bool is3d = (app == APP_3D);
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+
+        if (is3d ? listed(FLAGS_2D, arg) : listed(FLAGS_3D, arg)) {
+            std::cerr << arg << " is a " << (is3d ? "2D_wave" : "3D_wave") << " option\n";
+            exit(EXIT_FAILURE);
+        }
+
+        if (std::strcmp(arg, "--headless") == 0) {
+            opts.headless = true;
+        } else if (std::strcmp(arg, "--steps") == 0 && i + 1 < argc) {
+            opts.steps = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--fused") == 0 && i + 1 < argc) {
+            opts.fusedSteps = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--boundary") == 0 && i + 1 < argc) {
+            std::string b = argv[++i];
+            if (b != "cpml" && b != "sponge") {
+                std::cerr << "--boundary must be cpml or sponge\n";
+                exit(EXIT_FAILURE);
+            }
+            opts.cpml = (b == "cpml");
+        } else if (std::strcmp(arg, "--dense") == 0) {
+            opts.activeTiles = false;
+        } else if (std::strcmp(arg, "--refine") == 0 && i + 1 < argc) {
+            int* r = opts.refine;
+            if (std::sscanf(argv[++i], "%d,%d,%d,%d", &r[0], &r[1], &r[2], &r[3]) != 4 ||
+                r[0] < 0 || r[1] < 0 || r[2] < r[0] + 2 || r[3] < r[1] + 2) {
+                std::cerr << "--refine must be X0,Y0,X1,Y1 with X1 >= X0 + 2, Y1 >= Y0 + 2\n";
+                exit(EXIT_FAILURE);
+            }
+        } else if (std::strcmp(arg, "--refine-ratio") == 0 && i + 1 < argc) {
+            opts.refineRatio = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--workgroup") == 0 && i + 1 < argc) {
+            autotune::Shape shape;
+            if (!autotune::parse(argv[++i], shape) || shape.invocations() > 1024 ||
+                (!is3d && (shape.wg[2] > 1 || shape.march > 1 || shape.tiled))) {
+                std::cerr << (is3d ? "--workgroup must be XxYxZ[/zN][/smem]"
+                                   : "--workgroup must be XxY")
+                          << ", at most 1024 invocations\n";
+                exit(EXIT_FAILURE);
+            }
+            std::copy(shape.wg, shape.wg + 3, opts.workgroup);
+            opts.marchZ       = shape.march;
+            opts.tiledStencil = shape.tiled;
+        } else if (std::strcmp(arg, "--no-autotune") == 0) {
+            opts.autotune = false;
+        } else if (std::strcmp(arg, "--retune") == 0) {
+            opts.retune = true;
+        } else if (std::strcmp(arg, "--layout") == 0 && i + 1 < argc) {
+            std::string l = argv[++i];
+            if (l != "soa" && l != "packed") {
+                std::cerr << "--layout must be soa or packed\n";
+                exit(EXIT_FAILURE);
+            }
+            opts.fieldLayout = (l == "soa") ? grid::LAYOUT_SOA : grid::LAYOUT_PACKED;
+        } else if (std::strcmp(arg, "--index") == 0 && i + 1 < argc) {
+            std::string o = argv[++i];
+            if (o == "linear")      opts.fieldIndex = grid::INDEX_LINEAR;
+            else if (o == "brick")  opts.fieldIndex = grid::INDEX_BRICK;
+            else if (o == "morton") opts.fieldIndex = grid::INDEX_MORTON;
+            else {
+                std::cerr << "--index must be linear, brick or morton\n";
+                exit(EXIT_FAILURE);
+            }
+        } else if (std::strcmp(arg, "--precision") == 0 && i + 1 < argc) {
+            std::string p = argv[++i];
+            if (p == "fp32")       opts.precision = grid::PRECISION_FP32;
+            else if (p == "fp16")  opts.precision = grid::PRECISION_FP16;
+            else if (p == "mixed") opts.precision = grid::PRECISION_MIXED;
+            else {
+                std::cerr << "--precision must be fp32, fp16 or mixed\n";
+                exit(EXIT_FAILURE);
+            }
+        } else if (std::strcmp(arg, "--compare-fp32") == 0) {
+            opts.compareFp32 = true;
+        } else if (std::strcmp(arg, "--backend") == 0 && i + 1 < argc) {
+            std::string b = argv[++i];
+            if (b != "gpu" && b != "cpu") {
+                std::cerr << "--backend must be gpu or cpu\n";
+                exit(EXIT_FAILURE);
+            }
+            opts.cpuBackend = (b == "cpu");
+        } else if (std::strcmp(arg, "--threads") == 0 && i + 1 < argc) {
+            opts.threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--compare-cpu") == 0) {
+            opts.compareCpu = true;
+        } else if (std::strcmp(arg, "--gpu-timers") == 0) {
+            opts.gpuTimers = true;
+        } else if (std::strcmp(arg, "--profile-out") == 0 && i + 1 < argc) {
+            opts.profilePath = argv[++i];
+            opts.gpuTimers   = true;
+        } else if (std::strcmp(arg, "--snapshot-every") == 0 && i + 1 < argc) {
+            opts.snapshotEvery = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--snapshot-dir") == 0 && i + 1 < argc) {
+            opts.snapshotDir = argv[++i];
+        } else if (std::strcmp(arg, "--snapshot-slice") == 0) {
+            opts.snapshotSlice = true;
+        } else if (std::strcmp(arg, "--snapshot-stride") == 0 && i + 1 < argc) {
+            opts.snapshotStride = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--record") == 0 && i + 1 < argc) {
+            opts.recordPath = argv[++i];
+        } else if (std::strcmp(arg, "--record-codec") == 0 && i + 1 < argc) {
+            std::string c = argv[++i];
+            if (c == "raw")           opts.recordCodec = 0;
+            else if (c == "lossless") opts.recordCodec = 1;
+            else if (c == "lossy")    opts.recordCodec = 2;
+            else {
+                std::cerr << "--record-codec must be raw, lossless or lossy\n";
+                exit(EXIT_FAILURE);
+            }
+        } else if (std::strcmp(arg, "--record-error") == 0 && i + 1 < argc) {
+            opts.recordError = float(std::atof(argv[++i]));
+        } else if (std::strcmp(arg, "--replay") == 0 && i + 1 < argc) {
+            opts.replayPath = argv[++i];
+        } else if (std::strcmp(arg, "--checkpoint") == 0 && i + 1 < argc) {
+            opts.checkpointPath = argv[++i];
+        } else if (std::strcmp(arg, "--checkpoint-every") == 0 && i + 1 < argc) {
+            opts.checkpointEvery = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--restart") == 0 && i + 1 < argc) {
+            opts.restartPath = argv[++i];
+        } else if (std::strcmp(arg, "--dft-probe") == 0 && i + 1 < argc) {
+            dft::Box b;
+            if (std::sscanf(argv[++i], "%d,%d,%d,%d,%d,%d", &b.lo[0], &b.lo[1], &b.lo[2],
+                            &b.hi[0], &b.hi[1], &b.hi[2]) != 6 ||
+                b.hi[0] < b.lo[0] || b.hi[1] < b.lo[1] || b.hi[2] < b.lo[2]) {
+                std::cerr << "--dft-probe must be X0,Y0,Z0,X1,Y1,Z1 with X0 <= X1 etc.\n";
+                exit(EXIT_FAILURE);
+            }
+            opts.dftProbes.push_back(b);
+        } else if (std::strcmp(arg, "--dft-freq") == 0 && i + 1 < argc) {
+            for (const char* f = argv[++i]; *f;) {
+                char* end = nullptr;
+                float v   = std::strtof(f, &end);
+                if (end == f || v <= 0.0f) {
+                    std::cerr << "--dft-freq must be a comma-separated list of positive values\n";
+                    exit(EXIT_FAILURE);
+                }
+                opts.dftFreqs.push_back(v);
+                f = (*end == ',') ? end + 1 : end;
+            }
+        } else if (std::strcmp(arg, "--dft-out") == 0 && i + 1 < argc) {
+            opts.dftPath = argv[++i];
+        } else if (std::strcmp(arg, "--ntff") == 0) {
+            opts.ntff = true;
+        } else if (std::strcmp(arg, "--ntff-box") == 0 && i + 1 < argc) {
+            int* b = opts.ntffBox;
+            if (std::sscanf(argv[++i], "%d,%d,%d,%d,%d,%d", &b[0], &b[1], &b[2], &b[3], &b[4],
+                            &b[5]) != 6 ||
+                b[3] <= b[0] || b[4] <= b[1] || b[5] <= b[2]) {
+                std::cerr << "--ntff-box must be X0,Y0,Z0,X1,Y1,Z1 with X0 < X1 etc.\n";
+                exit(EXIT_FAILURE);
+            }
+            opts.ntff = true;
+        } else if (std::strcmp(arg, "--ntff-dirs") == 0 && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%d,%d", &opts.ntffDirs[0], &opts.ntffDirs[1]) != 2) {
+                std::cerr << "--ntff-dirs must be THETAS,PHIS\n";
+                exit(EXIT_FAILURE);
+            }
+        } else if (std::strcmp(arg, "--ntff-every") == 0 && i + 1 < argc) {
+            opts.ntffEvery = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--ntff-out") == 0 && i + 1 < argc) {
+            opts.ntffPath = argv[++i];
+        } else if (std::strcmp(arg, "--arrow-stride") == 0 && i + 1 < argc) {
+            opts.arrowStride = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--arrow-min") == 0 && i + 1 < argc) {
+            opts.arrowMin = float(std::atof(argv[++i]));
+        } else if (std::strcmp(arg, "--stats-every") == 0 && i + 1 < argc) {
+            opts.statsEvery = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--exposure") == 0 && i + 1 < argc) {
+            const char* e = argv[++i];
+            opts.exposure = (std::strcmp(e, "auto") == 0) ? 0.0f : float(std::atof(e));
+            if (opts.exposure <= 0.0f && std::strcmp(e, "auto") != 0) {
+                std::cerr << "--exposure must be auto or a positive scale\n";
+                exit(EXIT_FAILURE);
+            }
+        } else if (std::strcmp(arg, "--watchdog") == 0 && i + 1 < argc) {
+            opts.watchdogGrowth = float(std::atof(argv[++i]));
+        } else if (std::strcmp(arg, "--shader-cache") == 0 && i + 1 < argc) {
+            opts.shaderCache = argv[++i];
+            if (opts.shaderCache == "off") opts.shaderCache.clear();
+        } else if (std::strcmp(arg, "--scene") == 0 && i + 1 < argc) {
+            opts.scenePath = argv[++i];
+        } else if (std::strcmp(arg, "--vram-mb") == 0 && i + 1 < argc) {
+            opts.vramMB = std::atoi(argv[++i]);
+            if (opts.vramMB <= 0) {
+                std::cerr << "--vram-mb must be positive\n";
+                exit(EXIT_FAILURE);
+            }
+        } else if (std::strcmp(arg, "--fit-vram") == 0) {
+            opts.fitVram = true;
+        } else if (std::strcmp(arg, "--grid") == 0 && i + 1 < argc) {
+            const char* g = argv[++i];
+            int n = std::sscanf(g, "%dx%dx%d", &opts.gridNx, &opts.gridNy, &opts.gridNz);
+            if (n < 2 || (!is3d && n == 3) || opts.gridNx <= 0 || opts.gridNy <= 0 ||
+                (n == 3 && opts.gridNz <= 0)) {
+                std::cerr << (is3d ? "--grid must be NXxNY or NXxNYxNZ\n" : "--grid must be NXxNY\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (std::strcmp(arg, "--steps-per-frame") == 0 && i + 1 < argc) {
+            opts.stepsPerFrame = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--frame-budget") == 0 && i + 1 < argc) {
+            opts.frameBudgetMs = std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--source-freq") == 0 && i + 1 < argc) {
+            opts.sourceFreq = float(std::atof(argv[++i]));
+        } else if (std::strcmp(arg, "--source-amp") == 0 && i + 1 < argc) {
+            opts.sourceAmp = float(std::atof(argv[++i]));
+        } else if (std::strcmp(arg, "--source") == 0 && i + 1 < argc) {
+            opts.sources.push_back(argv[++i]);
+        } else if (std::strcmp(arg, "--medium") == 0 && i + 1 < argc) {
+            opts.media.push_back(argv[++i]);
+        } else if (std::strcmp(arg, "--batch") == 0 && i + 1 < argc) {
+            opts.batch = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0) {
+            printUsage(argv[0], app);
+            exit(EXIT_SUCCESS);
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            printUsage(argv[0], app);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (opts.steps < 0) {
+        std::cerr << "--steps must be non-negative\n";
+        exit(EXIT_FAILURE);
+    }
+    if (opts.stepsPerFrame < 0 || opts.sourceFreq < 0.0f) {
+        std::cerr << "--steps-per-frame and --source-freq must be positive\n";
+        exit(EXIT_FAILURE);
+    }
+    if (opts.frameBudgetMs < 0.0) {
+        std::cerr << "--frame-budget must be non-negative\n";
+        exit(EXIT_FAILURE);
+    }
+    if (opts.frameBudgetMs > 0.0 && opts.headless) {
+        std::cout << "Headless runs are not paced; ignoring --frame-budget\n";
+        opts.frameBudgetMs = 0.0;
+    }
+    if (opts.snapshotEvery < 0 || opts.snapshotStride < 1) {
+        std::cerr << "--snapshot-every must be non-negative and --snapshot-stride positive\n";
+        exit(EXIT_FAILURE);
+    }
+    if (opts.recordError <= 0.0f) {
+        std::cerr << "--record-error must be positive\n";
+        exit(EXIT_FAILURE);
+    }
+    if (!opts.recordPath.empty()) {
+        if (opts.snapshotEvery == 0) {
+            std::cout << "--record without --snapshot-every: recording every 10 steps\n";
+            opts.snapshotEvery = 10;
+        }
+        if (opts.snapshotSlice) {
+            std::cout << "Recordings hold whole volumes; ignoring --snapshot-slice\n";
+            opts.snapshotSlice = false;
+        }
+    }
+    if (opts.checkpointEvery < 0) {
+        std::cerr << "--checkpoint-every must be non-negative\n";
+        exit(EXIT_FAILURE);
+    }
+    if (!opts.checkpointPath.empty() && opts.checkpointEvery == 0) {
+        std::cout << "--checkpoint without --checkpoint-every: checkpointing every 1000 steps\n";
+        opts.checkpointEvery = 1000;
+    }
+    // The Huygens box takes six probe slots, one per face
+    size_t probeSlots = opts.dftProbes.size() + (opts.ntff ? 6 : 0);
+    if (opts.dftFreqs.size() > size_t(dft::MAX_FREQS) || probeSlots > size_t(dft::MAX_PROBES)) {
+        std::cerr << "At most " << dft::MAX_FREQS << " DFT frequencies and " << dft::MAX_PROBES
+                  << " probes (a Huygens box counts as 6)\n";
+        exit(EXIT_FAILURE);
+    }
+    if (opts.ntffDirs[0] < 2 || opts.ntffDirs[1] < 1 ||
+        opts.ntffDirs[0] * opts.ntffDirs[1] > ntff::MAX_DIRECTIONS || opts.ntffEvery < 0) {
+        std::cerr << "--ntff-dirs needs at least 2 thetas and 1 phi (at most "
+                  << ntff::MAX_DIRECTIONS << " directions); --ntff-every must be non-negative\n";
+        exit(EXIT_FAILURE);
+    }
+    if (opts.arrowStride < 1 || opts.arrowMin < 0.0f) {
+        std::cerr << "--arrow-stride must be positive and --arrow-min non-negative\n";
+        exit(EXIT_FAILURE);
+    }
+    if (opts.statsEvery < 0 || (opts.watchdogGrowth != 0.0f && opts.watchdogGrowth <= 1.0f)) {
+        std::cerr << "--stats-every must be non-negative and --watchdog above 1 (or 0)\n";
+        exit(EXIT_FAILURE);
+    }
+    if (opts.statsEvery == 0 && opts.exposure == 0.0f) {
+        if (!opts.headless)
+            std::cout << "--stats-every 0: no auto exposure, fixed colour scale "
+                      << stats::DEFAULT_SCALE << "\n";
+        opts.exposure = stats::DEFAULT_SCALE;
+    }
+    if (!opts.dftFreqs.empty() && probeSlots == 0)
+        std::cout << "--dft-freq without --dft-probe: no DFT accumulated\n";
+    if (opts.fusedSteps < 0) {
+        std::cerr << "--fused must be non-negative\n";
+        exit(EXIT_FAILURE);
+    }
+    if (opts.threads < 0) {
+        std::cerr << "--threads must be non-negative\n";
+        exit(EXIT_FAILURE);
+    }
+    if (opts.cpuBackend) {
+        // The host solver is one fp32 linear grid stepped in two passes
+        if (opts.snapshotEvery > 0 || !opts.checkpointPath.empty() ||
+            !opts.restartPath.empty() || !opts.replayPath.empty() || !opts.dftProbes.empty() ||
+            opts.ntff) {
+            std::cerr << "--backend cpu does not support snapshots, recordings, checkpoints, DFT "
+                         "probes or NTFF\n";
+            exit(EXIT_FAILURE);
+        }
+        if (!opts.headless) {
+            std::cout << "The CPU backend runs headless\n";
+            opts.headless = true;
+        }
+        if (opts.fusedSteps > 0 || opts.precision != grid::PRECISION_FP32 ||
+            opts.fieldLayout != grid::LAYOUT_SOA || opts.fieldIndex != grid::INDEX_LINEAR) {
+            std::cout << "The CPU backend uses fp32 SoA linear storage and two passes\n";
+            opts.fusedSteps  = 0;
+            opts.precision   = grid::PRECISION_FP32;
+            opts.fieldLayout = grid::LAYOUT_SOA;
+            opts.fieldIndex  = grid::INDEX_LINEAR;
+        }
+        if (opts.batch > 1) {
+            std::cout << "The CPU backend steps one scenario; ignoring --batch\n";
+            opts.batch = 1;
+        }
+        opts.compareCpu  = false;
+        opts.compareFp32 = false;
+    }
+    if (opts.compareCpu &&
+        (!opts.headless || opts.precision != grid::PRECISION_FP32 || !opts.restartPath.empty())) {
+        std::cout << "--compare-cpu needs --headless, fp32 storage and no --restart\n";
+        opts.compareCpu = false;
+    }
+    if (opts.refineRatio < 2 || opts.refineRatio > 8) {
+        std::cerr << "--refine-ratio must be between 2 and 8\n";
+        exit(EXIT_FAILURE);
+    }
+    if (opts.refine[2] > 0) {
+        if (opts.fusedSteps > 0) {
+            std::cout << "A refined patch uses the two-pass kernels\n";
+            opts.fusedSteps = 0;
+        }
+        if (opts.compareCpu) {
+            std::cout << "The CPU solver has no refined patch; ignoring --compare-cpu\n";
+            opts.compareCpu = false;
+        }
+        opts.activeTiles = false;  // restriction writes coarse cells the tiles do not track
+    }
+    if (opts.batch < 1) {
+        std::cerr << "--batch must be positive\n";
+        exit(EXIT_FAILURE);
+    }
+    if (opts.batch > 1) {
+        if (opts.refine[2] > 0) {
+            std::cerr << "--batch does not support a refined patch\n";
+            exit(EXIT_FAILURE);
+        }
+        opts.activeTiles = false;  // the tile mask covers one layer
+    }
+    if (opts.fusedSteps > 0 && opts.precision != grid::PRECISION_FP32) {
+        std::cout << "Reduced-precision storage uses the two-pass kernels\n";
+        opts.fusedSteps = 0;
+    }
+    if (opts.compareFp32 && (!opts.headless || opts.precision == grid::PRECISION_FP32)) {
+        std::cout << "--compare-fp32 needs --headless and --precision fp16 or mixed\n";
+        opts.compareFp32 = false;
+    }
+    if (opts.fusedSteps > 0 && opts.cpml) {
+        std::cout << "Fused kernels use the sponge boundary (CPML needs per-pass corrections)\n";
+        opts.cpml = false;
+    }
+    if (opts.headless && opts.steps == 0)
+        opts.steps = 1000;
+
+    return opts;
+}
+
+// Sustained solver throughput over a timed batch of steps
+inline void printThroughput(int steps, double seconds, long long cellsPerStep) {
+    double stepsPerSec = (seconds > 0.0) ? steps / seconds : 0.0;
+    double cellsPerSec = stepsPerSec * static_cast<double>(cellsPerStep);
+
+    std::cout << "\n=== Headless run ===\n"
+              << "  Steps         : " << steps << "\n"
+              << "  Wall time     : " << seconds << " s\n"
+              << "  Steps/s       : " << stepsPerSec << "\n"
+              << "  Cell-updates/s: " << cellsPerSec / 1.0e6 << " M\n";
+}
+
+} // namespace cli
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Colour maps as 1D lookup textures, read from assets/colormaps/*.lut: one
+// "r g b" line per entry, '#' comment lines, the entries spread evenly over
+// the mapped range. shaders/colormap.glsl samples them (linear filtering
+// between entries), so a map is changed by editing its file, not a shader.
+// Both maps stay bound on their own units above the ones the views use.
+namespace colormap {
+
+constexpr int DIVERGING_UNIT  = 1;  // signed components, [-1, 1]
+constexpr int SEQUENTIAL_UNIT = 2;  // magnitudes, [0, 1]
+
+inline std::string defines() {
+    return "#define COLORMAP_DIVERGING_UNIT " + std::to_string(DIVERGING_UNIT) + "\n"
+         + "#define COLORMAP_SEQUENTIAL_UNIT " + std::to_string(SEQUENTIAL_UNIT) + "\n";
+}
+
+inline std::vector<float> loadLut(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open colormap: " << path << "\n";
+        exit(EXIT_FAILURE);
+    }
+    std::vector<float> rgb;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream in(line);
+        float r, g, b;
+        if (!(in >> r >> g >> b)) {
+            std::cerr << "Malformed colormap entry in " << path << ": " << line << "\n";
+            exit(EXIT_FAILURE);
+        }
+        rgb.insert(rgb.end(), {r, g, b});
+    }
+    if (rgb.size() < 2 * 3) {
+        std::cerr << "Colormap needs at least two entries: " << path << "\n";
+        exit(EXIT_FAILURE);
+    }
+    return rgb;
+}
+
+struct Maps {
+    GLuint diverging  = 0;
+    GLuint sequential = 0;
+
+    // Float texels, so the glow above 1 survives into the volume compositing
+    static GLuint upload(const std::vector<float>& rgb) {
+        GLuint tex;
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_1D, tex);
+        glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB16F, GLsizei(rgb.size() / 3), 0, GL_RGB, GL_FLOAT,
+                     rgb.data());
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_1D, 0);
+        return tex;
+    }
+
+    void init(const std::string& dir = "assets/colormaps") {
+        diverging  = upload(loadLut(dir + "/diverging.lut"));
+        sequential = upload(loadLut(dir + "/sequential.lut"));
+        bind();
+    }
+
+    void bind() const {
+        glActiveTexture(GL_TEXTURE0 + DIVERGING_UNIT);
+        glBindTexture(GL_TEXTURE_1D, diverging);
+        glActiveTexture(GL_TEXTURE0 + SEQUENTIAL_UNIT);
+        glBindTexture(GL_TEXTURE_1D, sequential);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void cleanup() {
+        glDeleteTextures(1, &diverging);
+        glDeleteTextures(1, &sequential);
+        diverging = sequential = 0;
+    }
+};
+
+} // namespace colormap
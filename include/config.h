@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "cli.h"
+#include "media.h"
+#include "sources.h"
+
+// Run-time scene parameters: grid size, steps per frame, sources and media. Each
+// entry point starts from its own defaults, then applies a scene file
+// (--scene) and finally the command-line overrides, so grid experiments
+// need neither a rebuild nor a shader recompile.
+//
+// Scene files hold one `key = value` per line; `#` starts a comment.
+//   nx = 256            grid cells per axis (nz ignored by 2D)
+//   ny = 256
+//   nz = 128
+//   steps_per_frame = 2
+//   source_freq = 0.05  normalized frequency
+//   source_amp  = 1.0
+//   source = 64,64:wave=gauss    one more source (sources.h), repeatable;
+//                               none = a sine at the grid centre
+//   medium = sphere:96,64,12:drude=0.6/0.02   one more medium (media.h),
+//                               repeatable; none = vacuum
+namespace config {
+
+struct Scene {
+    int   nx            = 0;
+    int   ny            = 0;
+    int   nz            = 1;     // 1 for the 2D entry point
+    int   stepsPerFrame = 1;
+    float sourceFreq    = 0.0f;
+    float sourceAmp     = 1.0f;
+    std::vector<sources::Source> sources;  // empty = the default source
+    std::vector<media::Region>   media;    // empty = vacuum
+
+    size_t cells() const { return size_t(nx) * ny * nz; }
+
+    bool sameGrid(const Scene& o) const {
+        return nx == o.nx && ny == o.ny && nz == o.nz;
+    }
+
+    bool sameMedia(const Scene& o) const {
+        if (media.size() != o.media.size()) return false;
+        for (size_t i = 0; i < media.size(); ++i)
+            if (media[i].spec != o.media[i].spec ||
+                !std::equal(media[i].offset, media[i].offset + 3, o.media[i].offset))
+                return false;  // a nudged object reloads at its given place
+        return true;
+    }
+};
+
+// Overlay the keys found in `path` onto `scene`; false (scene untouched) on
+// a missing file or a bad line. `source` / `medium` lines replace the
+// scene's sources / media.
+inline bool load(const std::string& path, Scene& scene, bool is3d) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open scene file: " << path << "\n";
+        return false;
+    }
+
+    Scene s = scene;
+    bool  sourcesGiven = false;
+    bool  mediaGiven   = false;
+    std::string line;
+    for (int lineNo = 1; std::getline(file, line); ++lineNo) {
+        line = line.substr(0, line.find('#'));
+        size_t eq = line.find('=');
+        std::istringstream keyIn(line.substr(0, eq));
+        std::string key;
+        if (!(keyIn >> key)) continue;  // blank or comment-only line
+
+        std::istringstream valueIn(eq == std::string::npos ? "" : line.substr(eq + 1));
+        bool ok = false;
+        if (key == "nx")                   ok = bool(valueIn >> s.nx);
+        else if (key == "ny")              ok = bool(valueIn >> s.ny);
+        else if (key == "nz")              ok = bool(valueIn >> s.nz);
+        else if (key == "steps_per_frame") ok = bool(valueIn >> s.stepsPerFrame);
+        else if (key == "source_freq")     ok = bool(valueIn >> s.sourceFreq);
+        else if (key == "source_amp")      ok = bool(valueIn >> s.sourceAmp);
+        else if (key == "source") {
+            std::string spec;
+            sources::Source src;
+            ok = bool(valueIn >> spec) && sources::parse(spec, is3d, src);
+            if (ok && !sourcesGiven) s.sources.clear();
+            if (ok) s.sources.push_back(src);
+            sourcesGiven = true;
+        } else if (key == "medium") {
+            std::string spec;
+            media::Region region;
+            ok = bool(valueIn >> spec) && media::parse(spec, is3d, region);
+            if (ok && !mediaGiven) s.media.clear();
+            if (ok) s.media.push_back(region);
+            mediaGiven = true;
+        }
+
+        if (!ok) {
+            std::cerr << path << ":" << lineNo << ": bad scene entry '" << key << "'\n";
+            return false;
+        }
+    }
+    scene = s;
+    return true;
+}
+
+// Grid must leave an interior inside the absorbing boundary on every axis,
+// and every source must lie in the grid (and in one of `layers` 2D batch
+// scenarios)
+inline bool validate(const Scene& s, int boundaryWidth, bool is3d, int layers = 1) {
+    int minCells = 2 * boundaryWidth + 8;
+    if (s.nx < minCells || s.ny < minCells || (is3d && s.nz < minCells)) {
+        std::cerr << "Grid " << s.nx << "x" << s.ny;
+        if (is3d) std::cerr << "x" << s.nz;
+        std::cerr << " too small: need at least " << minCells << " cells per axis\n";
+        return false;
+    }
+    if (s.stepsPerFrame < 1) {
+        std::cerr << "steps_per_frame must be at least 1\n";
+        return false;
+    }
+    int dims[3] = {s.nx, s.ny, s.nz};
+    return sources::validate(s.sources, dims, layers);
+}
+
+// Defaults, then the scene file, then command-line overrides. Also used for
+// live reloads, so errors are reported rather than fatal.
+inline bool resolve(const Scene& defaults, const cli::RunOptions& opts,
+                    int boundaryWidth, bool is3d, Scene& out) {
+    Scene s = defaults;
+    if (!opts.scenePath.empty() && !load(opts.scenePath, s, is3d))
+        return false;
+
+    if (opts.gridNx > 0) s.nx = opts.gridNx;
+    if (opts.gridNy > 0) s.ny = opts.gridNy;
+    if (opts.gridNz > 0) s.nz = opts.gridNz;
+    if (opts.stepsPerFrame > 0)  s.stepsPerFrame = opts.stepsPerFrame;
+    if (opts.sourceFreq > 0.0f)  s.sourceFreq    = opts.sourceFreq;
+    if (opts.sourceAmp != 0.0f)  s.sourceAmp     = opts.sourceAmp;
+    if (!is3d) s.nz = 1;
+    if (!opts.sources.empty()) s.sources.clear();
+    for (const std::string& spec : opts.sources) {
+        sources::Source src;
+        if (!sources::parse(spec, is3d, src)) return false;
+        s.sources.push_back(src);
+    }
+    if (!opts.media.empty()) s.media.clear();
+    for (const std::string& spec : opts.media) {
+        media::Region region;
+        if (!media::parse(spec, is3d, region)) return false;
+        s.media.push_back(region);
+    }
+
+    if (!validate(s, boundaryWidth, is3d, is3d ? 1 : opts.batch))
+        return false;
+    out = s;
+    return true;
+}
+
+} // namespace config
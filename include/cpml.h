@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+// Convolutional PML (Roden & Gedney) with kappa = 1.
+//
+// The main kernels run the plain vacuum/material update everywhere; a
+// correction pass over the boundary slabs then adds the recursive-convolution
+// terms  psi = b * psi + a * dF/du  to the fields. psi storage is allocated
+// per slab only: an x-slab is the 2*width cells at both x ends of every row,
+// indexed by slab position s in [0, 2*width).
+namespace cpml {
+
+// Per-slab-position recursion coefficients — matches GLSL `vec4 cpmlCoeffs[]`.
+// psi accumulates raw neighbour differences (like the main kernels), so it is
+// scaled by the same cb/db curl coefficient when applied.
+struct Coeffs {
+    float bE, aE;  // E-field psi (integer positions along the axis)
+    float bH, aH;  // H-field psi (half-cell offset positions)
+};
+
+struct Params {
+    int   width    = 10;     // cells per side
+    int   order    = 3;      // polynomial grading of sigma
+    float alphaMax = 0.05f;  // CFS alpha at the interface (absorbs low frequencies)
+};
+
+// Slab position s -> grid index along an axis of length n (and back)
+inline int slabToGrid(int s, int n, int width) {
+    return (s < width) ? s : n - 2 * width + s;
+}
+
+inline bool inSlab(int i, int n, int width) {
+    return i < width || i >= n - width;
+}
+
+// Normalized depth into the layer for a field sample at position p.
+// The low interface sits at p = width, the high one at p = n - width - 0.5,
+// so every sample with non-zero depth falls inside the slab cells.
+inline float depth(float p, int n, int width) {
+    float lo = (float(width) - p) / float(width);
+    float hi = (p - (float(n - width) - 0.5f)) / float(width);
+    return std::fmax(0.0f, std::fmin(1.0f, std::fmax(lo, hi)));
+}
+
+// Coefficient table for one axis (identical for every axis: it only depends
+// on the slab position). eps0 = mu0 = 1 and eta = 1 in normalized units.
+inline std::vector<Coeffs> buildProfile(const Params& p, int n, float dt, float dx) {
+    const float sigmaMax = 0.8f * float(p.order + 1) / dx;  // ~optimal for eta = 1
+
+    auto recursion = [&](float rho, float& b, float& a) {
+        float sigma = sigmaMax * std::pow(rho, float(p.order));
+        float alpha = p.alphaMax * (1.0f - rho);
+        b = std::exp(-(sigma + alpha) * dt);
+        a = (sigma + alpha > 0.0f) ? sigma / (sigma + alpha) * (b - 1.0f) : 0.0f;
+    };
+
+    std::vector<Coeffs> table(2 * p.width);
+    for (int s = 0; s < 2 * p.width; ++s) {
+        int i = slabToGrid(s, n, p.width);
+        recursion(depth(float(i),        n, p.width), table[s].bE, table[s].aE);
+        recursion(depth(float(i) + 0.5f, n, p.width), table[s].bH, table[s].aH);
+    }
+    return table;
+}
+
+} // namespace cpml
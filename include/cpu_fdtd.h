@@ -0,0 +1,579 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "cpml.h"
+#include "em_common.h"
+#include "materials.h"
+#include "media.h"
+#include "sources.h"
+
+// CPU reference / fallback FDTD solver. It runs the update equations of
+// maxwell.comp / maxwell3d.comp and the corrections of cpml.comp /
+// cpml3d.comp, in the same order. It takes the same SimParams / SimParams3D
+// the kernels read from their UBO, plus the same coefficient map, CPML
+// profile and source records the GPU engines upload.
+//
+// Fields are fp32 SoA planes in grid::idx2d / idx3d order, laid out like
+// the engines' readFields(), so results compare directly. The coefficient
+// table is expanded to per-cell ca/cb/da/db planes, which keeps the x loops
+// free of gathers.
+//
+// Each x row runs as SIMD vectors plus a scalar tail:
+// - AVX-512, AVX, SSE2 or NEON: the widest the compiler targets;
+// - EMWAVE_CPU_NATIVE in CMake builds for the host ISA.
+// Rows are grouped into tiles of TILE_ROWS consecutive y (one z plane in
+// 3D) so neighbour rows stay in cache, and a thread pool claims tiles
+// dynamically.
+namespace cpu {
+
+constexpr int    TILE_ROWS = 8;     // y rows per work item
+constexpr double TOLERANCE = 1e-4;  // max |GPU - CPU| relative to the peak |field|
+
+// ── SIMD ──
+
+#if defined(__AVX512F__)
+struct Vec {
+    static constexpr int N = 16;
+    __m512 v;
+    static Vec load(const float* p) { return {_mm512_loadu_ps(p)}; }
+    void store(float* p) const { _mm512_storeu_ps(p, v); }
+    friend Vec operator+(Vec a, Vec b) { return {_mm512_add_ps(a.v, b.v)}; }
+    friend Vec operator-(Vec a, Vec b) { return {_mm512_sub_ps(a.v, b.v)}; }
+    friend Vec operator*(Vec a, Vec b) { return {_mm512_mul_ps(a.v, b.v)}; }
+};
+inline const char* isaName() { return "AVX-512"; }
+#elif defined(__AVX__)
+struct Vec {
+    static constexpr int N = 8;
+    __m256 v;
+    static Vec load(const float* p) { return {_mm256_loadu_ps(p)}; }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+    friend Vec operator+(Vec a, Vec b) { return {_mm256_add_ps(a.v, b.v)}; }
+    friend Vec operator-(Vec a, Vec b) { return {_mm256_sub_ps(a.v, b.v)}; }
+    friend Vec operator*(Vec a, Vec b) { return {_mm256_mul_ps(a.v, b.v)}; }
+};
+inline const char* isaName() { return "AVX"; }
+#elif defined(__SSE2__) || defined(_M_X64)
+struct Vec {
+    static constexpr int N = 4;
+    __m128 v;
+    static Vec load(const float* p) { return {_mm_loadu_ps(p)}; }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+    friend Vec operator+(Vec a, Vec b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend Vec operator-(Vec a, Vec b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend Vec operator*(Vec a, Vec b) { return {_mm_mul_ps(a.v, b.v)}; }
+};
+inline const char* isaName() { return "SSE2"; }
+#elif defined(__ARM_NEON)
+struct Vec {
+    static constexpr int N = 4;
+    float32x4_t v;
+    static Vec load(const float* p) { return {vld1q_f32(p)}; }
+    void store(float* p) const { vst1q_f32(p, v); }
+    friend Vec operator+(Vec a, Vec b) { return {vaddq_f32(a.v, b.v)}; }
+    friend Vec operator-(Vec a, Vec b) { return {vsubq_f32(a.v, b.v)}; }
+    friend Vec operator*(Vec a, Vec b) { return {vmulq_f32(a.v, b.v)}; }
+};
+inline const char* isaName() { return "NEON"; }
+#else
+#define EMWAVE_CPU_SCALAR
+inline const char* isaName() { return "scalar"; }
+#endif
+
+// One lane with the Vec interface, for row tails
+struct Scalar {
+    static constexpr int N = 1;
+    float v;
+    static Scalar load(const float* p) { return {*p}; }
+    void store(float* p) const { *p = v; }
+    friend Scalar operator+(Scalar a, Scalar b) { return {a.v + b.v}; }
+    friend Scalar operator-(Scalar a, Scalar b) { return {a.v - b.v}; }
+    friend Scalar operator*(Scalar a, Scalar b) { return {a.v * b.v}; }
+};
+#ifdef EMWAVE_CPU_SCALAR
+using Vec = Scalar;
+#endif
+
+// body(V{}, i) for i in [begin, end): Vec-wide steps, then single lanes
+template <typename Body>
+inline void simdFor(int begin, int end, Body&& body) {
+    int i = begin;
+    for (; i + Vec::N <= end; i += Vec::N) body(Vec{}, i);
+    for (; i < end; ++i) body(Scalar{}, i);
+}
+
+// ── Thread pool ──
+
+// Persistent workers; run(n, fn) calls fn(i) for every i in [0, n) across
+// the workers and the calling thread, claiming items one at a time
+struct ThreadPool {
+    std::vector<std::thread> workers;
+    std::mutex               mutex;
+    std::condition_variable  wake, done;
+    const std::function<void(int)>* job = nullptr;
+    std::atomic<int> next{0};
+    int      count      = 0;
+    int      pending    = 0;   // workers still on the current job
+    uint64_t generation = 0;
+    bool     quit       = false;
+
+    // threads <= 0: one per hardware thread (the caller is one of them)
+    void start(int threads) {
+        if (threads <= 0) threads = int(std::max(1u, std::thread::hardware_concurrency()));
+        for (int i = 1; i < threads; ++i)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    int threads() const { return int(workers.size()) + 1; }
+
+    void run(int n, const std::function<void(int)>& fn) {
+        if (workers.empty() || n <= 1) {
+            for (int i = 0; i < n; ++i) fn(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job     = &fn;
+            count   = n;
+            next    = 0;
+            pending = int(workers.size());
+            ++generation;
+        }
+        wake.notify_all();
+        work();
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return pending == 0; });
+        job = nullptr;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) t.join();
+        workers.clear();
+    }
+
+    ~ThreadPool() { stop(); }
+
+    void work() {
+        for (int i; (i = next.fetch_add(1)) < count;) (*job)(i);
+    }
+
+    void workerLoop() {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || generation != seen; });
+                if (quit) return;
+                seen = generation;
+            }
+            work();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) done.notify_one();
+        }
+    }
+};
+
+// ── Shared setup ──
+
+// Per-cell ca/cb/da/db planes from the 16-bit IDs + table
+struct CoeffPlanes {
+    std::vector<float> ca, cb, da, db;
+
+    void expand(const materials::CoeffMap& map, size_t cells) {
+        ca.resize(cells); cb.resize(cells); da.resize(cells); db.resize(cells);
+        for (size_t i = 0; i < cells; ++i) {
+            uint32_t id = (map.packedIds[i >> 1] >> ((i & 1) * 16)) & 0xFFFFu;
+            const materials::Coeffs& c = map.table[id];
+            ca[i] = c.ca; cb[i] = c.cb; da[i] = c.da; db[i] = c.db;
+        }
+    }
+};
+
+// The soft sources of one step, in table order (shaders/sources.glsl):
+// fn(cell index, axis, value) per driven component
+template <typename Fn>
+inline void driveSources(const std::vector<sources::Record>& records, int nx, int ny,
+                         float t, Fn&& fn) {
+    for (const sources::Record& r : records) {
+        float  w    = sources::waveAt(r, t);
+        size_t cell = (size_t(r.cell[2]) * ny + r.cell[1]) * nx + r.cell[0];
+        for (int a = 0; a < 3; ++a)
+            if (r.drive[a] != 0.0f) fn(cell, a, r.drive[a] * w);
+    }
+}
+
+// The ADE step of every dispersive cell (shaders/media2d.comp /
+// media3d.comp): `e[c]` is component c's plane, `cb` the cells' coefficient
+template <size_t N>
+inline void stepMedia(const media::Plan& plan, std::vector<float>& state, int nx, int ny,
+                      float* const (&e)[N], const std::vector<float>& cb, float cbScale) {
+    for (size_t i = 0; i < plan.count(); ++i) {
+        const int32_t*       cell = &plan.cells[4 * i];
+        const media::Record& m    = plan.media[cell[3]];
+        size_t f = (size_t(cell[2]) * ny + cell[1]) * nx + cell[0];
+        float* s = state.data() + m.range[1] + (i - m.range[0]) * m.range[3] * N;
+        float  v[N];
+        for (size_t c = 0; c < N; ++c) v[c] = e[c][f];
+        media::step(m, s, v, cb[f] * cbScale, int(N));
+        for (size_t c = 0; c < N; ++c) e[c][f] = v[c];
+    }
+}
+
+// ── 2D TMz ──
+
+struct Solver2D {
+    SimParams   p{};
+    int         W = 0;                   // CPML width (0 = sponge in the coefficients)
+    std::vector<float> fields;           // Ez, Hx, Hy planes (as 2D readFields)
+    float*      Ez = nullptr;
+    float*      Hx = nullptr;
+    float*      Hy = nullptr;
+    CoeffPlanes c;
+    std::vector<float>         psi[2];   // x-, y-slab boxes: (psiE, psiH) per cell
+    std::vector<cpml::Coeffs>  profile;
+    std::vector<sources::Record> records;  // one layer: z = 0
+    media::Plan        media;
+    std::vector<float> mediaState;       // one layer
+    ThreadPool  pool;
+
+    void init(const SimParams& params, const materials::CoeffMap& map, int pmlWidth,
+              const std::vector<cpml::Coeffs>& pmlProfile,
+              const std::vector<sources::Record>& sourceRecords, const media::Plan& dispersive,
+              int threads) {
+        p = params;
+        W = pmlWidth;
+        records = sourceRecords;
+        media   = dispersive;
+        mediaState.assign(media.stateFloats, 0.0f);
+        const size_t cells = size_t(p.nx) * p.ny;
+        fields.assign(3 * cells, 0.0f);
+        Ez = fields.data();
+        Hx = Ez + cells;
+        Hy = Hx + cells;
+        c.expand(map, cells);
+        profile = pmlProfile;
+        if (W > 0) {
+            psi[0].assign(size_t(2 * W) * p.ny * 2, 0.0f);
+            psi[1].assign(size_t(p.nx) * 2 * W * 2, 0.0f);
+        }
+        pool.start(threads);
+    }
+
+    int tiles() const { return (p.ny + TILE_ROWS - 1) / TILE_ROWS; }
+
+    void step(int stepBase) {
+        const int nx = p.nx, ny = p.ny;
+
+        // H: Hx -= db * dEz/dy, Hy += db * dEz/dx
+        pool.run(tiles(), [&](int tile) {
+            for (int y = tile * TILE_ROWS; y < std::min(ny, (tile + 1) * TILE_ROWS); ++y) {
+                const size_t r = size_t(y) * nx;
+                if (y < ny - 1)
+                    simdFor(0, nx, [&](auto v, int x) {
+                        using V = decltype(v);
+                        size_t i = r + x;
+                        V h = V::load(c.da.data() + i) * V::load(Hx + i) -
+                              V::load(c.db.data() + i) * (V::load(Ez + i + nx) - V::load(Ez + i));
+                        h.store(Hx + i);
+                    });
+                simdFor(0, nx - 1, [&](auto v, int x) {
+                    using V = decltype(v);
+                    size_t i = r + x;
+                    V h = V::load(c.da.data() + i) * V::load(Hy + i) +
+                          V::load(c.db.data() + i) * (V::load(Ez + i + 1) - V::load(Ez + i));
+                    h.store(Hy + i);
+                });
+            }
+        });
+        if (W > 0) cpml(0);
+
+        // E: Ez = ca * Ez + cb * (dHy/dx - dHx/dy) on interior cells
+        pool.run(tiles(), [&](int tile) {
+            for (int y = std::max(1, tile * TILE_ROWS);
+                 y < std::min(ny - 1, (tile + 1) * TILE_ROWS); ++y) {
+                const size_t r = size_t(y) * nx;
+                simdFor(1, nx - 1, [&](auto v, int x) {
+                    using V = decltype(v);
+                    size_t i = r + x;
+                    V e = V::load(c.ca.data() + i) * V::load(Ez + i) +
+                          V::load(c.cb.data() + i) * ((V::load(Hy + i) - V::load(Hy + i - 1)) -
+                                                      (V::load(Hx + i) - V::load(Hx + i - nx)));
+                    e.store(Ez + i);
+                });
+            }
+        });
+        driveSources(records, nx, ny, float(stepBase) * p.dt,
+                     [&](size_t i, int, float v) { Ez[i] += v; });
+        if (W > 0) cpml(1);
+        float* const e[1] = {Ez};
+        stepMedia(media, mediaState, nx, ny, e, c.cb, p.dx / p.dt);
+    }
+
+    // cpml.comp over the x-slab box (2W x ny), then the y-slab box (nx x 2W)
+    void cpml(int updateStep) {
+        const int nx = p.nx, ny = p.ny;
+        for (int a = 0; a < 2; ++a) {
+            const int boxW = (a == 0) ? 2 * W : nx;
+            const int boxH = (a == 0) ? ny : 2 * W;
+            float* ps = psi[a].data();
+            pool.run(boxH, [&](int j) {
+                for (int i = 0; i < boxW; ++i) {
+                    int s = (a == 0) ? i : j;
+                    int x = (a == 0) ? cpml::slabToGrid(i, nx, W) : i;
+                    int y = (a == 0) ? j : cpml::slabToGrid(j, ny, W);
+                    size_t f = size_t(y) * nx + x;
+                    float* pe = ps + (size_t(j) * boxW + i) * 2;
+                    const cpml::Coeffs& k = profile[s];
+                    if (updateStep == 0) {
+                        if (a == 0 && x < nx - 1) {
+                            pe[1] = k.bH * pe[1] + k.aH * (Ez[f + 1] - Ez[f]);
+                            Hy[f] += c.db[f] * pe[1];
+                        } else if (a == 1 && y < ny - 1) {
+                            pe[1] = k.bH * pe[1] + k.aH * (Ez[f + nx] - Ez[f]);
+                            Hx[f] -= c.db[f] * pe[1];
+                        }
+                    } else {
+                        if (x <= 0 || x >= nx - 1 || y <= 0 || y >= ny - 1) continue;
+                        if (a == 0) {
+                            pe[0] = k.bE * pe[0] + k.aE * (Hy[f] - Hy[f - 1]);
+                            Ez[f] += c.cb[f] * pe[0];
+                        } else {
+                            pe[0] = k.bE * pe[0] + k.aE * (Hx[f] - Hx[f - nx]);
+                            Ez[f] -= c.cb[f] * pe[0];
+                        }
+                    }
+                }
+            });
+        }
+    }
+};
+
+// ── 3D Yee ──
+
+struct Solver3D {
+    SimParams3D p{};
+    int         W = 0;
+    std::vector<float> fields;           // Ex..Hz planes (as 3D readFields)
+    float*      F[6] = {};
+    CoeffPlanes c;
+    std::vector<float>         psi[3];   // slab boxes, 4 floats per cell (as cpml3d.comp)
+    std::vector<cpml::Coeffs>  profile;
+    std::vector<sources::Record> records;
+    media::Plan        media;            // undivided grid
+    std::vector<float> mediaState;
+    ThreadPool  pool;
+
+    void init(const SimParams3D& params, const materials::CoeffMap& map, int pmlWidth,
+              const std::vector<cpml::Coeffs>& pmlProfile,
+              const std::vector<sources::Record>& sourceRecords, const media::Plan& dispersive,
+              int threads) {
+        p = params;
+        W = pmlWidth;
+        records = sourceRecords;
+        media   = dispersive;
+        mediaState.assign(media.stateFloats, 0.0f);
+        const size_t cells = size_t(p.nx) * p.ny * p.nz;
+        fields.assign(6 * cells, 0.0f);
+        for (int i = 0; i < 6; ++i) F[i] = fields.data() + i * cells;
+        c.expand(map, cells);
+        profile = pmlProfile;
+        for (int a = 0; a < 3 && W > 0; ++a) {
+            int box[3];
+            cpmlBox(a, box);
+            psi[a].assign(size_t(box[0]) * box[1] * box[2] * 4, 0.0f);
+        }
+        pool.start(threads);
+    }
+
+    void cpmlBox(int axis, int box[3]) const {
+        box[0] = p.nx; box[1] = p.ny; box[2] = p.nz;
+        box[axis] = 2 * W;
+    }
+
+    int tilesPerPlane() const { return (p.ny + TILE_ROWS - 1) / TILE_ROWS; }
+
+    // fn(y, z) for every row, tiled TILE_ROWS rows of one plane per work item
+    template <typename RowFn>
+    void forRows(int y0, int y1, int z0, int z1, RowFn&& fn) {
+        const int perPlane = tilesPerPlane();
+        pool.run((z1 - z0) * perPlane, [&](int t) {
+            int z = z0 + t / perPlane, tile = t % perPlane;
+            for (int y = std::max(y0, tile * TILE_ROWS);
+                 y < std::min(y1, (tile + 1) * TILE_ROWS); ++y)
+                fn(y, z);
+        });
+    }
+
+    void step(int stepBase) {
+        const int    nx = p.nx, ny = p.ny, nz = p.nz;
+        const size_t sy = size_t(nx), sz = size_t(nx) * ny;
+        float *Ex = F[0], *Ey = F[1], *Ez = F[2], *Hx = F[3], *Hy = F[4], *Hz = F[5];
+        const float *ca = c.ca.data(), *cb = c.cb.data(), *da = c.da.data(), *db = c.db.data();
+
+        // H = da * H - db * curl(E), each component under the kernel's guards
+        forRows(0, ny, 0, nz, [&](int y, int z) {
+            const size_t r = z * sz + y * sy;
+            auto update = [&](float* h, const float* a1, const float* a0, const float* b1,
+                              const float* b0, int xEnd) {
+                simdFor(0, xEnd, [&](auto v, int x) {
+                    using V = decltype(v);
+                    size_t i = r + x;
+                    V n = V::load(da + i) * V::load(h + i) -
+                          V::load(db + i) * ((V::load(a1 + i) - V::load(a0 + i)) -
+                                             (V::load(b1 + i) - V::load(b0 + i)));
+                    n.store(h + i);
+                });
+            };
+            if (y < ny - 1 && z < nz - 1) update(Hx, Ez + sy, Ez, Ey + sz, Ey, nx);
+            if (z < nz - 1)               update(Hy, Ex + sz, Ex, Ez + 1, Ez, nx - 1);
+            if (y < ny - 1)               update(Hz, Ey + 1, Ey, Ex + sy, Ex, nx - 1);
+        });
+        if (W > 0) cpml(0);
+
+        // E = ca * E + cb * curl(H) on interior cells
+        forRows(1, ny - 1, 1, nz - 1, [&](int y, int z) {
+            const size_t r = z * sz + y * sy;
+            auto update = [&](float* e, const float* a1, const float* a0, const float* b1,
+                              const float* b0) {
+                simdFor(1, nx - 1, [&](auto v, int x) {
+                    using V = decltype(v);
+                    size_t i = r + x;
+                    V n = V::load(ca + i) * V::load(e + i) +
+                          V::load(cb + i) * ((V::load(a1 + i) - V::load(a0 + i)) -
+                                             (V::load(b1 + i) - V::load(b0 + i)));
+                    n.store(e + i);
+                });
+            };
+            update(Ex, Hz, Hz - sy, Hy, Hy - sz);
+            update(Ey, Hx, Hx - sz, Hz, Hz - 1);
+            update(Ez, Hy, Hy - 1, Hx, Hx - sy);
+        });
+        driveSources(records, nx, ny, float(stepBase) * p.dt,
+                     [&](size_t i, int a, float v) { F[a][i] += v; });
+        if (W > 0) cpml(1);
+        float* const e[3] = {Ex, Ey, Ez};
+        stepMedia(media, mediaState, nx, ny, e, c.cb, p.dx / p.dt);
+    }
+
+    // cpml3d.comp, one slab pair at a time (x, y, z) since the pairs share edges
+    void cpml(int updateStep) {
+        const int    nx = p.nx, ny = p.ny, nz = p.nz;
+        const size_t sy = size_t(nx), sz = size_t(nx) * ny;
+        float *Ex = F[0], *Ey = F[1], *Ez = F[2], *Hx = F[3], *Hy = F[4], *Hz = F[5];
+
+        for (int a = 0; a < 3; ++a) {
+            int box[3];
+            cpmlBox(a, box);
+            float* ps = psi[a].data();
+            pool.run(box[2], [&](int bz) {
+                for (int by = 0; by < box[1]; ++by)
+                for (int bx = 0; bx < box[0]; ++bx) {
+                    int b[3] = {bx, by, bz};
+                    int g[3] = {bx, by, bz};
+                    g[a] = cpml::slabToGrid(b[a], a == 0 ? nx : a == 1 ? ny : nz, W);
+                    const int x = g[0], y = g[1], z = g[2];
+                    const size_t f = z * sz + y * sy + x;
+                    float* q = ps + ((size_t(bz) * box[1] + by) * box[0] + bx) * 4;
+                    const cpml::Coeffs& k = profile[b[a]];
+                    const float cb = c.cb[f], db = c.db[f];
+
+                    if (updateStep == 0) {
+                        if (a == 0) {
+                            if (x < nx - 1 && z < nz - 1) {
+                                q[2] = k.bH * q[2] + k.aH * (Ez[f + 1] - Ez[f]);
+                                Hy[f] += db * q[2];
+                            }
+                            if (x < nx - 1 && y < ny - 1) {
+                                q[3] = k.bH * q[3] + k.aH * (Ey[f + 1] - Ey[f]);
+                                Hz[f] -= db * q[3];
+                            }
+                        } else if (a == 1) {
+                            if (y < ny - 1 && z < nz - 1) {
+                                q[2] = k.bH * q[2] + k.aH * (Ez[f + sy] - Ez[f]);
+                                Hx[f] -= db * q[2];
+                            }
+                            if (x < nx - 1 && y < ny - 1) {
+                                q[3] = k.bH * q[3] + k.aH * (Ex[f + sy] - Ex[f]);
+                                Hz[f] += db * q[3];
+                            }
+                        } else {
+                            if (y < ny - 1 && z < nz - 1) {
+                                q[2] = k.bH * q[2] + k.aH * (Ey[f + sz] - Ey[f]);
+                                Hx[f] += db * q[2];
+                            }
+                            if (x < nx - 1 && z < nz - 1) {
+                                q[3] = k.bH * q[3] + k.aH * (Ex[f + sz] - Ex[f]);
+                                Hy[f] -= db * q[3];
+                            }
+                        }
+                    } else {
+                        if (x <= 0 || x >= nx - 1 || y <= 0 || y >= ny - 1 || z <= 0 ||
+                            z >= nz - 1)
+                            continue;
+                        if (a == 0) {
+                            q[0] = k.bE * q[0] + k.aE * (Hz[f] - Hz[f - 1]);
+                            q[1] = k.bE * q[1] + k.aE * (Hy[f] - Hy[f - 1]);
+                            Ey[f] -= cb * q[0];
+                            Ez[f] += cb * q[1];
+                        } else if (a == 1) {
+                            q[0] = k.bE * q[0] + k.aE * (Hz[f] - Hz[f - sy]);
+                            q[1] = k.bE * q[1] + k.aE * (Hx[f] - Hx[f - sy]);
+                            Ex[f] += cb * q[0];
+                            Ez[f] -= cb * q[1];
+                        } else {
+                            q[0] = k.bE * q[0] + k.aE * (Hy[f] - Hy[f - sz]);
+                            q[1] = k.bE * q[1] + k.aE * (Hx[f] - Hx[f - sz]);
+                            Ex[f] -= cb * q[0];
+                            Ey[f] += cb * q[1];
+                        }
+                    }
+                }
+            });
+        }
+    }
+};
+
+// ── Validation ──
+
+// Worst absolute difference against a reference, relative to its peak.
+// Returns true within TOLERANCE.
+inline bool reportMatch(const std::vector<float>& fields, const std::vector<float>& reference,
+                        const char* label) {
+    double maxAbs = 0.0, peak = 0.0;
+    for (size_t i = 0; i < fields.size() && i < reference.size(); ++i) {
+        maxAbs = std::max(maxAbs, std::fabs(double(fields[i]) - reference[i]));
+        peak   = std::max(peak, std::fabs(double(reference[i])));
+    }
+    double rel = peak > 0.0 ? maxAbs / peak : maxAbs;
+    bool   ok  = fields.size() == reference.size() && rel <= TOLERANCE;
+    std::cout << "\n=== CPU reference check (" << label << ") ===\n"
+              << "  max |GPU - CPU| : " << maxAbs << "\n"
+              << "  peak |CPU|      : " << peak << "\n"
+              << "  relative        : " << rel << " (tolerance " << TOLERANCE << ") "
+              << (ok ? "PASS" : "FAIL") << "\n";
+    return ok;
+}
+
+} // namespace cpu
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.h"
+
+// Frequency-domain probes for the 3D solver. A running DFT
+//
+//   F(w) = sum_n f(t_n) e^(-i w t_n) dt
+//
+// is accumulated on the GPU (shaders/dft3d.comp) for every cell of a list
+// of probe boxes (points, planes or volumes) at up to MAX_FREQS frequencies,
+// once per step after the E pass. E is sampled at t = (n + 1) dt and H at the
+// half step (n + 1/2) dt. Only the final phasors come back to the host, per
+// probe cell and frequency, instead of a time series per step.
+//
+// Output file (.emdft): Header, freqs[freqCount], Box[probeCount], then per
+// probe, per frequency, per component Ex..Hz: cells (re, im) pairs, x fastest.
+namespace dft {
+
+constexpr int MAX_FREQS     = 16;
+constexpr int MAX_PROBES    = 32;
+constexpr int ACCUM_BINDING = 21;  // above the snapshot binding
+constexpr int PROBE_BINDING = 22;
+constexpr int VEC4_PER_CELL = 3;   // six complex components per (frequency, cell)
+
+// Inclusive cell box; lo == hi on an axis makes a plane, on all three a point
+struct Box {
+    int32_t lo[3] = {0, 0, 0};
+    int32_t hi[3] = {0, 0, 0};
+
+    int    extent(int a) const { return hi[a] - lo[a] + 1; }
+    size_t cells() const { return size_t(extent(0)) * extent(1) * extent(2); }
+};
+
+struct Header {
+    char    magic[4]   = {'E', 'M', 'D', 'F'};
+    int32_t version    = 1;
+    int32_t dims[3]    = {};
+    int32_t freqCount  = 0;
+    int32_t probeCount = 0;
+    int32_t steps      = 0;    // steps accumulated
+    float   dt         = 0.0f;
+    float   dx         = 0.0f;
+};
+
+// Probe table entry — matches the GLSL `Probe` struct (std430)
+struct ProbeEntry {
+    int32_t origin[4];  // xyz, w = first accumulator cell
+    int32_t dims[4];
+};
+
+// Bindings and sizes for dft3d.comp
+inline std::string defines() {
+    return "#define DFT_ACCUM_BINDING " + std::to_string(ACCUM_BINDING) + "\n"
+         + "#define DFT_PROBE_BINDING " + std::to_string(PROBE_BINDING) + "\n"
+         + "#define DFT_MAX_FREQS " + std::to_string(MAX_FREQS) + "\n";
+}
+
+struct Probes {
+    bool               enabled = false;
+    std::vector<float> freqs;
+    std::vector<Box>   boxes;
+    size_t             cells   = 0;  // over all boxes
+    int                steps   = 0;  // steps accumulated so far
+    GLuint             accumSSBO = 0;
+    GLuint             probeSSBO = 0;
+
+    // Cached uniform locations — dft3d.comp
+    GLint loc_probeCount = -1, loc_probeCells = -1, loc_freqCount = -1;
+    GLint loc_phaseE = -1, loc_phaseH = -1;
+
+    // Zeroed accumulators; boxes must already be inside the grid
+    void init(const std::vector<float>& f, const std::vector<Box>& b, GLuint program) {
+        freqs = f;
+        boxes = b;
+        steps = 0;
+        cells = 0;
+        std::vector<ProbeEntry> table;
+        for (const Box& box : boxes) {
+            table.push_back({{box.lo[0], box.lo[1], box.lo[2], int32_t(cells)},
+                             {box.extent(0), box.extent(1), box.extent(2), 0}});
+            cells += box.cells();
+        }
+
+        if (!accumSSBO) glGenBuffers(1, &accumSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, accumSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, accumFloats() * sizeof(float), nullptr,
+                     GL_DYNAMIC_COPY);
+        vram::clear(GL_SHADER_STORAGE_BUFFER);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ACCUM_BINDING, accumSSBO);
+
+        if (!probeSSBO) glGenBuffers(1, &probeSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, probeSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, table.size() * sizeof(ProbeEntry), table.data(),
+                     GL_STATIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PROBE_BINDING, probeSSBO);
+
+        loc_probeCount = glGetUniformLocation(program, "probeCount");
+        loc_probeCells = glGetUniformLocation(program, "probeCells");
+        loc_freqCount  = glGetUniformLocation(program, "freqCount");
+        loc_phaseE     = glGetUniformLocation(program, "phaseE");
+        loc_phaseH     = glGetUniformLocation(program, "phaseH");
+        enabled = true;
+
+        std::cout << "DFT probes: " << boxes.size() << " boxes, " << cells << " cells x "
+                  << freqs.size() << " frequencies, " << accumBytes() / (1024.0 * 1024.0)
+                  << " MB of accumulators\n";
+    }
+
+    size_t accumFloats() const { return freqs.size() * cells * VEC4_PER_CELL * 4; }
+    size_t accumBytes() const { return accumFloats() * sizeof(float); }
+
+    // Fold in the fields after the E pass of step `step`. Phases are taken
+    // in double on the host, so long runs keep full fp32 accuracy.
+    void accumulate(GLuint program, int step, float dt) {
+        if (!enabled) return;
+        const double TWO_PI = 6.283185307179586;
+        float phaseE[MAX_FREQS * 2], phaseH[MAX_FREQS * 2];
+        for (size_t k = 0; k < freqs.size(); ++k) {
+            double w  = TWO_PI * freqs[k];
+            double tE = (step + 1.0) * dt, tH = (step + 0.5) * dt;
+            phaseE[2 * k]     = float(std::cos(w * tE) * dt);
+            phaseE[2 * k + 1] = float(-std::sin(w * tE) * dt);
+            phaseH[2 * k]     = float(std::cos(w * tH) * dt);
+            phaseH[2 * k + 1] = float(-std::sin(w * tH) * dt);
+        }
+        glUseProgram(program);
+        glUniform1i(loc_probeCount, int(boxes.size()));
+        glUniform1i(loc_probeCells, int(cells));
+        glUniform1i(loc_freqCount, int(freqs.size()));
+        glUniform2fv(loc_phaseE, GLsizei(freqs.size()), phaseE);
+        glUniform2fv(loc_phaseH, GLsizei(freqs.size()), phaseH);
+        glDispatchCompute(GLuint((cells + 63) / 64), 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        ++steps;
+    }
+
+    // Accumulators as stored: (frequency, cell) -> 12 floats
+    std::vector<float> read() const {
+        std::vector<float> raw(accumFloats());
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, accumSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, raw.size() * sizeof(float), raw.data());
+        return raw;
+    }
+
+    bool write(const std::string& path, const int dims[3], float dt, float dx) const {
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) {
+            std::cerr << "Failed to open DFT output: " << path << "\n";
+            return false;
+        }
+        Header h;
+        for (int a = 0; a < 3; ++a) h.dims[a] = dims[a];
+        h.freqCount  = int32_t(freqs.size());
+        h.probeCount = int32_t(boxes.size());
+        h.steps      = steps;
+        h.dt         = dt;
+        h.dx         = dx;
+        bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+                  std::fwrite(freqs.data(), sizeof(float), freqs.size(), f) == freqs.size() &&
+                  std::fwrite(boxes.data(), sizeof(Box), boxes.size(), f) == boxes.size();
+
+        // Regroup (frequency, cell, component) into per-probe component planes
+        std::vector<float> raw = read();
+        std::vector<float> plane;
+        size_t first = 0;
+        for (const Box& box : boxes) {
+            size_t n = box.cells();
+            for (size_t k = 0; k < freqs.size() && ok; ++k)
+            for (int c = 0; c < 6 && ok; ++c) {
+                plane.resize(2 * n);
+                for (size_t i = 0; i < n; ++i) {
+                    const float* a = &raw[((k * cells) + first + i) * VEC4_PER_CELL * 4];
+                    plane[2 * i]     = a[2 * c];
+                    plane[2 * i + 1] = a[2 * c + 1];
+                }
+                ok = std::fwrite(plane.data(), sizeof(float), plane.size(), f) == plane.size();
+            }
+            first += n;
+        }
+        ok = (std::fclose(f) == 0) && ok;
+        if (ok)
+            std::cout << "DFT probes: " << steps << " steps of phasors written to " << path
+                      << "\n";
+        else
+            std::cerr << "Failed to write DFT output: " << path << "\n";
+        return ok;
+    }
+
+    void cleanup() {
+        glDeleteBuffers(1, &accumSSBO);
+        glDeleteBuffers(1, &probeSSBO);
+        accumSSBO = probeSSBO = 0;
+        enabled = false;
+    }
+};
+
+} // namespace dft
@@ -33,16 +33,16 @@ struct SimParams {
     int   source_y;     // source position y
     float dx;           // spatial step
     float dt;           // time step
-    float time;         // current simulation time
+    float time;         // unused by kernels (time = stepBase uniform * dt)
     float source_freq;  // source frequency (normalized)
     float source_amp;   // source amplitude
     float field_scale;  // visual scaling factor
-    int   timestep;     // current timestep number
+    int   timestep;     // unused by kernels (pushed as the stepBase uniform)
     int   _pad0;        // padding to 48 bytes
 };
 
 // 3D Simulation parameters — matches GLSL std140 UBO layout.
-// Total: 64 bytes (4 * 16, std140-aligned).
+// Total: 80 bytes (5 * 16, std140-aligned).
 struct SimParams3D {
     int   nx;               // grid width
     int   ny;               // grid height
@@ -52,12 +52,16 @@ struct SimParams3D {
     int   source_z;         // source position z
     float dx;               // spatial step
     float dt;               // time step
-    float time;             // current simulation time
+    float time;             // unused by kernels (time = stepBase uniform * dt)
     float source_freq;      // source frequency (normalized)
     float source_amp;       // source amplitude
     float field_scale;      // visual scaling factor
-    int   timestep;         // current timestep number
+    int   timestep;         // unused by kernels (pushed as the stepBase uniform)
     int   render_component; // 0=Ex,1=Ey,2=Ez,3=|E|,4=Hx,5=Hy,6=Hz
     int   slice_axis;       // 0=XY, 1=XZ, 2=YZ
     int   slice_index;      // position along slice axis
+    int   field_precision;  // field storage: 0=fp32, 1=fp16, 2=fp16 + fp32 near source
+    int   near_x0;          // mixed precision: origin of the fp32 near-source box
+    int   near_y0;
+    int   near_z0;
 };
@@ -0,0 +1,425 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "em_common.h"
+#include "grid.h"
+
+// Chunked field time series (.emf) for the 3D solver. Each recorded frame
+// stores the six components as CHUNK^3 bricks, each compressed on its own,
+// behind a per-frame chunk table, so any frame / chunk can be located and
+// decoded from the memory-mapped file without touching the rest of it.
+//
+//   FileHeader                          once, carries the run's SimParams3D
+//   FrameHeader, ChunkEntry[6 * chunks], chunk payloads    per frame
+//
+// Chunks are numbered z-major over the chunk grid, component-major in the
+// table; voxels inside a chunk are row-major (x fastest) and padded with
+// zeros past the grid edge. There is no trailing index: the reader walks
+// the frame headers on open, so a run that dies mid-frame keeps every
+// complete frame.
+//
+// Codecs (per file, with per-chunk fallback to RAW when that is smaller):
+//   RAW       fp32 as is
+//   LOSSLESS  XOR with the previous value's bits, bytes split into planes,
+//             zero runs collapsed
+//   LOSSY     uniform quantisation to |error| <= errorBound, zig-zag deltas
+//             as varints, zero runs collapsed
+namespace fieldfile {
+
+constexpr int CHUNK      = 16;                       // chunk edge (2 x grid::BRICK)
+constexpr int CHUNK_VOX  = CHUNK * CHUNK * CHUNK;
+constexpr int COMPONENTS = 6;                        // Ex, Ey, Ez, Hx, Hy, Hz
+static_assert(CHUNK % grid::BRICK == 0, "chunks must hold whole storage bricks");
+
+enum Codec : uint32_t { RAW = 0, LOSSLESS = 1, LOSSY = 2 };
+
+struct FileHeader {
+    char        magic[4]   = {'E', 'M', 'F', 'F'};
+    uint32_t    version    = 1;
+    SimParams3D params{};           // parameters of the recorded run
+    int32_t     dims[3]    = {};    // stored frame extent
+    int32_t     stride     = 1;     // grid cells per stored cell
+    int32_t     chunk      = CHUNK;
+    uint32_t    codec      = RAW;
+    float       errorBound = 0.0f;  // LOSSY only
+};
+
+struct FrameHeader {
+    char     magic[4]  = {'F', 'R', 'M', 'E'};
+    int32_t  step      = 0;
+    uint64_t dataBytes = 0;         // payload after the chunk table
+};
+
+struct ChunkEntry {
+    uint64_t offset = 0;            // from the start of the frame payload
+    uint32_t bytes  = 0;
+    uint32_t codec  = RAW;
+};
+
+inline int chunksAlong(int n) { return (n + CHUNK - 1) / CHUNK; }
+
+// ── Codec helpers ──
+
+// Collapse runs of zero bytes: control c < 128 = c + 1 literals follow,
+// c >= 128 = (c - 127) zeros
+inline void packZeros(const uint8_t* in, size_t n, std::vector<uint8_t>& out) {
+    size_t i = 0;
+    while (i < n) {
+        size_t run = 0;
+        while (i + run < n && in[i + run] == 0 && run < 128) ++run;
+        if (run >= 2 || (run == 1 && i + 1 == n)) {
+            out.push_back(uint8_t(127 + run));
+            i += run;
+            continue;
+        }
+        size_t lit = 0;  // literals until the next pair of zeros
+        while (i + lit < n && lit < 128 &&
+               !(in[i + lit] == 0 && i + lit + 1 < n && in[i + lit + 1] == 0))
+            ++lit;
+        out.push_back(uint8_t(lit - 1));
+        out.insert(out.end(), in + i, in + i + lit);
+        i += lit;
+    }
+}
+
+inline bool unpackZeros(const uint8_t* in, size_t n, uint8_t* out, size_t outBytes) {
+    size_t o = 0;
+    for (size_t i = 0; i < n;) {
+        uint8_t c = in[i++];
+        if (c >= 128) {
+            size_t run = c - 127;
+            if (o + run > outBytes) return false;
+            std::memset(out + o, 0, run);
+            o += run;
+        } else {
+            size_t lit = size_t(c) + 1;
+            if (i + lit > n || o + lit > outBytes) return false;
+            std::memcpy(out + o, in + i, lit);
+            i += lit;
+            o += lit;
+        }
+    }
+    return o == outBytes;
+}
+
+inline void encodeLossless(const float* v, std::vector<uint8_t>& out) {
+    std::vector<uint8_t> planes(CHUNK_VOX * 4);
+    uint32_t prev = 0;
+    for (int i = 0; i < CHUNK_VOX; ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, &v[i], 4);
+        uint32_t x = bits ^ prev;
+        prev = bits;
+        for (int b = 0; b < 4; ++b) planes[b * CHUNK_VOX + i] = uint8_t(x >> (8 * b));
+    }
+    packZeros(planes.data(), planes.size(), out);
+}
+
+inline bool decodeLossless(const uint8_t* in, size_t n, float* v) {
+    std::vector<uint8_t> planes(CHUNK_VOX * 4);
+    if (!unpackZeros(in, n, planes.data(), planes.size())) return false;
+    uint32_t prev = 0;
+    for (int i = 0; i < CHUNK_VOX; ++i) {
+        uint32_t x = 0;
+        for (int b = 0; b < 4; ++b) x |= uint32_t(planes[b * CHUNK_VOX + i]) << (8 * b);
+        prev ^= x;
+        std::memcpy(&v[i], &prev, 4);
+    }
+    return true;
+}
+
+inline void encodeLossy(const float* v, float errorBound, std::vector<uint8_t>& out) {
+    const double step = 2.0 * errorBound;
+    std::vector<uint8_t> varints;
+    varints.reserve(CHUNK_VOX);
+    int64_t prev = 0;
+    for (int i = 0; i < CHUNK_VOX; ++i) {
+        int64_t  q = std::llround(v[i] / step);
+        int64_t  d = q - prev;
+        uint64_t z = (uint64_t(d) << 1) ^ uint64_t(d >> 63);  // zig-zag
+        prev = q;
+        do {
+            uint8_t byte = z & 0x7f;
+            z >>= 7;
+            varints.push_back(byte | (z ? 0x80 : 0));
+        } while (z);
+    }
+    packZeros(varints.data(), varints.size(), out);
+}
+
+inline bool decodeLossy(const uint8_t* in, size_t n, float errorBound, float* v) {
+    // Undo the zero-run packing, then walk the varints (their count is
+    // implied by the voxel count)
+    std::vector<uint8_t> varints;
+    varints.reserve(CHUNK_VOX * 2);
+    for (size_t i = 0; i < n;) {
+        uint8_t c = in[i++];
+        if (c >= 128) {
+            varints.insert(varints.end(), size_t(c - 127), uint8_t(0));
+        } else {
+            size_t lit = size_t(c) + 1;
+            if (i + lit > n) return false;
+            varints.insert(varints.end(), in + i, in + i + lit);
+            i += lit;
+        }
+    }
+
+    const double step = 2.0 * errorBound;
+    int64_t prev = 0;
+    size_t  p    = 0;
+    for (int i = 0; i < CHUNK_VOX; ++i) {
+        uint64_t z = 0;
+        for (int shift = 0;; shift += 7) {
+            if (p >= varints.size() || shift > 63) return false;
+            uint8_t byte = varints[p++];
+            z |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        int64_t d = int64_t(z >> 1) ^ -int64_t(z & 1);
+        prev += d;
+        v[i] = float(prev * step);
+    }
+    return true;
+}
+
+// ── Writing ──
+
+struct Writer {
+    FILE*      file = nullptr;
+    FileHeader header;
+    int        frames = 0;
+    bool       warnedDims = false;
+    long long  rawBytes = 0, storedBytes = 0;
+
+    bool open(const std::string& path, const SimParams3D& params, const int dims[3], int stride,
+              Codec codec, float errorBound) {
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Failed to open recording: " << path << "\n";
+            return false;
+        }
+        header.params     = params;
+        header.stride     = stride;
+        header.codec      = codec;
+        header.errorBound = errorBound;
+        for (int a = 0; a < 3; ++a) header.dims[a] = dims[a];
+        std::fwrite(&header, sizeof(header), 1, file);
+        const char* names[] = {"raw", "lossless", "lossy"};
+        std::cout << "Recording: " << dims[0] << "x" << dims[1] << "x" << dims[2] << " frames, "
+                  << CHUNK << "^3 chunks, " << names[codec] << " -> " << path << "\n";
+        return true;
+    }
+
+    // One frame of fp32 linear planes (Ex..Hz, x fastest). Runs on the
+    // snapshot writer thread.
+    bool append(int step, const int dims[3], const float* planes) {
+        if (!file) return false;
+        for (int a = 0; a < 3; ++a) {
+            if (dims[a] == header.dims[a]) continue;
+            if (!warnedDims)
+                std::cerr << "Recording: frame size changed, later frames are not recorded\n";
+            warnedDims = true;
+            return false;
+        }
+
+        const int cx = chunksAlong(dims[0]), cy = chunksAlong(dims[1]), cz = chunksAlong(dims[2]);
+        const int chunks = cx * cy * cz;
+        const size_t plane = size_t(dims[0]) * dims[1] * dims[2];
+
+        std::vector<ChunkEntry> table(size_t(COMPONENTS) * chunks);
+        std::vector<uint8_t>    payload, coded;
+        std::vector<float>      vox(CHUNK_VOX);
+
+        for (int c = 0; c < COMPONENTS; ++c) {
+            const float* src = planes + c * plane;
+            for (int k = 0; k < chunks; ++k) {
+                int x0 = (k % cx) * CHUNK, y0 = ((k / cx) % cy) * CHUNK, z0 = (k / (cx * cy)) * CHUNK;
+                for (int z = 0; z < CHUNK; ++z)
+                for (int y = 0; y < CHUNK; ++y)
+                for (int x = 0; x < CHUNK; ++x) {
+                    int gx = x0 + x, gy = y0 + y, gz = z0 + z;
+                    bool in = gx < dims[0] && gy < dims[1] && gz < dims[2];
+                    vox[(z * CHUNK + y) * CHUNK + x] =
+                        in ? src[grid::idx3d(gx, gy, gz, dims[0], dims[1])] : 0.0f;
+                }
+
+                coded.clear();
+                Codec used = Codec(header.codec);
+                if (used == LOSSLESS)   encodeLossless(vox.data(), coded);
+                else if (used == LOSSY) encodeLossy(vox.data(), header.errorBound, coded);
+                if (used == RAW || coded.size() >= CHUNK_VOX * sizeof(float)) {
+                    used = RAW;
+                    coded.resize(CHUNK_VOX * sizeof(float));
+                    std::memcpy(coded.data(), vox.data(), coded.size());
+                }
+
+                ChunkEntry& e = table[size_t(c) * chunks + k];
+                e.offset = payload.size();
+                e.bytes  = uint32_t(coded.size());
+                e.codec  = used;
+                payload.insert(payload.end(), coded.begin(), coded.end());
+            }
+        }
+
+        FrameHeader fh;
+        fh.step      = step;
+        fh.dataBytes = payload.size();
+        bool ok = std::fwrite(&fh, sizeof(fh), 1, file) == 1 &&
+                  std::fwrite(table.data(), sizeof(ChunkEntry), table.size(), file) == table.size() &&
+                  std::fwrite(payload.data(), 1, payload.size(), file) == payload.size();
+        std::fflush(file);  // complete frames survive a crash
+        if (!ok) return false;
+
+        ++frames;
+        rawBytes    += static_cast<long long>(COMPONENTS * plane * sizeof(float));
+        storedBytes += static_cast<long long>(sizeof(fh) + table.size() * sizeof(ChunkEntry) + payload.size());
+        return true;
+    }
+
+    void close() {
+        if (!file) return;
+        std::fclose(file);
+        file = nullptr;
+        double ratio = storedBytes > 0 ? double(rawBytes) / storedBytes : 0.0;
+        std::cout << "Recording: " << frames << " frames, " << storedBytes / (1024.0 * 1024.0)
+                  << " MB (" << ratio << ":1 vs raw fp32)\n";
+    }
+};
+
+// ── Reading ──
+
+struct Reader {
+    const uint8_t* data  = nullptr;
+    size_t         size  = 0;
+    FileHeader     header;
+    int            chunkGrid[3] = {};
+    int            chunks = 0;
+
+    struct Frame {
+        int            step;
+        const uint8_t* table;    // ChunkEntry[COMPONENTS * chunks], unaligned
+        const uint8_t* payload;
+        uint64_t       dataBytes;
+    };
+    std::vector<Frame> frames;
+
+#ifdef _WIN32
+    std::vector<uint8_t> storage;  // no mmap: the file is read whole
+#endif
+
+    bool open(const std::string& path) {
+#ifdef _WIN32
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) {
+            std::cerr << "Failed to open recording: " << path << "\n";
+            return false;
+        }
+        std::fseek(f, 0, SEEK_END);
+        storage.resize(size_t(std::ftell(f)));
+        std::fseek(f, 0, SEEK_SET);
+        size = std::fread(storage.data(), 1, storage.size(), f);
+        std::fclose(f);
+        data = storage.data();
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            std::cerr << "Failed to open recording: " << path << "\n";
+            if (fd >= 0) ::close(fd);
+            return false;
+        }
+        size = size_t(st.st_size);
+        void* m = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (m == MAP_FAILED) {
+            std::cerr << "Failed to map recording: " << path << "\n";
+            return false;
+        }
+        data = static_cast<const uint8_t*>(m);
+#endif
+        if (size < sizeof(FileHeader) || std::memcmp(data, "EMFF", 4) != 0) {
+            std::cerr << path << ": not a field recording\n";
+            close();
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (header.version != 1 || header.chunk != CHUNK) {
+            std::cerr << path << ": unsupported recording version or chunk size\n";
+            close();
+            return false;
+        }
+        for (int a = 0; a < 3; ++a) chunkGrid[a] = chunksAlong(header.dims[a]);
+        chunks = chunkGrid[0] * chunkGrid[1] * chunkGrid[2];
+
+        // Walk the frame headers; a truncated last frame is dropped
+        size_t tableBytes = size_t(COMPONENTS) * chunks * sizeof(ChunkEntry);
+        for (size_t pos = sizeof(FileHeader); pos + sizeof(FrameHeader) + tableBytes <= size;) {
+            FrameHeader fh;
+            std::memcpy(&fh, data + pos, sizeof(fh));
+            if (std::memcmp(fh.magic, "FRME", 4) != 0) break;
+            size_t payload = pos + sizeof(fh) + tableBytes;
+            if (fh.dataBytes > size - payload) break;
+            frames.push_back({fh.step, data + pos + sizeof(fh), data + payload, fh.dataBytes});
+            pos = payload + fh.dataBytes;
+        }
+        std::cout << "Replay: " << frames.size() << " frames of " << header.dims[0] << "x"
+                  << header.dims[1] << "x" << header.dims[2] << " from " << path << "\n";
+        return !frames.empty();
+    }
+
+    // Chunks cut by the plane `fixedAxis` = `index` (-1 = every chunk)
+    std::vector<int> chunksOnPlane(int fixedAxis, int index) const {
+        std::vector<int> out;
+        for (int k = 0; k < chunks; ++k) {
+            int c[3] = {k % chunkGrid[0], (k / chunkGrid[0]) % chunkGrid[1],
+                        k / (chunkGrid[0] * chunkGrid[1])};
+            if (fixedAxis < 0 || c[fixedAxis] == index / CHUNK) out.push_back(k);
+        }
+        return out;
+    }
+
+    // One chunk of one component into CHUNK_VOX floats; false on an entry
+    // outside the frame's payload (corrupt table)
+    bool decode(int frame, int component, int chunk, float* out) const {
+        const Frame& f = frames[frame];
+        ChunkEntry   e;
+        std::memcpy(&e, f.table + (size_t(component) * chunks + chunk) * sizeof(ChunkEntry),
+                    sizeof(e));
+        if (e.offset > f.dataBytes || e.bytes > f.dataBytes - e.offset) return false;
+        const uint8_t* p = f.payload + e.offset;
+        switch (e.codec) {
+        case RAW:
+            if (e.bytes != CHUNK_VOX * sizeof(float)) return false;
+            std::memcpy(out, p, e.bytes);
+            return true;
+        case LOSSLESS: return decodeLossless(p, e.bytes, out);
+        case LOSSY:    return decodeLossy(p, e.bytes, header.errorBound, out);
+        }
+        return false;
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (data) munmap(const_cast<uint8_t*>(data), size);
+#endif
+        data = nullptr;
+        frames.clear();
+    }
+};
+
+} // namespace fieldfile
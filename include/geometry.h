@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Scene geometry in grid cells: the shapes media fill (media.h) and the
+// voxelizer rasterizes into the material IDs (voxelizer.h). A cell is
+// sampled at its integer coordinates; every test below runs the same float
+// operations in the same order as shaders/voxelize.comp, multiplications
+// and additions only, so the host reference and the GPU agree cell for
+// cell.
+//
+//   box:X0,Y0[,Z0],X1,Y1[,Z1]        inclusive cell box
+//   sphere:X,Y[,Z],R                 disc in 2D
+//   wire:X0,Y0[,Z0],X1,Y1[,Z1],R     capsule around a segment (antenna
+//                                    wires, rounded slits)
+//   mesh:X,Y,Z + file=F [scale=S]    closed triangle mesh (OBJ or STL,
+//                                    3D only), vertex (0, 0, 0) at cell
+//                                    (X, Y, Z), S cells per mesh unit
+namespace geometry {
+
+enum Kind { KIND_BOX = 0, KIND_SPHERE = 1, KIND_WIRE = 2, KIND_MESH = 3 };
+
+// Triangles of a mesh, scaled but not placed: 9 floats each
+struct Mesh {
+    std::vector<float> vertices;
+    float lo[3] = {}, hi[3] = {};  // bounds
+
+    size_t triangles() const { return vertices.size() / 9; }
+};
+
+// Crossing of the vertical (z) line through (px, py) with triangle `t`:
+// false when it misses, else the crossing height as n / a (a > 0). Edges
+// and vertices belong to one side only (a fixed rule on the edge
+// direction), so a line through a shared edge of a closed mesh crosses it
+// once, or twice at a silhouette fold — the parity stays right.
+inline bool crossing(const float* t, float px, float py, float& n, float& a) {
+    const float* v0 = t;
+    const float* v1 = t + 3;
+    const float* v2 = t + 6;
+    float area = (v1[0] - v0[0]) * (v2[1] - v0[1]) - (v1[1] - v0[1]) * (v2[0] - v0[0]);
+    if (area == 0.0f) return false;  // edge-on: the neighbours close the surface
+    if (area < 0.0f) std::swap(v1, v2);
+
+    // Edge functions, each the weight of the opposite vertex
+    auto edge = [&](const float* p, const float* q, float& w) {
+        float dx = q[0] - p[0], dy = q[1] - p[1];
+        w = dx * (py - p[1]) - dy * (px - p[0]);
+        return w > 0.0f || (w == 0.0f && (dy > 0.0f || (dy == 0.0f && dx > 0.0f)));
+    };
+    float w0, w1, w2;
+    if (!edge(v1, v2, w0) || !edge(v2, v0, w1) || !edge(v0, v1, w2)) return false;
+    a = w0 + w1 + w2;
+    n = w0 * v0[2] + w1 * v1[2] + w2 * v2[2];
+    return a > 0.0f;
+}
+
+struct Shape {
+    int   kind   = KIND_BOX;
+    float p0[3]  = {};    // box: low corner; sphere: centre; wire: one end; mesh: placement
+    float p1[3]  = {};    // box: high corner; wire: the other end
+    float radius = 0.0f;
+    std::shared_ptr<const Mesh> mesh;
+
+    bool contains(int x, int y, int z) const {
+        float p[3] = {float(x), float(y), float(z)};
+        if (kind == KIND_BOX)
+            return p[0] >= p0[0] && p[0] <= p1[0] && p[1] >= p0[1] && p[1] <= p1[1] &&
+                   p[2] >= p0[2] && p[2] <= p1[2];
+        if (kind == KIND_SPHERE) {
+            float dx = p[0] - p0[0], dy = p[1] - p0[1], dz = p[2] - p0[2];
+            return dx * dx + dy * dy + dz * dz <= radius * radius;
+        }
+        if (kind == KIND_WIRE) {
+            // Squared distance to the segment, scaled by its squared length
+            float d[3], q[3];
+            for (int i = 0; i < 3; ++i) {
+                d[i] = p1[i] - p0[i];
+                q[i] = p[i] - p0[i];
+            }
+            float len = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+            float t   = q[0] * d[0] + q[1] * d[1] + q[2] * d[2];
+            float qq  = q[0] * q[0] + q[1] * q[1] + q[2] * q[2];
+            float rr  = radius * radius;
+            if (t <= 0.0f) return qq <= rr;
+            if (t >= len) {
+                float e[3] = {p[0] - p1[0], p[1] - p1[1], p[2] - p1[2]};
+                return e[0] * e[0] + e[1] * e[1] + e[2] * e[2] <= rr;
+            }
+            return qq * len - t * t <= rr * len;
+        }
+        // Mesh: odd count of crossings above the cell, inside the mesh's
+        // bounds (an open mesh would otherwise fill everything below it)
+        float px = p[0] - p0[0], py = p[1] - p0[1], pz = p[2] - p0[2];
+        if (px < mesh->lo[0] || px > mesh->hi[0] || py < mesh->lo[1] || py > mesh->hi[1] ||
+            pz < mesh->lo[2] || pz > mesh->hi[2])
+            return false;
+        int above = 0;
+        for (size_t i = 0; i < mesh->triangles(); ++i) {
+            float n, a;
+            if (crossing(&mesh->vertices[9 * i], px, py, n, a) && n > pz * a) ++above;
+        }
+        return above & 1;
+    }
+
+    // Inclusive bounding box in cells
+    void bounds(int b[6]) const {
+        float lo[3], hi[3];
+        for (int i = 0; i < 3; ++i) {
+            if (kind == KIND_BOX) {
+                lo[i] = p0[i];
+                hi[i] = p1[i];
+            } else if (kind == KIND_SPHERE) {
+                lo[i] = p0[i] - radius;
+                hi[i] = p0[i] + radius;
+            } else if (kind == KIND_WIRE) {
+                lo[i] = std::min(p0[i], p1[i]) - radius;
+                hi[i] = std::max(p0[i], p1[i]) + radius;
+            } else {
+                lo[i] = p0[i] + mesh->lo[i];
+                hi[i] = p0[i] + mesh->hi[i];
+            }
+            b[i]     = int(std::floor(lo[i]));
+            b[3 + i] = int(std::ceil(hi[i]));
+        }
+    }
+
+    void translate(const int d[3]) {
+        for (int i = 0; i < 3; ++i) {
+            p0[i] += float(d[i]);
+            if (kind == KIND_BOX || kind == KIND_WIRE) p1[i] += float(d[i]);
+        }
+    }
+};
+
+// OBJ (v / f records, polygons fanned) or STL (ASCII or binary), by content
+inline bool loadMesh(const std::string& path, float scale, Mesh& out, std::string& why) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        why = "cannot open " + path;
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    Mesh m;
+    auto push = [&](const float* v) {
+        for (int i = 0; i < 3; ++i) m.vertices.push_back(v[i] * scale);
+    };
+
+    uint32_t count = 0;
+    if (data.size() >= 84) std::memcpy(&count, data.data() + 80, 4);
+    bool binaryStl = data.size() >= 84 && data.size() == 84 + size_t(count) * 50;
+    std::string ext = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if (binaryStl) {
+        for (uint32_t t = 0; t < count; ++t) {
+            float v[12];  // normal, then the three vertices
+            std::memcpy(v, data.data() + 84 + size_t(t) * 50, sizeof(v));
+            for (int k = 1; k < 4; ++k) push(v + 3 * k);
+        }
+    } else if (ext == ".stl") {
+        std::istringstream in(data);
+        std::string word;
+        while (in >> word) {
+            if (word != "vertex") continue;
+            float v[3];
+            if (!(in >> v[0] >> v[1] >> v[2])) break;
+            push(v);
+        }
+        m.vertices.resize(m.vertices.size() / 9 * 9);
+    } else {
+        std::vector<float> pos;
+        std::istringstream in(data);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream ls(line);
+            std::string tag;
+            ls >> tag;
+            if (tag == "v") {
+                float v[3] = {};
+                ls >> v[0] >> v[1] >> v[2];
+                pos.insert(pos.end(), v, v + 3);
+            } else if (tag == "f") {
+                std::vector<long> idx;
+                std::string token;
+                while (ls >> token) {
+                    long i = std::strtol(token.c_str(), nullptr, 10);  // stops at '/'
+                    i = i < 0 ? long(pos.size() / 3) + i : i - 1;
+                    if (i < 0 || size_t(i) >= pos.size() / 3) {
+                        why = "face index out of range in " + path;
+                        return false;
+                    }
+                    idx.push_back(i);
+                }
+                for (size_t k = 2; k < idx.size(); ++k)
+                    for (long i : {idx[0], idx[k - 1], idx[k]}) push(&pos[3 * i]);
+            }
+        }
+    }
+    if (m.vertices.empty()) {
+        why = "no triangles in " + path;
+        return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+        m.lo[i] = m.hi[i] = m.vertices[i];
+        for (size_t k = i; k < m.vertices.size(); k += 3) {
+            m.lo[i] = std::min(m.lo[i], m.vertices[k]);
+            m.hi[i] = std::max(m.hi[i], m.vertices[k]);
+        }
+    }
+    out = std::move(m);
+    return true;
+}
+
+// Shape `kind` from its coordinate list (2D drops the z values; meshes take
+// their file separately, see media::parse); false with `why` otherwise
+inline bool parse(const std::string& kind, const std::vector<float>& v, bool is3d, Shape& out,
+                  std::string& why) {
+    const int axes = is3d ? 3 : 2;
+    Shape s;
+    auto corners = [&](float* a, float* b, int offset) {
+        for (int i = 0; i < axes; ++i) {
+            a[i] = float(int(v[offset + i]));
+            b[i] = float(int(v[offset + axes + i]));
+        }
+    };
+    if (kind == "box") {
+        if (int(v.size()) != 2 * axes) {
+            why = is3d ? "need X0,Y0,Z0,X1,Y1,Z1" : "need X0,Y0,X1,Y1";
+            return false;
+        }
+        corners(s.p0, s.p1, 0);
+        for (int i = 0; i < axes; ++i)
+            if (s.p1[i] < s.p0[i]) {
+                why = "box corners out of order";
+                return false;
+            }
+    } else if (kind == "sphere" || kind == "mesh") {
+        bool sphere = kind == "sphere";
+        if (int(v.size()) != axes + (sphere ? 1 : 0) || (!sphere && !is3d)) {
+            why = sphere ? (is3d ? "need X,Y,Z,R" : "need X,Y,R")
+                         : (is3d ? "need X,Y,Z" : "meshes are 3D only");
+            return false;
+        }
+        s.kind = sphere ? KIND_SPHERE : KIND_MESH;
+        for (int i = 0; i < axes; ++i) s.p0[i] = float(int(v[i]));
+        if (sphere) s.radius = v[axes];
+        if (sphere && s.radius <= 0.0f) {
+            why = "radius must be positive";
+            return false;
+        }
+    } else if (kind == "wire") {
+        if (int(v.size()) != 2 * axes + 1) {
+            why = is3d ? "need X0,Y0,Z0,X1,Y1,Z1,R" : "need X0,Y0,X1,Y1,R";
+            return false;
+        }
+        s.kind = KIND_WIRE;
+        corners(s.p0, s.p1, 0);
+        s.radius = v[2 * axes];
+        if (s.radius < 0.0f) {
+            why = "radius must not be negative";
+            return false;
+        }
+    } else {
+        why = "shape must be box, sphere, wire or mesh";
+        return false;
+    }
+    out = s;
+    return true;
+}
+
+} // namespace geometry
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// GPU-side timing of the per-frame passes with GL_TIMESTAMP query pairs.
+// Each frame records into its own query set and FRAMES_IN_FLIGHT sets are
+// cycled, so a set is only read back frames after it was issued, and only
+// if the results are already available: reading never stalls the pipeline
+// (a frame still pending when its set comes round again is dropped).
+namespace profile {
+
+constexpr int FRAMES_IN_FLIGHT = 4;    // query sets cycled between frames
+constexpr int WINDOW           = 240;  // frames in the rolling min/avg/p99
+
+enum Section {
+    H_PASS, E_PASS, CPML, TILES, FUSED, SUBGRID, MEDIA, DFT, NTFF, STATS, UPLOAD, SNAPSHOT,
+    RENDER,
+    SECTION_COUNT
+};
+
+const char* const SECTION_NAMES[] = {
+    "H pass", "E pass", "CPML", "tile compaction", "fused", "refined patch", "dispersive media",
+    "DFT probes", "NTFF", "field stats", "UBO upload", "snapshot", "render",
+};
+const char* const SECTION_KEYS[] = {  // CSV / JSON column names
+    "h_pass", "e_pass", "cpml", "tiles", "fused", "subgrid", "media", "dft", "ntff", "stats",
+    "upload", "snapshot", "render",
+};
+const char* const SECTION_TAGS[] = {  // window title
+    "H", "E", "PML", "tiles", "fused", "patch", "media", "dft", "ntff", "stats", "ubo", "snap",
+    "draw",
+};
+static_assert(sizeof(SECTION_NAMES) == SECTION_COUNT * sizeof(char*) &&
+              sizeof(SECTION_KEYS) == SECTION_COUNT * sizeof(char*) &&
+              sizeof(SECTION_TAGS) == SECTION_COUNT * sizeof(char*),
+              "one name, key and tag per Section");
+
+// Sections that advance the fields (throughput is measured against these)
+inline bool isSolver(int s) { return s <= MEDIA; }
+
+struct Stats {
+    int    samples = 0;
+    double min = 0.0, avg = 0.0, p99 = 0.0;  // ms per frame
+};
+
+struct GpuTimers {
+    // One resolved frame: GPU ms per section (-1 = section not run)
+    struct Row {
+        long long frame = 0;
+        int       steps = 0;
+        double    ms[SECTION_COUNT];
+    };
+
+    struct Mark { GLuint begin, end; int section; };
+
+    struct FrameSet {
+        std::vector<GLuint> pool;   // query objects, reused across frames
+        std::vector<Mark>   marks;  // issued this frame
+        size_t    used  = 0;
+        int       steps = 0;
+        long long frame = -1;
+    };
+
+    bool      enabled = false;
+    FrameSet  sets[FRAMES_IN_FLIGHT];
+    GLuint    open[SECTION_COUNT] = {};  // begin query of the running section
+    int       current = 0;
+    bool      inFrame = false;
+    long long frames  = 0;
+    int       dropped = 0;
+    std::vector<Row> rows;  // every resolved frame, oldest first
+
+    // ── Recording ──
+
+    void beginFrame() {
+        if (!enabled) return;
+        FrameSet& f = sets[current];
+        resolve(f, false);  // issued FRAMES_IN_FLIGHT frames ago
+        f.used  = 0;
+        f.frame = frames;
+        inFrame = true;
+    }
+
+    // `steps` = FDTD steps the frame advanced (for the derived throughput)
+    void endFrame(int steps) {
+        if (!enabled || !inFrame) return;
+        sets[current].steps = steps;
+        inFrame = false;
+        ++frames;
+        current = (current + 1) % FRAMES_IN_FLIGHT;
+    }
+
+    void begin(Section s) {
+        if (!enabled || !inFrame) return;
+        open[s] = counter();
+    }
+
+    void end(Section s) {
+        if (!enabled || !inFrame) return;
+        sets[current].marks.push_back({open[s], counter(), s});
+    }
+
+    // Block for everything still in flight (shutdown / end of a batch)
+    void finish() {
+        if (!enabled) return;
+        for (int i = 0; i < FRAMES_IN_FLIGHT; ++i)  // oldest set first
+            resolve(sets[(current + i) % FRAMES_IN_FLIGHT], true);
+    }
+
+    // ── Results ──
+
+    // Rolling stats over the last WINDOW frames that ran section s
+    Stats stats(int s) const {
+        std::vector<double> v;
+        for (size_t i = rows.size(); i-- > 0 && v.size() < size_t(WINDOW);)
+            if (rows[i].ms[s] >= 0.0) v.push_back(rows[i].ms[s]);
+
+        Stats st;
+        st.samples = int(v.size());
+        if (v.empty()) return st;
+        std::sort(v.begin(), v.end());
+        double sum = 0.0;
+        for (double x : v) sum += x;
+        st.min = v.front();
+        st.avg = sum / v.size();
+        st.p99 = v[std::min(v.size() - 1, size_t(0.99 * v.size()))];
+        return st;
+    }
+
+    // Short per-section averages for the window title
+    std::string overlay() const {
+        std::string out = "GPU ms";
+        for (int s = 0; s < SECTION_COUNT; ++s) {
+            Stats st = stats(s);
+            if (st.samples == 0) continue;
+            char buf[48];
+            std::snprintf(buf, sizeof(buf), " %s %.2f", SECTION_TAGS[s], st.avg);
+            out += buf;
+        }
+        return out;
+    }
+
+    // Solver time and steps over the rolling window
+    void solverTotals(double& ms, long long& steps) const {
+        ms = 0.0;
+        steps = 0;
+        size_t first = rows.size() > size_t(WINDOW) ? rows.size() - WINDOW : 0;
+        for (size_t i = first; i < rows.size(); ++i) {
+            for (int s = 0; s < SECTION_COUNT; ++s)
+                if (isSolver(s) && rows[i].ms[s] > 0.0) ms += rows[i].ms[s];
+            steps += rows[i].steps;
+        }
+    }
+
+    // cells = cells per step; bytesPerCell = theoretical traffic per cell update
+    void printSummary(size_t cells, double bytesPerCell) const {
+        if (!enabled) return;
+        std::cout << "\n=== GPU timers (last " << std::min(rows.size(), size_t(WINDOW))
+                  << " frames, " << dropped << " dropped) ===\n"
+                  << "  section            min ms    avg ms    p99 ms\n";
+        for (int s = 0; s < SECTION_COUNT; ++s) {
+            Stats st = stats(s);
+            if (st.samples == 0) continue;
+            std::printf("  %-16s %9.4f %9.4f %9.4f\n", SECTION_NAMES[s], st.min, st.avg, st.p99);
+        }
+        std::fflush(stdout);
+
+        double ms;
+        long long steps;
+        solverTotals(ms, steps);
+        if (ms <= 0.0 || steps == 0) return;
+        double cellsPerSec = double(steps) * double(cells) / (ms * 1.0e-3);
+        std::cout << "  Solver        : " << ms / steps << " ms/step\n"
+                  << "  Cell-updates/s: " << cellsPerSec / 1.0e6 << " M (GPU time)\n"
+                  << "  Effective BW  : " << cellsPerSec * bytesPerCell / 1.0e9
+                  << " GB/s at " << bytesPerCell << " B/cell-update\n";
+    }
+
+    // Per-frame rows as CSV, or summary + rows as JSON when path ends in .json
+    bool dump(const std::string& path, size_t cells, double bytesPerCell) const {
+        std::ofstream out(path);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open profile output: " << path << "\n";
+            return false;
+        }
+        bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+
+        // Derived throughput for one frame from its solver time
+        auto derived = [&](const Row& r, double& mcells, double& gbs) {
+            double ms = 0.0;
+            for (int s = 0; s < SECTION_COUNT; ++s)
+                if (isSolver(s) && r.ms[s] > 0.0) ms += r.ms[s];
+            double cps = (ms > 0.0) ? double(r.steps) * double(cells) / (ms * 1.0e-3) : 0.0;
+            mcells = cps / 1.0e6;
+            gbs    = cps * bytesPerCell / 1.0e9;
+        };
+
+        if (!json) {
+            out << "frame,steps";
+            for (int s = 0; s < SECTION_COUNT; ++s) out << "," << SECTION_KEYS[s] << "_ms";
+            out << ",mcells_per_s,gb_per_s\n";
+            for (const Row& r : rows) {
+                double mcells, gbs;
+                derived(r, mcells, gbs);
+                out << r.frame << "," << r.steps;
+                for (int s = 0; s < SECTION_COUNT; ++s) {
+                    out << ",";
+                    if (r.ms[s] >= 0.0) out << r.ms[s];
+                }
+                out << "," << mcells << "," << gbs << "\n";
+            }
+        } else {
+            out << "{\n  \"cells\": " << cells << ",\n  \"bytes_per_cell_update\": "
+                << bytesPerCell << ",\n  \"dropped_frames\": " << dropped
+                << ",\n  \"summary\": {";
+            bool first = true;
+            for (int s = 0; s < SECTION_COUNT; ++s) {
+                Stats st = stats(s);
+                if (st.samples == 0) continue;
+                out << (first ? "" : ",") << "\n    \"" << SECTION_KEYS[s]
+                    << "\": {\"min_ms\": " << st.min << ", \"avg_ms\": " << st.avg
+                    << ", \"p99_ms\": " << st.p99 << ", \"samples\": " << st.samples << "}";
+                first = false;
+            }
+            out << "\n  },\n  \"frames\": [";
+            for (size_t i = 0; i < rows.size(); ++i) {
+                const Row& r = rows[i];
+                double mcells, gbs;
+                derived(r, mcells, gbs);
+                out << (i ? "," : "") << "\n    {\"frame\": " << r.frame
+                    << ", \"steps\": " << r.steps;
+                for (int s = 0; s < SECTION_COUNT; ++s)
+                    if (r.ms[s] >= 0.0) out << ", \"" << SECTION_KEYS[s] << "_ms\": " << r.ms[s];
+                out << ", \"mcells_per_s\": " << mcells << ", \"gb_per_s\": " << gbs << "}";
+            }
+            out << "\n  ]\n}\n";
+        }
+        std::cout << "GPU timers: " << rows.size() << " frames written to " << path << "\n";
+        return true;
+    }
+
+    void cleanup() {
+        for (FrameSet& f : sets) {
+            if (!f.pool.empty()) glDeleteQueries(GLsizei(f.pool.size()), f.pool.data());
+            f.pool.clear();
+        }
+    }
+
+    // ── Internals ──
+
+    // Next query of the current set, growing the pool on first use
+    GLuint counter() {
+        FrameSet& f = sets[current];
+        if (f.used == f.pool.size()) {
+            size_t grow = std::max<size_t>(16, f.pool.size());
+            f.pool.resize(f.pool.size() + grow);
+            glGenQueries(GLsizei(grow), f.pool.data() + f.used);
+        }
+        GLuint q = f.pool[f.used++];
+        glQueryCounter(q, GL_TIMESTAMP);
+        return q;
+    }
+
+    // Fold a finished set into `rows`; without `wait`, drop it if not ready
+    void resolve(FrameSet& f, bool wait) {
+        if (f.marks.empty()) return;
+
+        GLuint ready = GL_TRUE;
+        if (!wait) glGetQueryObjectuiv(f.marks.back().end, GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready) {
+            ++dropped;
+            f.marks.clear();
+            return;
+        }
+
+        Row r;
+        r.frame = f.frame;
+        r.steps = f.steps;
+        std::fill(r.ms, r.ms + SECTION_COUNT, -1.0);
+        for (const Mark& m : f.marks) {
+            GLuint64 t0 = 0, t1 = 0;
+            glGetQueryObjectui64v(m.begin, GL_QUERY_RESULT, &t0);
+            glGetQueryObjectui64v(m.end, GL_QUERY_RESULT, &t1);
+            r.ms[m.section] = std::max(r.ms[m.section], 0.0) + (t1 - t0) * 1.0e-6;
+        }
+        rows.push_back(r);
+        f.marks.clear();
+    }
+};
+
+} // namespace profile
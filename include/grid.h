@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 // Grid utilities for FDTD simulation
 namespace grid {
 
@@ -23,4 +25,64 @@ inline bool inBounds3D(int x, int y, int z, int nx, int ny, int nz) {
     return x >= 0 && x < nx && y >= 0 && y < ny && z >= 0 && z < nz;
 }
 
+// Workgroups needed to cover n cells with `local` cells per group
+inline unsigned groups(int n, int local) {
+    return unsigned((n + local - 1) / local);
+}
+
+// ── 3D field storage orders (must match shaders/fields3d.glsl) ──
+//
+// Brick orders tile the grid into BRICK^3 blocks stored contiguously, so a
+// compute workgroup's stencil stays within a few cache lines/pages. Inside a
+// brick cells are either row-major or Morton (Z-order) interleaved.
+
+enum FieldLayout { LAYOUT_SOA = 0, LAYOUT_PACKED = 1 };  // 6 float / 2 vec4 buffers
+enum FieldIndex  { INDEX_LINEAR = 0, INDEX_BRICK = 1, INDEX_MORTON = 2 };
+enum FieldPrecision {
+    PRECISION_FP32  = 0,
+    PRECISION_FP16  = 1,  // packHalf2x16 storage, fp32 arithmetic
+    PRECISION_MIXED = 2,  // fp16, plus an fp32 box around the source
+};
+
+constexpr int BRICK = 8;
+
+// Spread the low 3 bits of v so they occupy every third bit
+inline int spreadBits3(int v) {
+    return (v & 1) | ((v & 2) << 2) | ((v & 4) << 4);
+}
+
+// Index of the brick containing (x, y, z); bricks are laid out z-major
+inline int brickOf(int x, int y, int z, int nx, int ny) {
+    int bnx = (nx + BRICK - 1) / BRICK;
+    int bny = (ny + BRICK - 1) / BRICK;
+    return ((z / BRICK) * bny + (y / BRICK)) * bnx + (x / BRICK);
+}
+
+// 8^3 bricks, row-major inside each brick
+inline int idx3dBrick(int x, int y, int z, int nx, int ny) {
+    int inner = ((z % BRICK) * BRICK + (y % BRICK)) * BRICK + (x % BRICK);
+    return brickOf(x, y, z, nx, ny) * BRICK * BRICK * BRICK + inner;
+}
+
+// 8^3 bricks, Morton order inside each brick
+inline int idx3dMorton(int x, int y, int z, int nx, int ny) {
+    int inner = spreadBits3(x % BRICK) | (spreadBits3(y % BRICK) << 1) |
+                (spreadBits3(z % BRICK) << 2);
+    return brickOf(x, y, z, nx, ny) * BRICK * BRICK * BRICK + inner;
+}
+
+inline int idx3dOrdered(FieldIndex order, int x, int y, int z, int nx, int ny) {
+    if (order == INDEX_BRICK)  return idx3dBrick(x, y, z, nx, ny);
+    if (order == INDEX_MORTON) return idx3dMorton(x, y, z, nx, ny);
+    return idx3d(x, y, z, nx, ny);
+}
+
+// Cells to allocate per field component: brick orders pad every axis to a
+// whole number of bricks
+inline size_t fieldCells3d(FieldIndex order, int nx, int ny, int nz) {
+    if (order == INDEX_LINEAR) return size_t(nx) * ny * nz;
+    auto pad = [](int n) { return size_t((n + BRICK - 1) / BRICK * BRICK); };
+    return pad(nx) * pad(ny) * pad(nz);
+}
+
 } // namespace grid
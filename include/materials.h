@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <vector>
+
+// Per-cell FDTD update coefficients, stored as a 16-bit material ID per cell
+// that indexes a small deduplicated coefficient table. The kernels read one
+// ID and one vec4 instead of re-deriving the loss profile every pass.
+namespace materials {
+
+// Constitutive parameters of one cell (normalized units)
+struct Material {
+    float eps_r   = 1.0f;  // relative permittivity
+    float mu_r    = 1.0f;  // relative permeability
+    float sigma   = 0.0f;  // electric conductivity
+    float sigma_m = 0.0f;  // magnetic conductivity
+};
+
+// Update coefficients — matches GLSL `vec4 coeffTable[]` (std430)
+//   E = ca * E + cb * curl(H)
+//   H = da * H - db * curl(E)
+struct Coeffs {
+    float ca, cb;
+    float da, db;
+};
+
+constexpr size_t MAX_IDS = 65536;  // 16-bit material IDs
+
+inline Coeffs updateCoeffs(const Material& m, float dt, float dx) {
+    float lossE = m.sigma   * dt * 0.5f / m.eps_r;
+    float lossH = m.sigma_m * dt * 0.5f / m.mu_r;
+
+    Coeffs c;
+    c.ca = (1.0f - lossE) / (1.0f + lossE);
+    c.cb = (dt / (m.eps_r * dx)) / (1.0f + lossE);
+    c.da = (1.0f - lossH) / (1.0f + lossH);
+    c.db = (dt / (m.mu_r * dx)) / (1.0f + lossH);
+    return c;
+}
+
+// Cells into the sponge along one axis: 0 in the interior, width at the edge
+inline int spongeIndex(int i, int n, int width) {
+    int d = 0;
+    if (i < width)      d = width - i;
+    if (i >= n - width) d = i - (n - 1 - width);
+    return d;
+}
+
+// Quadratic sponge profile at depth index d: 0 in the interior, 1 at the edge
+inline float spongeDepthAt(int d, int width) {
+    float s = d > 0 ? float(d) / float(width) : 0.0f;
+    return s * s;
+}
+
+inline float spongeDepth(int i, int n, int width) {
+    return spongeDepthAt(spongeIndex(i, n, width), width);
+}
+
+// Per-cell material IDs (two per 32-bit word) + deduplicated coefficient table
+struct CoeffMap {
+    std::vector<uint32_t> packedIds;
+    std::vector<Coeffs>   table;
+    std::map<std::tuple<float, float, float, float>, uint16_t> lookup;
+
+    void reset(size_t cells) {
+        packedIds.assign((cells + 1) / 2, 0u);
+        table.clear();
+        lookup.clear();
+    }
+
+    // Table only: the IDs are written on the GPU (voxelizer.h)
+    void resetTable() {
+        packedIds.clear();
+        table.clear();
+        lookup.clear();
+    }
+
+    uint16_t intern(const Coeffs& c) {
+        auto key = std::make_tuple(c.ca, c.cb, c.da, c.db);
+        auto it  = lookup.find(key);
+        if (it != lookup.end()) return it->second;
+
+        if (table.size() >= MAX_IDS) {
+            std::cerr << "Material table overflow (> " << MAX_IDS
+                      << " distinct coefficient sets)\n";
+            exit(EXIT_FAILURE);
+        }
+        uint16_t id = static_cast<uint16_t>(table.size());
+        table.push_back(c);
+        lookup.emplace(key, id);
+        return id;
+    }
+
+    void set(size_t cell, uint16_t id) {
+        uint32_t shift = (cell & 1) * 16;
+        uint32_t& word = packedIds[cell >> 1];
+        word = (word & ~(0xFFFFu << shift)) | (uint32_t(id) << shift);
+    }
+
+    size_t idBytes()    const { return packedIds.size() * sizeof(uint32_t); }
+    static size_t idBytes(size_t cells) { return (cells + 1) / 2 * sizeof(uint32_t); }
+    size_t tableBytes() const { return table.size() * sizeof(Coeffs); }
+};
+
+// Build the map from a per-cell material callback: materialAt(x, y, z)
+template <typename MaterialFn>
+inline void build(CoeffMap& map, int nx, int ny, int nz,
+                  float dt, float dx, MaterialFn materialAt) {
+    map.reset(size_t(nx) * ny * nz);
+
+    for (int z = 0; z < nz; ++z)
+    for (int y = 0; y < ny; ++y)
+    for (int x = 0; x < nx; ++x) {
+        size_t cell = (size_t(z) * ny + y) * nx + x;
+        map.set(cell, map.intern(updateCoeffs(materialAt(x, y, z), dt, dx)));
+    }
+}
+
+inline void printSummary(const CoeffMap& map, size_t cells) {
+    double fullGrid = double(cells) * sizeof(Coeffs) / (1024.0 * 1024.0);
+    std::cout << "Materials: " << map.table.size() << " coefficient sets, "
+              << CoeffMap::idBytes(cells) / (1024.0 * 1024.0) << " MB IDs + "
+              << map.tableBytes() / 1024.0 << " KB table (full-grid Ca/Cb/Da/Db: "
+              << fullGrid << " MB)\n";
+}
+
+} // namespace materials
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "geometry.h"
+#include "materials.h"
+#include "shader_utils.h"
+
+// Dispersive and nonlinear media. A medium fills a shape of the grid
+// (geometry.h) with an instantaneous permittivity eps_inf, a permeability and
+// a conductivity (voxelized into the coefficient map like any material, see
+// voxelizer.h), plus up to MAX_POLES Drude or Lorentz poles and an optional
+// Kerr chi3. The E pass updates every cell
+// with eps_inf; a sparse pass (shaders/media2d.comp / media3d.comp) then
+// visits only the cells of dispersive media and applies the auxiliary
+// differential equation (ADE) of each pole's polarization P:
+//
+//   d2P/dt2 + damping dP/dt + w0^2 P = strength E
+//     Drude:   w0 = 0, damping = gamma, strength = wp^2
+//     Lorentz: damping = delta, strength = deps w0^2
+//
+// on integer steps, P^{n+1} = c1 P^n + c2 P^{n-1} + c3 E^n, coupled through
+// E^{n+1} -= (cb dx / dt) (P^{n+1} - P^n). Kerr cells also keep E^n and scale
+// the step's E increment by eps_inf / (eps_inf + chi3 |E^n|^2).
+//
+// The pole state lives in one compact buffer: the cell list is sorted by
+// medium and each medium's cells take `slots` consecutive vectors, so a small
+// object costs a few floats per object cell instead of full-grid arrays.
+//
+// Media are given as (--medium, or `medium =` lines in a scene file)
+//   box:X0,Y0[,Z0],X1,Y1[,Z1][:key=value...]   inclusive cell box
+//   sphere:X,Y[,Z],R[:key=value...]            disc in 2D
+//   wire:X0,Y0[,Z0],X1,Y1[,Z1],R[:key=value...] capsule around a segment
+//   mesh:X,Y,Z:file=PATH[:scale=S][:key=value...] closed OBJ / STL mesh (3D)
+// with keys (angular frequencies in rad per unit time; repeat drude /
+// lorentz for more poles):
+//   eps=E  mu=M  sigma=S  drude=WP/GAMMA  lorentz=DEPS/W0/DELTA  chi3=X
+// Later media win where they overlap.
+namespace media {
+
+constexpr int CELL_BINDING  = 31;  // above the source table's
+constexpr int TABLE_BINDING = 32;
+constexpr int STATE_BINDING = 33;
+constexpr int MAX_POLES     = 2;
+constexpr int GROUP_SIZE    = 64;
+
+// One pole in the common ADE form above
+struct Pole {
+    float w0       = 0.0f;
+    float damping  = 0.0f;
+    float strength = 0.0f;
+};
+
+// One medium as given
+struct Region {
+    std::string     spec;                   // as parsed (a scene reload compares these)
+    geometry::Shape shape;
+    int             offset[3] = {0, 0, 0};  // cells moved since parsed (live nudges)
+    float           epsInf    = 1.0f;
+    float           muR       = 1.0f;
+    float           sigma     = 0.0f;
+    float           chi3      = 0.0f;
+    std::vector<Pole> poles;
+
+    bool dispersive() const { return !poles.empty() || chi3 != 0.0f; }
+    bool contains(int x, int y, int z) const { return shape.contains(x, y, z); }
+
+    // Inclusive bounding box
+    void bounds(int b[6]) const { shape.bounds(b); }
+};
+
+// Record — matches the GLSL `Medium` struct (std430)
+struct Record {
+    float    pole[MAX_POLES][4];  // c1, c2, c3, unused
+    float    kerr[4];             // chi3, eps_inf, unused
+    uint32_t range[4];            // first cell, first state float, poles, slots per cell
+};
+
+inline std::string defines() {
+    return "#define MEDIA_CELL_BINDING " + std::to_string(CELL_BINDING) + "\n"
+         + "#define MEDIA_TABLE_BINDING " + std::to_string(TABLE_BINDING) + "\n"
+         + "#define MEDIA_STATE_BINDING " + std::to_string(STATE_BINDING) + "\n"
+         + "#define MEDIA_MAX_POLES " + std::to_string(MAX_POLES) + "\n"
+         + "#define MEDIA_GROUP_SIZE " + std::to_string(GROUP_SIZE) + "\n";
+}
+
+// `spec` as described above; false (with a message) on a malformed one
+inline bool parse(const std::string& spec, bool is3d, Region& out) {
+    Region r;
+    auto fail = [&](const std::string& why) {
+        std::cerr << "Bad medium '" << spec << "': " << why << "\n";
+        return false;
+    };
+
+    r.spec = spec;
+    std::istringstream in(spec);
+    std::string shape, coords, part;
+    std::getline(in, shape, ':');
+    std::getline(in, coords, ':');
+    std::vector<float> v;
+    std::istringstream values(coords);
+    while (std::getline(values, part, ',')) {
+        char* end = nullptr;
+        v.push_back(std::strtof(part.c_str(), &end));
+        if (part.empty() || *end) return fail("coordinates must be numbers");
+    }
+    std::string why;
+    if (!geometry::parse(shape, v, is3d, r.shape, why)) return fail(why);
+
+    std::string file;
+    float scale = 1.0f;
+    while (std::getline(in, part, ':')) {
+        size_t eq = part.find('=');
+        std::string key   = part.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : part.substr(eq + 1);
+        float a = 0.0f, b = 0.0f, c = 0.0f;
+        if (key == "drude") {
+            if (std::sscanf(value.c_str(), "%f/%f", &a, &b) != 2 || a <= 0.0f || b < 0.0f)
+                return fail("drude must be WP/GAMMA, WP > 0, GAMMA >= 0");
+            r.poles.push_back({0.0f, b, a * a});
+        } else if (key == "lorentz") {
+            if (std::sscanf(value.c_str(), "%f/%f/%f", &a, &b, &c) != 3 || a <= 0.0f ||
+                b <= 0.0f || c < 0.0f)
+                return fail("lorentz must be DEPS/W0/DELTA, DEPS and W0 > 0, DELTA >= 0");
+            r.poles.push_back({b, c, a * b * b});
+        } else if (key == "file" && r.shape.kind == geometry::KIND_MESH && !value.empty()) {
+            file = value;
+        } else {
+            char* end = nullptr;
+            float x   = std::strtof(value.c_str(), &end);
+            if (value.empty() || *end) return fail("'" + key + "' needs a numeric value");
+            if (key == "eps" && x >= 1.0f)        r.epsInf = x;
+            else if (key == "mu" && x >= 1.0f)    r.muR    = x;
+            else if (key == "sigma" && x >= 0.0f) r.sigma  = x;
+            else if (key == "chi3" && x >= 0.0f)  r.chi3   = x;
+            else if (key == "scale" && x > 0.0f && r.shape.kind == geometry::KIND_MESH)
+                scale = x;
+            else return fail("unknown key or value out of range: '" + part + "'");
+        }
+        if (int(r.poles.size()) > MAX_POLES)
+            return fail("at most " + std::to_string(MAX_POLES) + " poles");
+    }
+    if (r.shape.kind == geometry::KIND_MESH) {
+        if (file.empty()) return fail("a mesh needs file=PATH");
+        auto mesh = std::make_shared<geometry::Mesh>();
+        if (!geometry::loadMesh(file, scale, *mesh, why)) return fail(why);
+        r.shape.mesh = mesh;
+    }
+    out = r;
+    return true;
+}
+
+// Last medium of `list` holding cell (x, y, z), or null
+inline const Region* regionAt(const std::vector<Region>& list, int x, int y, int z) {
+    for (auto it = list.rbegin(); it != list.rend(); ++it)
+        if (it->contains(x, y, z)) return &*it;
+    return nullptr;
+}
+
+// Instantaneous part of a medium's material (vacuum for null)
+inline materials::Material materialOf(const Region* r) {
+    materials::Material m;
+    if (r) {
+        m.eps_r = r->epsInf;
+        m.mu_r  = r->muR;
+        m.sigma = r->sigma;
+    }
+    return m;
+}
+
+inline bool anyDispersive(const std::vector<Region>& list) {
+    for (const Region& r : list)
+        if (r.dispersive()) return true;
+    return false;
+}
+
+// The explicit ADE is stable for w dt < 2 per pole, with w^2 = w0^2 plus the
+// plasma term over eps_inf; warn (the watchdog catches the rest) otherwise
+inline void checkStability(const std::vector<Region>& list, float dt) {
+    for (const Region& r : list)
+        for (const Pole& p : r.poles)
+            if (std::sqrt(p.w0 * p.w0 + p.strength / r.epsInf) * dt >= 2.0f)
+                std::cout << "Medium: a pole resonates faster than the timestep resolves "
+                             "(w dt >= 2); expect divergence\n";
+}
+
+// Host form of the sparse state, shared by the GPU upload and the CPU
+// reference: cells as (x, y, z, medium) sorted by medium, medium records and
+// the state floats per scenario
+struct Plan {
+    std::vector<int32_t> cells;  // 4 per cell
+    std::vector<Record>  media;
+    size_t stateFloats = 0;
+    int    comps       = 1;      // field components per state vector: 1 (TMz) or 3
+
+    size_t count() const { return cells.size() / 4; }
+    bool   empty() const { return cells.empty(); }
+};
+
+// Cells of the dispersive media on a grid of `dims`. Only cells the E pass
+// updates (not on the grid faces) are listed.
+inline Plan plan(const std::vector<Region>& list, const int dims[3], int comps, float dt) {
+    Plan p;
+    p.comps = comps;
+    const bool is3d = dims[2] > 1;
+    for (size_t m = 0; m < list.size(); ++m) {
+        const Region& r = list[m];
+        if (!r.dispersive()) continue;
+
+        Record rec{};
+        for (size_t k = 0; k < r.poles.size(); ++k) {
+            const Pole& q = r.poles[k];
+            float d = 1.0f + 0.5f * q.damping * dt;
+            rec.pole[k][0] = (2.0f - q.w0 * q.w0 * dt * dt) / d;
+            rec.pole[k][1] = -(1.0f - 0.5f * q.damping * dt) / d;
+            rec.pole[k][2] = q.strength * dt * dt / d;
+        }
+        rec.kerr[0]   = r.chi3;
+        rec.kerr[1]   = r.epsInf;
+        rec.range[0] = uint32_t(p.count());
+        rec.range[1] = uint32_t(p.stateFloats);
+        rec.range[2] = uint32_t(r.poles.size());
+        rec.range[3] = uint32_t(2 * r.poles.size() + (r.chi3 != 0.0f ? 1 : 0));
+
+        int b[6];
+        r.bounds(b);
+        int lo[3] = {std::max(b[0], 1), std::max(b[1], 1), is3d ? std::max(b[2], 1) : 0};
+        int hi[3] = {std::min(b[3], dims[0] - 2), std::min(b[4], dims[1] - 2),
+                     is3d ? std::min(b[5], dims[2] - 2) : 0};
+        size_t first = p.count();
+        for (int z = lo[2]; z <= hi[2]; ++z)
+        for (int y = lo[1]; y <= hi[1]; ++y)
+        for (int x = lo[0]; x <= hi[0]; ++x)
+            if (regionAt(list, x, y, z) == &r)
+                p.cells.insert(p.cells.end(), {x, y, z, int32_t(p.media.size())});
+        if (p.count() == first) continue;  // hidden behind later media, or off the grid
+        p.stateFloats += (p.count() - first) * rec.range[3] * comps;
+        p.media.push_back(rec);
+    }
+    return p;
+}
+
+// Checkpoints carry the plan's hash, so a restart must model the same media
+inline uint64_t hash(const Plan& p) {
+    uint64_t h = shader::fnv1a(p.cells.data(), p.cells.size() * sizeof(int32_t));
+    return shader::fnv1a(p.media.data(), p.media.size() * sizeof(Record), h);
+}
+
+inline void printSummary(const Plan& p, size_t gridCells, int layers) {
+    if (p.empty()) return;
+    double kb = double(p.stateFloats) * layers * sizeof(float) / 1024.0;
+    std::cout << "Media: " << p.media.size() << " dispersive, " << p.count() << " cells, "
+              << kb << " KB pole state (" << 100.0 * p.count() / gridCells
+              << "% of the grid)\n";
+}
+
+// One ADE step of one cell (shaders/media.glsl). `e`: the cell's E after
+// the E pass, turned into E^{n+1}; `s`: its state floats; `k` = cb dx / dt.
+inline void step(const Record& m, float* s, float* e, float k, int comps) {
+    const int poles = int(m.range[2]);
+    for (int c = 0; c < comps; ++c) {
+        float dP = 0.0f;
+        for (int q = 0; q < poles; ++q) dP += s[2 * q * comps + c] - s[(2 * q + 1) * comps + c];
+        e[c] -= k * dP;
+    }
+    if (m.kerr[0] != 0.0f) {
+        float* prev = s + 2 * poles * comps;
+        float  sq   = 0.0f;
+        for (int c = 0; c < comps; ++c) sq += prev[c] * prev[c];
+        float scale = m.kerr[1] / (m.kerr[1] + m.kerr[0] * sq);
+        for (int c = 0; c < comps; ++c) {
+            e[c]    = prev[c] + scale * (e[c] - prev[c]);
+            prev[c] = e[c];
+        }
+    }
+    for (int q = 0; q < poles; ++q)
+        for (int c = 0; c < comps; ++c) {
+            float* pa = s + 2 * q * comps + c;
+            float* pb = pa + comps;
+            float  pn = m.pole[q][0] * *pa + m.pole[q][1] * *pb + m.pole[q][2] * e[c];
+            *pb = *pa;
+            *pa = pn;
+        }
+}
+
+// Plan on the GPU (bindings CELL_BINDING / TABLE_BINDING / STATE_BINDING);
+// the state is zeroed and sized for `layers` 2D batch scenarios
+struct Buffers {
+    GLuint cellSSBO   = 0;
+    GLuint tableSSBO  = 0;
+    GLuint stateSSBO  = 0;
+    int    count      = 0;
+    size_t stateBytes = 0;  // all layers
+
+    void upload(const Plan& p, int layers) {
+        count = int(p.count());
+        if (!count) return;
+        if (!cellSSBO) glGenBuffers(1, &cellSSBO);
+        if (!tableSSBO) glGenBuffers(1, &tableSSBO);
+        if (!stateSSBO) glGenBuffers(1, &stateSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, cellSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, p.cells.size() * sizeof(int32_t), p.cells.data(),
+                     GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, tableSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, p.media.size() * sizeof(Record), p.media.data(),
+                     GL_STATIC_DRAW);
+        stateBytes = p.stateFloats * layers * sizeof(float);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, stateBytes, nullptr, GL_DYNAMIC_COPY);
+        vram::clear(GL_SHADER_STORAGE_BUFFER);
+    }
+
+    void bind() const {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CELL_BINDING, cellSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TABLE_BINDING, tableSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, STATE_BINDING, stateSSBO);
+    }
+
+    // One invocation per cell (x) and scenario (z)
+    void dispatch(int layers) const {
+        glDispatchCompute(GLuint((count + GROUP_SIZE - 1) / GROUP_SIZE), 1, GLuint(layers));
+    }
+
+    void cleanup() {
+        glDeleteBuffers(1, &cellSSBO);
+        glDeleteBuffers(1, &tableSSBO);
+        glDeleteBuffers(1, &stateSSBO);
+        *this = Buffers();
+    }
+};
+
+} // namespace media
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "dft.h"
+
+// Far-field radiation pattern of the 3D solver by a near-to-far-field
+// transform. A closed Huygens box inside the absorbing layer is recorded
+// as six DFT probe faces (dft.h). Every `every` steps, shaders/ntff3d.comp
+// integrates their equivalent surface currents for all (theta, phi)
+// directions at once, one invocation per direction and frequency. The
+// running DFT keeps converging, so each pass refines the pattern, and the
+// change since the previous pass is reported.
+//
+// Output (CSV, rewritten every pass): freq, theta/phi in degrees, complex
+// E_theta / E_phi (times r e^(jkr)), directivity in dBi.
+namespace ntff {
+
+constexpr int    PATTERN_BINDING = 23;   // above the DFT bindings
+constexpr int    MARGIN          = 3;    // default box: cells inside the absorbing layer
+constexpr int    MAX_DIRECTIONS  = 1 << 20;
+constexpr double PI              = 3.14159265358979323846;
+
+inline std::string defines() {
+    return "#define NTFF_PATTERN_BINDING " + std::to_string(PATTERN_BINDING) + "\n";
+}
+
+// The six faces of `box` as probe boxes: -x +x -y +y -z +z (ntff3d.comp
+// order), each the face plane plus the plane below it along the normal
+inline std::vector<dft::Box> faces(const dft::Box& box) {
+    std::vector<dft::Box> out;
+    for (int a = 0; a < 3; ++a)
+        for (int side = 0; side < 2; ++side) {
+            dft::Box f = box;
+            f.hi[a] = side ? box.hi[a] : box.lo[a];
+            f.lo[a] = f.hi[a] - 1;
+            out.push_back(f);
+        }
+    return out;
+}
+
+struct Transform {
+    bool        enabled    = false;
+    dft::Box    box;
+    int         thetaCount = 0, phiCount = 0;
+    int         faceBase   = 0;    // probe index of the -x face
+    std::string path;
+    GLuint      program     = 0;
+    GLuint      patternSSBO = 0;
+
+    // Directivity of the previous pass per (frequency, direction): the
+    // baseline for the convergence report
+    std::vector<float> lastDirectivity;
+
+    // Cached uniform locations — ntff3d.comp
+    GLint loc_faceBase = -1, loc_probeCells = -1, loc_thetaCount = -1, loc_phiCount = -1;
+    GLint loc_freqCount = -1, loc_center = -1, loc_dx = -1, loc_waveNumber = -1;
+
+    int directions() const { return thetaCount * phiCount; }
+
+    void init(const dft::Box& b, int base, int thetas, int phis, size_t freqCount,
+              const std::string& out, GLuint prog) {
+        box        = b;
+        faceBase   = base;
+        thetaCount = thetas;
+        phiCount   = phis;
+        path       = out;
+        program    = prog;
+        lastDirectivity.clear();
+
+        if (!patternSSBO) glGenBuffers(1, &patternSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, patternSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, freqCount * directions() * 4 * sizeof(float),
+                     nullptr, GL_DYNAMIC_READ);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PATTERN_BINDING, patternSSBO);
+
+        loc_faceBase   = glGetUniformLocation(program, "faceBase");
+        loc_probeCells = glGetUniformLocation(program, "probeCells");
+        loc_thetaCount = glGetUniformLocation(program, "thetaCount");
+        loc_phiCount   = glGetUniformLocation(program, "phiCount");
+        loc_freqCount  = glGetUniformLocation(program, "freqCount");
+        loc_center     = glGetUniformLocation(program, "center");
+        loc_dx         = glGetUniformLocation(program, "dx");
+        loc_waveNumber = glGetUniformLocation(program, "waveNumber");
+        enabled = true;
+
+        size_t surface = 0;
+        for (const dft::Box& f : faces(box)) surface += f.cells() / 2;
+        std::cout << "NTFF: Huygens box (" << box.lo[0] << "," << box.lo[1] << "," << box.lo[2]
+                  << ")-(" << box.hi[0] << "," << box.hi[1] << "," << box.hi[2] << "), "
+                  << surface << " surface cells, " << thetaCount << "x" << phiCount
+                  << " directions\n";
+    }
+
+    // Transform the accumulators as they stand, report and rewrite the
+    // pattern file. Needs the probes' frequencies (c = 1: k = 2 pi f).
+    void update(const dft::Probes& probes, float dx, int step) {
+        if (!enabled || probes.steps == 0) return;
+        const size_t nf = probes.freqs.size();
+        float k[dft::MAX_FREQS];
+        for (size_t i = 0; i < nf; ++i) k[i] = float(2.0 * PI * probes.freqs[i]);
+
+        glUseProgram(program);
+        glUniform1i(loc_faceBase, faceBase);
+        glUniform1i(loc_probeCells, int(probes.cells));
+        glUniform1i(loc_thetaCount, thetaCount);
+        glUniform1i(loc_phiCount, phiCount);
+        glUniform1i(loc_freqCount, int(nf));
+        glUniform3f(loc_center, 0.5f * (box.lo[0] + box.hi[0]), 0.5f * (box.lo[1] + box.hi[1]),
+                    0.5f * (box.lo[2] + box.hi[2]));
+        glUniform1f(loc_dx, dx);
+        glUniform1fv(loc_waveNumber, GLsizei(nf), k);
+        glDispatchCompute(GLuint((directions() + 63) / 64), GLuint(nf), 1);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        std::vector<float> field(nf * directions() * 4);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, patternSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, field.size() * sizeof(float),
+                           field.data());
+
+        std::vector<float> directivity = report(field, probes.freqs, step);
+        write(field, directivity, probes.freqs);
+        lastDirectivity = std::move(directivity);
+    }
+
+    // Radiation intensity |E|^2 / (2 eta) of one (E_theta, E_phi) sample, eta = 1
+    static double intensity(const float* e) {
+        return 0.5 * (double(e[0]) * e[0] + double(e[1]) * e[1] + double(e[2]) * e[2] +
+                      double(e[3]) * e[3]);
+    }
+
+    // Directivity D = 4 pi U / P_rad per (frequency, direction), P_rad
+    // integrated over the sampled sphere (trapezoidal in theta)
+    std::vector<float> report(const std::vector<float>& field, const std::vector<float>& freqs,
+                              int step) const {
+        const int    dirs   = directions();
+        const double dTheta = PI / (thetaCount - 1), dPhi = 2.0 * PI / phiCount;
+        std::vector<float> out(field.size() / 4);
+
+        for (size_t k = 0; k < freqs.size(); ++k) {
+            const float* f = &field[k * dirs * 4];
+            double power = 0.0;
+            for (int d = 0; d < dirs; ++d) {
+                int    t = d / phiCount;
+                double w = (t == 0 || t == thetaCount - 1) ? 0.5 : 1.0;
+                power += intensity(f + 4 * d) * std::sin(t * dTheta) * w * dTheta * dPhi;
+            }
+
+            int   peak = 0;
+            float change = 0.0f;
+            for (int d = 0; d < dirs; ++d) {
+                float& D = out[k * dirs + d];
+                D = power > 0.0 ? float(4.0 * PI * intensity(f + 4 * d) / power) : 0.0f;
+                if (D > out[k * dirs + peak]) peak = d;
+                if (!lastDirectivity.empty())
+                    change = std::max(change, std::abs(D - lastDirectivity[k * dirs + d]));
+            }
+
+            float Dmax = out[k * dirs + peak];
+            std::printf("NTFF step %d, f = %g: peak %.2f dBi at theta %.1f, phi %.1f deg",
+                        step, freqs[k], 10.0 * std::log10(std::max(Dmax, 1e-30f)),
+                        (peak / phiCount) * 180.0 / (thetaCount - 1),
+                        (peak % phiCount) * 360.0 / phiCount);
+            if (lastDirectivity.empty())
+                std::printf("\n");
+            else
+                std::printf(", pattern change %.3g %%\n",
+                            Dmax > 0.0f ? 100.0 * change / Dmax : 0.0);
+        }
+        return out;
+    }
+
+    // Via a temporary file renamed into place, so a viewer never reads half a pattern
+    bool write(const std::vector<float>& field, const std::vector<float>& directivity,
+               const std::vector<float>& freqs) const {
+        std::string tmp = path + ".tmp";
+        FILE* f = std::fopen(tmp.c_str(), "w");
+        if (!f) {
+            std::cerr << "Failed to open pattern output: " << path << "\n";
+            return false;
+        }
+        std::fprintf(f, "freq,theta_deg,phi_deg,e_theta_re,e_theta_im,e_phi_re,e_phi_im,"
+                        "directivity_dbi\n");
+        const int dirs = directions();
+        for (size_t k = 0; k < freqs.size(); ++k)
+            for (int d = 0; d < dirs; ++d) {
+                const float* e = &field[(k * dirs + d) * 4];
+                std::fprintf(f, "%g,%g,%g,%g,%g,%g,%g,%g\n", freqs[k],
+                             (d / phiCount) * 180.0 / (thetaCount - 1),
+                             (d % phiCount) * 360.0 / phiCount, e[0], e[1], e[2], e[3],
+                             10.0 * std::log10(std::max(directivity[k * dirs + d], 1e-30f)));
+            }
+        bool ok = std::fclose(f) == 0;
+#ifdef _WIN32
+        if (ok) std::remove(path.c_str());
+#endif
+        ok = ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+        if (!ok) std::cerr << "Failed to write pattern output: " << path << "\n";
+        return ok;
+    }
+
+    void cleanup() {
+        glDeleteBuffers(1, &patternSSBO);
+        patternSSBO = 0;
+        enabled = false;
+    }
+};
+
+} // namespace ntff
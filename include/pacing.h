@@ -0,0 +1,159 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+// Adaptive steps per frame for the windowed loop. The solver and render
+// passes of every frame are bracketed by GL_TIME_ELAPSED queries, and
+// FRAMES_IN_FLIGHT query pairs are cycled. A pair is read back only once
+// its results are available, so pacing never stalls the pipeline. From the
+// smoothed GPU cost per step and of the rest of the frame, the pacer picks
+// how many steps fit in the frame budget:
+//
+//   steps = (budget * HEADROOM - render ms) / solver ms per step
+//
+// An idle display then runs the solver as fast as it goes, and a heavy
+// frame sheds steps instead of stuttering. Each rendered frame shows the
+// fields after that frame's last step.
+namespace pacing {
+
+constexpr int    FRAMES_IN_FLIGHT = 4;     // query pairs cycled between frames
+constexpr int    MAX_STEPS        = 512;   // steps per frame ceiling
+constexpr double HEADROOM         = 0.85;  // share of the budget the GPU work may fill
+constexpr double SMOOTHING        = 0.2;   // weight of the newest sample
+
+struct Pacer {
+    struct Slot {
+        GLuint solve = 0, render = 0;
+        int    steps   = 0;      // 0 = nothing issued / stale sample
+        bool   pending = false;
+    };
+
+    bool   enabled   = false;
+    double budgetMs  = 0.0;   // target frame time
+    int    steps     = 1;     // steps to run this frame
+    double msPerStep = 0.0;   // smoothed solver GPU ms per step (0 = no sample yet)
+    double renderMs  = 0.0;   // smoothed GPU ms of the rest of the frame
+    Slot   slots[FRAMES_IN_FLIGHT];
+    int    current   = 0;
+
+    // Achieved rate: since the last overlay() and over the whole run
+    long long windowSteps = 0, windowFrames = 0;
+    long long totalSteps  = 0, totalFrames  = 0;
+    int       minSteps    = MAX_STEPS, maxSteps = 0;
+
+    // budgetMs <= 0 keeps the fixed `initialSteps` per frame
+    void start(double budget, int initialSteps) {
+        enabled  = budget > 0.0;
+        budgetMs = budget;
+        steps    = std::max(initialSteps, 1);
+        if (!enabled) return;
+        for (Slot& s : slots) {
+            glGenQueries(1, &s.solve);
+            glGenQueries(1, &s.render);
+        }
+        std::cout << "Pacing: adaptive steps per frame for a " << budgetMs << " ms frame\n";
+    }
+
+    // New grid or scene: forget the cost estimate, keep in-flight queries
+    // but drop their samples
+    void restart(int initialSteps) {
+        steps     = std::max(initialSteps, 1);
+        msPerStep = 0.0;
+        renderMs  = 0.0;
+        for (Slot& s : slots) s.steps = 0;
+    }
+
+    // ── Per frame ──
+
+    // Fold in the oldest finished frame and pick this frame's step count
+    void beginFrame() {
+        if (!enabled) return;
+        Slot& s = slots[current];
+        if (s.pending) resolve(s);
+    }
+
+    void beginSolve() {
+        if (enabled) glBeginQuery(GL_TIME_ELAPSED, slots[current].solve);
+    }
+
+    void endSolve() {
+        if (!enabled) return;
+        glEndQuery(GL_TIME_ELAPSED);
+        glBeginQuery(GL_TIME_ELAPSED, slots[current].render);
+    }
+
+    // `ran` = steps the frame actually advanced
+    void endFrame(int ran) {
+        windowSteps += ran;
+        totalSteps  += ran;
+        ++windowFrames;
+        ++totalFrames;
+        minSteps = std::min(minSteps, ran);
+        maxSteps = std::max(maxSteps, ran);
+        if (!enabled) return;
+        glEndQuery(GL_TIME_ELAPSED);
+        slots[current].steps   = ran;
+        slots[current].pending = true;
+        current = (current + 1) % FRAMES_IN_FLIGHT;
+    }
+
+    // ── Results ──
+
+    // Title-bar text for the last `seconds`: steps per frame and per second
+    std::string overlay(double seconds) {
+        char buf[96];
+        double perFrame = windowFrames ? double(windowSteps) / windowFrames : 0.0;
+        std::snprintf(buf, sizeof(buf), "%.1f steps/frame%s, %.0f steps/s", perFrame,
+                      enabled ? " (auto)" : "", seconds > 0.0 ? windowSteps / seconds : 0.0);
+        windowSteps = windowFrames = 0;
+        return buf;
+    }
+
+    void printSummary() const {
+        if (!enabled || totalFrames == 0) return;
+        std::cout << "\n=== Pacing (" << budgetMs << " ms frame budget) ===\n"
+                  << "  Steps/frame   : " << double(totalSteps) / totalFrames << " avg, "
+                  << minSteps << " min, " << maxSteps << " max over " << totalFrames
+                  << " frames\n"
+                  << "  Solver        : " << msPerStep << " GPU ms/step\n"
+                  << "  Rest of frame : " << renderMs << " GPU ms\n";
+    }
+
+    void cleanup() {
+        for (Slot& s : slots) {
+            if (s.solve) glDeleteQueries(1, &s.solve);
+            if (s.render) glDeleteQueries(1, &s.render);
+            s = Slot{};
+        }
+    }
+
+    // ── Internals ──
+
+    void resolve(Slot& s) {
+        GLuint ready = GL_FALSE;
+        glGetQueryObjectuiv(s.render, GL_QUERY_RESULT_AVAILABLE, &ready);
+        s.pending = false;
+        if (!ready || s.steps == 0) return;  // still running (dropped) or stale
+
+        GLuint64 solveNs = 0, renderNs = 0;
+        glGetQueryObjectui64v(s.solve, GL_QUERY_RESULT, &solveNs);
+        glGetQueryObjectui64v(s.render, GL_QUERY_RESULT, &renderNs);
+        double perStep = solveNs * 1.0e-6 / s.steps;
+        double rest    = renderNs * 1.0e-6;
+        bool   first   = msPerStep <= 0.0;
+        msPerStep = first ? perStep : msPerStep + SMOOTHING * (perStep - msPerStep);
+        renderMs  = first ? rest : renderMs + SMOOTHING * (rest - renderMs);
+        if (msPerStep <= 0.0) return;
+
+        // At most double or halve per sample so one outlier cannot swing it
+        double fit  = (budgetMs * HEADROOM - renderMs) / msPerStep;
+        int    want = int(std::clamp(fit, 1.0, double(MAX_STEPS)));
+        steps = std::clamp(want, std::max(steps / 2, 1), std::min(steps * 2, MAX_STEPS));
+    }
+};
+
+} // namespace pacing
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Host-side support for reduced-precision field storage: decoding the
+// packHalf2x16 words read back from the GPU and comparing a run against an
+// fp32 reference.
+namespace precision {
+
+// IEEE 754 binary16 -> binary32 (matches GLSL unpackHalf2x16)
+inline float halfToFloat(uint16_t h) {
+    uint32_t sign = uint32_t(h & 0x8000u) << 16;
+    uint32_t exp  = (h >> 10) & 0x1Fu;
+    uint32_t man  = h & 0x3FFu;
+    uint32_t bits;
+
+    if (exp == 0x1Fu) {
+        bits = sign | 0x7F800000u | (man << 13);           // inf / NaN
+    } else if (exp != 0) {
+        bits = sign | ((exp + 112u) << 23) | (man << 13);  // normal
+    } else if (man == 0) {
+        bits = sign;                                       // +-0
+    } else {
+        float f = std::ldexp(float(man), -24);             // subnormal
+        std::memcpy(&bits, &f, 4);
+        bits |= sign;
+    }
+    float out;
+    std::memcpy(&out, &bits, 4);
+    return out;
+}
+
+struct ErrorStats {
+    double maxAbs = 0.0;  // max |test - ref|
+    double rms    = 0.0;  // RMS of (test - ref)
+    double refRms = 0.0;  // RMS of ref, for the relative figure
+    double refMax = 0.0;  // max |ref|
+};
+
+inline ErrorStats compare(const float* test, const float* ref, size_t n) {
+    ErrorStats s;
+    double sumErr = 0.0, sumRef = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double d = double(test[i]) - double(ref[i]);
+        s.maxAbs = std::fmax(s.maxAbs, std::fabs(d));
+        s.refMax = std::fmax(s.refMax, std::fabs(double(ref[i])));
+        sumErr += d * d;
+        sumRef += double(ref[i]) * double(ref[i]);
+    }
+    s.rms    = std::sqrt(sumErr / double(n));
+    s.refRms = std::sqrt(sumRef / double(n));
+    return s;
+}
+
+// Per-component report for fields stored as 6 consecutive grids (Ex..Hz)
+inline void printReport(const std::vector<float>& test, const std::vector<float>& ref,
+                        size_t cells, const char* label) {
+    const char* names[] = {"Ex", "Ey", "Ez", "Hx", "Hy", "Hz"};
+
+    std::cout << "\n=== Field error vs fp32 (" << label << ") ===\n"
+              << "  comp     max|err|      rms err      rms ref    rel rms\n";
+    for (int c = 0; c < 6; ++c) {
+        ErrorStats s = compare(test.data() + c * cells, ref.data() + c * cells, cells);
+        double rel = (s.refRms > 0.0) ? s.rms / s.refRms : 0.0;
+        std::cout << "  " << names[c] << "  " << std::scientific
+                  << "  " << s.maxAbs << "  " << s.rms << "  " << s.refRms
+                  << "  " << rel << std::defaultfloat << "\n";
+    }
+    ErrorStats all = compare(test.data(), ref.data(), 6 * cells);
+    std::cout << "  all   " << std::scientific << all.maxAbs << "  " << all.rms
+              << "  " << all.refRms << "  "
+              << ((all.refRms > 0.0) ? all.rms / all.refRms : 0.0)
+              << std::defaultfloat << "\n";
+}
+
+} // namespace precision
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+
+#include "shader_utils.h"
+
+// Cached render path of the windowed views. The fields are coloured once
+// per simulation update into an RGBA8 image at grid resolution (a compute
+// pass through the colormap LUTs); shaders/present.frag then scales it to
+// the window with the camera transform. Each stage keeps the key of what it
+// was built from and is skipped while the key holds, and the presented
+// frame itself is kept in an offscreen target: a frame where neither the
+// fields, the slice, the camera nor the window changed is a single blit.
+namespace target {
+
+constexpr int IMAGE_UNIT = 1;  // above the volume mirror's
+
+inline std::string defines() {
+    return "#define TARGET_IMAGE_UNIT " + std::to_string(IMAGE_UNIT) + "\n";
+}
+
+// Everything a cached stage depends on, folded into one hash
+struct Key {
+    uint64_t hash = shader::fnv1a("", 0);
+
+    template <typename T>
+    Key& add(const T& value) {
+        hash = shader::fnv1a(&value, sizeof(value), hash);
+        return *this;
+    }
+};
+
+// Coloured fields at grid resolution
+struct Image {
+    GLuint   texture = 0;
+    int      width   = 0, height = 0;
+    uint64_t key     = 0;
+    bool     valid   = false;
+
+    // True when the image must be recoloured for `k`: it is then sized
+    // w x h and bound for writing on IMAGE_UNIT
+    bool stale(int w, int h, const Key& k) {
+        if (valid && k.hash == key && w == width && h == height) return false;
+        if (w != width || h != height) {  // immutable storage: a new texture per size
+            glDeleteTextures(1, &texture);
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, w, h);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            width  = w;
+            height = h;
+        }
+        glBindImageTexture(IMAGE_UNIT, texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        key   = k.hash;
+        valid = true;
+        return true;
+    }
+
+    void cleanup() {
+        glDeleteTextures(1, &texture);
+        *this = Image();
+    }
+};
+
+// The last presented frame, at window resolution, with a depth buffer for
+// the views that test depth
+struct Frame {
+    GLuint   fbo     = 0;
+    GLuint   texture = 0;
+    GLuint   depth   = 0;
+    int      width   = 0, height = 0;
+    uint64_t key     = 0;
+    bool     valid   = false;
+
+    // True when the frame must be redrawn for `k`: the offscreen target is
+    // then bound, sized w x h. False: present() repeats the last one.
+    bool begin(int w, int h, const Key& k) {
+        if (valid && k.hash == key && w == width && h == height) return false;
+        if (!fbo) glGenFramebuffers(1, &fbo);
+        if (w != width || h != height) {  // immutable storage: a new texture per size
+            glDeleteTextures(1, &texture);
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, w, h);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            if (!depth) glGenRenderbuffers(1, &depth);
+            glBindRenderbuffer(GL_RENDERBUFFER, depth);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture,
+                                   0);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                                      depth);
+            width  = w;
+            height = h;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, w, h);
+        key   = k.hash;
+        valid = true;
+        return true;
+    }
+
+    // Copy the frame to the window
+    void present() const {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT,
+                          GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void cleanup() {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(1, &texture);
+        glDeleteRenderbuffers(1, &depth);
+        *this = Frame();
+    }
+};
+
+// Draws an Image into the bound quad: aspect-correct, with the 2D camera's
+// pan and zoom (identity for the 3D slice)
+struct Presenter {
+    GLuint program = 0;
+
+    // Cached uniform locations — present.frag
+    GLint loc_aspect_ratio = -1, loc_image_ratio = -1, loc_view_center = -1, loc_view_zoom = -1;
+
+    void init() {
+        program          = shader::createProgram("shaders/field.vert", "shaders/present.frag");
+        loc_aspect_ratio = glGetUniformLocation(program, "aspect_ratio");
+        loc_image_ratio  = glGetUniformLocation(program, "image_ratio");
+        loc_view_center  = glGetUniformLocation(program, "view_center");
+        loc_view_zoom    = glGetUniformLocation(program, "view_zoom");
+    }
+
+    // `imageRatio`: width / height the image is shown at
+    void draw(const Image& image, float aspect, float imageRatio, float centerX = 0.0f,
+              float centerY = 0.0f, float zoom = 1.0f) const {
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        glUseProgram(program);
+        glUniform1f(loc_aspect_ratio, aspect);
+        glUniform1f(loc_image_ratio, imageRatio);
+        glUniform2f(loc_view_center, centerX, centerY);
+        glUniform1f(loc_view_zoom, zoom);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, image.texture);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void cleanup() {
+        glDeleteProgram(program);
+        program = 0;
+    }
+};
+
+} // namespace target
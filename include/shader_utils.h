@@ -1,6 +1,10 @@
 #pragma once
 
 #include <GL/glew.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -20,8 +24,42 @@ inline std::string loadSource(const char* path) {
     return ss.str();
 }
 
-inline GLuint compile(const char* path, GLenum type) {
-    std::string src = loadSource(path);
+// Source with `#include "file"` lines expanded, resolved relative to the
+// including file (GLSL has no include of its own)
+inline std::string preprocess(const std::string& path, int depth = 0) {
+    if (depth > 8) {
+        std::cerr << "Shader include nesting too deep: " << path << "\n";
+        exit(EXIT_FAILURE);
+    }
+    std::string dir = path.substr(0, path.find_last_of('/') + 1);
+    std::istringstream in(loadSource(path.c_str()));
+    std::string out, line;
+
+    while (std::getline(in, line)) {
+        size_t open = line.find('"');
+        if (line.rfind("#include", 0) == 0 && open != std::string::npos) {
+            size_t close = line.find('"', open + 1);
+            out += preprocess(dir + line.substr(open + 1, close - open - 1), depth + 1);
+        } else {
+            out += line + "\n";
+        }
+    }
+    return out;
+}
+
+// Full source of one stage: includes expanded and `defines` (a block of
+// #define lines) spliced in after #version, so variants of the same file
+// can be chosen at startup
+inline std::string variantSource(const char* path, const std::string& defines = "") {
+    std::string src = preprocess(path);
+    if (!defines.empty()) {
+        size_t eol = src.find('\n') + 1;  // #version must stay first
+        src.insert(eol, defines + "#line 2\n");
+    }
+    return src;
+}
+
+inline GLuint compileSource(const std::string& src, const char* path, GLenum type) {
     const char* srcPtr = src.c_str();
 
     GLuint shader = glCreateShader(type);
@@ -42,36 +80,155 @@ inline GLuint compile(const char* path, GLenum type) {
     return shader;
 }
 
-inline GLuint createProgram(const char* vertPath, const char* fragPath) {
-    GLuint vs = compile(vertPath, GL_VERTEX_SHADER);
-    GLuint fs = compile(fragPath, GL_FRAGMENT_SHADER);
+inline GLuint compile(const char* path, GLenum type, const std::string& defines = "") {
+    return compileSource(variantSource(path, defines), path, type);
+}
 
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vs);
-    glAttachShader(program, fs);
-    glLinkProgram(program);
+// One stage of a program: its final source, and the file it came from
+// (for error messages)
+struct Stage {
+    GLenum      type;
+    const char* path;
+    std::string source;
+};
 
-    GLint success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        GLint logLen;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLen);
-        std::vector<char> log(logLen);
-        glGetProgramInfoLog(program, logLen, nullptr, log.data());
-        std::cerr << "Shader link error:\n" << log.data() << "\n";
-        exit(EXIT_FAILURE);
+// ── Program binary cache ──
+//
+// Linked programs are kept on disk (glGetProgramBinary) under `dir`, one
+// file per variant, named by an FNV-1a hash of the driver strings and of
+// every stage's final source. Any edit to a shader or an include, a new
+// set of defines or a driver update is a different key; a binary the
+// driver still rejects is recompiled and replaced. Empty `dir` = off.
+struct BinaryCache {
+    std::string dir = "shader_cache";
+    int  hits = 0, misses = 0;
+    bool probed = false, supported = false;  // GL_NUM_PROGRAM_BINARY_FORMATS > 0
+};
+
+inline BinaryCache& binaryCache() {
+    static BinaryCache cache;
+    return cache;
+}
+
+// File layout: this header, then `length` bytes of driver binary
+struct BinaryHeader {
+    char     magic[4] = {'E', 'M', 'P', 'B'};
+    uint32_t version  = 1;
+    uint32_t format   = 0;  // GLenum from glGetProgramBinary
+    uint32_t length   = 0;
+};
+
+inline uint64_t fnv1a(const void* data, size_t n, uint64_t h = 0xcbf29ce484222325ull) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 0x100000001b3ull;
+    return h;
+}
+
+// Cache file of a program built from `stages`, or "" when the cache is
+// off or the driver keeps no binaries
+inline std::string binaryPath(const std::vector<Stage>& stages) {
+    BinaryCache& cache = binaryCache();
+    if (cache.dir.empty()) return "";
+    if (!cache.probed) {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        cache.probed    = true;
+        cache.supported = formats > 0;
+        if (!cache.supported) std::cout << "Shader cache: driver keeps no program binaries\n";
     }
+    if (!cache.supported) return "";
 
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-    return program;
+    uint64_t h = fnv1a("", 0);
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const char* s = reinterpret_cast<const char*>(glGetString(name));
+        if (s) h = fnv1a(s, std::strlen(s) + 1, h);
+    }
+    for (const Stage& st : stages) {
+        h = fnv1a(&st.type, sizeof(st.type), h);
+        h = fnv1a(st.source.data(), st.source.size() + 1, h);
+    }
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(h));
+    return cache.dir + "/" + name + ".bin";
+}
+
+// Load a cached binary into `program`; false on a miss or a rejected binary.
+// A header whose length is not the rest of the file (truncated, foreign or
+// corrupt) is a miss too.
+inline bool loadBinary(GLuint program, const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    std::streamoff size = in.tellg();
+    in.seekg(0);
+    BinaryHeader h, want;
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)) ||
+        std::memcmp(h.magic, want.magic, 4) != 0 || h.version != want.version ||
+        std::streamoff(h.length) != size - std::streamoff(sizeof(h)))
+        return false;
+    std::vector<char> blob(h.length);
+    if (!in.read(blob.data(), blob.size())) return false;
+
+    glProgramBinary(program, h.format, blob.data(), GLsizei(blob.size()));
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    return success == GL_TRUE;
 }
 
-inline GLuint createComputeProgram(const char* compPath) {
-    GLuint cs = compile(compPath, GL_COMPUTE_SHADER);
+// Via a temporary file renamed into place, so a concurrent start never
+// loads half a binary. Failures only cost the next start a compile.
+inline void storeBinary(GLuint program, const std::string& path) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    BinaryHeader h;
+    std::vector<char> blob(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, blob.data());
+    h.format = format;
+    h.length = uint32_t(length);
+
+    std::error_code ec;
+    std::filesystem::create_directories(binaryCache().dir, ec);
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(blob.data(), blob.size());
+        if (!out) {
+            std::cerr << "Shader cache: failed to write " << path << "\n";
+            return;
+        }
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) std::cerr << "Shader cache: failed to write " << path << "\n";
+}
 
+// Hits and misses since the last call
+inline void printCacheStats() {
+    BinaryCache& cache = binaryCache();
+    if (cache.dir.empty() || !cache.supported) return;
+    std::cout << "Shader cache: " << cache.hits << " programs loaded, " << cache.misses
+              << " compiled (" << cache.dir << ")\n";
+    cache.hits = cache.misses = 0;
+}
+
+// Program from `stages` — the cached binary if there is one, else
+// compiled, linked and stored
+inline GLuint buildProgram(const std::vector<Stage>& stages, const char* what) {
+    BinaryCache& cache = binaryCache();
+    std::string  file  = binaryPath(stages);
     GLuint program = glCreateProgram();
-    glAttachShader(program, cs);
+    if (!file.empty() && loadBinary(program, file)) {
+        ++cache.hits;
+        return program;
+    }
+
+    std::vector<GLuint> shaders;
+    for (const Stage& st : stages) {
+        shaders.push_back(compileSource(st.source, st.path, st.type));
+        glAttachShader(program, shaders.back());
+    }
+    if (!file.empty()) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(program);
 
     GLint success;
@@ -81,12 +238,31 @@ inline GLuint createComputeProgram(const char* compPath) {
         glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLen);
         std::vector<char> log(logLen);
         glGetProgramInfoLog(program, logLen, nullptr, log.data());
-        std::cerr << "Compute program link error:\n" << log.data() << "\n";
+        std::cerr << what << " link error:\n" << log.data() << "\n";
         exit(EXIT_FAILURE);
     }
 
-    glDeleteShader(cs);
+    for (GLuint s : shaders) {
+        glDetachShader(program, s);
+        glDeleteShader(s);
+    }
+    if (!file.empty()) {
+        storeBinary(program, file);
+        ++cache.misses;
+    }
     return program;
 }
 
+inline GLuint createProgram(const char* vertPath, const char* fragPath,
+                            const std::string& defines = "") {
+    return buildProgram({{GL_VERTEX_SHADER, vertPath, variantSource(vertPath, defines)},
+                         {GL_FRAGMENT_SHADER, fragPath, variantSource(fragPath, defines)}},
+                        "Shader");
+}
+
+inline GLuint createComputeProgram(const char* compPath, const std::string& defines = "") {
+    return buildProgram({{GL_COMPUTE_SHADER, compPath, variantSource(compPath, defines)}},
+                        "Compute program");
+}
+
 } // namespace shader
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Field snapshots written to disk without stalling the solver. The owner
+// copies (glCopyBufferSubData) or gathers (shaders/snapshot*.comp) the
+// fields into a ring of staging buffers and fences each one; poll() hands
+// slots whose fence has signalled to a writer thread, which streams them to
+// disk while the GPU keeps stepping. Staging buffers are persistently mapped
+// where ARB_buffer_storage is available; otherwise a signalled slot is read
+// with glGetBufferSubData (the copy is already done, so that does not wait
+// on the solver either).
+//
+// One file per snapshot, <dir>/<prefix>_<step>.snap: a Header followed by
+// `components` fp32 planes of dims[0]*dims[1]*dims[2] values, x fastest.
+namespace snapshot {
+
+constexpr int RING_SLOTS       = 3;   // staging buffers in flight
+constexpr int SNAPSHOT_BINDING = 20;  // gather output SSBO (above every solver binding)
+
+struct Header {
+    char    magic[4]   = {'E', 'M', 'S', 'N'};
+    int32_t version    = 1;
+    int32_t step       = 0;   // timestep the fields belong to
+    int32_t components = 0;   // 1 (2D Ez) or 6 (3D Ex..Hz)
+    int32_t dims[3]    = {1, 1, 1};  // output extent per axis
+    int32_t gridDims[3] = {1, 1, 1}; // simulation grid
+    int32_t fixedAxis  = -1;  // plane dumps: axis held at fixedIndex (-1 = volume)
+    int32_t fixedIndex = 0;
+    int32_t stride     = 1;   // cells between samples on the other axes
+};
+
+// Bindings and defines for the gather shaders
+inline std::string defines() {
+    return "#define SNAPSHOT_BINDING " + std::to_string(SNAPSHOT_BINDING) + "\n";
+}
+
+struct Ring {
+    enum State { FREE, GPU, WRITING };
+
+    struct Slot {
+        GLuint               buffer = 0;
+        void*                mapped = nullptr;  // persistent mapping, or null
+        std::vector<uint8_t> host;              // fallback copy for the writer
+        GLsync               fence  = nullptr;
+        Header               header;
+        size_t               bytes  = 0;        // payload of the pending snapshot
+        std::atomic<int>     state{FREE};
+    };
+
+    bool        enabled = false;
+    std::string name = "Snapshots";  // log label
+    std::string dir, prefix;         // destination (a file path when `sink` is set)
+    size_t      slotBytes = 0;
+    Slot        slots[RING_SLOTS];
+    std::deque<int> inFlight;   // GPU slots, oldest first (main thread only)
+
+    // Replaces the per-snapshot files when set before start() (e.g. a fieldfile::Writer
+    // or checkpoint::write); called on the writer thread
+    std::function<bool(const Header&, const void* data, size_t bytes)> sink;
+
+    // Writer thread
+    std::thread             writer;
+    std::mutex              mutex;
+    std::condition_variable wake;   // new job or quit
+    std::condition_variable freed;  // a slot went back to FREE
+    std::deque<int>         jobs;
+    bool                    quit = false;
+
+    // Stats
+    int       written = 0;
+    int       stalls  = 0;  // captures that had to wait for a free slot
+    long long bytesOut = 0;
+
+    // ── Lifetime ──
+
+    void start(const std::string& outDir, const std::string& filePrefix, size_t bytes) {
+        enabled = true;
+        dir     = outDir;
+        prefix  = filePrefix;
+        std::error_code ec;
+        if (!sink) std::filesystem::create_directories(dir, ec);
+        if (ec) {
+            std::cerr << "Failed to create snapshot directory " << dir << ": " << ec.message() << "\n";
+            exit(EXIT_FAILURE);
+        }
+        resize(bytes);
+        writer = std::thread([this] { writerLoop(); });
+    }
+
+    // (Re)allocate every slot for `bytes`; drains pending snapshots first
+    void resize(size_t bytes) {
+        finish();
+        slotBytes = bytes;
+        bool persistent = GLEW_ARB_buffer_storage;
+        for (Slot& s : slots) {
+            // Immutable storage cannot be resized: replace the buffer
+            if (s.buffer) glDeleteBuffers(1, &s.buffer);
+            glGenBuffers(1, &s.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, s.buffer);
+            if (persistent) {
+                GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                glBufferStorage(GL_COPY_WRITE_BUFFER, slotBytes, nullptr, flags);
+                s.mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, slotBytes, flags);
+            } else {
+                glBufferData(GL_COPY_WRITE_BUFFER, slotBytes, nullptr, GL_STREAM_READ);
+                s.mapped = nullptr;
+                s.host.resize(slotBytes);
+            }
+        }
+        std::cout << name << ": " << RING_SLOTS << " x " << slotBytes / (1024.0 * 1024.0)
+                  << " MB staging (" << (persistent ? "persistent map" : "buffer readback")
+                  << ") -> " << (sink ? dir : dir + "/") << "\n";
+    }
+
+    // Block until every snapshot is on disk (resize / shutdown / restore)
+    void finish() {
+        if (!enabled) return;
+        while (!inFlight.empty()) handOff(true);
+        std::unique_lock<std::mutex> lock(mutex);
+        freed.wait(lock, [&] {
+            for (const Slot& s : slots)
+                if (s.state != FREE) return false;
+            return true;
+        });
+    }
+
+    void cleanup() {
+        if (!enabled) return;
+        finish();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_one();
+        writer.join();
+        for (Slot& s : slots) {
+            if (s.mapped) {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, s.buffer);
+                glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            }
+            glDeleteBuffers(1, &s.buffer);
+        }
+        std::cout << name << ": " << written << " written (" << bytesOut / (1024.0 * 1024.0)
+                  << " MB), " << stalls << " waited for a free staging slot\n";
+        enabled = false;
+    }
+
+    // ── Capture (main thread) ──
+
+    // A FREE slot to copy into. Waits on the oldest snapshot only when the
+    // whole ring is busy (counted in `stalls`).
+    int acquire() {
+        for (int i = 0; i < RING_SLOTS; ++i)
+            if (slots[i].state == FREE) return i;
+
+        ++stalls;
+        if (!inFlight.empty()) handOff(true);
+        std::unique_lock<std::mutex> lock(mutex);
+        int slot = -1;
+        freed.wait(lock, [&] {
+            for (int i = 0; i < RING_SLOTS; ++i)
+                if (slots[i].state == FREE) { slot = i; return true; }
+            return false;
+        });
+        return slot;
+    }
+
+    GLuint target(int slot) const { return slots[slot].buffer; }
+
+    // Commands writing the slot are issued; fence them
+    void submit(int slot, const Header& header, size_t bytes) {
+        Slot& s  = slots[slot];
+        s.header = header;
+        s.bytes  = bytes;
+        s.fence  = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        s.state  = GPU;
+        inFlight.push_back(slot);
+    }
+
+    // Hand finished copies to the writer, oldest first; never blocks
+    void poll() {
+        while (!inFlight.empty() && handOff(false)) {}
+    }
+
+    // ── Internals ──
+
+    // Pass the oldest in-flight slot to the writer once its fence signals
+    bool handOff(bool wait) {
+        Slot&  s       = slots[inFlight.front()];
+        GLuint64 timeout = wait ? GLuint64(10) * 1000 * 1000 * 1000 : 0;  // ns
+        GLenum r = glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) {
+            if (!wait) return false;
+            std::cerr << "Snapshot fence did not signal\n";
+            exit(EXIT_FAILURE);
+        }
+        glDeleteSync(s.fence);
+        s.fence = nullptr;
+
+        if (!s.mapped) {
+            glBindBuffer(GL_COPY_READ_BUFFER, s.buffer);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, s.bytes, s.host.data());
+        }
+        s.state = WRITING;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(inFlight.front());
+        }
+        inFlight.pop_front();
+        wake.notify_one();
+        return true;
+    }
+
+    bool writeFile(const Header& header, const void* data, size_t bytes) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "_%08d.snap", int(header.step));
+        std::string path = dir + "/" + prefix + name;
+
+        FILE* f = std::fopen(path.c_str(), "wb");
+        bool ok = f && std::fwrite(&header, sizeof(Header), 1, f) == 1 &&
+                  std::fwrite(data, 1, bytes, f) == bytes;
+        if (f) std::fclose(f);
+        if (!ok) std::cerr << "Failed to write snapshot " << path << "\n";
+        return ok;
+    }
+
+    void writerLoop() {
+        for (;;) {
+            int slot;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || !jobs.empty(); });
+                if (jobs.empty()) return;  // quit with nothing left
+                slot = jobs.front();
+                jobs.pop_front();
+            }
+
+            Slot& s = slots[slot];
+            const void* data = s.mapped ? s.mapped : s.host.data();
+            bool ok = sink ? sink(s.header, data, s.bytes) : writeFile(s.header, data, s.bytes);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (ok) {
+                    ++written;
+                    bytesOut += static_cast<long long>(sizeof(Header) + s.bytes);
+                }
+                s.state = FREE;
+            }
+            freed.notify_all();
+        }
+    }
+};
+
+} // namespace snapshot
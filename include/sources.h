@@ -0,0 +1,277 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "shader_utils.h"
+
+// Source table of the field kernels. Any number of soft (additive) point
+// sources, each with its own waveform, phase and polarization, drive E after
+// the E update. The records are sorted into bins of a few cells per axis
+// with a start offset per bin (CSR), so each cell of the E pass reads its
+// bin's range (shaders/sources.glsl) and only cells in a bin that holds a
+// source compare positions.
+//
+// Sources are given as `X,Y[,Z][:key=value...]` (--source, or `source =`
+// lines in a scene file), `c` for the grid centre on an axis:
+//   wave=sine|gauss|mod  sinusoid (default), Gaussian pulse, or a sinusoid
+//                        under a Gaussian envelope, both peaking at `delay`
+//   freq=F amp=A         default: the scene's source_freq / source_amp
+//   phase=P              radians
+//   width=W delay=D      pulse 1/e half-width and peak, in steps
+//                        (default 20, and 4 widths)
+//   pol=x|y|z|X/Y/Z      3D polarization (normalized); 2D drives Ez only
+//   batch=K              2D --batch runs: scenario K only (default: all)
+namespace sources {
+
+constexpr int TABLE_BINDING = 29;  // above the field statistics'
+constexpr int BIN_BINDING   = 30;
+
+constexpr int BIN_2D[3] = {16, 16, 1};  // z: one bin per batch layer
+constexpr int BIN_3D[3] = {8, 8, 8};
+
+constexpr float DEFAULT_WIDTH = 20.0f;  // steps
+constexpr float DELAY_WIDTHS  = 4.0f;   // default pulse peak, in widths
+
+enum Waveform { WAVE_SINE = 0, WAVE_GAUSSIAN = 1, WAVE_MODULATED = 2 };
+
+// One source as given. Zero freq / amp take the scene's, so a changed
+// source_freq (scene reload, restart) reaches every source left at default.
+struct Source {
+    int   cell[3]  = {-1, -1, -1};  // -1 = grid centre
+    int   waveform = WAVE_SINE;
+    float freq     = 0.0f;
+    float amp      = 0.0f;
+    float phase    = 0.0f;
+    float width    = DEFAULT_WIDTH;
+    float delay    = -1.0f;         // -1 = DELAY_WIDTHS widths
+    float pol[3]   = {0.0f, 0.0f, 1.0f};
+    int   batch    = -1;            // -1 = every scenario
+};
+
+// Record — matches the GLSL `Source` struct (std430)
+struct Record {
+    int32_t cell[4];   // x, y, z (2D: batch layer), waveform
+    float   drive[4];  // amplitude x polarization, unused
+    float   wave[4];   // omega, phase, pulse peak time, 1 / pulse width
+};
+
+inline std::string defines(const int bin[3]) {
+    return "#define SOURCE_TABLE_BINDING " + std::to_string(TABLE_BINDING) + "\n"
+         + "#define SOURCE_BIN_BINDING " + std::to_string(BIN_BINDING) + "\n"
+         + "#define SOURCE_BIN ivec3(" + std::to_string(bin[0]) + ", " +
+           std::to_string(bin[1]) + ", " + std::to_string(bin[2]) + ")\n";
+}
+
+// `spec` as described above; false (with a message) on a malformed one
+inline bool parse(const std::string& spec, bool is3d, Source& out) {
+    Source s;
+    auto fail = [&](const std::string& why) {
+        std::cerr << "Bad source '" << spec << "': " << why << "\n";
+        return false;
+    };
+
+    std::istringstream in(spec);
+    std::string part;
+    std::getline(in, part, ':');
+    std::istringstream coords(part);
+    std::string c;
+    int axes = 0;
+    while (std::getline(coords, c, ',')) {
+        if (axes == 3) return fail("too many coordinates");
+        char* end = nullptr;
+        s.cell[axes] = (c == "c") ? -1 : int(std::strtol(c.c_str(), &end, 10));
+        if (c != "c" && (c.empty() || *end || s.cell[axes] < 0))
+            return fail("coordinates must be cells or c");
+        ++axes;
+    }
+    if (axes != (is3d ? 3 : 2)) return fail(is3d ? "need X,Y,Z" : "need X,Y");
+
+    while (std::getline(in, part, ':')) {
+        size_t eq = part.find('=');
+        std::string key   = part.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : part.substr(eq + 1);
+        char* end = nullptr;
+        float v   = std::strtof(value.c_str(), &end);
+        bool  num = !value.empty() && !*end;
+
+        if (key == "wave") {
+            if (value == "sine")       s.waveform = WAVE_SINE;
+            else if (value == "gauss") s.waveform = WAVE_GAUSSIAN;
+            else if (value == "mod")   s.waveform = WAVE_MODULATED;
+            else return fail("wave must be sine, gauss or mod");
+        } else if (key == "pol") {
+            if (value == "x" || value == "y" || value == "z") {
+                s.pol[0] = s.pol[1] = s.pol[2] = 0.0f;
+                s.pol[value[0] - 'x'] = 1.0f;
+            } else if (std::sscanf(value.c_str(), "%f/%f/%f", &s.pol[0], &s.pol[1],
+                                   &s.pol[2]) != 3) {
+                return fail("pol must be x, y, z or X/Y/Z");
+            }
+            float n = std::sqrt(s.pol[0] * s.pol[0] + s.pol[1] * s.pol[1] + s.pol[2] * s.pol[2]);
+            if (n == 0.0f) return fail("pol must not be zero");
+            for (float& p : s.pol) p /= n;
+            if (!is3d && (s.pol[0] != 0.0f || s.pol[1] != 0.0f))
+                return fail("2D (TMz) sources drive Ez only");
+        } else if (!num) {
+            return fail("'" + key + "' needs a numeric value");
+        } else if (key == "freq" && v > 0.0f) {
+            s.freq = v;
+        } else if (key == "amp") {
+            s.amp = v;
+        } else if (key == "phase") {
+            s.phase = v;
+        } else if (key == "width" && v > 0.0f) {
+            s.width = v;
+        } else if (key == "delay" && v >= 0.0f) {
+            s.delay = v;
+        } else if (key == "batch" && !is3d && v >= 0.0f) {
+            s.batch = int(v);
+        } else {
+            return fail("unknown key or value out of range: '" + part + "'");
+        }
+    }
+    out = s;
+    return true;
+}
+
+// Position of `s` on a grid of `dims` cells
+inline void position(const Source& s, const int dims[3], int out[3]) {
+    for (int a = 0; a < 3; ++a) out[a] = s.cell[a] < 0 ? dims[a] / 2 : s.cell[a];
+}
+
+// Every source inside the grid and its batch scenario present; no sources
+// means the default one (sine at the centre), which always fits
+inline bool validate(const std::vector<Source>& list, const int dims[3], int layers) {
+    for (const Source& s : list) {
+        int p[3];
+        position(s, dims, p);
+        if (p[0] >= dims[0] || p[1] >= dims[1] || p[2] >= dims[2]) {
+            std::cerr << "Source at (" << p[0] << ", " << p[1];
+            if (dims[2] > 1) std::cerr << ", " << p[2];
+            std::cerr << ") lies outside the grid\n";
+            return false;
+        }
+        if (s.batch >= layers) {
+            std::cerr << "Source for batch scenario " << s.batch << ", but the run has only "
+                      << layers << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// GPU records in grid cells. 2D batches (`layers` > 1) take the layer as z;
+// a source without a batch index is repeated on every layer.
+inline std::vector<Record> pack(std::vector<Source> list, const int dims[3], int layers,
+                                float dt, float freq, float amp) {
+    if (list.empty()) list.push_back(Source());
+    std::vector<Record> out;
+    for (const Source& s : list) {
+        float f     = s.freq > 0.0f ? s.freq : freq;
+        float width = s.width * dt;
+        float delay = (s.delay >= 0.0f ? s.delay : DELAY_WIDTHS * s.width) * dt;
+
+        Record r{};
+        position(s, dims, r.cell);
+        r.cell[3] = s.waveform;
+        for (int a = 0; a < 3; ++a)
+            r.drive[a] = (s.amp != 0.0f ? s.amp : amp) * s.pol[a];
+        r.wave[0] = 2.0f * 3.14159265358979f * f;  // same rounding as the kernels had
+        r.wave[1] = s.phase;
+        r.wave[2] = delay;
+        r.wave[3] = 1.0f / width;
+        for (int l = 0; l < layers; ++l) {
+            if (s.batch >= 0 && s.batch != l) continue;
+            if (layers > 1 || dims[2] == 1) r.cell[2] = l;
+            out.push_back(r);
+        }
+    }
+    return out;
+}
+
+// Same expression as shaders/sources.glsl
+inline float waveAt(const Record& r, float t) {
+    if (r.cell[3] == WAVE_SINE) return std::sin(r.wave[0] * t + r.wave[1]);
+    float u        = (t - r.wave[2]) * r.wave[3];
+    float envelope = std::exp(-u * u);
+    if (r.cell[3] == WAVE_GAUSSIAN) return envelope;
+    return envelope * std::sin(r.wave[0] * (t - r.wave[2]) + r.wave[1]);
+}
+
+// Checkpoints carry the table's hash, so a restart must drive the same sources
+inline uint64_t hash(const std::vector<Record>& records) {
+    return shader::fnv1a(records.data(), records.size() * sizeof(Record));
+}
+
+inline const char* waveName(int w) {
+    return w == WAVE_SINE ? "sine" : w == WAVE_GAUSSIAN ? "gauss" : "mod";
+}
+
+inline void printSummary(const std::vector<Record>& records, int layers) {
+    const Record& r = records.front();
+    std::cout << "Sources: " << records.size();
+    if (layers > 1) std::cout << " over " << layers << " batch scenarios";
+    if (records.size() == 1)
+        std::cout << " (" << waveName(r.cell[3]) << " at " << r.cell[0] << ", " << r.cell[1]
+                  << ", " << r.cell[2] << ")";
+    std::cout << "\n";
+}
+
+// Records binned on the GPU (bindings TABLE_BINDING / BIN_BINDING)
+struct Table {
+    GLuint recordSSBO = 0;
+    GLuint binSSBO    = 0;
+    int    count      = 0;
+
+    // `records` in the cells of a grid of `dims` (z: layers for 2D
+    // batches), binned `bin` cells per axis. The sort is stable, so sources
+    // sharing a cell add up in the order given.
+    void upload(std::vector<Record> records, const int dims[3], const int bin[3]) {
+        int bins[3];
+        for (int a = 0; a < 3; ++a) bins[a] = (dims[a] + bin[a] - 1) / bin[a];
+        auto binOf = [&](const Record& r) {
+            return (r.cell[2] / bin[2] * bins[1] + r.cell[1] / bin[1]) * bins[0] +
+                   r.cell[0] / bin[0];
+        };
+        std::stable_sort(records.begin(), records.end(),
+                         [&](const Record& a, const Record& b) { return binOf(a) < binOf(b); });
+
+        std::vector<GLuint> start(size_t(bins[0]) * bins[1] * bins[2] + 1, 0u);
+        for (const Record& r : records) ++start[binOf(r) + 1];
+        for (size_t b = 1; b < start.size(); ++b) start[b] += start[b - 1];
+
+        count = int(records.size());
+        if (records.empty()) records.push_back(Record{});  // no zero-sized buffer
+        if (!recordSSBO) glGenBuffers(1, &recordSSBO);
+        if (!binSSBO) glGenBuffers(1, &binSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, recordSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, records.size() * sizeof(Record), records.data(),
+                     GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, binSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, start.size() * sizeof(GLuint), start.data(),
+                     GL_STATIC_DRAW);
+        bind();
+    }
+
+    void bind() const {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TABLE_BINDING, recordSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BIN_BINDING, binSSBO);
+    }
+
+    void cleanup() {
+        glDeleteBuffers(1, &recordSSBO);
+        glDeleteBuffers(1, &binSSBO);
+        *this = Table();
+    }
+};
+
+} // namespace sources
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+
+#include "shader_utils.h"
+
+// Live field statistics without readback stalls. Every `every` steps a
+// reduction pass (shaders/stats2d.comp / stats3d.comp) folds the fields into
+// one partial per workgroup: with GL_KHR_shader_subgroup arithmetic inside
+// each subgroup and through shared memory across the subgroups, otherwise
+// a shared-memory tree over the whole group. shaders/stats_final.comp then
+// folds the partials into one Sample in a slot of a small readback ring.
+// Slots are fenced and next() only takes those already signalled, a few
+// frames later; with the whole ring in flight a capture is skipped rather
+// than waited for.
+//
+// Energy is 1/2 sum(|E|^2 + |H|^2) over the cells in the normalized units of
+// the update equations (vacuum weighting: eps_r / mu_r are not applied).
+// Flux is the net Poynting flux E x H out through the box just inside the
+// absorbing layer, cells taken as collocated samples.
+namespace stats {
+
+constexpr int    PARTIAL_BINDING = 27;     // above the arrow view's
+constexpr int    SAMPLE_BINDING  = 28;
+constexpr int    GROUP_SIZE      = 256;
+constexpr int    MAX_GROUPS      = 1024;   // per pass: a grid-stride loop covers the rest
+constexpr int    RING_SLOTS      = 4;      // samples in flight
+constexpr int    DEFAULT_EVERY   = 10;     // steps between samples
+constexpr float  DEFAULT_SCALE   = 15.0f;  // colour scale before the first sample, or fixed
+constexpr float  EXPOSURE_KEY    = 0.5f;   // auto exposure: RMS |E| shown at this level
+constexpr float  EXPOSURE_RATE   = 0.25f;  // share of the way to the target per sample
+constexpr float  DEFAULT_GROWTH  = 2.0f;   // watchdog: energy factor per sample ...
+constexpr int    GROWTH_SAMPLES  = 8;      // ... sustained over this many samples
+
+// Sample / Partial — matches the GLSL `Partial` struct (std430)
+struct Sample {
+    float sums[4];    // energy of E, energy of H, boundary flux, unused
+    float maxima[4];  // max |E|, max |H|, unused x2
+};
+
+// One sample on the host
+struct Reading {
+    int    step    = -1;   // timestep the fields belong to (-1 = none yet)
+    size_t cells   = 0;
+    double energyE = 0.0, energyH = 0.0;
+    double flux    = 0.0;
+    float  maxE    = 0.0f, maxH = 0.0f;
+
+    double energy() const { return energyE + energyH; }
+    double rmsE() const { return cells ? std::sqrt(2.0 * energyE / cells) : 0.0; }
+};
+
+// Subgroup arithmetic in compute shaders (GL_KHR_shader_subgroup), probed once
+inline bool subgroupArithmetic() {
+    static int supported = -1;
+    if (supported < 0) {
+        supported = 0;
+        GLint n = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+        for (GLint i = 0; i < n; ++i) {
+            const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (ext && std::strcmp(ext, "GL_KHR_shader_subgroup") == 0) {
+                GLint stages = 0, features = 0;
+                glGetIntegerv(GL_SUBGROUP_SUPPORTED_STAGES_KHR, &stages);
+                glGetIntegerv(GL_SUBGROUP_SUPPORTED_FEATURES_KHR, &features);
+                GLint need = GL_SUBGROUP_FEATURE_BASIC_BIT_KHR |
+                             GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR;
+                supported = (stages & GL_COMPUTE_SHADER_BIT) && (features & need) == need;
+            }
+        }
+    }
+    return supported != 0;
+}
+
+inline std::string defines() {
+    return "#define STATS_PARTIAL_BINDING " + std::to_string(PARTIAL_BINDING) + "\n"
+         + "#define STATS_SAMPLE_BINDING " + std::to_string(SAMPLE_BINDING) + "\n"
+         + "#define STATS_GROUP_SIZE " + std::to_string(GROUP_SIZE) + "\n"
+         + "#define STATS_SUBGROUPS " + std::to_string(int(subgroupArithmetic())) + "\n";
+}
+
+// Colour scale of the views: fixed, or following the RMS |E| of the
+// samples so the wave keeps a usable contrast as it spreads and decays
+struct Exposure {
+    bool  automatic = true;
+    float scale     = DEFAULT_SCALE;
+
+    void update(const Reading& r) {
+        double rms = r.rmsE();
+        if (!automatic || !(rms > 0.0) || !std::isfinite(rms)) return;
+        float target = float(EXPOSURE_KEY / rms);
+        scale *= std::pow(target / scale, EXPOSURE_RATE);
+    }
+};
+
+// Halts the run when the fields blow up: a non-finite sample, or energy
+// growing by more than `growth` per sample GROWTH_SAMPLES times in a row
+// (a radiating source grows the energy polynomially, an instability
+// exponentially)
+struct Watchdog {
+    float  growth  = DEFAULT_GROWTH;  // 0 = non-finite samples only
+    int    run     = 0;
+    double last    = 0.0;
+    bool   tripped = false;
+
+    // True once the run must stop; reports the sample that tripped it
+    bool check(const Reading& r) {
+        if (tripped) return true;
+        double u = r.energy();
+        bool finite = std::isfinite(u) && std::isfinite(r.maxE) && std::isfinite(r.maxH);
+        run = (growth > 0.0f && last > 0.0 && u > growth * last) ? run + 1 : 0;
+        last = u;
+        if (finite && run < GROWTH_SAMPLES) return false;
+
+        tripped = true;
+        std::cerr << "Watchdog: field energy ";
+        if (finite)
+            std::cerr << "grew more than " << growth << "x per sample " << GROWTH_SAMPLES
+                      << " samples in a row";
+        else
+            std::cerr << "is no longer finite";
+        std::cerr << " at step " << r.step << " (energy " << u << ", max |E| " << r.maxE
+                  << "); halting the run\n";
+        return true;
+    }
+};
+
+struct Reduction {
+    struct Slot {
+        GLuint buffer = 0;
+        void*  mapped = nullptr;  // persistent mapping, or null
+        GLsync fence  = nullptr;
+        int    step   = 0;
+        size_t cells  = 0;
+    };
+
+    bool    enabled   = false;
+    int     every     = DEFAULT_EVERY;
+    GLuint  partialSSBO  = 0;
+    GLuint  finalProgram = 0;   // stats_final.comp
+    GLint   loc_partialCount = -1;
+    Slot    slots[RING_SLOTS];
+    std::deque<int> inFlight;  // oldest first
+    int     partialsUsed = 0;  // by the capture being recorded
+    size_t  cellsUsed    = 0;
+
+    Reading latest;
+    int     samples = 0;
+    int     skipped = 0;  // captures dropped with the whole ring in flight
+
+    // ── Lifetime ──
+
+    void init() {
+        finalProgram = shader::createComputeProgram("shaders/stats_final.comp", defines());
+        loc_partialCount = glGetUniformLocation(finalProgram, "partial_count");
+
+        glGenBuffers(1, &partialSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, partialSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_GROUPS * sizeof(Sample),
+                     nullptr, GL_DYNAMIC_COPY);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTIAL_BINDING, partialSSBO);
+
+        bool persistent = GLEW_ARB_buffer_storage;
+        for (Slot& s : slots) {
+            glGenBuffers(1, &s.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, s.buffer);
+            if (persistent) {
+                GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                glBufferStorage(GL_COPY_WRITE_BUFFER, sizeof(Sample), nullptr, flags);
+                s.mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, sizeof(Sample), flags);
+            } else {
+                glBufferData(GL_COPY_WRITE_BUFFER, sizeof(Sample), nullptr, GL_STREAM_READ);
+            }
+        }
+        enabled = true;
+        std::cout << "Stats: every " << every << " steps, "
+                  << (subgroupArithmetic() ? "subgroup" : "shared-memory")
+                  << " reduction, " << RING_SLOTS << " samples in flight\n";
+    }
+
+    void cleanup() {
+        if (!enabled) return;
+        for (Slot& s : slots) {
+            if (s.fence) glDeleteSync(s.fence);
+            if (s.mapped) {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, s.buffer);
+                glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            }
+            glDeleteBuffers(1, &s.buffer);
+            s = Slot();
+        }
+        inFlight.clear();
+        glDeleteBuffers(1, &partialSSBO);
+        glDeleteProgram(finalProgram);
+        partialSSBO = finalProgram = 0;
+        enabled = false;
+    }
+
+    // ── Capture ──
+
+    // Start a sample; false (counted in `skipped`) when every slot is in flight
+    bool begin() {
+        if (inFlight.size() == RING_SLOTS) {
+            ++skipped;
+            return false;
+        }
+        partialsUsed = 0;
+        cellsUsed    = 0;
+        return true;
+    }
+
+    // Reduce `cells` cells with the bound reduction program
+    void dispatch(size_t cells) {
+        GLuint groups = GLuint(std::clamp<size_t>((cells + GROUP_SIZE - 1) / GROUP_SIZE, 1,
+                                                  MAX_GROUPS));
+        glDispatchCompute(groups, 1, 1);
+        partialsUsed = int(groups);
+        cellsUsed    = cells;
+    }
+
+    // Fold the partials into a free slot and fence it; never waits
+    void end(int step) {
+        int slot = 0;
+        while (std::find(inFlight.begin(), inFlight.end(), slot) != inFlight.end()) ++slot;
+        Slot& s = slots[slot];
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        glUseProgram(finalProgram);
+        glUniform1i(loc_partialCount, partialsUsed);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SAMPLE_BINDING, s.buffer);
+        glDispatchCompute(1, 1, 1);
+        glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        s.step  = step;
+        s.cells = cellsUsed;
+        s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        inFlight.push_back(slot);
+    }
+
+    // The oldest sample whose fence has signalled, if any; `wait` blocks
+    // for it instead (end of run)
+    bool next(Reading& out, bool wait = false) {
+        if (inFlight.empty()) return false;
+        Slot&    s       = slots[inFlight.front()];
+        GLuint64 timeout = wait ? GLuint64(10) * 1000 * 1000 * 1000 : 0;  // ns
+        GLenum   r       = glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) return false;
+        glDeleteSync(s.fence);
+        s.fence = nullptr;
+
+        Sample sample;
+        if (s.mapped) {
+            std::memcpy(&sample, s.mapped, sizeof(sample));
+        } else {
+            glBindBuffer(GL_COPY_READ_BUFFER, s.buffer);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(sample), &sample);
+        }
+        inFlight.pop_front();
+
+        out.step    = s.step;
+        out.cells   = s.cells;
+        out.energyE = sample.sums[0];
+        out.energyH = sample.sums[1];
+        out.flux    = sample.sums[2];
+        out.maxE    = sample.maxima[0];
+        out.maxH    = sample.maxima[1];
+        latest = out;
+        ++samples;
+        return true;
+    }
+
+    // ── Reporting ──
+
+    std::string overlay(float scale) const {
+        char buf[96];
+        std::snprintf(buf, sizeof(buf), "U %.3g, |E| max %.3g, flux %.3g, scale %.3g",
+                      latest.energy(), latest.maxE, latest.flux, scale);
+        return buf;
+    }
+
+    void printSummary() const {
+        if (!enabled) return;
+        std::cout << "\n=== Field statistics (" << samples << " samples, " << skipped
+                  << " skipped) ===\n";
+        if (latest.step < 0) return;
+        std::cout << "  Step          : " << latest.step << "\n"
+                  << "  Energy        : " << latest.energy() << " (E " << latest.energyE
+                  << ", H " << latest.energyH << ")\n"
+                  << "  Max |E|, |H|  : " << latest.maxE << ", " << latest.maxH << "\n"
+                  << "  Boundary flux : " << latest.flux << " (out of the box inside the "
+                                                            "absorber)\n";
+    }
+};
+
+} // namespace stats
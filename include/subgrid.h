@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+// Refined patch for the 2D solver: a nested Yee grid `ratio` times finer in
+// space and time inside a box of the coarse grid. Small features get fine
+// cells without refining the whole domain.
+//
+// Per coarse step (shaders/subgrid.comp does the coupling):
+//   1. the coarse grid advances everywhere, patch included;
+//   2. the coarse Ez is sampled onto the patch's outer ring of fine Ez nodes;
+//   3. the patch runs `ratio` sub-steps of the ordinary kernel, with its
+//      ring interpolated linearly in time between the last two samples;
+//   4. the coarse Ez strictly inside the patch is replaced by the
+//      coincident fine Ez, so the fine solution feeds back.
+// Ez nodes coincide for every integer ratio, and the Courant number is
+// unchanged (dt and dx both shrink by `ratio`), so the fine grid uses the
+// same vacuum coefficients.
+namespace subgrid {
+
+struct Patch {
+    int x0 = 0, y0 = 0;  // coarse node of the (0, 0) corner
+    int w  = 0, h  = 0;  // size in coarse cells (0 = no patch)
+    int ratio = 2;
+
+    bool enabled() const { return w > 0 && h > 0; }
+
+    int    fineNx()    const { return w * ratio + 1; }
+    int    fineNy()    const { return h * ratio + 1; }
+    size_t fineCells() const { return size_t(fineNx()) * fineNy(); }
+    int    ringSize()  const { return 2 * (fineNx() + fineNy()) - 4; }
+
+    // The box must stay clear of the absorbing layer and of the source
+    // (a soft source injected on the coarse grid would be overwritten)
+    bool validate(int nx, int ny, int boundary, int srcX, int srcY) const {
+        if (x0 < boundary + 1 || y0 < boundary + 1 || x0 + w > nx - boundary - 2 ||
+            y0 + h > ny - boundary - 2) {
+            std::cerr << "--refine box must lie inside the " << nx << "x" << ny
+                      << " grid, clear of the " << boundary << "-cell absorbing layer\n";
+            return false;
+        }
+        if (srcX >= x0 && srcX <= x0 + w && srcY >= y0 && srcY <= y0 + h) {
+            std::cerr << "--refine box must not contain the source at (" << srcX << ", " << srcY
+                      << ")\n";
+            return false;
+        }
+        return true;
+    }
+
+    // Cell updates per coarse step, and for the uniform grid at the fine
+    // resolution over the same physical time (ratio^2 cells, ratio steps)
+    double updates(size_t coarseCells) const {
+        return double(coarseCells) + ratio * double(fineCells());
+    }
+    double uniformUpdates(size_t coarseCells) const {
+        return double(ratio) * ratio * ratio * double(coarseCells);
+    }
+
+    // bytesPerCell = field + material storage per cell, on either grid
+    void printSummary(size_t coarseCells, double bytesPerCell) const {
+        const double MB = 1024.0 * 1024.0;
+        double mem     = (double(coarseCells) + double(fineCells())) * bytesPerCell / MB;
+        double uniform = double(ratio) * ratio * double(coarseCells) * bytesPerCell / MB;
+        std::cout << "Refined patch: " << w << "x" << h << " coarse cells at (" << x0 << ", "
+                  << y0 << "), " << ratio << "x finer (" << fineNx() << "x" << fineNy()
+                  << " fine nodes, " << ratio << " sub-steps)\n"
+                  << "  Memory      : " << mem << " MB vs " << uniform << " MB uniform ("
+                  << 100.0 * (1.0 - mem / uniform) << " % saved)\n"
+                  << "  Cell updates: " << updates(coarseCells) / 1.0e6 << " M per coarse step vs "
+                  << uniformUpdates(coarseCells) / 1.0e6 << " M uniform ("
+                  << uniformUpdates(coarseCells) / updates(coarseCells) << "x fewer)\n";
+    }
+
+    // Wall time of the uniform fine grid, scaled from a measured run by the
+    // update counts
+    void printTiming(double seconds, size_t coarseCells) const {
+        double scale = uniformUpdates(coarseCells) / updates(coarseCells);
+        std::cout << "  Uniform " << ratio << "x grid (estimated): " << seconds * scale
+                  << " s for the same physical time (" << scale << "x the refined run)\n";
+    }
+};
+
+} // namespace subgrid
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "colormap.h"
+#include "shader_utils.h"
+
+// Volume view of the 3D solver. The E pass of the last step before each
+// rendered frame is built with VOLUME_COMPONENT (shaders/volume_mirror.glsl)
+// and also writes the displayed component, or the precomputed |E|, into an
+// R16F 3D texture, plus a per-brick mask of cells bright enough to show.
+// shaders/volume3d.frag raymarches that texture from the orbit camera with
+// trilinear filtering, empty-space skipping over clear bricks and early ray
+// termination. Under active tiles the sleeping tiles are never dispatched,
+// so they stay clear in the mask too (their fields are exactly zero).
+namespace volume {
+
+constexpr int   IMAGE_UNIT        = 0;
+constexpr int   OCCUPANCY_BINDING = 24;     // above the NTFF binding
+constexpr int   BRICK             = 8;      // occupancy granularity, cells per axis
+constexpr float CUTOFF            = 0.02f;  // displayed brightness a cell needs to show
+
+inline std::string defines() {
+    return "#define VOLUME_IMAGE_UNIT " + std::to_string(IMAGE_UNIT) + "\n"
+         + "#define VOLUME_OCCUPANCY_BINDING " + std::to_string(OCCUPANCY_BINDING) + "\n"
+         + "#define VOLUME_BRICK " + std::to_string(BRICK) + "\n";
+}
+
+// The mirroring variant of an E-pass kernel for one component
+inline std::string defines(int component) {
+    return defines() + "#define VOLUME_COMPONENT " + std::to_string(component) + "\n";
+}
+
+// One mirroring E-pass program; the owner builds them on first use
+struct Kernel {
+    GLuint program      = 0;
+    GLint  loc_stepBase = -1;
+    GLint  loc_cutoff   = -1;
+
+    void init(GLuint prog) {
+        program      = prog;
+        loc_stepBase = glGetUniformLocation(program, "stepBase");
+        loc_cutoff   = glGetUniformLocation(program, "volumeCutoff");
+    }
+
+    void cleanup() {
+        glDeleteProgram(program);
+        *this = Kernel();
+    }
+};
+
+struct Mirror {
+    bool   enabled       = false;
+    int    dims[3]       = {};
+    int    bricks[3]     = {};
+    GLuint texture       = 0;
+    GLuint occupancySSBO = 0;
+    GLuint program       = 0;  // raymarcher
+
+    // Cached uniform locations — volume3d.frag
+    GLint loc_invViewProj = -1, loc_boxHalf = -1, loc_clipLo = -1, loc_clipHi = -1;
+    GLint loc_dims = -1, loc_bricks = -1, loc_fieldScale = -1, loc_stepLength = -1;
+    GLint loc_magnitude = -1;
+
+    size_t brickCount() const { return size_t(bricks[0]) * bricks[1] * bricks[2]; }
+
+    // Zeroed mirror for a grid of `d` cells. Call again after a resize:
+    // storage is reallocated, the raymarcher kept.
+    void init(const int d[3]) {
+        size_t cells = 1;
+        for (int a = 0; a < 3; ++a) {
+            dims[a]   = d[a];
+            bricks[a] = (d[a] + BRICK - 1) / BRICK;
+            cells    *= size_t(d[a]);
+        }
+        if (!program) {
+            program = shader::createProgram("shaders/field.vert", "shaders/volume3d.frag",
+                                            defines() + colormap::defines());
+            loc_invViewProj = glGetUniformLocation(program, "invViewProj");
+            loc_boxHalf     = glGetUniformLocation(program, "boxHalf");
+            loc_clipLo      = glGetUniformLocation(program, "clipLo");
+            loc_clipHi      = glGetUniformLocation(program, "clipHi");
+            loc_dims        = glGetUniformLocation(program, "dims");
+            loc_bricks      = glGetUniformLocation(program, "bricks");
+            loc_fieldScale  = glGetUniformLocation(program, "field_scale");
+            loc_stepLength  = glGetUniformLocation(program, "stepLength");
+            loc_magnitude   = glGetUniformLocation(program, "magnitude");
+        }
+
+        std::vector<float> zeros(cells, 0.0f);
+        if (!texture) glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_3D, texture);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, dims[0], dims[1], dims[2], 0, GL_RED, GL_FLOAT,
+                     zeros.data());
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        for (GLenum wrap : {GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T, GL_TEXTURE_WRAP_R})
+            glTexParameteri(GL_TEXTURE_3D, wrap, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_3D, 0);
+        glBindImageTexture(IMAGE_UNIT, texture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R16F);
+
+        if (!occupancySSBO) glGenBuffers(1, &occupancySSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, occupancySSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, brickCount() * sizeof(GLuint), nullptr,
+                     GL_DYNAMIC_COPY);
+        vram::clear(GL_SHADER_STORAGE_BUFFER);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCUPANCY_BINDING, occupancySSBO);
+        enabled = true;
+
+        std::cout << "Volume view: " << dims[0] << "x" << dims[1] << "x" << dims[2]
+                  << " R16F mirror, " << cells * 2 / (1024.0 * 1024.0) << " MB, "
+                  << brickCount() << " occupancy bricks\n";
+    }
+
+    // Before a mirroring E pass: every brick starts clear, and cells need
+    // `cutoff` (field units) to mark theirs
+    void beginWrite(const Kernel& k, float cutoff) const {
+        const GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, occupancySSBO);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT,
+                          &zero);
+        glUseProgram(k.program);
+        glUniform1f(k.loc_cutoff, cutoff);
+    }
+
+    // Raymarch into the bound fullscreen quad. The grid is centred on the
+    // origin with its longest axis one unit long; `edge` cells per side
+    // (the absorbing layer) are left out.
+    void draw(const glm::mat4& view, const glm::mat4& proj, int edge, float fieldScale,
+              bool magnitude) const {
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+        int   longest = std::max({dims[0], dims[1], dims[2]});
+        float half[3], lo[3], hi[3];
+        for (int a = 0; a < 3; ++a) {
+            int e   = std::min(edge, (dims[a] - 1) / 2);
+            half[a] = 0.5f * dims[a] / longest;
+            lo[a]   = float(e) / dims[a];
+            hi[a]   = float(dims[a] - e) / dims[a];
+        }
+        glm::mat4 invViewProj = glm::inverse(proj * view);
+
+        glUseProgram(program);
+        glUniformMatrix4fv(loc_invViewProj, 1, GL_FALSE, glm::value_ptr(invViewProj));
+        glUniform3fv(loc_boxHalf, 1, half);
+        glUniform3fv(loc_clipLo, 1, lo);
+        glUniform3fv(loc_clipHi, 1, hi);
+        glUniform3i(loc_dims, dims[0], dims[1], dims[2]);
+        glUniform3i(loc_bricks, bricks[0], bricks[1], bricks[2]);
+        glUniform1f(loc_fieldScale, fieldScale);
+        glUniform1f(loc_stepLength, 0.5f / longest);
+        glUniform1i(loc_magnitude, magnitude ? 1 : 0);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_3D, texture);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindTexture(GL_TEXTURE_3D, 0);
+    }
+
+    void cleanup() {
+        glDeleteTextures(1, &texture);
+        glDeleteBuffers(1, &occupancySSBO);
+        glDeleteProgram(program);
+        texture = occupancySSBO = program = 0;
+        enabled = false;
+    }
+};
+
+} // namespace volume
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "geometry.h"
+#include "materials.h"
+#include "media.h"
+#include "shader_utils.h"
+
+// Scene geometry painted straight into the 16-bit material IDs on the GPU
+// (shaders/voxelize.comp), so a large grid never builds or uploads its map
+// cell by cell on the host. The scene's media (media.h) are drawn in order
+// over a background, each pass clipped to the object's bounding box: later
+// objects win, as in media::regionAt. Boxes, spheres and wires take one
+// invocation per cell; meshes one per (x, y) column, which gathers the
+// column's surface crossings once and then fills the cells above an odd
+// number of them.
+//
+// Only the build of the coefficient table stays on the host: a cell's ID is
+// lookup[base + (c Lb + b) La + a] with the object's slot base and the
+// cell's sponge depth indices (materials::spongeIndex) along x, y, z, offset
+// to the range the object's box spans. Every combination is interned from
+// the engine's materialOf(region, a, b, c), so the table holds the same
+// coefficients the per-cell host build would.
+//
+// Moving an object repaints only the union of its old and new boxes (the
+// next objects are redrawn inside it too); the table only grows, so IDs
+// painted before stay valid.
+namespace voxel {
+
+constexpr int IDS_BINDING      = 34;  // above the media's
+constexpr int OBJECT_BINDING   = 35;
+constexpr int LOOKUP_BINDING   = 36;
+constexpr int TRIANGLE_BINDING = 37;
+constexpr int GROUP_X          = 8;
+constexpr int GROUP_Y          = 8;
+constexpr int MAX_CROSSINGS    = 32;   // per mesh column before the slow path
+
+constexpr int KIND_BACKGROUND = -1;   // slot 0: every cell
+
+// Object — matches the GLSL `Object` struct (std430)
+struct Object {
+    float   a[4];       // box low corner / centre / wire end / mesh placement; w: radius
+    float   b[4];       // box high corner / wire end / mesh low bound (unplaced)
+    float   c[4];       // mesh high bound (unplaced)
+    int32_t shape[4];   // kind, first triangle, triangles, lookup base
+    int32_t sponge[4];  // lowest sponge index along x, y, z
+    int32_t extent[4];  // sponge indices spanned: La, Lb, Lc
+};
+
+inline std::string defines() {
+    return "#define VOXEL_IDS_BINDING " + std::to_string(IDS_BINDING) + "\n"
+         + "#define VOXEL_OBJECT_BINDING " + std::to_string(OBJECT_BINDING) + "\n"
+         + "#define VOXEL_LOOKUP_BINDING " + std::to_string(LOOKUP_BINDING) + "\n"
+         + "#define VOXEL_TRIANGLE_BINDING " + std::to_string(TRIANGLE_BINDING) + "\n"
+         + "#define VOXEL_GROUP_X " + std::to_string(GROUP_X) + "\n"
+         + "#define VOXEL_GROUP_Y " + std::to_string(GROUP_Y) + "\n"
+         + "#define VOXEL_MAX_CROSSINGS " + std::to_string(MAX_CROSSINGS) + "\n";
+}
+
+struct Voxelizer {
+    GLuint primitiveProgram = 0;
+    GLuint meshProgram      = 0;
+    GLuint objectSSBO   = 0;
+    GLuint lookupSSBO   = 0;
+    GLuint triangleSSBO = 0;
+
+    int dims[3]     = {1, 1, 1};  // global grid
+    int spongeWidth = 0;          // 0: no sponge (CPML)
+
+    std::vector<Object>   objects;    // slot 0 = background, then the media in order
+    std::vector<int>      boxes;      // 6 per slot: inclusive box on the grid, lo > hi if off it
+    std::vector<uint32_t> lookup;
+    std::vector<float>    triangles;  // 9 per triangle, every mesh back to back
+
+    void init() {
+        if (primitiveProgram) return;
+        primitiveProgram = shader::createComputeProgram("shaders/voxelize.comp", defines());
+        meshProgram      = shader::createComputeProgram("shaders/voxelize.comp",
+                                                        defines() + "#define VOXEL_MESH\n");
+    }
+
+    // Slots for `list` on a grid of `size` cells with a sponge of `width`
+    // (0 for none); interns every coefficient set a slot can paint into
+    // `map`. Call again after a move: existing table entries keep their IDs.
+    template <typename MaterialFn>
+    void plan(const std::vector<media::Region>& list, const int size[3], int width,
+              materials::CoeffMap& map, float dt, float dx, MaterialFn materialOf) {
+        std::copy(size, size + 3, dims);
+        spongeWidth = width;
+        objects.clear();
+        boxes.clear();
+        lookup.clear();
+        triangles.clear();
+
+        for (int slot = 0; slot <= int(list.size()); ++slot) {
+            const media::Region* r = slot ? &list[slot - 1] : nullptr;
+            Object o{};
+            int b[6] = {0, 0, 0, dims[0] - 1, dims[1] - 1, dims[2] - 1};
+            o.shape[0] = KIND_BACKGROUND;
+            if (r) {
+                const geometry::Shape& s = r->shape;
+                std::copy(s.p0, s.p0 + 3, o.a);
+                o.a[3]     = s.radius;
+                o.shape[0] = s.kind;
+                if (s.kind == geometry::KIND_MESH) {
+                    std::copy(s.mesh->lo, s.mesh->lo + 3, o.b);
+                    std::copy(s.mesh->hi, s.mesh->hi + 3, o.c);
+                    o.shape[1] = int32_t(triangles.size() / 9);
+                    o.shape[2] = int32_t(s.mesh->triangles());
+                    triangles.insert(triangles.end(), s.mesh->vertices.begin(),
+                                     s.mesh->vertices.end());
+                } else {
+                    std::copy(s.p1, s.p1 + 3, o.b);
+                }
+                int sb[6];
+                r->bounds(sb);
+                for (int i = 0; i < 3; ++i) {
+                    b[i]     = std::max(sb[i], 0);
+                    b[3 + i] = std::min(sb[3 + i], dims[i] - 1);
+                }
+            }
+            boxes.insert(boxes.end(), b, b + 6);
+
+            // Sponge indices spanned by the box, then one ID per combination
+            o.shape[3] = int32_t(lookup.size());
+            int lo[3] = {0, 0, 0}, hi[3] = {-1, -1, -1};
+            for (int i = 0; i < 3; ++i)
+                for (int x = b[i]; x <= b[3 + i]; ++x) {
+                    int d = materials::spongeIndex(x, dims[i], spongeWidth);
+                    lo[i] = x == b[i] ? d : std::min(lo[i], d);
+                    hi[i] = x == b[i] ? d : std::max(hi[i], d);
+                }
+            for (int i = 0; i < 3; ++i) {
+                o.sponge[i] = lo[i];
+                o.extent[i] = std::max(hi[i] - lo[i] + 1, 0);
+            }
+            for (int c = lo[2]; c <= hi[2]; ++c)
+            for (int y = lo[1]; y <= hi[1]; ++y)
+            for (int x = lo[0]; x <= hi[0]; ++x)
+                lookup.push_back(
+                    map.intern(materials::updateCoeffs(materialOf(r, x, y, c), dt, dx)));
+            objects.push_back(o);
+        }
+    }
+
+    void upload() {
+        if (!objectSSBO) glGenBuffers(1, &objectSSBO);
+        if (!lookupSSBO) glGenBuffers(1, &lookupSSBO);
+        if (!triangleSSBO) glGenBuffers(1, &triangleSSBO);
+        std::vector<float> tris = triangles;
+        if (tris.empty()) tris.assign(9, 0.0f);  // no zero-sized buffer
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, objects.size() * sizeof(Object), objects.data(),
+                     GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, lookupSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, lookup.size() * sizeof(uint32_t), lookup.data(),
+                     GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, triangleSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, tris.size() * sizeof(float), tris.data(),
+                     GL_STATIC_DRAW);
+    }
+
+    // Paint box `box` (inclusive) into `ids`
+    void paint(GLuint ids, const int box[6]) const {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, IDS_BINDING, ids);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_BINDING, objectSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LOOKUP_BINDING, lookupSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TRIANGLE_BINDING, triangleSSBO);
+
+        for (size_t slot = 0; slot < objects.size(); ++slot) {
+            const int* b = &boxes[6 * slot];
+            int lo[3], hi[3];
+            for (int i = 0; i < 3; ++i) {
+                lo[i] = std::max(box[i], b[i]);
+                hi[i] = std::min(box[3 + i], b[3 + i]);
+            }
+            if (lo[0] > hi[0] || lo[1] > hi[1] || lo[2] > hi[2]) continue;
+
+            bool   mesh    = objects[slot].shape[0] == geometry::KIND_MESH;
+            GLuint program = mesh ? meshProgram : primitiveProgram;
+            glUseProgram(program);
+            glUniform1i(glGetUniformLocation(program, "object"), GLint(slot));
+            glUniform3i(glGetUniformLocation(program, "box_lo"), lo[0], lo[1], lo[2]);
+            glUniform3i(glGetUniformLocation(program, "box_hi"), hi[0], hi[1], hi[2]);
+            glUniform3i(glGetUniformLocation(program, "dims"), dims[0], dims[1], dims[2]);
+            glUniform1i(glGetUniformLocation(program, "sponge_width"), spongeWidth);
+            glDispatchCompute(GLuint((hi[0] - lo[0] + GROUP_X) / GROUP_X),
+                              GLuint((hi[1] - lo[1] + GROUP_Y) / GROUP_Y),
+                              mesh ? 1u : GLuint(hi[2] - lo[2] + 1));
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);  // next object paints over this one
+        }
+    }
+
+    // The whole grid
+    void paintAll(GLuint ids) const {
+        int box[6] = {0, 0, 0, dims[0] - 1, dims[1] - 1, dims[2] - 1};
+        paint(ids, box);
+    }
+
+    // Inclusive box of medium `i` on the grid (lo > hi when off it)
+    const int* box(size_t i) const { return &boxes[6 * (i + 1)]; }
+
+    void printSummary() const {
+        size_t n = objects.size() - 1;
+        std::cout << "Voxelizer: " << n << (n == 1 ? " object" : " objects");
+        if (!triangles.empty()) std::cout << " (" << triangles.size() / 9 << " triangles)";
+        std::cout << " painted on the GPU, " << lookup.size() << " lookup entries\n";
+    }
+
+    void cleanup() {
+        glDeleteProgram(primitiveProgram);
+        glDeleteProgram(meshProgram);
+        glDeleteBuffers(1, &objectSSBO);
+        glDeleteBuffers(1, &lookupSSBO);
+        glDeleteBuffers(1, &triangleSSBO);
+        *this = Voxelizer();
+    }
+};
+
+} // namespace voxel
@@ -0,0 +1,1332 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+
+#include "em_common.h"
+#include "shader_utils.h"
+#include "grid.h"
+#include "camera.h"
+#include "cli.h"
+#include "config.h"
+#include "materials.h"
+#include "cpml.h"
+#include "active_tiles.h"
+#include "gpu_timer.h"
+#include "pacing.h"
+#include "subgrid.h"
+#include "snapshot.h"
+#include "cpu_fdtd.h"
+#include "colormap.h"
+#include "render_target.h"
+#include "stats.h"
+#include "sources.h"
+#include "media.h"
+#include "voxelizer.h"
+#include "buffer_pool.h"
+#include "autotune.h"
+
+// The 2D solver: scene defaults, the state the window callbacks share and
+// the Engine, driven by 2D_wave.cpp and fdtd_bench.cpp
+namespace wave2d {
+
+// ── Window ──
+constexpr int WIDTH  = 1280;
+constexpr int HEIGHT = 720;
+
+// ── Scene defaults (--scene / --grid and friends override these) ──
+constexpr int   DEFAULT_NX              = 512;
+constexpr int   DEFAULT_NY              = 512;
+constexpr int   DEFAULT_STEPS_PER_FRAME = 4;
+constexpr float DEFAULT_SOURCE_FREQ     = 0.04f;  // normalized (wavelength ~ 25 cells)
+constexpr float DEFAULT_SOURCE_AMP      = 1.0f;
+
+// ── Absorbing boundary ──
+constexpr int   CPML_WIDTH       = 10;    // default: convolutional PML
+constexpr int   SPONGE_WIDTH     = 30;    // fallback: graded conductivity sponge
+constexpr float SPONGE_SIGMA_MAX = 0.4f;
+
+// ── Fused time-stepping ──
+constexpr int FUSED_REGION    = 32;  // shared window edge in maxwell_fused.comp
+constexpr int MAX_FUSED_STEPS = 8;   // keeps the written tile >= 16 cells wide
+
+// ── Globals ──
+inline Camera2D      camera;
+inline config::Scene scene;                 // grid + source in use (see config.h)
+inline bool          reloadScene = false;   // F5: re-read the scene file
+inline int           shownLayer  = 0;       // [ / ]: batch scenario on screen
+inline int           movedObject = 0;       // Tab: medium the nudge keys move
+inline int           nudge[3]    = {};      // J/L, K/I: pending move in cells
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Engine — owns all OpenGL state, following kavan010/black_hole architecture
+// ─────────────────────────────────────────────────────────────────────────────
+struct Engine {
+    GLFWwindow* window = nullptr;
+
+    // Programs: one maxwell.comp variant per pass (UPDATE_STEP 0 = H, 1 = E)
+    GLuint computeProgram[2] = {};
+    GLuint renderProgram     = 0;  // field.comp: colours Ez into fieldImage
+    int    workgroup[2]      = {16, 16};  // two-pass local size (= active tile shape)
+    bool   specialized       = true;      // grid dims compiled in (off after a live resize)
+
+    // Batch (--batch N): N independent scenarios of the scene stepped by the
+    // same dispatches, one layer each (dispatch z). Every field buffer holds
+    // the layers back to back; materials are shared.
+    int batch = 1;
+
+    // SSBOs (field data lives on the GPU)
+    GLuint ezSSBO = 0;
+    GLuint hxSSBO = 0;
+    GLuint hySSBO = 0;
+
+    // Fused time-stepping: K leapfrog steps per dispatch (0 = two-pass H/E)
+    int    fusedSteps    = 0;
+    GLuint fusedProgram  = 0;
+    GLuint backSSBO[3]   = {};  // ping-pong targets (Ez, Hx, Hy) for the fused kernel
+
+    // Update coefficients: 16-bit material ID per cell, painted from the
+    // scene's media on the GPU (voxelizer.h), + coefficient table
+    materials::CoeffMap coeffMap;
+    voxel::Voxelizer    voxelizer;
+    GLuint materialIdSSBO = 0;  // binding 6
+    GLuint coeffTableSSBO = 0;  // binding 7
+
+    // CPML boundary: psi stored only in the x/y slab pairs
+    bool         useCpml       = true;
+    cpml::Params cpmlParams;
+    GLuint       cpmlProgram   = 0;
+    GLuint       psiSSBO[2]    = {};  // x-slabs (2W x ny), y-slabs (nx x 2W)
+    GLuint       cpmlCoeffSSBO = 0;
+
+    // Active tiles: two-pass kernels dispatched only where the wave has reached
+    tiles::ActiveSet activeTiles;
+    GLuint activeProgram[2] = {};  // maxwell.comp built with ACTIVE_TILES, H and E
+    int    cpmlReach     = 0;  // cells from the source to the nearest CPML slab
+
+    // Refined patch (subgrid.h): a finer grid sub-cycled inside a coarse
+    // box, stepped by computeProgram with its own buffers bound
+    subgrid::Patch patch;
+    GLuint subgridProgram     = 0;
+    GLuint fineSSBO[3]        = {};  // Ez (also at binding 12), Hx, Hy
+    GLuint fineMaterialIdSSBO = 0;
+    GLuint fineCoeffTableSSBO = 0;
+    GLuint fineParamsUBO      = 0;
+    GLuint ringSSBO           = 0;   // binding 13: ring samples (previous, current)
+
+    // Source table (sources.h) at bindings 29/30, and an empty one for the
+    // refined patch (the sources stay on the coarse grid)
+    std::vector<sources::Record> sourceRecords;
+    sources::Table sourceTable;
+    sources::Table fineSources;
+
+    // Dispersive media (media.h): the ADE pass over their cells at bindings
+    // 31..33, after each E pass; pole state per batch scenario
+    media::Plan    mediaPlan;
+    media::Buffers mediaState;
+    GLuint         mediaProgram = 0;
+
+    // UBO
+    GLuint simParamsUBO = 0;
+
+    // Device memory (buffer_pool.h): the grid-sized buffers, zeroed on the
+    // GPU; a new grid is planned against the free memory first
+    vram::Pool memory;
+    size_t     vramFree = 0;  // bytes, 0 = unknown
+
+    // GPU timer queries per pass (--gpu-timers / --profile-out)
+    profile::GpuTimers timers;
+
+    // Ez snapshots to disk every snapshotEvery steps (0 = off)
+    snapshot::Ring snapshots;
+    int         snapshotEvery   = 0;
+    int         snapshotStride  = 1;
+    std::string snapshotDir;
+    GLuint      snapshotProgram = 0;  // decimating gather (stride > 1)
+
+    // Fullscreen quad
+    GLuint quadVAO = 0;
+    GLuint quadVBO = 0;
+
+    // Cached render path (render_target.h): Ez is recoloured only after the
+    // fields changed, the frame redrawn only when the image, the camera or
+    // the window did (windowed runs only)
+    target::Image     fieldImage;
+    target::Frame     frameCache;
+    target::Presenter presenter;
+    colormap::Maps    colormaps;
+    uint64_t          fieldsVersion = 0;  // bumped whenever the fields change
+
+    // Field statistics every statsEvery steps (stats.h; 0 = off), read back
+    // a few frames late: they set the colour scale and feed the watchdog,
+    // which halts the run once the fields diverge. Coarse grid only.
+    stats::Reduction fieldStats;
+    stats::Exposure  exposure;
+    stats::Watchdog  watchdog;
+    int              statsEvery   = 0;
+    GLuint           statsProgram = 0;
+    bool             halted       = false;
+
+    // Cached uniform locations — render program
+    GLint loc_nx          = -1;
+    GLint loc_ny          = -1;
+    GLint loc_layer       = -1;
+    GLint loc_field_scale = -1;
+
+    // Cached uniform locations — compute programs (H, E)
+    GLint loc_stepBase[2] = {-1, -1};
+
+    // Cached uniform locations — active-tile compute programs (H, E)
+    GLint loc_active_stepBase[2] = {-1, -1};
+
+    // Cached uniform locations — CPML program
+    GLint loc_cpml_updateStep = -1;
+    GLint loc_cpml_slabAxis   = -1;
+    GLint loc_cpml_pmlWidth   = -1;
+
+    // Cached uniform locations — fused compute program
+    GLint loc_fused_stepBase  = -1;
+    GLint loc_fused_stepCount = -1;
+
+    // Cached uniform locations — refined-patch coupling program
+    GLint loc_sub_mode  = -1;
+    GLint loc_sub_alpha = -1;
+
+    // Cached uniform locations — snapshot gather program
+    GLint loc_snap_nx      = -1;
+    GLint loc_snap_ny      = -1;
+    GLint loc_snap_outDims = -1;
+    GLint loc_snap_stride  = -1;
+
+    // Cached uniform locations — statistics program
+    GLint loc_stats_nx           = -1;
+    GLint loc_stats_ny           = -1;
+    GLint loc_stats_layers       = -1;
+    GLint loc_stats_flux_lo      = -1;
+    GLint loc_stats_flux_hi      = -1;
+
+    // Cached uniform locations — dispersive media program
+    GLint loc_media_nx           = -1;
+    GLint loc_media_ny           = -1;
+    GLint loc_media_cell_count   = -1;
+    GLint loc_media_state_floats = -1;
+    GLint loc_media_cb_scale     = -1;
+
+    // ── Initialisation ──────────────────────────────────────────────────────
+
+    void init(const cli::RunOptions& opts) {
+        fusedSteps       = std::min(opts.fusedSteps, MAX_FUSED_STEPS);
+        if (fusedSteps > 0 && media::anyDispersive(scene.media)) {
+            std::cout << "Dispersive media need the two-pass kernels; ignoring --fused\n";
+            fusedSteps = 0;
+        }
+        useCpml          = opts.cpml;
+        cpmlParams.width = CPML_WIDTH;
+        bool trackTiles  = opts.activeTiles && fusedSteps == 0;
+        timers.enabled   = opts.gpuTimers;
+        snapshotEvery    = opts.snapshotEvery;
+        snapshotStride   = opts.snapshotStride;
+        snapshotDir      = opts.snapshotDir;
+        statsEvery       = opts.statsEvery;
+        exposure.automatic = opts.exposure == 0.0f;
+        if (!exposure.automatic) exposure.scale = opts.exposure;
+        watchdog.growth  = opts.watchdogGrowth;
+        batch            = opts.batch;
+        if (opts.workgroup[0] > 0) {
+            workgroup[0] = opts.workgroup[0];
+            workgroup[1] = opts.workgroup[1];
+        }
+        if (opts.refine[2] > 0) {
+            patch.x0    = opts.refine[0];
+            patch.y0    = opts.refine[1];
+            patch.w     = opts.refine[2] - opts.refine[0];
+            patch.h     = opts.refine[3] - opts.refine[1];
+            patch.ratio = opts.refineRatio;
+        }
+
+        initWindow(opts.headless);
+        planMemory(opts);
+        shader::binaryCache().dir = opts.shaderCache;
+        bool timeShapes = loadShape(opts);
+        initShaders(trackTiles);
+        if (statsEvery > 0) {
+            fieldStats.every = statsEvery;
+            fieldStats.init();
+        }
+        initGrid();
+        if (timeShapes) autotuneShape(opts.shaderCache);
+        memory.printSummary();
+        initQuad();
+        if (!opts.headless) initRender();
+        cacheUniformLocations();
+    }
+
+    // ── Launch shape autotuning ──
+
+    std::string tuneVariant() const {
+        return "2D " + std::to_string(scene.nx) + "x" + std::to_string(scene.ny) + " batch " +
+               std::to_string(batch) + (useCpml ? " cpml" : " sponge");
+    }
+
+    // Milliseconds per step of the dense H and E passes at shape `s`, on the
+    // live buffers (CPML and media passes cost the same at every shape)
+    double timeShape(const autotune::Shape& s) {
+        std::string kernel = gridDefines() + sources::defines(sources::BIN_2D) + shapeDefines(s);
+        GLuint program[2];
+        GLint  loc[2];
+        for (int pass = 0; pass < 2; ++pass) {
+            program[pass] = shader::createComputeProgram("shaders/maxwell.comp",
+                                                         kernel + passDefines(pass));
+            loc[pass] = glGetUniformLocation(program[pass], "stepBase");
+        }
+        GLuint gx = grid::groups(scene.nx, s.wg[0]);
+        GLuint gy = grid::groups(scene.ny, s.wg[1]);
+        int step = 0;
+        double ms = autotune::msPerStep([&](int steps) {
+            for (int i = 0; i < steps; ++i, ++step)
+                for (int pass = 0; pass < 2; ++pass) {
+                    glUseProgram(program[pass]);
+                    glUniform1i(loc[pass], step);
+                    glDispatchCompute(gx, gy, GLuint(batch));
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                }
+        });
+        for (GLuint p : program) glDeleteProgram(p);
+        return ms;
+    }
+
+    void setLaunchShape(const autotune::Shape& s) {
+        workgroup[0] = s.wg[0];
+        workgroup[1] = s.wg[1];
+    }
+
+    // Without --workgroup: the shape stored for this GPU, driver and variant,
+    // applied before any program is built; true when there is none and the
+    // candidates are to be timed once the grid is up. A refined patch only
+    // reads a stored shape: its programs keep the grid size as a uniform and
+    // the trials would not step it.
+    bool loadShape(const cli::RunOptions& opts) {
+        if (fusedSteps > 0 || opts.workgroup[0] > 0 || !opts.autotune) return false;
+        std::string     variant = tuneVariant();
+        autotune::Shape stored;
+        if (!opts.retune && autotune::Cache(opts.shaderCache).lookup(variant, false, stored) &&
+            autotune::launchable(stored, 1)) {
+            setLaunchShape(stored);
+            std::cout << "Autotune: " << stored.name(false) << " (stored for " << variant << ")\n";
+            return false;
+        }
+        if (patch.enabled()) {
+            std::cout << "Autotune: nothing stored for " << variant
+                      << "; run once without --refine to tune\n";
+            return false;
+        }
+        return true;
+    }
+
+    // The fastest launchable candidate, stored under `cacheDir`, replaces
+    // the default programs. The trials stepped the live fields, so they
+    // start over from zero.
+    void autotuneShape(const std::string& cacheDir) {
+        std::string variant = tuneVariant();
+        std::vector<autotune::Shape> candidates;
+        for (const autotune::Shape& c : autotune::candidates2d())
+            if (autotune::launchable(c, 1)) candidates.push_back(c);
+        auto trial = [&](const autotune::Shape& c) { return timeShape(c); };
+        autotune::Shape best = autotune::pick(candidates, false, variant, trial);
+        autotune::Cache(cacheDir).store(variant, best, false);
+        for (GLuint b : {ezSSBO, hxSSBO, hySSBO}) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, b);
+            vram::clear(GL_SHADER_STORAGE_BUFFER);
+        }
+        if (best == launchShape()) return;
+
+        setLaunchShape(best);
+        bool trackTiles = activeProgram[0] != 0;
+        for (GLuint& p : computeProgram) { glDeleteProgram(p); p = 0; }
+        for (GLuint& p : activeProgram) { glDeleteProgram(p); p = 0; }
+        initTwoPassShaders(trackTiles);
+        if (trackTiles) initActiveTiles();
+    }
+
+    // ── Memory plan ──
+
+    static std::string gridName(const config::Scene& s) {
+        return std::to_string(s.nx) + "x" + std::to_string(s.ny);
+    }
+
+    // Bytes the grid-sized buffers of `s` take under the current settings,
+    // before any is allocated (tables, tiles and the sparse media state are
+    // small and left out)
+    vram::Budget footprint(const config::Scene& s) const {
+        vram::Budget b;
+        size_t cells = s.cells(), layers = size_t(batch);
+        b.bytes[vram::FIELDS] = (fusedSteps > 0 ? 6 : 3) * cells * layers * sizeof(float);
+        b.bytes[vram::COEFFS] = materials::CoeffMap::idBytes(cells);
+        if (useCpml)
+            b.bytes[vram::BOUNDARY] =
+                size_t(2 * cpmlParams.width) * (s.nx + s.ny) * 2 * layers * sizeof(float);
+        if (patch.enabled())
+            b.bytes[vram::SUBGRID] = 3 * patch.fineCells() * sizeof(float) +
+                                     size_t(patch.ringSize()) * 2 * sizeof(float) +
+                                     materials::CoeffMap::idBytes(patch.fineCells());
+        if (snapshotEvery > 0)
+            b.bytes[vram::STAGING] = size_t(snapshot::RING_SLOTS) *
+                                     grid::groups(s.nx, snapshotStride) *
+                                     grid::groups(s.ny, snapshotStride) * layers * sizeof(float);
+        return b;
+    }
+
+    // The scene's plan against the free memory: an oversized grid stops
+    // here, or with --fit-vram shrinks (same aspect) to the largest that fits
+    void planMemory(const cli::RunOptions& opts) {
+        vramFree = vram::availableBytes(opts.vramMB);
+        vram::Budget plan = footprint(scene);
+        if (!plan.fits(vramFree)) {
+            plan.print(gridName(scene), vramFree);
+            if (!opts.fitVram) {
+                std::cerr << "Grid " << gridName(scene) << " needs more than "
+                          << 100.0 * vram::HEADROOM << " % of the free GPU memory; use a "
+                          << "smaller --grid or --fit-vram\n";
+                exit(EXIT_FAILURE);
+            }
+            config::Scene fitted = scene;
+            auto scaled = [&](double k) {
+                fitted.nx = std::max(int(scene.nx * k), 1);
+                fitted.ny = std::max(int(scene.ny * k), 1);
+                return footprint(fitted);
+            };
+            scaled(vram::fitScale(vramFree, scaled));
+            int boundary = useCpml ? cpmlParams.width : 0;
+            std::cout << "Memory: shrinking the grid to " << gridName(fitted) << "\n";
+            if (!config::validate(fitted, boundary, false, batch)) exit(EXIT_FAILURE);
+            scene = fitted;
+            plan  = footprint(scene);
+        }
+        plan.print(gridName(scene), vramFree);
+    }
+
+    void initRender() {
+        colormaps.init();
+        presenter.init();
+    }
+
+    // Everything sized by the grid. Buffers are (re)allocated in place, so
+    // this also serves a live resize. The field programs have the size
+    // compiled in until the first one; from then on they read it from the UBO.
+    void initGrid() {
+        initBuffers();
+        initSources();
+        initMaterials();
+        initMedia();
+        if (useCpml) initCpml();
+        if (patch.enabled()) initSubgrid();
+        if (activeProgram[0]) initActiveTiles();
+        if (snapshotEvery > 0) initSnapshots();
+        uploadSimParams();
+        ++fieldsVersion;
+    }
+
+    // Live scene change. A new grid size reallocates and restarts from zero
+    // fields (returns true); source changes only update the UBO, new media
+    // rebuild the coefficients and restart their pole state.
+    bool applyScene(const config::Scene& next) {
+        if (fusedSteps > 0 && media::anyDispersive(next.media)) {
+            std::cerr << "Scene: dispersive media need the two-pass kernels (run without "
+                         "--fused); keeping the current scene\n";
+            return false;
+        }
+        bool regrid = !next.sameGrid(scene);
+        bool newMedia = !next.sameMedia(scene);
+        if (regrid && !footprint(next).fits(vramFree)) {
+            footprint(next).print(gridName(next), vramFree);
+            std::cerr << "Scene: the new grid does not fit the free GPU memory; keeping the "
+                         "current scene\n";
+            return false;
+        }
+        scene = next;
+        if (!regrid) {
+            uploadSimParams();
+            initSources();
+            if (newMedia) {
+                initMaterials();
+                initMedia();
+                ++fieldsVersion;
+            }
+            return false;
+        }
+        std::cout << "Scene: resizing to " << scene.nx << "x" << scene.ny << "\n";
+        // The first resize swaps the size-specialized programs for a set that
+        // reads the size from the UBO; later ones keep the compiled programs
+        if (specialized) {
+            specialized     = false;
+            bool trackTiles = activeProgram[0] != 0;
+            deletePrograms();
+            initShaders(trackTiles);
+        }
+        initGrid();
+        cacheUniformLocations();
+        return true;
+    }
+
+    void initWindow(bool headless) {
+        if (!glfwInit()) {
+            std::cerr << "Failed to initialise GLFW\n";
+            exit(EXIT_FAILURE);
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        if (headless)
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);  // offscreen context only
+
+        window = glfwCreateWindow(WIDTH, HEIGHT, "EM Wave - 2D FDTD", nullptr, nullptr);
+        if (!window) {
+            std::cerr << "Failed to create GLFW window\n";
+            glfwTerminate();
+            exit(EXIT_FAILURE);
+        }
+        glfwMakeContextCurrent(window);
+        glfwSwapInterval(headless ? 0 : 1);  // vsync only when presenting
+
+        glewExperimental = GL_TRUE;
+        if (glewInit() != GLEW_OK) {
+            std::cerr << "Failed to initialise GLEW\n";
+            exit(EXIT_FAILURE);
+        }
+
+        std::cout << "OpenGL " << glGetString(GL_VERSION) << "\n";
+        std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+    }
+
+    // Workgroup shape of the two-pass kernel as WG_X / WG_Y #defines
+    static std::string shapeDefines(const autotune::Shape& s) {
+        return "#define WG_X " + std::to_string(s.wg[0]) + "\n"
+             + "#define WG_Y " + std::to_string(s.wg[1]) + "\n";
+    }
+
+    autotune::Shape launchShape() const {
+        autotune::Shape s;
+        s.wg[0] = workgroup[0];
+        s.wg[1] = workgroup[1];
+        return s;
+    }
+
+    std::string workgroupDefines() const { return shapeDefines(launchShape()); }
+
+    // Grid dims compiled into the field kernels (shaders/specialize.glsl);
+    // none once a live resize has switched to the programs that take the
+    // size from the UBO
+    std::string gridDefines() const {
+        if (!specialized) return "";
+        return "#define GRID_NX " + std::to_string(scene.nx) + "\n"
+             + "#define GRID_NY " + std::to_string(scene.ny) + "\n";
+    }
+
+    static std::string passDefines(int pass) {
+        return "#define UPDATE_STEP " + std::to_string(pass) + "\n";
+    }
+
+    // Two-pass H / E programs at the current workgroup shape. The refined
+    // patch is stepped by the same programs on its own grid, so they keep
+    // the size as a uniform there.
+    void initTwoPassShaders(bool trackTiles) {
+        std::string twoPass = (patch.enabled() ? "" : gridDefines()) +
+                              sources::defines(sources::BIN_2D) + workgroupDefines();
+        for (int pass = 0; pass < 2; ++pass) {
+            computeProgram[pass] = shader::createComputeProgram(
+                "shaders/maxwell.comp", twoPass + passDefines(pass));
+            if (trackTiles)
+                activeProgram[pass] = shader::createComputeProgram(
+                    "shaders/maxwell.comp", twoPass + passDefines(pass) +
+                                                "#define ACTIVE_TILES\n" + tiles::defines(10, 11));
+        }
+    }
+
+    void initShaders(bool trackTiles) {
+        std::string dims = gridDefines() + sources::defines(sources::BIN_2D);
+
+        initTwoPassShaders(trackTiles);
+        renderProgram  = shader::createComputeProgram("shaders/field.comp",
+                                                      colormap::defines() + target::defines());
+        if (fusedSteps > 0)
+            fusedProgram = shader::createComputeProgram("shaders/maxwell_fused.comp", dims);
+        if (useCpml)
+            cpmlProgram = shader::createComputeProgram(
+                "shaders/cpml.comp",
+                dims + "#define PML_WIDTH " + std::to_string(cpmlParams.width) + "\n");
+        if (patch.enabled())
+            subgridProgram = shader::createComputeProgram("shaders/subgrid.comp");
+        if (snapshotEvery > 0 && snapshotStride > 1)
+            snapshotProgram = shader::createComputeProgram("shaders/snapshot.comp",
+                                                           snapshot::defines());
+        if (statsEvery > 0)
+            statsProgram = shader::createComputeProgram("shaders/stats2d.comp", stats::defines());
+        shader::printCacheStats();
+    }
+
+    void deletePrograms() {
+        for (int pass = 0; pass < 2; ++pass) {
+            glDeleteProgram(computeProgram[pass]);
+            glDeleteProgram(activeProgram[pass]);
+            computeProgram[pass] = activeProgram[pass] = 0;
+        }
+        for (GLuint* p : {&renderProgram, &fusedProgram, &cpmlProgram, &subgridProgram,
+                          &snapshotProgram, &statsProgram, &mediaProgram}) {
+            glDeleteProgram(*p);
+            *p = 0;
+        }
+    }
+
+    void initBuffers() {
+        size_t bytes = scene.cells() * batch * sizeof(float);
+
+        auto makeSSBO = [&](GLuint& ssbo, GLuint binding) {
+            memory.alloc(ssbo, bytes, vram::FIELDS);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, ssbo);
+        };
+
+        makeSSBO(ezSSBO, 0);  // Ez at binding 0
+        makeSSBO(hxSSBO, 1);  // Hx at binding 1
+        makeSSBO(hySSBO, 2);  // Hy at binding 2
+
+        // Fused kernel writes the next step into a second set at bindings 3..5
+        if (fusedSteps > 0) {
+            for (int i = 0; i < 3; ++i)
+                makeSSBO(backSSBO[i], 3 + i);
+        }
+
+        // SimParams UBO at binding 0 (UBO and SSBO namespaces are separate)
+        if (!simParamsUBO) glGenBuffers(1, &simParamsUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, simParamsUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(SimParams), nullptr,
+                     GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, simParamsUBO);
+    }
+
+    // Source records on every layer, binned for the E pass; also the seeds
+    // of the active tiles
+    void initSources() {
+        int dims[3]   = {scene.nx, scene.ny, 1};
+        sourceRecords = sources::pack(scene.sources, dims, batch, em::DT, scene.sourceFreq,
+                                      scene.sourceAmp);
+        int layers[3] = {scene.nx, scene.ny, batch};
+        sourceTable.upload(sourceRecords, layers, sources::BIN_2D);
+        sources::printSummary(sourceRecords, batch);
+    }
+
+    // Material of medium `r` (null: vacuum) plus the sponge loss at depth
+    // indices (a, b) from the x / y edges (materials::spongeIndex)
+    materials::Material materialOf(const media::Region* r, int a, int b, int) const {
+        materials::Material m = media::materialOf(r);
+        if (useCpml) return m;  // CPML absorbs in the correction pass instead
+
+        float sigma = SPONGE_SIGMA_MAX * (materials::spongeDepthAt(a, SPONGE_WIDTH) +
+                                          materials::spongeDepthAt(b, SPONGE_WIDTH));
+        m.sigma  += sigma * m.eps_r;  // matched electric/magnetic loss
+        m.sigma_m = sigma * m.mu_r;
+        return m;
+    }
+
+    // Per-cell material (the scene's media, else vacuum) plus the sponge
+    // loss near the edges: the host form of what the voxelizer paints
+    materials::Material materialAt(int x, int y) const {
+        return materialOf(media::regionAt(scene.media, x, y, 0),
+                          materials::spongeIndex(x, scene.nx, SPONGE_WIDTH),
+                          materials::spongeIndex(y, scene.ny, SPONGE_WIDTH), 0);
+    }
+
+    // Cells and zeroed pole state of the dispersive media; the program is
+    // built the first time a scene has any
+    void initMedia() {
+        int dims[3] = {scene.nx, scene.ny, 1};
+        mediaPlan   = media::plan(scene.media, dims, 1, em::DT);
+        mediaState.upload(mediaPlan, batch);
+        memory.track(mediaState.stateSSBO, vram::MEDIA);
+        if (mediaPlan.empty()) return;
+        if (!mediaProgram) {
+            mediaProgram = shader::createComputeProgram("shaders/media2d.comp", media::defines());
+            loc_media_nx           = glGetUniformLocation(mediaProgram, "nx");
+            loc_media_ny           = glGetUniformLocation(mediaProgram, "ny");
+            loc_media_cell_count   = glGetUniformLocation(mediaProgram, "cell_count");
+            loc_media_state_floats = glGetUniformLocation(mediaProgram, "state_floats");
+            loc_media_cb_scale     = glGetUniformLocation(mediaProgram, "cb_scale");
+        }
+        media::checkStability(scene.media, em::DT);
+        media::printSummary(mediaPlan, scene.cells(), batch);
+    }
+
+    // Coefficient table on the host, IDs voxelized on the GPU; call again
+    // on geometry change
+    void initMaterials() {
+        planVoxels();
+
+        memory.upload(materialIdSSBO, nullptr, materials::CoeffMap::idBytes(scene.cells()),
+                      vram::COEFFS);  // every cell painted below
+        voxelizer.paintAll(materialIdSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, materialIdSSBO);
+
+        materials::printSummary(coeffMap, scene.cells());
+        voxelizer.printSummary();
+    }
+
+    // Voxelizer slots of the scene's media and the table they paint from:
+    // a fresh one, or the current one grown (IDs already painted stay valid)
+    void planVoxels(bool fresh = true) {
+        int dims[3] = {scene.nx, scene.ny, 1};
+        if (fresh) coeffMap.resetTable();
+        voxelizer.init();
+        voxelizer.plan(scene.media, dims, useCpml ? 0 : SPONGE_WIDTH, coeffMap, em::DT, em::DX,
+                       [&](const media::Region* r, int a, int b, int c) {
+                           return materialOf(r, a, b, c);
+                       });
+        voxelizer.upload();
+
+        memory.upload(coeffTableSSBO, coeffMap.table.data(), coeffMap.tableBytes(), vram::COEFFS);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, coeffTableSSBO);
+    }
+
+    // Live nudge of medium `i` by `d` cells: only the union of its old and
+    // new boxes is repainted. A dispersive medium restarts its pole state.
+    void moveObject(size_t i, const int d[3]) {
+        if (i >= scene.media.size()) return;
+        if (patch.enabled()) {
+            std::cout << "Move: the refined patch keeps its own materials; run without "
+                         "--refine to move objects\n";
+            return;
+        }
+        int box[6];
+        std::copy(voxelizer.box(i), voxelizer.box(i) + 6, box);
+        media::Region& r = scene.media[i];
+        r.shape.translate(d);
+        for (int a = 0; a < 3; ++a) r.offset[a] += d[a];
+
+        planVoxels(false);
+        const int* moved = voxelizer.box(i);
+        for (int a = 0; a < 3; ++a) {
+            box[a]     = std::min(box[a], moved[a]);
+            box[3 + a] = std::max(box[3 + a], moved[3 + a]);
+        }
+        voxelizer.paint(materialIdSSBO, box);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, materialIdSSBO);
+        if (r.dispersive()) initMedia();
+        std::cout << "Move: object " << i << " (" << r.spec << ") offset " << r.offset[0] << ", "
+                  << r.offset[1] << "\n";
+    }
+
+    // Zeroed psi slabs + per-slab-position recursion coefficients
+    void initCpml() {
+        const int W = cpmlParams.width;
+        size_t slabCells[2] = {size_t(2 * W) * scene.ny, size_t(scene.nx) * 2 * W};
+
+        for (int a = 0; a < 2; ++a)  // vec2 per cell
+            memory.alloc(psiSSBO[a], slabCells[a] * 2 * batch * sizeof(float), vram::BOUNDARY);
+
+        std::vector<cpml::Coeffs> profile = cpml::buildProfile(cpmlParams, scene.nx, em::DT, em::DX);
+        memory.upload(cpmlCoeffSSBO, profile.data(), profile.size() * sizeof(cpml::Coeffs),
+                      vram::BOUNDARY);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, cpmlCoeffSSBO);
+
+        double psiMB =
+            (slabCells[0] + slabCells[1]) * 2 * batch * sizeof(float) / (1024.0 * 1024.0);
+        std::cout << "CPML: " << W << " cells, psi slabs " << psiMB << " MB, useful domain "
+                  << scene.nx - 2 * W << "x" << scene.ny - 2 * W << "\n";
+    }
+
+    // Zeroed patch fields, its own coefficients and parameters (the source
+    // stays on the coarse grid), plus the static coupling uniforms
+    void initSubgrid() {
+        int boundary = useCpml ? cpmlParams.width : SPONGE_WIDTH;
+        for (const sources::Record& s : sourceRecords)
+            if (!patch.validate(scene.nx, scene.ny, boundary, s.cell[0], s.cell[1]))
+                exit(EXIT_FAILURE);
+        for (size_t i = 0; i < mediaPlan.count(); ++i) {  // the patch has no pole state
+            int x = mediaPlan.cells[4 * i], y = mediaPlan.cells[4 * i + 1];
+            if (x >= patch.x0 && x <= patch.x0 + patch.w && y >= patch.y0 &&
+                y <= patch.y0 + patch.h) {
+                std::cerr << "Refined patch overlaps a dispersive medium at (" << x << ", " << y
+                          << ")\n";
+                exit(EXIT_FAILURE);
+            }
+        }
+        const int r = patch.ratio;
+
+        for (GLuint& ssbo : fineSSBO)
+            memory.alloc(ssbo, patch.fineCells() * sizeof(float), vram::SUBGRID);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, fineSSBO[0]);
+
+        memory.alloc(ringSSBO, size_t(patch.ringSize()) * 2 * sizeof(float), vram::SUBGRID);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, ringSSBO);
+
+        // Fine cell (x, y) takes the material of the coarse cell it lies in
+        materials::CoeffMap fineMap;
+        materials::build(fineMap, patch.fineNx(), patch.fineNy(), 1, em::DT / r, em::DX / r,
+                         [&](int x, int y, int) {
+                             return materialAt(patch.x0 + x / r, patch.y0 + y / r);
+                         });
+        memory.upload(fineMaterialIdSSBO, fineMap.packedIds.data(), fineMap.idBytes(),
+                      vram::SUBGRID);
+        memory.upload(fineCoeffTableSSBO, fineMap.table.data(), fineMap.tableBytes(),
+                      vram::SUBGRID);
+
+        SimParams p = simParams();
+        p.nx       = patch.fineNx();
+        p.ny       = patch.fineNy();
+        p.source_x = -1;
+        p.source_y = -1;
+        p.dx       = em::DX / r;
+        p.dt       = em::DT / r;
+        if (!fineParamsUBO) glGenBuffers(1, &fineParamsUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, fineParamsUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(SimParams), &p, GL_STATIC_DRAW);
+        int fineDims[3] = {patch.fineNx(), patch.fineNy(), 1};
+        fineSources.upload({}, fineDims, sources::BIN_2D);
+        sourceTable.bind();
+
+        glUseProgram(subgridProgram);
+        glUniform1i(glGetUniformLocation(subgridProgram, "coarseNx"), scene.nx);
+        glUniform2i(glGetUniformLocation(subgridProgram, "origin"), patch.x0, patch.y0);
+        glUniform2i(glGetUniformLocation(subgridProgram, "extent"), patch.w, patch.h);
+        glUniform2i(glGetUniformLocation(subgridProgram, "fineDims"), patch.fineNx(),
+                    patch.fineNy());
+        glUniform1i(glGetUniformLocation(subgridProgram, "ratio"), r);
+
+        patch.printSummary(scene.cells(), 3 * sizeof(float) + sizeof(uint16_t));
+    }
+
+    // Fields start at zero, so only the source tiles are live at step 0. Mask
+    // and list at bindings 10/11.
+    void initActiveTiles() {
+        const int W  = cpmlParams.width;
+        int tw       = workgroup[0], th = workgroup[1];
+        int tilesX   = int(grid::groups(scene.nx, tw));
+        int tilesY   = int(grid::groups(scene.ny, th));
+
+        std::vector<int> seeds;
+        cpmlReach = scene.nx;
+        for (const sources::Record& s : sourceRecords) {
+            int srcX = s.cell[0], srcY = s.cell[1];
+            seeds.push_back((srcY / th) * tilesX + srcX / tw);
+            cpmlReach = std::min({cpmlReach, srcX - (W - 1), (scene.nx - W) - srcX,
+                                  srcY - (W - 1), (scene.ny - W) - srcY});
+        }
+        activeTiles.init(tilesX * tilesY, seeds, 10, 11);
+    }
+
+    // Staging ring sized for one (decimated) Ez plane; a resize drains it first
+    void initSnapshots() {
+        size_t bytes = size_t(grid::groups(scene.nx, snapshotStride)) *
+                       grid::groups(scene.ny, snapshotStride) * batch * sizeof(float);
+        for (const snapshot::Ring::Slot& s : snapshots.slots) memory.forget(s.buffer);
+        if (!snapshots.enabled) snapshots.start(snapshotDir, "ez", bytes);
+        else                    snapshots.resize(bytes);
+        for (const snapshot::Ring::Slot& s : snapshots.slots) memory.track(s.buffer, vram::STAGING);
+    }
+
+    void initQuad() {
+        // clang-format off
+        float verts[] = {
+        //  pos (xy)       texcoord (uv)
+            -1.f,  1.f,   0.f, 1.f,
+            -1.f, -1.f,   0.f, 0.f,
+             1.f, -1.f,   1.f, 0.f,
+
+            -1.f,  1.f,   0.f, 1.f,
+             1.f, -1.f,   1.f, 0.f,
+             1.f,  1.f,   1.f, 1.f,
+        };
+        // clang-format on
+
+        glGenVertexArrays(1, &quadVAO);
+        glGenBuffers(1, &quadVBO);
+        glBindVertexArray(quadVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+
+        // location 0 — position (vec2)
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE,
+                              4 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        // location 1 — texcoord (vec2)
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE,
+                              4 * sizeof(float),
+                              (void*)(2 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        glBindVertexArray(0);
+    }
+
+    void cacheUniformLocations() {
+        loc_nx          = glGetUniformLocation(renderProgram, "nx");
+        loc_ny          = glGetUniformLocation(renderProgram, "ny");
+        loc_layer       = glGetUniformLocation(renderProgram, "layer");
+        loc_field_scale = glGetUniformLocation(renderProgram, "field_scale");
+
+        for (int pass = 0; pass < 2; ++pass) {
+            loc_stepBase[pass] = glGetUniformLocation(computeProgram[pass], "stepBase");
+            if (activeProgram[pass])
+                loc_active_stepBase[pass] = glGetUniformLocation(activeProgram[pass], "stepBase");
+        }
+
+        if (cpmlProgram) {
+            loc_cpml_updateStep = glGetUniformLocation(cpmlProgram, "updateStep");
+            loc_cpml_slabAxis   = glGetUniformLocation(cpmlProgram, "slabAxis");
+            loc_cpml_pmlWidth   = glGetUniformLocation(cpmlProgram, "pmlWidth");
+        }
+
+        if (fusedProgram) {
+            loc_fused_stepBase  = glGetUniformLocation(fusedProgram, "stepBase");
+            loc_fused_stepCount = glGetUniformLocation(fusedProgram, "stepCount");
+        }
+
+        if (subgridProgram) {
+            loc_sub_mode  = glGetUniformLocation(subgridProgram, "mode");
+            loc_sub_alpha = glGetUniformLocation(subgridProgram, "alpha");
+        }
+
+        if (snapshotProgram) {
+            loc_snap_nx      = glGetUniformLocation(snapshotProgram, "nx");
+            loc_snap_ny      = glGetUniformLocation(snapshotProgram, "ny");
+            loc_snap_outDims = glGetUniformLocation(snapshotProgram, "outDims");
+            loc_snap_stride  = glGetUniformLocation(snapshotProgram, "stride");
+        }
+
+        if (statsProgram) {
+            loc_stats_nx           = glGetUniformLocation(statsProgram, "nx");
+            loc_stats_ny           = glGetUniformLocation(statsProgram, "ny");
+            loc_stats_layers       = glGetUniformLocation(statsProgram, "layers");
+            loc_stats_flux_lo      = glGetUniformLocation(statsProgram, "flux_lo");
+            loc_stats_flux_hi      = glGetUniformLocation(statsProgram, "flux_hi");
+        }
+    }
+
+    // ── Per-frame work ──────────────────────────────────────────────────────
+
+    // Static parameters only — the timestep is pushed per dispatch as a
+    // uniform, so nothing here changes between steps. The source_* members
+    // describe the scene's default source; the kernels read the table.
+    SimParams simParams() const {
+        SimParams p{};
+        p.nx          = scene.nx;
+        p.ny          = scene.ny;
+        p.source_x    = scene.nx / 2;
+        p.source_y    = scene.ny / 2;
+        p.dx          = em::DX;
+        p.dt          = em::DT;
+        p.time        = 0.0f;
+        p.source_freq = scene.sourceFreq;
+        p.source_amp  = scene.sourceAmp;
+        p.field_scale = 1.0f;
+        p.timestep    = 0;
+        p._pad0       = 0;
+        return p;
+    }
+
+    void uploadSimParams() {
+        SimParams p = simParams();
+        timers.begin(profile::UPLOAD);
+        glBindBuffer(GL_UNIFORM_BUFFER, simParamsUBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SimParams), &p);
+        timers.end(profile::UPLOAD);
+    }
+
+    // Theoretical traffic per cell update: H pass reads Ez, Hx, Hy and writes
+    // Hx, Hy; E pass reads all three and writes Ez; plus a 16-bit material ID
+    // per pass. Neighbour reads are assumed cached.
+    double bytesPerCellUpdate() const {
+        return (5 + 4) * sizeof(float) + 2 * sizeof(uint16_t);
+    }
+
+    void updateFields(int timestep) {
+        // The grid support grows one cell per step, so the CPML corrections
+        // are exactly zero until it comes within a cell of a slab. Tracking
+        // stops there: the slabs then need the full correction passes.
+        if (activeTiles.enabled && useCpml && timestep + 2 >= cpmlReach)
+            activeTiles.stop(timestep);
+        bool sparse = activeTiles.enabled;
+
+        const GLuint* program     = sparse ? activeProgram : computeProgram;
+        const GLint*  locStepBase = sparse ? loc_active_stepBase : loc_stepBase;
+
+        GLuint gx = grid::groups(scene.nx, workgroup[0]);
+        GLuint gy = grid::groups(scene.ny, workgroup[1]);
+        auto dispatch = [&](int pass) {
+            glUseProgram(program[pass]);
+            glUniform1i(locStepBase[pass], timestep);
+            if (sparse) activeTiles.dispatch();
+            else        glDispatchCompute(gx, gy, batch);
+        };
+
+        // Pass 1 — H field update
+        timers.begin(profile::H_PASS);
+        dispatch(0);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        timers.end(profile::H_PASS);
+        if (useCpml && !sparse) applyCpml(0);
+
+        // Pass 2 — E field update + source + absorbing boundary
+        timers.begin(profile::E_PASS);
+        dispatch(1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        timers.end(profile::E_PASS);
+        if (useCpml && !sparse) applyCpml(1);
+        if (mediaState.count) applyMedia();
+
+        // Tiles woken by this E pass join the next step's dispatch
+        if (sparse) {
+            timers.begin(profile::TILES);
+            activeTiles.compact();
+            timers.end(profile::TILES);
+            activeTiles.poll(timestep + 1);
+        }
+
+        if (patch.enabled()) updateSubgrid();
+    }
+
+    // Fields, coefficients, sources and parameters the two-pass kernel reads
+    void bindFieldSet(GLuint ez, GLuint hx, GLuint hy, GLuint ids, GLuint table,
+                      const sources::Table& drive, GLuint ubo) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ez);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, hx);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, hy);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, ids);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, table);
+        drive.bind();
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, ubo);
+    }
+
+    // After a coarse step: drive the patch ring, run `ratio` fine sub-steps
+    // with the ring interpolated in time, then restrict back onto the coarse
+    // grid (see subgrid.h)
+    void updateSubgrid() {
+        const int r = patch.ratio;
+        GLuint ringGroups  = grid::groups(patch.ringSize(), 64);
+        GLuint innerGroups = grid::groups((patch.w - 1) * (patch.h - 1), 64);
+        GLuint gx = grid::groups(patch.fineNx(), workgroup[0]);
+        GLuint gy = grid::groups(patch.fineNy(), workgroup[1]);
+
+        timers.begin(profile::SUBGRID);
+        glUseProgram(subgridProgram);
+        glUniform1i(loc_sub_mode, 0);
+        glDispatchCompute(ringGroups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        bindFieldSet(fineSSBO[0], fineSSBO[1], fineSSBO[2], fineMaterialIdSSBO,
+                     fineCoeffTableSSBO, fineSources, fineParamsUBO);
+        for (int k = 1; k <= r; ++k) {
+            for (int pass = 0; pass < 2; ++pass) {
+                glUseProgram(computeProgram[pass]);
+                glDispatchCompute(gx, gy, 1);
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            }
+            glUseProgram(subgridProgram);
+            glUniform1i(loc_sub_mode, 1);
+            glUniform1f(loc_sub_alpha, float(k) / r);
+            glDispatchCompute(ringGroups, 1, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+        bindFieldSet(ezSSBO, hxSSBO, hySSBO, materialIdSSBO, coeffTableSSBO, sourceTable,
+                     simParamsUBO);
+
+        glUniform1i(loc_sub_mode, 2);
+        glDispatchCompute(innerGroups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        timers.end(profile::SUBGRID);
+    }
+
+    // CPML convolution terms for the pass just run, one slab pair at a time
+    void applyCpml(int updateStep) {
+        const int W = cpmlParams.width;
+        timers.begin(profile::CPML);
+        glUseProgram(cpmlProgram);
+        glUniform1i(loc_cpml_updateStep, updateStep);
+        glUniform1i(loc_cpml_pmlWidth, W);
+
+        // x-slabs: 2W x ny box, y-slabs: nx x 2W box (sequential: both touch Ez)
+        GLuint boxW[2] = {GLuint(2 * W),    GLuint(scene.nx)};
+        GLuint boxH[2] = {GLuint(scene.ny), GLuint(2 * W)};
+        for (int a = 0; a < 2; ++a) {
+            glUniform1i(loc_cpml_slabAxis, a);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, psiSSBO[a]);
+            glDispatchCompute(grid::groups(boxW[a], 8), grid::groups(boxH[a], 8), batch);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+        timers.end(profile::CPML);
+    }
+
+    // Polarization and Kerr terms of the dispersive cells, on every layer
+    void applyMedia() {
+        timers.begin(profile::MEDIA);
+        glUseProgram(mediaProgram);
+        glUniform1i(loc_media_nx, scene.nx);
+        glUniform1i(loc_media_ny, scene.ny);
+        glUniform1i(loc_media_cell_count, mediaState.count);
+        glUniform1ui(loc_media_state_floats, GLuint(mediaPlan.stateFloats));
+        glUniform1f(loc_media_cb_scale, em::DX / em::DT);
+        mediaState.bind();
+        mediaState.dispatch(batch);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        timers.end(profile::MEDIA);
+    }
+
+    // Temporal-blocked path: up to fusedSteps leapfrog steps per dispatch
+    void updateFieldsFused(int timestep, int count) {
+        timers.begin(profile::FUSED);
+        glUseProgram(fusedProgram);
+
+        while (count > 0) {
+            int k    = std::min(count, fusedSteps);
+            int tile = FUSED_REGION - 2 * k;  // cells still exact after k steps
+
+            glUniform1i(loc_fused_stepBase, timestep);
+            glUniform1i(loc_fused_stepCount, k);
+            glDispatchCompute(grid::groups(scene.nx, tile), grid::groups(scene.ny, tile), batch);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+            swapFieldBuffers();
+            timestep += k;
+            count    -= k;
+        }
+        timers.end(profile::FUSED);
+    }
+
+    // Output set becomes current at bindings 0..2 (read by render and next step)
+    void swapFieldBuffers() {
+        std::swap(ezSSBO, backSSBO[0]);
+        std::swap(hxSSBO, backSSBO[1]);
+        std::swap(hySSBO, backSSBO[2]);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ezSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, hxSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, hySSBO);
+        for (int i = 0; i < 3; ++i)
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3 + i, backSSBO[i]);
+    }
+
+    // Advance `count` steps starting at `timestep` on whichever path is active
+    void step(int timestep, int count) {
+        if (count > 0) ++fieldsVersion;
+        if (fusedSteps > 0) {
+            updateFieldsFused(timestep, count);
+            return;
+        }
+        for (int i = 0; i < count; ++i)
+            updateFields(timestep + i);
+    }
+
+    // Call after advancing from `from` to `to`: queues a snapshot whenever a
+    // multiple of snapshotEvery was crossed and hands finished ones to disk
+    void snapshotAfter(int from, int to) {
+        if (!snapshots.enabled) return;
+        snapshots.poll();
+        if (to / snapshotEvery != from / snapshotEvery) captureSnapshot(to);
+    }
+
+    // Ez into a staging slot: a plain buffer copy at full resolution, the
+    // gather shader when decimated. Only fenced here — never waited on.
+    void captureSnapshot(int timestep) {
+        const int stride = snapshotStride;
+        int outX = int(grid::groups(scene.nx, stride));
+        int outY = int(grid::groups(scene.ny, stride));
+
+        snapshot::Header h;
+        h.step        = timestep;
+        h.components  = 1;
+        h.dims[0]     = outX;
+        h.dims[1]     = outY;
+        h.dims[2]     = batch;  // batch scenarios stacked along z
+        h.gridDims[0] = scene.nx;
+        h.gridDims[1] = scene.ny;
+        h.gridDims[2] = batch;
+        h.stride      = stride;
+        size_t bytes  = size_t(outX) * outY * batch * sizeof(float);
+
+        int slot = snapshots.acquire();
+        timers.begin(profile::SNAPSHOT);
+        if (stride == 1) {
+            glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+            glBindBuffer(GL_COPY_READ_BUFFER, ezSSBO);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, snapshots.target(slot));
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+        } else {
+            glUseProgram(snapshotProgram);
+            glUniform1i(loc_snap_nx, scene.nx);
+            glUniform1i(loc_snap_ny, scene.ny);
+            glUniform2i(loc_snap_outDims, outX, outY);
+            glUniform1i(loc_snap_stride, stride);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, snapshot::SNAPSHOT_BINDING,
+                             snapshots.target(slot));
+            glDispatchCompute(grid::groups(outX, 16), grid::groups(outY, 16), batch);
+        }
+        glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+        timers.end(profile::SNAPSHOT);
+        snapshots.submit(slot, h, bytes);
+    }
+
+    // Call after advancing from `from` to `to`, like snapshotAfter: applies
+    // the samples read back since, and starts one whenever a multiple of
+    // statsEvery was crossed
+    void statsAfter(int from, int to) {
+        if (!fieldStats.enabled) return;
+        stats::Reading r;
+        while (fieldStats.next(r)) applyStats(r);
+        if (!halted && to / statsEvery != from / statsEvery) captureStats(to);
+    }
+
+    // The samples still in flight (end of a run)
+    void finishStats() {
+        stats::Reading r;
+        while (fieldStats.next(r, true)) applyStats(r);
+    }
+
+    void applyStats(const stats::Reading& r) {
+        exposure.update(r);
+        if (watchdog.check(r)) halted = true;
+    }
+
+    // Ez / Hx / Hy reduced into a sample slot; fenced, not waited on
+    void captureStats(int timestep) {
+        if (!fieldStats.begin()) return;
+        timers.begin(profile::STATS);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        glUseProgram(statsProgram);
+        glUniform1i(loc_stats_nx, scene.nx);
+        glUniform1i(loc_stats_ny, scene.ny);
+        glUniform1i(loc_stats_layers, batch);
+        int w = useCpml ? cpmlParams.width : SPONGE_WIDTH;
+        glUniform2i(loc_stats_flux_lo, w, w);
+        glUniform2i(loc_stats_flux_hi, scene.nx - w, scene.ny - w);
+        fieldStats.dispatch(scene.cells() * batch);
+        fieldStats.end(timestep);
+        timers.end(profile::STATS);
+    }
+
+    void render() {
+        int winW, winH;
+        glfwGetFramebufferSize(window, &winW, &winH);
+        float aspect = (winH > 0) ? static_cast<float>(winW) / winH : 1.0f;
+
+        timers.begin(profile::RENDER);
+        target::Key fields;
+        int layer = std::clamp(shownLayer, 0, batch - 1);
+        fields.add(fieldsVersion).add(exposure.scale).add(layer);
+        if (fieldImage.stale(scene.nx, scene.ny, fields)) {
+            glUseProgram(renderProgram);
+            glUniform1i(loc_nx, scene.nx);
+            glUniform1i(loc_ny, scene.ny);
+            glUniform1i(loc_layer, layer);
+            glUniform1f(loc_field_scale, exposure.scale);
+            glDispatchCompute((scene.nx + 15) / 16, (scene.ny + 15) / 16, 1);
+        }
+        target::Key view;
+        view.add(fieldImage.key).add(camera.center).add(camera.zoom);
+        if (frameCache.begin(winW, winH, view)) {
+            glBindVertexArray(quadVAO);
+            presenter.draw(fieldImage, aspect, 1.0f, camera.center.x, camera.center.y,
+                           camera.zoom);
+        }
+        frameCache.present();
+        timers.end(profile::RENDER);
+    }
+
+    // Current fields as host floats: Ez, Hx, Hy of nx*ny per layer each
+    std::vector<float> readFields() const {
+        const size_t cells = scene.cells() * batch;
+        std::vector<float> out(3 * cells);
+        GLuint bufs[3] = {ezSSBO, hxSSBO, hySSBO};
+
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        for (int b = 0; b < 3; ++b) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufs[b]);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, cells * sizeof(float),
+                               out.data() + b * cells);
+        }
+        return out;
+    }
+
+    // Host solver over the same parameters, coefficients, CPML profile and
+    // sources (those of batch scenario `layer`) the kernels read. Needs only
+    // useCpml / cpmlParams, batch and the scene, so it also works on an
+    // Engine that was never init()ed (--backend cpu).
+    void initCpuSolver(cpu::Solver2D& solver, int threads, int layer = 0) const {
+        materials::CoeffMap map;
+        materials::build(map, scene.nx, scene.ny, 1, em::DT, em::DX,
+                         [&](int x, int y, int) { return materialAt(x, y); });
+        std::vector<cpml::Coeffs> profile;
+        if (useCpml) profile = cpml::buildProfile(cpmlParams, scene.nx, em::DT, em::DX);
+        int dims[3] = {scene.nx, scene.ny, 1};
+        std::vector<sources::Record> drive;
+        for (sources::Record r : sources::pack(scene.sources, dims, batch, em::DT,
+                                               scene.sourceFreq, scene.sourceAmp))
+            if (r.cell[2] == layer) {
+                r.cell[2] = 0;
+                drive.push_back(r);
+            }
+        solver.init(simParams(), map, useCpml ? cpmlParams.width : 0, profile, drive,
+                    media::plan(scene.media, dims, 1, em::DT), threads);
+    }
+
+    // GPU timer summary, plus the per-frame dump when a path was given
+    void reportTimers(const std::string& path) {
+        if (!timers.enabled) return;
+        timers.finish();
+        timers.printSummary(scene.cells(), bytesPerCellUpdate());
+        if (!path.empty()) timers.dump(path, scene.cells(), bytesPerCellUpdate());
+    }
+
+    // ── Cleanup ─────────────────────────────────────────────────────────────
+
+    void cleanup() {
+        snapshots.cleanup();  // flushes pending snapshots to disk
+        timers.cleanup();
+        memory.release(ezSSBO);
+        memory.release(hxSSBO);
+        memory.release(hySSBO);
+        memory.release(backSSBO, 3);
+        memory.release(materialIdSSBO);
+        voxelizer.cleanup();
+        memory.release(coeffTableSSBO);
+        memory.release(psiSSBO, 2);
+        memory.release(cpmlCoeffSSBO);
+        memory.release(fineSSBO, 3);
+        memory.release(fineMaterialIdSSBO);
+        memory.release(fineCoeffTableSSBO);
+        glDeleteBuffers(1, &fineParamsUBO);
+        memory.release(ringSSBO);
+        sourceTable.cleanup();
+        fineSources.cleanup();
+        mediaState.cleanup();
+        activeTiles.cleanup();
+        fieldStats.cleanup();
+        fieldImage.cleanup();
+        frameCache.cleanup();
+        presenter.cleanup();
+        colormaps.cleanup();
+        glDeleteBuffers(1, &simParamsUBO);
+        glDeleteVertexArrays(1, &quadVAO);
+        glDeleteBuffers(1, &quadVBO);
+        deletePrograms();
+    }
+};
+
+// Scene defaults of this solver, before --scene and the overrides
+inline config::Scene defaultScene() {
+    config::Scene s;
+    s.nx            = DEFAULT_NX;
+    s.ny            = DEFAULT_NY;
+    s.stepsPerFrame = DEFAULT_STEPS_PER_FRAME;
+    s.sourceFreq    = DEFAULT_SOURCE_FREQ;
+    s.sourceAmp     = DEFAULT_SOURCE_AMP;
+    return s;
+}
+
+} // namespace wave2d
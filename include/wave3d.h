@@ -0,0 +1,1902 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "em_common.h"
+#include "shader_utils.h"
+#include "grid.h"
+#include "camera.h"
+#include "cli.h"
+#include "config.h"
+#include "materials.h"
+#include "cpml.h"
+#include "precision.h"
+#include "active_tiles.h"
+#include "gpu_timer.h"
+#include "pacing.h"
+#include "snapshot.h"
+#include "dft.h"
+#include "ntff.h"
+#include "fieldfile.h"
+#include "checkpoint.h"
+#include "cpu_fdtd.h"
+#include "volume.h"
+#include "colormap.h"
+#include "render_target.h"
+#include "arrows.h"
+#include "stats.h"
+#include "sources.h"
+#include "media.h"
+#include "voxelizer.h"
+#include "buffer_pool.h"
+#include "autotune.h"
+
+// The 3D solver: scene defaults, the state the window callbacks share and
+// the Engine, driven by 3D_wave.cpp and fdtd_bench.cpp
+namespace wave3d {
+
+// ── Window ──
+constexpr int WIDTH  = 1280;
+constexpr int HEIGHT = 720;
+
+// ── Scene defaults (--scene / --grid and friends override these) ──
+constexpr int   DEFAULT_NX              = 128;
+constexpr int   DEFAULT_NY              = 128;
+constexpr int   DEFAULT_NZ              = 128;
+constexpr int   DEFAULT_STEPS_PER_FRAME = 1;
+constexpr float DEFAULT_SOURCE_FREQ     = 0.06f;  // normalized (wavelength ~ 17 cells)
+constexpr float DEFAULT_SOURCE_AMP      = 1.0f;
+
+// ── Absorbing boundary ──
+constexpr int   CPML_WIDTH       = 10;    // default: convolutional PML
+constexpr int   SPONGE_WIDTH     = 20;    // fallback: graded conductivity sponge
+constexpr float SPONGE_SIGMA_MAX = 0.4f;
+
+// ── Replay ──
+constexpr double REPLAY_FRAME_TIME = 1.0 / 30.0;  // seconds per recorded frame when playing
+
+// ── Mixed precision ──
+constexpr int NEAR_BOX = 16;  // edge of the fp32 box around the source (even)
+
+// ── State ──
+inline Camera3D      camera;
+inline config::Scene scene;                // grid + source in use (see config.h)
+inline bool          reloadScene = false;  // F5: re-read the scene file
+inline bool replayPlaying   = true;  // --replay: advance one recorded frame per tick
+inline int  replayScrub     = 0;     // Left/Right presses not yet applied
+inline int renderComponent = 2;  // default: Ez
+inline int sliceAxis       = 0;  // default: XY
+inline int sliceIndex      = 0;  // set to the middle of the grid at startup
+inline bool volumeView     = false;  // V: raymarched volume instead of the slice
+inline bool arrowView      = false;  // A: E or H arrows instead of the slice
+inline int  movedObject    = 0;      // Tab: medium the nudge keys move
+inline int  nudge[3]       = {};     // J/L, K/I, U/O: pending move in cells
+
+inline const char* componentNames[] = {"Ex", "Ey", "Ez", "|E|", "Hx", "Hy", "Hz"};
+inline const char* axisNames[]      = {"XY", "XZ", "YZ"};
+
+inline int getSliceMax() {
+    if (sliceAxis == 0) return scene.nz - 1;
+    if (sliceAxis == 1) return scene.ny - 1;
+    return scene.nx - 1;
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Engine — owns all OpenGL state, following kavan010/black_hole architecture
+// ─────────────────────────────────────────────────────────────────────────────
+struct Engine {
+    GLFWwindow* window = nullptr;
+
+    // Programs: one maxwell3d.comp variant per pass (UPDATE_STEP 0 = H,
+    // 1 = E) and one slice3d.comp variant per render component, built on
+    // first use
+    GLuint computeProgram[2]  = {};
+    GLuint renderPrograms[7]  = {};
+    int    workgroup[3]       = {8, 8, 8};  // two-pass local size (active tile: x * cellsX)
+    bool   specialized        = true;       // grid dims compiled in (off after a live resize)
+    int    marchZ             = 1;          // cells per invocation along z (MARCH_Z)
+    bool   tiledStencil       = false;      // neighbour field staged in shared memory
+
+    // Field SSBOs — storage variant fixed at startup (see shaders/fields3d.glsl)
+    grid::FieldLayout fieldLayout  = grid::LAYOUT_SOA;
+    grid::FieldIndex  fieldIndex   = grid::INDEX_LINEAR;
+    grid::FieldPrecision fieldPrecision = grid::PRECISION_FP32;
+    int               fieldBuffers = 6;     // 6 (SoA) or 2 (packed)
+    size_t            fieldCells   = 0;     // per buffer, incl. brick padding
+    int               cellsX       = 1;     // x-cells per invocation (CELLS_X)
+    GLuint ssbo[6] = {};  // SoA: Ex, Ey, Ez, Hx, Hy, Hz — packed: E, H
+
+    // Mixed precision: fp32 E/H (vec4 per cell) for the box around the source
+    int    nearOrigin[3] = {};
+    GLuint nearSSBO[2]   = {};  // bindings 16, 17
+
+    // Fused H+E dispatch (one leapfrog step per dispatch, ping-pong buffers)
+    bool   fused        = false;
+    GLuint fusedProgram = 0;
+    GLuint backSSBO[6]  = {};  // next-step targets at bindings 6..11
+
+    // Update coefficients: 16-bit material ID per cell, painted from the
+    // scene's media on the GPU (voxelizer.h), + coefficient table
+    materials::CoeffMap coeffMap;
+    voxel::Voxelizer    voxelizer;
+    GLuint materialIdSSBO = 0;  // binding 12
+    GLuint coeffTableSSBO = 0;  // binding 13
+
+    // CPML boundary: psi stored only in the x/y/z slab pairs
+    bool         useCpml       = true;
+    cpml::Params cpmlParams;
+    GLuint       cpmlProgram   = 0;
+    GLuint       psiSSBO[3]    = {};  // x-, y-, z-slab pairs (vec4 per cell)
+    GLuint       cpmlCoeffSSBO = 0;
+
+    // Active tiles: two-pass kernels dispatched only where the wave has reached
+    tiles::ActiveSet activeTiles;
+    GLuint activeProgram[2] = {};  // maxwell3d.comp built with ACTIVE_TILES, H and E
+    int    cpmlReach     = 0;  // cells from the source to the nearest CPML slab
+
+    // Source table (sources.h) at bindings 29/30
+    std::vector<sources::Record> sourceRecords;
+    sources::Table sourceTable;
+
+    // Dispersive media (media.h): the ADE pass over their cells at bindings
+    // 31..33 after each E pass (fp32 storage)
+    media::Plan    mediaPlan;
+    media::Buffers mediaState;
+    GLuint         mediaProgram = 0;
+
+    // UBO
+    GLuint simParamsUBO = 0;
+
+    // Device memory (buffer_pool.h): the grid-sized buffers, zeroed on the
+    // GPU; a new grid is planned against the free memory first
+    vram::Pool memory;
+    size_t     vramFree = 0;  // bytes, 0 = unknown
+
+    // GPU timer queries per pass (--gpu-timers / --profile-out)
+    profile::GpuTimers timers;
+
+    // Six-component snapshots to disk every snapshotEvery steps (0 = off)
+    snapshot::Ring snapshots;
+    int         snapshotEvery   = 0;
+    int         snapshotStride  = 1;
+    bool        snapshotSlice   = false;  // displayed slice plane only
+    std::string snapshotDir;
+    GLuint      snapshotProgram = 0;      // gather through the storage variant
+
+    // Snapshots recorded into one chunked file instead (--record)
+    fieldfile::Writer recorder;
+    std::string       recordPath;
+    int               recordCodec = fieldfile::LOSSLESS;
+    float             recordError = 0.0f;
+
+    // Solver state saved through its own staging ring every checkpointEvery
+    // steps (0 = off); the writer thread reads checkpointHeader
+    snapshot::Ring     checkpoints;
+    int                checkpointEvery = 0;
+    std::string        checkpointPath;
+    checkpoint::Header checkpointHeader;
+
+    // Running DFT over the probe boxes after every step (none = off); the
+    // frequencies default to the source frequency
+    dft::Probes           probes;
+    std::vector<dft::Box> dftBoxes;
+    std::vector<float>    dftFreqs;
+    GLuint                dftProgram = 0;
+
+    // Far-field pattern from a Huygens box recorded as six more probe faces,
+    // transformed every ntffEvery steps and at the end of the run
+    ntff::Transform farField;
+    bool            ntffOn      = false;
+    int             ntffBox[6]  = {};  // all 0 = inset from the absorbing layer
+    int             ntffDirs[2] = {};
+    int             ntffEvery   = 0;
+    std::string     ntffPath;
+    GLuint          ntffProgram = 0;
+
+    // Volume view (volume.h): the E pass of a frame's last step also writes
+    // the mirror texture, through a variant per kernel path and component
+    enum MirrorPath { MIRROR_TWO_PASS, MIRROR_ACTIVE, MIRROR_FUSED };
+    volume::Mirror mirror;
+    volume::Kernel mirrorKernels[3][7];
+    int            mirrorComponent = -1;  // set per frame by the window loop (-1 = off)
+
+    // Vector view (arrows.h): E or H arrows, culled and compacted on the GPU
+    // when the fields or the camera changed
+    arrows::Field  arrowField;
+    arrows::Kernel arrowKernels[2];  // E, H
+    int            arrowStride = arrows::DEFAULT_STRIDE;
+    float          arrowMin    = arrows::DEFAULT_MIN;
+    bool           showArrows  = false;  // set per frame by the window loop
+
+    // Field statistics every statsEvery steps (stats.h; 0 = off), read back
+    // a few frames late: they set the colour scale of the views and feed
+    // the watchdog, which halts the run once the fields diverge
+    stats::Reduction fieldStats;
+    stats::Exposure  exposure;
+    stats::Watchdog  watchdog;
+    int              statsEvery   = 0;
+    GLuint           statsProgram = 0;
+    bool             halted       = false;
+
+    // Fullscreen quad
+    GLuint quadVAO = 0;
+    GLuint quadVBO = 0;
+
+    // Cached render path (render_target.h): the slice is recoloured only
+    // after the fields, the slice or the component changed, the frame (slice
+    // or volume view) redrawn only when those, the camera or the window did
+    // (windowed runs only)
+    target::Image     fieldImage;
+    target::Frame     frameCache;
+    target::Presenter presenter;
+    colormap::Maps    colormaps;
+    uint64_t          fieldsVersion = 0;  // bumped whenever the fields change
+
+    // Cached uniform locations — render program
+    GLint loc_nx               = -1;
+    GLint loc_ny               = -1;
+    GLint loc_nz               = -1;
+    GLint loc_field_scale      = -1;
+    GLint loc_slice_axis       = -1;
+    GLint loc_slice_index      = -1;
+    GLint loc_near_origin[3]   = {-1, -1, -1};
+
+    // Cached uniform locations — compute programs (H, E)
+    GLint loc_stepBase[2] = {-1, -1};
+
+    // Cached uniform locations — active-tile compute programs (H, E)
+    GLint loc_active_stepBase[2] = {-1, -1};
+
+    // Cached uniform locations — CPML program
+    GLint loc_cpml_updateStep = -1;
+    GLint loc_cpml_slabAxis   = -1;
+    GLint loc_cpml_pmlWidth   = -1;
+
+    // Cached uniform locations — fused compute program
+    GLint loc_fused_stepBase = -1;
+
+    // Cached uniform locations — snapshot gather program
+    GLint loc_snap_origin   = -1;
+    GLint loc_snap_cellStep = -1;
+    GLint loc_snap_outDims  = -1;
+
+    // Cached uniform locations — statistics program
+    GLint loc_stats_nx           = -1;
+    GLint loc_stats_ny           = -1;
+    GLint loc_stats_nz           = -1;
+    GLint loc_stats_near_origin[3] = {-1, -1, -1};
+    GLint loc_stats_flux_lo      = -1;
+    GLint loc_stats_flux_hi      = -1;
+
+    // Cached uniform locations — dispersive media program
+    GLint loc_media_nx           = -1;
+    GLint loc_media_ny           = -1;
+    GLint loc_media_cell_count   = -1;
+    GLint loc_media_state_floats = -1;
+    GLint loc_media_cb_scale     = -1;
+
+    // ── Initialisation ──────────────────────────────────────────────────────
+
+    void init(const cli::RunOptions& opts) {
+        fused            = opts.fusedSteps > 0;
+        if (fused && media::anyDispersive(scene.media)) {
+            std::cout << "Dispersive media need the two-pass kernels; ignoring --fused\n";
+            fused = false;
+        }
+        useCpml          = opts.cpml;
+        cpmlParams.width = CPML_WIDTH;
+        fieldLayout      = opts.fieldLayout;
+        fieldIndex       = opts.fieldIndex;
+        fieldPrecision   = opts.precision;
+        fieldBuffers     = (fieldLayout == grid::LAYOUT_PACKED) ? 2 : 6;
+
+        // fp16 SoA packs x-neighbour pairs into one word, owned by one invocation
+        bool halfPairs = fieldPrecision != grid::PRECISION_FP32 &&
+                         fieldLayout == grid::LAYOUT_SOA;
+        cellsX = halfPairs ? 2 : 1;
+        if (halfPairs && (!gridFits(scene) || CPML_WIDTH % 2 != 0)) {
+            std::cerr << "fp16 SoA storage needs an even nx and CPML width\n";
+            exit(EXIT_FAILURE);
+        }
+        if (!mediaFit(scene)) {
+            std::cerr << "Dispersive media need fp32 field storage (--precision fp32)\n";
+            exit(EXIT_FAILURE);
+        }
+
+        bool trackTiles = opts.activeTiles && !fused;
+        timers.enabled  = opts.gpuTimers;
+        snapshotEvery   = opts.snapshotEvery;
+        snapshotStride  = opts.snapshotStride;
+        snapshotSlice   = opts.snapshotSlice;
+        snapshotDir     = opts.snapshotDir;
+        recordPath      = opts.recordPath;
+        recordCodec     = opts.recordCodec;
+        recordError     = opts.recordError;
+        checkpointPath  = opts.checkpointPath;
+        checkpointEvery = checkpointPath.empty() ? 0 : opts.checkpointEvery;
+        arrowStride     = opts.arrowStride;
+        arrowMin        = opts.arrowMin;
+        statsEvery      = opts.statsEvery;
+        exposure.automatic = opts.exposure == 0.0f;
+        if (!exposure.automatic) exposure.scale = opts.exposure;
+        watchdog.growth = opts.watchdogGrowth;
+        dftBoxes        = opts.dftProbes;
+        dftFreqs        = opts.dftFreqs;
+        ntffOn          = opts.ntff;
+        ntffEvery       = opts.ntffEvery;
+        ntffPath        = opts.ntffPath;
+        std::copy(opts.ntffBox, opts.ntffBox + 6, ntffBox);
+        std::copy(opts.ntffDirs, opts.ntffDirs + 2, ntffDirs);
+        if (opts.workgroup[0] > 0) {
+            workgroup[0] = opts.workgroup[0];
+            workgroup[1] = opts.workgroup[1];
+            workgroup[2] = std::max(opts.workgroup[2], 1);
+            marchZ       = opts.marchZ;
+            tiledStencil = opts.tiledStencil;
+        }
+
+        initWindow(opts.headless);
+        planMemory(opts);
+        shader::binaryCache().dir = opts.shaderCache;
+        bool timeShapes = loadShape(opts);
+        initShaders(trackTiles);
+        if (statsEvery > 0) {
+            fieldStats.every = statsEvery;
+            fieldStats.init();
+        }
+        initGrid();
+        if (timeShapes) autotuneShape(opts.shaderCache);
+        memory.printSummary();
+        initQuad();
+        if (!opts.headless) initRender();
+        cacheUniformLocations();
+    }
+
+    // ── Launch shape autotuning ──
+
+    // Grid and storage variant a tuned shape is stored under
+    std::string tuneVariant() const {
+        const char* layoutNames[]    = {"soa", "packed"};
+        const char* indexNames[]     = {"linear", "brick", "morton"};
+        const char* precisionNames[] = {"fp32", "fp16", "mixed"};
+        return "3D " + std::to_string(scene.nx) + "x" + std::to_string(scene.ny) + "x" +
+               std::to_string(scene.nz) + " " + layoutNames[fieldLayout] + " " +
+               indexNames[fieldIndex] + " " + precisionNames[fieldPrecision] +
+               (useCpml ? " cpml" : " sponge");
+    }
+
+    // Milliseconds per step of the dense H and E passes at shape `s`, on the
+    // live buffers (CPML and media passes cost the same at every shape)
+    double timeShape(const autotune::Shape& s) {
+        std::string kernel = fieldDefines() + gridDefines() + sources::defines(sources::BIN_3D) +
+                             shapeDefines(s);
+        GLuint program[2];
+        GLint  loc[2];
+        for (int pass = 0; pass < 2; ++pass) {
+            program[pass] = shader::createComputeProgram("shaders/maxwell3d.comp",
+                                                         kernel + passDefines(pass));
+            loc[pass] = glGetUniformLocation(program[pass], "stepBase");
+        }
+        GLuint gx = grid::groups(scene.nx / cellsX, s.wg[0]);
+        GLuint gy = grid::groups(scene.ny, s.wg[1]);
+        GLuint gz = grid::groups(scene.nz, s.wg[2] * s.march);
+        int step = 0;
+        double ms = autotune::msPerStep([&](int steps) {
+            for (int i = 0; i < steps; ++i, ++step)
+                for (int pass = 0; pass < 2; ++pass) {
+                    glUseProgram(program[pass]);
+                    glUniform1i(loc[pass], step);
+                    glDispatchCompute(gx, gy, gz);
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                }
+        });
+        for (GLuint p : program) glDeleteProgram(p);
+        return ms;
+    }
+
+    void setLaunchShape(const autotune::Shape& s) {
+        std::copy(s.wg, s.wg + 3, workgroup);
+        marchZ       = s.march;
+        tiledStencil = s.tiled;
+    }
+
+    // Without --workgroup: the shape stored for this GPU, driver and variant,
+    // applied before any program is built; true when there is none and the
+    // candidates are to be timed once the grid is up.
+    bool loadShape(const cli::RunOptions& opts) {
+        if (fused || opts.workgroup[0] > 0 || !opts.autotune) return false;
+        std::string     variant = tuneVariant();
+        autotune::Shape stored;
+        if (!opts.retune && autotune::Cache(opts.shaderCache).lookup(variant, true, stored) &&
+            autotune::launchable(stored, cellsX)) {
+            setLaunchShape(stored);
+            std::cout << "Autotune: " << stored.name(true) << " (stored for " << variant << ")\n";
+            return false;
+        }
+        return true;
+    }
+
+    // The fastest launchable candidate, stored under `cacheDir`, replaces
+    // the default programs. The trials stepped the live fields, so they
+    // start over from zero.
+    void autotuneShape(const std::string& cacheDir) {
+        std::string variant = tuneVariant();
+        std::vector<autotune::Shape> candidates;
+        for (const autotune::Shape& c : autotune::candidates3d())
+            if (autotune::launchable(c, cellsX)) candidates.push_back(c);
+        auto trial = [&](const autotune::Shape& c) { return timeShape(c); };
+        autotune::Shape best = autotune::pick(candidates, true, variant, trial);
+        autotune::Cache(cacheDir).store(variant, best, true);
+        for (int i = 0; i < fieldBuffers; ++i) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo[i]);
+            vram::clear(GL_SHADER_STORAGE_BUFFER);
+        }
+        for (GLuint b : nearSSBO)
+            if (b) {
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, b);
+                vram::clear(GL_SHADER_STORAGE_BUFFER);
+            }
+        if (best == launchShape()) return;
+
+        setLaunchShape(best);
+        bool trackTiles = activeProgram[0] != 0;
+        for (GLuint& p : computeProgram) { glDeleteProgram(p); p = 0; }
+        for (GLuint& p : activeProgram) { glDeleteProgram(p); p = 0; }
+        initTwoPassShaders(trackTiles);
+        if (trackTiles) initActiveTiles();
+    }
+
+    // ── Memory plan ──
+
+    static std::string gridName(const config::Scene& s) {
+        return std::to_string(s.nx) + "x" + std::to_string(s.ny) + "x" + std::to_string(s.nz);
+    }
+
+    // Bytes the grid-sized buffers of `s` take under the current settings,
+    // before any is allocated (tables, tiles, the sparse media state and the
+    // views toggled later are small or optional and left out)
+    vram::Budget footprint(const config::Scene& s) const {
+        vram::Budget b;
+        size_t plane  = size_t(s.nx) * s.ny;
+        size_t cells  = grid::fieldCells3d(fieldIndex, s.nx, s.ny, s.nz);
+        size_t state = fieldBuffers * cells * fieldBytesPerCell();
+        if (fieldPrecision == grid::PRECISION_MIXED) state += 2 * nearBytes();
+        b.bytes[vram::FIELDS] = state + (fused ? fieldBuffers * cells * fieldBytesPerCell() : 0);
+        b.bytes[vram::COEFFS] = materials::CoeffMap::idBytes(cells);
+        if (useCpml) {
+            size_t w = 2 * cpmlParams.width;
+            b.bytes[vram::BOUNDARY] =
+                w * ((size_t(s.nx) + s.ny) * s.nz + plane) * 4 * sizeof(float);
+            state += b.bytes[vram::BOUNDARY];
+        }
+        if (!dftBoxes.empty() || ntffOn) {
+            size_t boxCells = 0;
+            for (const dft::Box& box : dftBoxes) boxCells += box.cells();
+            if (ntffOn)
+                for (const dft::Box& f : ntff::faces(huygensBox(s))) boxCells += f.cells();
+            size_t freqs = std::max(dftFreqs.size(), size_t(1));
+            b.bytes[vram::PROBES] = freqs * boxCells * dft::VEC4_PER_CELL * 4 * sizeof(float);
+            state += b.bytes[vram::PROBES];
+        }
+        if (snapshotEvery > 0) {
+            size_t o[3] = {grid::groups(s.nx, snapshotStride), grid::groups(s.ny, snapshotStride),
+                           grid::groups(s.nz, snapshotStride)};
+            size_t snap = snapshotSlice ? std::max({o[0] * o[1], o[0] * o[2], o[1] * o[2]})
+                                        : o[0] * o[1] * o[2];
+            b.bytes[vram::STAGING] += snapshot::RING_SLOTS * 6 * snap * sizeof(float);
+        }
+        if (checkpointEvery > 0) b.bytes[vram::STAGING] += snapshot::RING_SLOTS * state;
+        return b;
+    }
+
+    // The scene's plan against the free memory: an oversized grid stops
+    // here, or with --fit-vram shrinks (same aspect) to the largest that fits
+    void planMemory(const cli::RunOptions& opts) {
+        vramFree = vram::availableBytes(opts.vramMB);
+        vram::Budget plan = footprint(scene);
+        if (!plan.fits(vramFree)) {
+            plan.print(gridName(scene), vramFree);
+            if (!opts.fitVram) {
+                std::cerr << "Grid " << gridName(scene) << " needs more than "
+                          << 100.0 * vram::HEADROOM << " % of the free GPU memory; use a "
+                          << "smaller --grid or --fit-vram\n";
+                exit(EXIT_FAILURE);
+            }
+            config::Scene fitted = scene;
+            auto scaled = [&](double k) {
+                fitted.nx = std::max(int(scene.nx * k) & ~(cellsX - 1), 1);  // fp16 pairs
+                fitted.ny = std::max(int(scene.ny * k), 1);
+                fitted.nz = std::max(int(scene.nz * k), 1);
+                return footprint(fitted);
+            };
+            scaled(vram::fitScale(vramFree, scaled));
+            int boundary = useCpml ? cpmlParams.width : 0;
+            std::cout << "Memory: shrinking the grid to " << gridName(fitted) << "\n";
+            if (!config::validate(fitted, boundary, true)) exit(EXIT_FAILURE);
+            scene      = fitted;
+            plan       = footprint(scene);
+            sliceIndex = scene.nz / 2;
+        }
+        plan.print(gridName(scene), vramFree);
+    }
+
+    void initRender() {
+        colormaps.init();
+        presenter.init();
+    }
+
+    // fp16 SoA pairs need an even nx; everything else takes any size
+    bool gridFits(const config::Scene& s) const {
+        return cellsX == 1 || s.nx % 2 == 0;
+    }
+
+    // The ADE pass reads and writes E in fp32 only
+    bool mediaFit(const config::Scene& s) const {
+        return fieldPrecision == grid::PRECISION_FP32 || !media::anyDispersive(s.media);
+    }
+
+    // Source records of scene `s`, global cells
+    static std::vector<sources::Record> sourcesOf(const config::Scene& s) {
+        int dims[3] = {s.nx, s.ny, s.nz};
+        return sources::pack(s.sources, dims, 1, em::DT_3D, s.sourceFreq, s.sourceAmp);
+    }
+
+    // Every probe box inside the grid, and the Huygens box (if any) between
+    // the absorbing layer and every source
+    bool probesFit(const config::Scene& s) const {
+        int dims[3] = {s.nx, s.ny, s.nz};
+        for (const dft::Box& b : dftBoxes)
+            for (int a = 0; a < 3; ++a)
+                if (b.lo[a] < 0 || b.hi[a] >= dims[a]) return false;
+        if (!ntffOn) return true;
+        dft::Box h    = huygensBox(s);
+        int      edge = absorberWidth();
+        for (int a = 0; a < 3; ++a)
+            if (h.lo[a] - 1 < edge || h.hi[a] >= dims[a] - edge) return false;
+        for (const sources::Record& r : sourcesOf(s))
+            for (int a = 0; a < 3; ++a)
+                if (r.cell[a] <= h.lo[a] || r.cell[a] >= h.hi[a]) return false;
+        return true;
+    }
+
+    int absorberWidth() const { return useCpml ? CPML_WIDTH : SPONGE_WIDTH; }
+
+    // --ntff-box, or the grid inset MARGIN cells past the absorbing layer
+    dft::Box huygensBox(const config::Scene& s) const {
+        dft::Box b;
+        int  dims[3] = {s.nx, s.ny, s.nz};
+        bool given   = ntffBox[3] > 0;
+        for (int a = 0; a < 3; ++a) {
+            b.lo[a] = given ? ntffBox[a] : absorberWidth() + ntff::MARGIN;
+            b.hi[a] = given ? ntffBox[3 + a] : dims[a] - 1 - absorberWidth() - ntff::MARGIN;
+        }
+        return b;
+    }
+
+    // Everything sized by the grid. Buffers are (re)allocated in place, so
+    // this also serves a live resize. The field programs have the size
+    // compiled in until the first one and read it from the UBO after that;
+    // the near box origin is always a uniform.
+    void initGrid() {
+        fieldCells = grid::fieldCells3d(fieldIndex, scene.nx, scene.ny, scene.nz);
+
+        // The near box stays at the centre, where the default source is
+        int source[3] = {scene.nx / 2, scene.ny / 2, scene.nz / 2};
+        int dims[3]   = {scene.nx, scene.ny, scene.nz};
+        for (int a = 0; a < 3; ++a)  // even-aligned so a pair never straddles the box
+            nearOrigin[a] = std::clamp((source[a] - NEAR_BOX / 2) & ~1, 0,
+                                       std::max(dims[a] - NEAR_BOX, 0));
+
+        initBuffers();
+        initMaterials();
+        if (useCpml) initCpml();
+        initSources();
+        initMedia();
+        if (activeProgram[0]) initActiveTiles();
+        if (snapshotEvery > 0) initSnapshots();
+        if (dftProgram) initProbes();
+        if (mirror.enabled) initMirror();
+        if (arrowField.enabled) initArrows();
+        if (checkpointEvery > 0) initCheckpoints();
+        uploadSimParams();
+        ++fieldsVersion;
+    }
+
+    // Live scene change. A new grid size reallocates and restarts from zero
+    // fields (returns true); source changes only update the UBO, new media
+    // rebuild the coefficients and restart their pole state.
+    bool applyScene(const config::Scene& next) {
+        if (!gridFits(next)) {
+            std::cerr << "Scene: fp16 SoA storage needs an even nx, keeping "
+                      << scene.nx << "x" << scene.ny << "x" << scene.nz << "\n";
+            return false;
+        }
+        if (!probesFit(next)) {
+            std::cerr << "Scene: a DFT probe or the Huygens box would not fit, keeping "
+                      << scene.nx << "x" << scene.ny << "x" << scene.nz << "\n";
+            return false;
+        }
+        if (!mediaFit(next) || (fused && media::anyDispersive(next.media))) {
+            std::cerr << "Scene: dispersive media need fp32 storage and the two-pass kernels, "
+                         "keeping the current scene\n";
+            return false;
+        }
+        bool regrid   = !next.sameGrid(scene);
+        bool newMedia = !next.sameMedia(scene);
+        if (regrid && !footprint(next).fits(vramFree)) {
+            footprint(next).print(gridName(next), vramFree);
+            std::cerr << "Scene: the new grid does not fit the free GPU memory; keeping the "
+                         "current scene\n";
+            return false;
+        }
+        scene = next;
+        if (!regrid) {
+            uploadSimParams();
+            initSources();
+            if (newMedia) {
+                initMaterials();
+                initMedia();
+                ++fieldsVersion;
+            }
+            if (checkpoints.enabled) {  // new source parameters; drain the writer first
+                checkpoints.finish();
+                initCheckpoints();
+            }
+            return false;
+        }
+        std::cout << "Scene: resizing to " << scene.nx << "x" << scene.ny << "x"
+                  << scene.nz << "\n";
+        // The first resize swaps the size-specialized programs for a set that
+        // reads the size from the UBO; later ones keep the compiled programs
+        if (specialized) {
+            specialized     = false;
+            bool trackTiles = activeProgram[0] != 0;
+            deletePrograms();
+            initShaders(trackTiles);
+        }
+        initGrid();
+        cacheUniformLocations();
+        sliceIndex = std::min(sliceIndex, getSliceMax());
+        return true;
+    }
+
+    void initWindow(bool headless) {
+        if (!glfwInit()) {
+            std::cerr << "Failed to initialise GLFW\n";
+            exit(EXIT_FAILURE);
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        if (headless)
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);  // offscreen context only
+
+        window = glfwCreateWindow(WIDTH, HEIGHT, "EM Wave - 3D FDTD", nullptr, nullptr);
+        if (!window) {
+            std::cerr << "Failed to create GLFW window\n";
+            glfwTerminate();
+            exit(EXIT_FAILURE);
+        }
+        glfwMakeContextCurrent(window);
+        glfwSwapInterval(headless ? 0 : 1);  // vsync only when presenting
+
+        glewExperimental = GL_TRUE;
+        if (glewInit() != GLEW_OK) {
+            std::cerr << "Failed to initialise GLEW\n";
+            exit(EXIT_FAILURE);
+        }
+
+        std::cout << "OpenGL " << glGetString(GL_VERSION) << "\n";
+        std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+    }
+
+    // #defines selecting the field storage variant in every field shader
+    std::string fieldDefines() const {
+        std::string d = "#define FIELD_LAYOUT "    + std::to_string(int(fieldLayout))    + "\n"
+                      + "#define FIELD_INDEX "     + std::to_string(int(fieldIndex))     + "\n"
+                      + "#define FIELD_PRECISION " + std::to_string(int(fieldPrecision)) + "\n";
+        if (fieldPrecision == grid::PRECISION_MIXED)
+            d += "#define FIELD_NEAR_N " + std::to_string(NEAR_BOX) + "\n";
+        return d;
+    }
+
+    // One fp32 E or H (vec4 per cell) buffer of the mixed-precision near box
+    static size_t nearBytes() { return size_t(NEAR_BOX) * NEAR_BOX * NEAR_BOX * 4 * sizeof(float); }
+
+    // Bytes per cell in one field buffer: fp32/fp16 scalar (SoA) or 4-lane (packed)
+    size_t fieldBytesPerCell() const {
+        size_t lanes = (fieldLayout == grid::LAYOUT_PACKED) ? 4 : 1;
+        return lanes * (fieldPrecision == grid::PRECISION_FP32 ? 4 : 2);
+    }
+
+    // Launch shape of the two-pass kernel as WG_X / WG_Y / WG_Z, MARCH_Z and
+    // TILED_STENCIL #defines
+    static std::string shapeDefines(const autotune::Shape& s) {
+        std::string d = "#define WG_X " + std::to_string(s.wg[0]) + "\n"
+                      + "#define WG_Y " + std::to_string(s.wg[1]) + "\n"
+                      + "#define WG_Z " + std::to_string(s.wg[2]) + "\n";
+        if (s.march > 1) d += "#define MARCH_Z " + std::to_string(s.march) + "\n";
+        if (s.tiled) d += "#define TILED_STENCIL\n";
+        return d;
+    }
+
+    autotune::Shape launchShape() const {
+        autotune::Shape s;
+        std::copy(workgroup, workgroup + 3, s.wg);
+        s.march = marchZ;
+        s.tiled = tiledStencil;
+        return s;
+    }
+
+    std::string workgroupDefines() const { return shapeDefines(launchShape()); }
+
+    // Grid dims (and the CPML width) compiled into the field kernels
+    // (shaders/specialize.glsl). None once a live resize has switched to the
+    // programs that take the size from the UBO.
+    std::string gridDefines() const {
+        if (!specialized) return "";
+        return "#define GRID_NX " + std::to_string(scene.nx) + "\n"
+             + "#define GRID_NY " + std::to_string(scene.ny) + "\n"
+             + "#define GRID_NZ " + std::to_string(scene.nz) + "\n";
+    }
+
+    static std::string passDefines(int pass) {
+        return "#define UPDATE_STEP " + std::to_string(pass) + "\n";
+    }
+
+    // Two-pass H / E programs at the current launch shape
+    void initTwoPassShaders(bool trackTiles) {
+        std::string kernel = fieldDefines() + gridDefines() + sources::defines(sources::BIN_3D);
+        std::string wg     = workgroupDefines();
+        for (int pass = 0; pass < 2; ++pass) {
+            computeProgram[pass] = shader::createComputeProgram(
+                "shaders/maxwell3d.comp", kernel + wg + passDefines(pass));
+            if (trackTiles)
+                activeProgram[pass] = shader::createComputeProgram(
+                    "shaders/maxwell3d.comp", kernel + wg + passDefines(pass) +
+                                                  "#define ACTIVE_TILES\n" +
+                                                  tiles::defines(18, 19));
+        }
+    }
+
+    void initShaders(bool trackTiles) {
+        std::string defines = fieldDefines();
+        std::string kernel  = defines + gridDefines() + sources::defines(sources::BIN_3D);
+
+        initTwoPassShaders(trackTiles);
+        renderProgramFor(renderComponent);
+        if (fused)
+            fusedProgram = shader::createComputeProgram("shaders/maxwell3d_fused.comp", kernel);
+        if (useCpml)
+            cpmlProgram = shader::createComputeProgram(
+                "shaders/cpml3d.comp",
+                kernel + "#define PML_WIDTH " + std::to_string(cpmlParams.width) + "\n");
+        if (snapshotEvery > 0)
+            snapshotProgram = shader::createComputeProgram("shaders/snapshot3d.comp",
+                                                           defines + snapshot::defines());
+        if (!dftBoxes.empty() || ntffOn)
+            dftProgram = shader::createComputeProgram("shaders/dft3d.comp",
+                                                      defines + dft::defines());
+        if (ntffOn)
+            ntffProgram = shader::createComputeProgram("shaders/ntff3d.comp",
+                                                       dft::defines() + ntff::defines());
+        if (statsEvery > 0)
+            statsProgram = shader::createComputeProgram("shaders/stats3d.comp",
+                                                        defines + stats::defines());
+        shader::printCacheStats();
+    }
+
+    // Slice colouring specialized to one render component (cached binaries
+    // make a switch cheap); all variants share their uniform locations
+    GLuint renderProgramFor(int component) {
+        GLuint& program = renderPrograms[component];
+        if (!program)
+            program = shader::createComputeProgram(
+                "shaders/slice3d.comp",
+                fieldDefines() + colormap::defines() + target::defines() +
+                    "#define RENDER_COMPONENT " + std::to_string(component) + "\n");
+        return program;
+    }
+
+    // E-pass variant of `path` that also writes the mirror of the
+    // displayed component, built on first use
+    const volume::Kernel& mirrorKernel(MirrorPath path) {
+        volume::Kernel& k = mirrorKernels[path][mirrorComponent];
+        if (k.program) return k;
+        std::string d = fieldDefines() + gridDefines() + sources::defines(sources::BIN_3D) +
+                        volume::defines(mirrorComponent);
+        if (path == MIRROR_FUSED) {
+            k.init(shader::createComputeProgram("shaders/maxwell3d_fused.comp", d));
+        } else {
+            d += workgroupDefines() + passDefines(1);
+            if (path == MIRROR_ACTIVE) d += "#define ACTIVE_TILES\n" + tiles::defines(18, 19);
+            k.init(shader::createComputeProgram("shaders/maxwell3d.comp", d));
+        }
+        return k;
+    }
+
+    void initMirror() {
+        int dims[3] = {scene.nx, scene.ny, scene.nz};
+        mirror.init(dims);
+        memory.track(mirror.occupancySSBO, vram::VIEW);
+    }
+
+    // Cull pass of the vector view for E (field 0) or H (1), built on first use
+    const arrows::Kernel& arrowKernel(int field) {
+        arrows::Kernel& k = arrowKernels[field];
+        if (!k.program)
+            k.init(shader::createComputeProgram("shaders/arrows3d.comp",
+                                                fieldDefines() + arrows::defines(field)));
+        return k;
+    }
+
+    void initArrows() {
+        int dims[3] = {scene.nx, scene.ny, scene.nz};
+        arrowField.init(dims, arrowStride, arrowMin);
+        memory.track(arrowField.instanceSSBO, vram::VIEW);
+    }
+
+    void deletePrograms() {
+        for (int pass = 0; pass < 2; ++pass) {
+            glDeleteProgram(computeProgram[pass]);
+            glDeleteProgram(activeProgram[pass]);
+            computeProgram[pass] = activeProgram[pass] = 0;
+        }
+        for (GLuint& p : renderPrograms) {
+            glDeleteProgram(p);
+            p = 0;
+        }
+        for (auto& path : mirrorKernels)
+            for (volume::Kernel& k : path) k.cleanup();
+        for (arrows::Kernel& k : arrowKernels) k.cleanup();
+        for (GLuint* p : {&fusedProgram, &cpmlProgram, &snapshotProgram, &dftProgram,
+                          &ntffProgram, &statsProgram, &mediaProgram}) {
+            glDeleteProgram(*p);
+            *p = 0;
+        }
+    }
+
+    void initBuffers() {
+        const char* layoutNames[]    = {"SoA", "packed vec4"};
+        const char* indexNames[]     = {"linear", "8^3 bricks", "8^3 Morton bricks"};
+        const char* precisionNames[] = {"fp32", "fp16", "fp16 + fp32 near source"};
+
+        // Zero bits are 0.0 in both fp32 and fp16
+        size_t bytesPerBuffer = fieldCells * fieldBytesPerCell();
+
+        for (int i = 0; i < fieldBuffers; ++i) {
+            memory.alloc(ssbo[i], bytesPerBuffer, vram::FIELDS);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, ssbo[i]);
+        }
+
+        if (fieldPrecision == grid::PRECISION_MIXED) {
+            for (int i = 0; i < 2; ++i) {
+                memory.alloc(nearSSBO[i], nearBytes(), vram::FIELDS);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 16 + i, nearSSBO[i]);
+            }
+        }
+
+        // Fused kernel writes the next step into a second set at bindings 6..
+        if (fused) {
+            for (int i = 0; i < fieldBuffers; ++i) {
+                memory.alloc(backSSBO[i], bytesPerBuffer, vram::FIELDS);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6 + i, backSSBO[i]);
+            }
+        }
+
+        double fieldMB = fieldBuffers * bytesPerBuffer / (1024.0 * 1024.0);
+        std::cout << "Fields: " << layoutNames[fieldLayout] << ", "
+                  << indexNames[fieldIndex] << ", " << precisionNames[fieldPrecision]
+                  << ", " << fieldMB << " MB"
+                  << (fused ? " (x2 ping-pong)" : "") << "\n";
+
+        // SimParams3D UBO at binding 0
+        if (!simParamsUBO) glGenBuffers(1, &simParamsUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, simParamsUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(SimParams3D), nullptr,
+                     GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, simParamsUBO);
+    }
+
+    // Material of medium `r` (null: vacuum) plus the sponge loss at depth
+    // indices (a, b, c) from the faces (materials::spongeIndex)
+    materials::Material materialOf(const media::Region* r, int a, int b, int c) const {
+        materials::Material m = media::materialOf(r);
+        if (useCpml) return m;  // CPML absorbs in the correction pass instead
+
+        float sigma = SPONGE_SIGMA_MAX * (materials::spongeDepthAt(a, SPONGE_WIDTH) +
+                                          materials::spongeDepthAt(b, SPONGE_WIDTH) +
+                                          materials::spongeDepthAt(c, SPONGE_WIDTH));
+        m.sigma  += sigma * m.eps_r;  // matched electric/magnetic loss
+        m.sigma_m = sigma * m.mu_r;
+        return m;
+    }
+
+    // Per-cell material (the scene's media, else vacuum) plus the sponge
+    // loss on all 6 faces: the host form of what the voxelizer paints
+    materials::Material materialAt(int x, int y, int z) const {
+        return materialOf(media::regionAt(scene.media, x, y, z),
+                          materials::spongeIndex(x, scene.nx, SPONGE_WIDTH),
+                          materials::spongeIndex(y, scene.ny, SPONGE_WIDTH),
+                          materials::spongeIndex(z, scene.nz, SPONGE_WIDTH));
+    }
+
+    // Coefficient table on the host, IDs voxelized on the GPU; call again
+    // on geometry change
+    void initMaterials() {
+        planVoxels();
+        memory.upload(materialIdSSBO, nullptr, materials::CoeffMap::idBytes(scene.cells()),
+                      vram::COEFFS);  // every cell painted below
+        voxelizer.paintAll(materialIdSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, materialIdSSBO);
+
+        materials::printSummary(coeffMap, scene.cells());
+        voxelizer.printSummary();
+    }
+
+    // Voxelizer slots of the scene's media and the table they paint from:
+    // a fresh one, or the current one grown (IDs already painted stay valid)
+    void planVoxels(bool fresh = true) {
+        int dims[3] = {scene.nx, scene.ny, scene.nz};
+        if (fresh) coeffMap.resetTable();
+        voxelizer.init();
+        voxelizer.plan(scene.media, dims, useCpml ? 0 : SPONGE_WIDTH, coeffMap, em::DT_3D,
+                       em::DX, [&](const media::Region* r, int a, int b, int c) {
+                           return materialOf(r, a, b, c);
+                       });
+        voxelizer.upload();
+        memory.upload(coeffTableSSBO, coeffMap.table.data(), coeffMap.tableBytes(),
+                      vram::COEFFS);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, coeffTableSSBO);
+    }
+
+    // Live nudge of medium `i` by `d` cells: only the union of its old and
+    // new boxes is repainted. A dispersive medium restarts its
+    // pole state.
+    void moveObject(size_t i, const int d[3]) {
+        if (i >= scene.media.size()) return;
+        int box[6];
+        std::copy(voxelizer.box(i), voxelizer.box(i) + 6, box);
+        media::Region& r = scene.media[i];
+        r.shape.translate(d);
+        for (int a = 0; a < 3; ++a) r.offset[a] += d[a];
+
+        planVoxels(false);
+        const int* moved = voxelizer.box(i);
+        for (int a = 0; a < 3; ++a) {
+            box[a]     = std::min(box[a], moved[a]);
+            box[3 + a] = std::max(box[3 + a], moved[3 + a]);
+        }
+        voxelizer.paint(materialIdSSBO, box);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, materialIdSSBO);
+        if (r.dispersive()) {
+            initMedia();
+            if (checkpoints.enabled) {  // new medium hash; drain the writer first
+                checkpoints.finish();
+                initCheckpoints();
+            }
+        }
+        std::cout << "Move: object " << i << " (" << r.spec << ") offset " << r.offset[0] << ", "
+                  << r.offset[1] << ", " << r.offset[2] << "\n";
+    }
+
+    // Slab box for the pair of CPML slabs normal to `axis`
+    void cpmlBox(int axis, GLuint box[3]) const {
+        box[0] = scene.nx; box[1] = scene.ny; box[2] = scene.nz;
+        box[axis] = 2 * cpmlParams.width;
+    }
+
+    // Zeroed psi slabs + per-slab-position recursion coefficients
+    void initCpml() {
+        const int W = cpmlParams.width;
+        size_t psiBytes = 0;
+
+        for (int a = 0; a < 3; ++a) {
+            GLuint box[3];
+            cpmlBox(a, box);
+            size_t bytes = size_t(box[0]) * box[1] * box[2] * 4 * sizeof(float);  // vec4 per cell
+            memory.alloc(psiSSBO[a], bytes, vram::BOUNDARY);
+            psiBytes += bytes;
+        }
+
+        std::vector<cpml::Coeffs> profile = cpml::buildProfile(cpmlParams, scene.nx, em::DT_3D, em::DX);
+        memory.upload(cpmlCoeffSSBO, profile.data(), profile.size() * sizeof(cpml::Coeffs),
+                      vram::BOUNDARY);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 15, cpmlCoeffSSBO);
+
+        double fullMB = 12.0 * scene.cells() * sizeof(float) / (1024.0 * 1024.0);
+        std::cout << "CPML: " << W << " cells, psi slabs " << psiBytes / (1024.0 * 1024.0)
+                  << " MB (full-grid psi: " << fullMB << " MB), useful domain "
+                  << scene.nx - 2 * W << "x" << scene.ny - 2 * W << "x" << scene.nz - 2 * W << "\n";
+    }
+
+    // Source records binned for the E pass
+    void initSources() {
+        sourceRecords = sourcesOf(scene);
+        sources::printSummary(sourceRecords, 1);
+        int dims[3] = {scene.nx, scene.ny, scene.nz};
+        sourceTable.upload(sourceRecords, dims, sources::BIN_3D);
+    }
+
+    // Cells and zeroed pole state of the dispersive media; the program is
+    // built the first time a scene has any
+    void initMedia() {
+        int dims[3] = {scene.nx, scene.ny, scene.nz};
+        mediaPlan   = media::plan(scene.media, dims, 3, em::DT_3D);
+        mediaState.upload(mediaPlan, 1);
+        memory.track(mediaState.stateSSBO, vram::MEDIA);
+        if (mediaPlan.empty()) return;
+        if (!mediaProgram) {
+            mediaProgram = shader::createComputeProgram("shaders/media3d.comp",
+                                                        fieldDefines() + media::defines());
+            loc_media_nx           = glGetUniformLocation(mediaProgram, "nx");
+            loc_media_ny           = glGetUniformLocation(mediaProgram, "ny");
+            loc_media_cell_count   = glGetUniformLocation(mediaProgram, "cell_count");
+            loc_media_state_floats = glGetUniformLocation(mediaProgram, "state_floats");
+            loc_media_cb_scale     = glGetUniformLocation(mediaProgram, "cb_scale");
+        }
+        media::checkStability(scene.media, em::DT_3D);
+        media::printSummary(mediaPlan, scene.cells(), 1);
+    }
+
+    // Fields start at zero, so only the source tiles are live at step 0. Tiles
+    // are one workgroup's block (x scaled by cellsX, z by MARCH_Z); mask and
+    // list at bindings 18/19.
+    void initActiveTiles() {
+        const int W   = cpmlParams.width;
+        const int tx  = workgroup[0] * cellsX, ty = workgroup[1], tz = workgroup[2] * marchZ;
+        int tilesX    = int(grid::groups(scene.nx, tx));
+        int tilesY    = int(grid::groups(scene.ny, ty));
+        int tilesZ    = int(grid::groups(scene.nz, tz));
+        int dims[3]   = {scene.nx, scene.ny, scene.nz};
+
+        std::vector<int> seeds;
+        cpmlReach = dims[0];
+        for (const sources::Record& r : sourceRecords) {
+            const int* src = r.cell;
+            seeds.push_back(((src[2] / tz) * tilesY + src[1] / ty) * tilesX + src[0] / tx);
+            for (int a = 0; a < 3; ++a)
+                cpmlReach = std::min({cpmlReach, src[a] - (W - 1), (dims[a] - W) - src[a]});
+        }
+        activeTiles.init(tilesX * tilesY * tilesZ, seeds, 18, 19);
+    }
+
+    // Sampled region of one snapshot: cell = origin + id * cellStep over
+    // outDims. Slice dumps hold the displayed plane's axis fixed.
+    void snapshotRegion(int origin[3], int cellStep[3], int outDims[3], int& fixedAxis) const {
+        int dims[3] = {scene.nx, scene.ny, scene.nz};
+        fixedAxis = snapshotSlice ? 2 - sliceAxis : -1;  // XY -> z, XZ -> y, YZ -> x
+        for (int a = 0; a < 3; ++a) {
+            bool fixed  = a == fixedAxis;
+            origin[a]   = fixed ? sliceIndex : 0;
+            cellStep[a] = fixed ? 0 : snapshotStride;
+            outDims[a]  = fixed ? 1 : int(grid::groups(dims[a], snapshotStride));
+        }
+    }
+
+    // Staging ring sized for the largest region (any slice plane can be
+    // selected later); a resize drains it first
+    void initSnapshots() {
+        size_t o[3];
+        int dims[3] = {scene.nx, scene.ny, scene.nz};
+        for (int a = 0; a < 3; ++a) o[a] = grid::groups(dims[a], snapshotStride);
+        size_t cells = snapshotSlice ? std::max({o[0] * o[1], o[0] * o[2], o[1] * o[2]})
+                                     : o[0] * o[1] * o[2];
+        size_t bytes = 6 * cells * sizeof(float);
+        if (snapshots.enabled) {
+            trackRing(snapshots, [&] { snapshots.resize(bytes); });
+            return;
+        }
+
+        if (!recordPath.empty()) {
+            int dims[3] = {int(o[0]), int(o[1]), int(o[2])};
+            if (!recorder.open(recordPath, simParams(), dims, snapshotStride,
+                               fieldfile::Codec(recordCodec), recordError))
+                exit(EXIT_FAILURE);
+            snapshots.sink = [this](const snapshot::Header& h, const void* data, size_t) {
+                return recorder.append(h.step, h.dims, static_cast<const float*>(data));
+            };
+        }
+        trackRing(snapshots, [&] {
+            snapshots.start(recordPath.empty() ? snapshotDir : recordPath, "fields", bytes);
+        });
+    }
+
+    // A staging ring (re)allocated by `alloc`, tracked as staging
+    template <typename AllocFn>
+    void trackRing(snapshot::Ring& ring, AllocFn alloc) {
+        for (const snapshot::Ring::Slot& s : ring.slots) memory.forget(s.buffer);
+        alloc();
+        for (const snapshot::Ring::Slot& s : ring.slots) memory.track(s.buffer, vram::STAGING);
+    }
+
+    // Zeroed accumulators for the probe boxes and the Huygens box faces
+    // after them (a new grid restarts them)
+    void initProbes() {
+        if (!probesFit(scene)) {
+            std::cerr << "--dft-probe boxes must lie inside the " << scene.nx << "x" << scene.ny
+                      << "x" << scene.nz << " grid, and the Huygens box around the sources, "
+                      << "clear of the " << absorberWidth() << "-cell absorbing layer\n";
+            exit(EXIT_FAILURE);
+        }
+        std::vector<float>    freqs = dftFreqs;
+        std::vector<dft::Box> boxes = dftBoxes;
+        if (freqs.empty()) freqs.push_back(scene.sourceFreq);
+        if (ntffOn) {
+            std::vector<dft::Box> f = ntff::faces(huygensBox(scene));
+            boxes.insert(boxes.end(), f.begin(), f.end());
+        }
+        probes.init(freqs, boxes, dftProgram);
+        memory.track(probes.accumSSBO, vram::PROBES);
+        memory.track(probes.probeSSBO, vram::PROBES);
+        if (ntffOn) {
+            farField.init(huygensBox(scene), int(dftBoxes.size()), ntffDirs[0], ntffDirs[1],
+                          freqs.size(), ntffPath, ntffProgram);
+            memory.track(farField.patternSSBO, vram::PROBES);
+        }
+    }
+
+    // Staging ring sized for the whole solver state; a resize drains it first
+    void initCheckpoints() {
+        size_t bytes = 0;
+        for (const auto& b : stateBuffers()) bytes += b.second;
+        if (checkpoints.enabled) trackRing(checkpoints, [&] { checkpoints.resize(bytes); });
+        checkpointHeader = stateHeader();
+        if (checkpoints.enabled) return;
+
+        checkpoints.name = "Checkpoints";
+        checkpoints.sink = [this](const snapshot::Header& h, const void* data, size_t) {
+            checkpoint::Header header = checkpointHeader;
+            header.step = h.step;
+            return checkpoint::write(checkpointPath, header, data);
+        };
+        trackRing(checkpoints, [&] { checkpoints.start(checkpointPath, "", bytes); });
+    }
+
+    void initQuad() {
+        // clang-format off
+        float verts[] = {
+        //  pos (xy)       texcoord (uv)
+            -1.f,  1.f,   0.f, 1.f,
+            -1.f, -1.f,   0.f, 0.f,
+             1.f, -1.f,   1.f, 0.f,
+
+            -1.f,  1.f,   0.f, 1.f,
+             1.f, -1.f,   1.f, 0.f,
+             1.f,  1.f,   1.f, 1.f,
+        };
+        // clang-format on
+
+        glGenVertexArrays(1, &quadVAO);
+        glGenBuffers(1, &quadVBO);
+        glBindVertexArray(quadVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+
+        // location 0 — position (vec2)
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE,
+                              4 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        // location 1 — texcoord (vec2)
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE,
+                              4 * sizeof(float),
+                              (void*)(2 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        glBindVertexArray(0);
+    }
+
+    void cacheUniformLocations() {
+        GLuint renderProgram = renderProgramFor(renderComponent);
+        loc_nx               = glGetUniformLocation(renderProgram, "nx");
+        loc_ny               = glGetUniformLocation(renderProgram, "ny");
+        loc_nz               = glGetUniformLocation(renderProgram, "nz");
+        loc_field_scale      = glGetUniformLocation(renderProgram, "field_scale");
+        loc_slice_axis       = glGetUniformLocation(renderProgram, "slice_axis");
+        loc_slice_index      = glGetUniformLocation(renderProgram, "slice_index");
+        loc_near_origin[0]   = glGetUniformLocation(renderProgram, "near_x0");
+        loc_near_origin[1]   = glGetUniformLocation(renderProgram, "near_y0");
+        loc_near_origin[2]   = glGetUniformLocation(renderProgram, "near_z0");
+
+        for (int pass = 0; pass < 2; ++pass) {
+            loc_stepBase[pass] = glGetUniformLocation(computeProgram[pass], "stepBase");
+            if (activeProgram[pass])
+                loc_active_stepBase[pass] = glGetUniformLocation(activeProgram[pass], "stepBase");
+        }
+
+        if (cpmlProgram) {
+            loc_cpml_updateStep = glGetUniformLocation(cpmlProgram, "updateStep");
+            loc_cpml_slabAxis   = glGetUniformLocation(cpmlProgram, "slabAxis");
+            loc_cpml_pmlWidth   = glGetUniformLocation(cpmlProgram, "pmlWidth");
+        }
+
+        if (fusedProgram)
+            loc_fused_stepBase = glGetUniformLocation(fusedProgram, "stepBase");
+
+        if (snapshotProgram) {
+            loc_snap_origin   = glGetUniformLocation(snapshotProgram, "origin");
+            loc_snap_cellStep = glGetUniformLocation(snapshotProgram, "cellStep");
+            loc_snap_outDims  = glGetUniformLocation(snapshotProgram, "outDims");
+        }
+
+        if (statsProgram) {
+            loc_stats_nx             = glGetUniformLocation(statsProgram, "nx");
+            loc_stats_ny             = glGetUniformLocation(statsProgram, "ny");
+            loc_stats_nz             = glGetUniformLocation(statsProgram, "nz");
+            loc_stats_near_origin[0] = glGetUniformLocation(statsProgram, "near_x0");
+            loc_stats_near_origin[1] = glGetUniformLocation(statsProgram, "near_y0");
+            loc_stats_near_origin[2] = glGetUniformLocation(statsProgram, "near_z0");
+            loc_stats_flux_lo        = glGetUniformLocation(statsProgram, "flux_lo");
+            loc_stats_flux_hi        = glGetUniformLocation(statsProgram, "flux_hi");
+        }
+    }
+
+    // ── Per-frame work ──────────────────────────────────────────────────────
+
+    // Static parameters only — the timestep is pushed per dispatch as a
+    // uniform, so nothing here changes between steps. The source_* members
+    // describe the scene's default source; the kernels read the table.
+    SimParams3D simParams() const {
+        SimParams3D p{};
+        p.nx               = scene.nx;
+        p.ny               = scene.ny;
+        p.nz               = scene.nz;
+        p.source_x         = scene.nx / 2;
+        p.source_y         = scene.ny / 2;
+        p.source_z         = scene.nz / 2;
+        p.dx               = em::DX;
+        p.dt               = em::DT_3D;
+        p.time             = 0.0f;
+        p.source_freq      = scene.sourceFreq;
+        p.source_amp       = scene.sourceAmp;
+        p.field_scale      = 1.0f;
+        p.timestep         = 0;
+        p.render_component = renderComponent;
+        p.slice_axis       = sliceAxis;
+        p.slice_index      = sliceIndex;
+        p.field_precision  = fieldPrecision;
+        p.near_x0          = nearOrigin[0];
+        p.near_y0          = nearOrigin[1];
+        p.near_z0          = nearOrigin[2];
+        return p;
+    }
+
+    void uploadSimParams() {
+        SimParams3D p = simParams();
+        timers.begin(profile::UPLOAD);
+        glBindBuffer(GL_UNIFORM_BUFFER, simParamsUBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SimParams3D), &p);
+        timers.end(profile::UPLOAD);
+    }
+
+    // Theoretical traffic per cell update: each pass reads the E and H
+    // vectors and writes one of them, plus a 16-bit material ID. Neighbour
+    // reads are assumed cached; packed storage moves its padding lane too.
+    double bytesPerCellUpdate() const {
+        double vec = (fieldLayout == grid::LAYOUT_PACKED) ? fieldBytesPerCell()
+                                                          : 3.0 * fieldBytesPerCell();
+        return 2 * 3 * vec + 2 * sizeof(uint16_t);
+    }
+
+    void updateFields(int timestep, bool mirrored = false) {
+        // The grid support grows one cell per step, so the CPML corrections
+        // are exactly zero until it comes within a cell of a slab. Tracking
+        // stops there: the slabs then need the full correction passes.
+        if (activeTiles.enabled && useCpml && timestep + 2 >= cpmlReach)
+            activeTiles.stop(timestep);
+        bool sparse = activeTiles.enabled;
+
+        GLuint program[2]     = {computeProgram[0], computeProgram[1]};
+        GLint  locStepBase[2] = {loc_stepBase[0], loc_stepBase[1]};
+        if (sparse) {
+            std::copy(activeProgram, activeProgram + 2, program);
+            std::copy(loc_active_stepBase, loc_active_stepBase + 2, locStepBase);
+        }
+        if (mirrored) {  // the E pass also writes the volume mirror
+            const volume::Kernel& k = mirrorKernel(sparse ? MIRROR_ACTIVE : MIRROR_TWO_PASS);
+            mirror.beginWrite(k, volume::CUTOFF / exposure.scale);
+            program[1]     = k.program;
+            locStepBase[1] = k.loc_stepBase;
+        }
+
+        GLuint gx = grid::groups(scene.nx / cellsX, workgroup[0]);
+        GLuint gy = grid::groups(scene.ny, workgroup[1]);
+        GLuint gz = grid::groups(scene.nz, workgroup[2] * marchZ);
+        auto dispatch = [&](int pass) {
+            glUseProgram(program[pass]);
+            glUniform1i(locStepBase[pass], timestep);
+            if (sparse) activeTiles.dispatch();
+            else        glDispatchCompute(gx, gy, gz);
+        };
+
+        // Pass 1 — H field update
+        timers.begin(profile::H_PASS);
+        dispatch(0);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        timers.end(profile::H_PASS);
+        if (useCpml && !sparse) applyCpml(0);
+
+        // Pass 2 — E field update + source + absorbing boundary
+        timers.begin(profile::E_PASS);
+        dispatch(1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        timers.end(profile::E_PASS);
+        if (useCpml && !sparse) applyCpml(1);
+        if (!mediaPlan.empty()) applyMedia();
+
+        // Tiles woken by this E pass join the next step's dispatch
+        if (sparse) {
+            timers.begin(profile::TILES);
+            activeTiles.compact();
+            timers.end(profile::TILES);
+            activeTiles.poll(timestep + 1);
+        }
+    }
+
+    // CPML convolution terms for the pass just run, one slab pair at a time
+    // (sequential, since slabs of different axes share edge cells)
+    void applyCpml(int updateStep) {
+        timers.begin(profile::CPML);
+        glUseProgram(cpmlProgram);
+        glUniform1i(loc_cpml_updateStep, updateStep);
+        glUniform1i(loc_cpml_pmlWidth, cpmlParams.width);
+
+        for (int a = 0; a < 3; ++a) {
+            glUniform1i(loc_cpml_slabAxis, a);
+            GLuint box[3];
+            cpmlBox(a, box);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, psiSSBO[a]);
+            glDispatchCompute(grid::groups(box[0] / cellsX, 8), grid::groups(box[1], 8),
+                              grid::groups(box[2], 4));
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+        timers.end(profile::CPML);
+    }
+
+    // Polarization and Kerr terms of the dispersive cells
+    void applyMedia() {
+        timers.begin(profile::MEDIA);
+        glUseProgram(mediaProgram);
+        glUniform1i(loc_media_nx, scene.nx);
+        glUniform1i(loc_media_ny, scene.ny);
+        glUniform1ui(loc_media_state_floats, 0u);  // one layer
+        glUniform1f(loc_media_cb_scale, em::DX / em::DT_3D);
+        if (mediaState.count) {
+            glUniform1i(loc_media_cell_count, mediaState.count);
+            mediaState.bind();
+            mediaState.dispatch(1);
+        }
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        timers.end(profile::MEDIA);
+    }
+
+    // Fused path — H and E in one dispatch, then the output set becomes current
+    void updateFieldsFused(int timestep, bool mirrored = false) {
+        timers.begin(profile::FUSED);
+        if (mirrored) {  // this step also writes the volume mirror
+            const volume::Kernel& k = mirrorKernel(MIRROR_FUSED);
+            mirror.beginWrite(k, volume::CUTOFF / exposure.scale);
+            glUniform1i(k.loc_stepBase, timestep);
+        } else {
+            glUseProgram(fusedProgram);
+            glUniform1i(loc_fused_stepBase, timestep);
+        }
+
+        glDispatchCompute(grid::groups(scene.nx, 8), grid::groups(scene.ny, 8),
+                          grid::groups(scene.nz, 8));
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        timers.end(profile::FUSED);
+
+        for (int i = 0; i < fieldBuffers; ++i) {
+            std::swap(ssbo[i], backSSBO[i]);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, ssbo[i]);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6 + i, backSSBO[i]);
+        }
+    }
+
+    // Advance `count` steps starting at `timestep` on whichever path is active
+    void step(int timestep, int count) {
+        if (count > 0) ++fieldsVersion;
+        if (mirrorComponent >= 0 && !mirror.enabled) initMirror();
+        for (int i = 0; i < count; ++i) {
+            bool mirrored = mirrorComponent >= 0 && i == count - 1;  // the frame's last step
+            if (fused)
+                updateFieldsFused(timestep + i, mirrored);
+            else
+                updateFields(timestep + i, mirrored);
+            if (probes.enabled) accumulateProbes(timestep + i);
+            if (farField.enabled && ntffEvery > 0 && (timestep + i + 1) % ntffEvery == 0)
+                updateFarField(timestep + i + 1);
+        }
+    }
+
+    // Separate pass rather than part of the E update, so it sees the CPML
+    // corrections and works with every kernel and storage variant; only the
+    // probe cells are visited
+    void accumulateProbes(int timestep) {
+        timers.begin(profile::DFT);
+        probes.accumulate(dftProgram, timestep, em::DT_3D);
+        timers.end(profile::DFT);
+    }
+
+    void updateFarField(int timestep) {
+        timers.begin(profile::NTFF);
+        farField.update(probes, em::DX, timestep);
+        timers.end(profile::NTFF);
+    }
+
+    // Phasors so far to `path`, and the final pattern unless the last step
+    // just produced it (at the end of a run)
+    void writeProbes(const std::string& path, int timestep) {
+        if (!probes.enabled) return;
+        int dims[3] = {scene.nx, scene.ny, scene.nz};
+        if (!dftBoxes.empty()) probes.write(path, dims, em::DT_3D, em::DX);
+        if (farField.enabled && (ntffEvery == 0 || timestep % ntffEvery != 0))
+            updateFarField(timestep);
+    }
+
+    // All six components (Ex..Hz grids, linear idx3d order) decoded to fp32
+    std::vector<float> readFields() const {
+        size_t lanes     = (fieldLayout == grid::LAYOUT_PACKED) ? 4 : 1;
+        int    perBuffer = 6 / fieldBuffers;  // components stored per buffer
+        bool   fp32      = fieldPrecision == grid::PRECISION_FP32;
+        const int    nx = scene.nx, ny = scene.ny, nz = scene.nz;
+        const size_t cells = scene.cells();
+
+        std::vector<float>   out(6 * cells);
+        std::vector<uint8_t> raw(fieldCells * fieldBytesPerCell());
+
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        for (int b = 0; b < fieldBuffers; ++b) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo[b]);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, raw.size(), raw.data());
+
+            for (int z = 0; z < nz; ++z)
+            for (int y = 0; y < ny; ++y)
+            for (int x = 0; x < nx; ++x) {
+                size_t f = grid::idx3dOrdered(fieldIndex, x, y, z, nx, ny);
+                size_t l = grid::idx3d(x, y, z, nx, ny);
+                for (int c = 0; c < perBuffer; ++c) {
+                    size_t e = f * lanes + c;
+                    float  v;
+                    if (fp32) {
+                        std::memcpy(&v, raw.data() + e * 4, 4);
+                    } else {
+                        uint16_t h;
+                        std::memcpy(&h, raw.data() + e * 2, 2);
+                        v = precision::halfToFloat(h);
+                    }
+                    out[(b * perBuffer + c) * cells + l] = v;
+                }
+            }
+        }
+
+        // Mixed precision: the near-source box lives in its own fp32 buffers
+        if (fieldPrecision == grid::PRECISION_MIXED) {
+            std::vector<float> box(size_t(NEAR_BOX) * NEAR_BOX * NEAR_BOX * 4);
+            for (int b = 0; b < 2; ++b) {
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, nearSSBO[b]);
+                glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, box.size() * sizeof(float),
+                                   box.data());
+                for (int n = 0; n < NEAR_BOX * NEAR_BOX * NEAR_BOX; ++n) {
+                    int x = nearOrigin[0] + n % NEAR_BOX;
+                    int y = nearOrigin[1] + (n / NEAR_BOX) % NEAR_BOX;
+                    int z = nearOrigin[2] + n / (NEAR_BOX * NEAR_BOX);
+                    if (!grid::inBounds3D(x, y, z, nx, ny, nz)) continue;
+                    size_t l = grid::idx3d(x, y, z, nx, ny);
+                    for (int c = 0; c < 3; ++c)
+                        out[(b * 3 + c) * cells + l] = box[n * 4 + c];
+                }
+            }
+        }
+        return out;
+    }
+
+    // Host solver over the same parameters, coefficients, CPML profile and
+    // sources the kernels read. Needs only useCpml / cpmlParams and the
+    // scene, so it also works on an Engine that was never init()ed
+    // (--backend cpu).
+    void initCpuSolver(cpu::Solver3D& solver, int threads) const {
+        materials::CoeffMap map;
+        materials::build(map, scene.nx, scene.ny, scene.nz, em::DT_3D, em::DX,
+                         [&](int x, int y, int z) { return materialAt(x, y, z); });
+        std::vector<cpml::Coeffs> profile;
+        if (useCpml) profile = cpml::buildProfile(cpmlParams, scene.nx, em::DT_3D, em::DX);
+        int dims[3] = {scene.nx, scene.ny, scene.nz};
+        solver.init(simParams(), map, useCpml ? cpmlParams.width : 0, profile, sourcesOf(scene),
+                    media::plan(scene.media, dims, 3, em::DT_3D), threads);
+    }
+
+    // Call after advancing from `from` to `to`: queues a snapshot whenever a
+    // multiple of snapshotEvery was crossed and hands finished ones to disk
+    void snapshotAfter(int from, int to) {
+        if (!snapshots.enabled) return;
+        snapshots.poll();
+        if (to / snapshotEvery != from / snapshotEvery) captureSnapshot(to);
+    }
+
+    // Ex..Hz into a staging slot as fp32 linear planes. Full-resolution fp32
+    // SoA linear grids are already in that format and are plain buffer
+    // copies; every other variant or region goes through the gather shader.
+    // Only fenced here — never waited on.
+    void captureSnapshot(int timestep) {
+        int origin[3], cellStep[3], outDims[3], fixedAxis;
+        snapshotRegion(origin, cellStep, outDims, fixedAxis);
+
+        snapshot::Header h;
+        h.step        = timestep;
+        h.components  = 6;
+        h.gridDims[0] = scene.nx;
+        h.gridDims[1] = scene.ny;
+        h.gridDims[2] = scene.nz;
+        h.fixedAxis   = fixedAxis;
+        h.fixedIndex  = (fixedAxis >= 0) ? sliceIndex : 0;
+        h.stride      = snapshotStride;
+        for (int a = 0; a < 3; ++a) h.dims[a] = outDims[a];
+        size_t plane = size_t(outDims[0]) * outDims[1] * outDims[2];
+        size_t bytes = 6 * plane * sizeof(float);
+
+        bool copy = fixedAxis < 0 && snapshotStride == 1 && fieldLayout == grid::LAYOUT_SOA &&
+                    fieldIndex == grid::INDEX_LINEAR && fieldPrecision == grid::PRECISION_FP32;
+
+        int slot = snapshots.acquire();
+        timers.begin(profile::SNAPSHOT);
+        if (copy) {
+            glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, snapshots.target(slot));
+            for (int i = 0; i < 6; ++i) {
+                glBindBuffer(GL_COPY_READ_BUFFER, ssbo[i]);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                                    i * plane * sizeof(float), plane * sizeof(float));
+            }
+        } else {
+            glUseProgram(snapshotProgram);
+            glUniform3i(loc_snap_origin, origin[0], origin[1], origin[2]);
+            glUniform3i(loc_snap_cellStep, cellStep[0], cellStep[1], cellStep[2]);
+            glUniform3i(loc_snap_outDims, outDims[0], outDims[1], outDims[2]);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, snapshot::SNAPSHOT_BINDING,
+                             snapshots.target(slot));
+            glDispatchCompute(grid::groups(outDims[0], 8), grid::groups(outDims[1], 8),
+                              grid::groups(outDims[2], 4));
+        }
+        glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+        timers.end(profile::SNAPSHOT);
+        snapshots.submit(slot, h, bytes);
+    }
+
+    // ── Field statistics ──
+
+    // Call after advancing from `from` to `to`, like snapshotAfter: applies
+    // the samples read back since, and starts one whenever a multiple of
+    // statsEvery was crossed
+    void statsAfter(int from, int to) {
+        if (!fieldStats.enabled) return;
+        stats::Reading r;
+        while (fieldStats.next(r)) applyStats(r);
+        if (!halted && to / statsEvery != from / statsEvery) captureStats(to);
+    }
+
+    // The samples still in flight (end of a run)
+    void finishStats() {
+        stats::Reading r;
+        while (fieldStats.next(r, true)) applyStats(r);
+    }
+
+    void applyStats(const stats::Reading& r) {
+        exposure.update(r);
+        if (watchdog.check(r)) halted = true;
+    }
+
+    // One reduction pass per field set over the planes it owns, folded into
+    // a sample slot; fenced, not waited on
+    void captureStats(int timestep) {
+        if (!fieldStats.begin()) return;
+        timers.begin(profile::STATS);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        glUseProgram(statsProgram);
+        glUniform1i(loc_stats_nx, scene.nx);
+        glUniform1i(loc_stats_ny, scene.ny);
+        glUniform1i(loc_stats_nz, scene.nz);
+        for (int a = 0; a < 3; ++a) glUniform1i(loc_stats_near_origin[a], nearOrigin[a]);
+        int w = absorberWidth();
+        glUniform3i(loc_stats_flux_lo, w, w, w);
+        glUniform3i(loc_stats_flux_hi, scene.nx - w, scene.ny - w, scene.nz - w);
+
+        fieldStats.dispatch(scene.cells());
+        fieldStats.end(timestep);
+        timers.end(profile::STATS);
+    }
+
+    // ── Checkpoints ──
+
+    // Every buffer that carries state from one step to the next, with its
+    // size, in checkpoint section order. Fused back buffers are left out:
+    // each dispatch overwrites them whole.
+    std::vector<std::pair<GLuint, size_t>> stateBuffers() const {
+        std::vector<std::pair<GLuint, size_t>> out;
+        size_t fieldBytes = fieldCells * fieldBytesPerCell();
+        for (int i = 0; i < fieldBuffers; ++i) out.push_back({ssbo[i], fieldBytes});
+
+        if (fieldPrecision == grid::PRECISION_MIXED) {
+            for (int i = 0; i < 2; ++i) out.push_back({nearSSBO[i], nearBytes()});
+        }
+        if (useCpml) {
+            for (int a = 0; a < 3; ++a) {
+                GLuint box[3];
+                cpmlBox(a, box);
+                out.push_back({psiSSBO[a], size_t(box[0]) * box[1] * box[2] * 4 * sizeof(float)});
+            }
+        }
+        if (probes.enabled) out.push_back({probes.accumSSBO, probes.accumBytes()});
+        if (mediaState.count) out.push_back({mediaState.stateSSBO, mediaState.stateBytes});
+        return out;
+    }
+
+    // Solver configuration a checkpoint belongs to (step left at 0)
+    checkpoint::Header stateHeader() const {
+        checkpoint::Header h;
+        h.dims[0]        = scene.nx;
+        h.dims[1]        = scene.ny;
+        h.dims[2]        = scene.nz;
+        h.fieldLayout    = fieldLayout;
+        h.fieldIndex     = fieldIndex;
+        h.fieldPrecision = fieldPrecision;
+        h.cpml           = useCpml;
+        h.fused          = fused;
+        h.sourceFreq     = scene.sourceFreq;
+        h.sourceAmp      = scene.sourceAmp;
+        h.sourceHash     = sources::hash(sourcesOf(scene));
+        h.mediumHash     = media::hash(mediaPlan);
+        for (const auto& b : stateBuffers()) h.sectionBytes[h.sections++] = b.second;
+        return h;
+    }
+
+    // Call after advancing from `from` to `to`, like snapshotAfter
+    void checkpointAfter(int from, int to) {
+        if (!checkpoints.enabled) return;
+        checkpoints.poll();
+        if (to / checkpointEvery != from / checkpointEvery) captureCheckpoint(to);
+    }
+
+    // The state buffers copied back to back into a staging slot; fenced, not waited on
+    void captureCheckpoint(int timestep) {
+        snapshot::Header h;
+        h.step = timestep;
+
+        int slot = checkpoints.acquire();
+        timers.begin(profile::SNAPSHOT);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, checkpoints.target(slot));
+        size_t offset = 0;
+        for (const auto& b : stateBuffers()) {
+            glBindBuffer(GL_COPY_READ_BUFFER, b.first);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset, b.second);
+            offset += b.second;
+        }
+        glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+        timers.end(profile::SNAPSHOT);
+        checkpoints.submit(slot, h, offset);
+    }
+
+    // Load a checkpoint read by checkpoint::read into the state buffers;
+    // returns the step to continue from. The engine must have been set up
+    // from the same header (see main). Active tiles are not saved: a
+    // restored run dispatches densely, which gives the same fields.
+    int restoreCheckpoint(const checkpoint::Header& header, const std::vector<uint8_t>& payload) {
+        if (!header.sameSetup(stateHeader())) {
+            std::cerr << "Checkpoint does not match this solver configuration";
+            if (header.sourceHash != stateHeader().sourceHash)
+                std::cerr << " (written with other --source sources)";
+            if (header.mediumHash != stateHeader().mediumHash)
+                std::cerr << " (written with other --medium media)";
+            std::cerr << "\n";
+            exit(EXIT_FAILURE);
+        }
+        size_t offset = 0;
+        for (const auto& b : stateBuffers()) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, b.first);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, b.second, payload.data() + offset);
+            offset += b.second;
+        }
+        if (activeTiles.enabled && header.step > 0) activeTiles.stop(header.step);
+        ++fieldsVersion;
+        probes.steps = header.step;  // the accumulators were restored with the fields
+        std::cout << "Restart: step " << header.step << ", " << header.sections << " buffers, "
+                  << offset / (1024.0 * 1024.0) << " MB\n";
+        return header.step;
+    }
+
+    // ── Replay ──
+
+    // Stream one recorded frame into the field SSBOs. Only the chunks cut by
+    // the displayed slice, for the components it shows, are decoded; cells
+    // off the slice keep stale data, which nothing reads. Needs fp32 SoA
+    // brick storage, where a decoded chunk is eight whole bricks.
+    void loadReplayFrame(const fieldfile::Reader& file, int frame) {
+        using fieldfile::CHUNK;
+        const int B = grid::BRICK;
+        int dims[3] = {scene.nx, scene.ny, scene.nz};
+        ++fieldsVersion;
+        int first = (renderComponent == 3) ? 0 : (renderComponent < 3 ? renderComponent
+                                                                      : renderComponent - 1);
+        int last  = (renderComponent == 3) ? 2 : first;
+
+        std::vector<float> vox(fieldfile::CHUNK_VOX), brick(B * B * B);
+        for (int k : file.chunksOnPlane(2 - sliceAxis, sliceIndex)) {
+            const int* cg = file.chunkGrid;
+            int c0[3] = {(k % cg[0]) * CHUNK, ((k / cg[0]) % cg[1]) * CHUNK,
+                         (k / (cg[0] * cg[1])) * CHUNK};
+
+            for (int comp = first; comp <= last; ++comp) {
+                if (!file.decode(frame, comp, k, vox.data())) {
+                    std::cerr << "Replay: corrupt chunk " << k << " in frame " << frame << "\n";
+                    return;
+                }
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo[comp]);
+                for (int b = 0; b < 8; ++b) {
+                    int o[3] = {(b & 1) * B, ((b >> 1) & 1) * B, (b >> 2) * B};
+                    if (c0[0] + o[0] >= dims[0] || c0[1] + o[1] >= dims[1] ||
+                        c0[2] + o[2] >= dims[2])
+                        continue;
+                    for (int z = 0; z < B; ++z)
+                    for (int y = 0; y < B; ++y)
+                        std::memcpy(&brick[(z * B + y) * B],
+                                    &vox[((o[2] + z) * CHUNK + o[1] + y) * CHUNK + o[0]],
+                                    B * sizeof(float));
+                    size_t at = size_t(grid::brickOf(c0[0] + o[0], c0[1] + o[1], c0[2] + o[2],
+                                                     scene.nx, scene.ny)) * brick.size();
+                    glBufferSubData(GL_SHADER_STORAGE_BUFFER, at * sizeof(float),
+                                    brick.size() * sizeof(float), brick.data());
+                }
+            }
+        }
+    }
+
+    void render() {
+        int winW, winH;
+        glfwGetFramebufferSize(window, &winW, &winH);
+        float aspect = (winH > 0) ? static_cast<float>(winW) / winH : 1.0f;
+        enum View { SLICE, VOLUME, ARROWS } mode = SLICE;
+        if (showArrows)
+            mode = ARROWS;
+        else if (mirrorComponent >= 0 && mirror.enabled)
+            mode = VOLUME;
+        if (mode == ARROWS && !arrowField.enabled) initArrows();
+
+        timers.begin(profile::RENDER);
+        target::Key view;
+        if (mode == VOLUME)
+            view.add(fieldsVersion).add(mirrorComponent).add(camera.getViewMatrix())
+                .add(exposure.scale);
+        else if (mode == ARROWS)
+            view.add(fieldsVersion).add(renderComponent >= 4).add(camera.getViewMatrix())
+                .add(exposure.scale);
+        else
+            view.add(colorSlice());
+        view.add(mode);
+        if (frameCache.begin(winW, winH, view)) {
+            glBindVertexArray(quadVAO);
+            if (mode == VOLUME)
+                renderVolume(aspect);
+            else if (mode == ARROWS)
+                renderArrows(aspect);
+            else
+                presenter.draw(fieldImage, aspect, float(fieldImage.width) / fieldImage.height);
+        }
+        frameCache.present();
+        timers.end(profile::RENDER);
+    }
+
+    // Recolour fieldImage from the displayed slice unless nothing it shows
+    // changed; returns the image's key
+    uint64_t colorSlice() {
+        int dimU = (sliceAxis == 2) ? scene.ny : scene.nx;
+        int dimV = (sliceAxis == 0) ? scene.ny : scene.nz;
+        target::Key k;
+        k.add(fieldsVersion).add(renderComponent).add(sliceAxis).add(sliceIndex)
+            .add(exposure.scale);
+        if (!fieldImage.stale(dimU, dimV, k)) return fieldImage.key;
+
+        glUseProgram(renderProgramFor(renderComponent));
+        glUniform1i(loc_nx, scene.nx);
+        glUniform1i(loc_ny, scene.ny);
+        glUniform1i(loc_nz, scene.nz);
+        for (int a = 0; a < 3; ++a)
+            glUniform1i(loc_near_origin[a], nearOrigin[a]);
+        glUniform1f(loc_field_scale, exposure.scale);
+        glUniform1i(loc_slice_axis, sliceAxis);
+        glUniform1i(loc_slice_index, sliceIndex);
+
+        glDispatchCompute(GLuint((dimU + 15) / 16), GLuint((dimV + 15) / 16), 1);
+        return fieldImage.key;
+    }
+
+    // Raymarched mirror from the orbit camera, inside the absorbing layer
+    // (the mirror is written before the CPML corrections, and the layer is
+    // not physical)
+    void renderVolume(float aspect) {
+        mirror.draw(camera.getViewMatrix(), camera.getProjectionMatrix(aspect), absorberWidth(),
+                    exposure.scale, mirrorComponent == 3);
+    }
+
+    // Arrows from the orbit camera: E for the E components and |E|, else H
+    void renderArrows(float aspect) {
+        glm::mat4 viewProj = camera.getProjectionMatrix(aspect) * camera.getViewMatrix();
+        const arrows::Kernel& k = arrowKernel(renderComponent >= 4 ? 1 : 0);
+        arrowField.beginCull(k, viewProj, exposure.scale);
+        glUniform1i(k.loc_nx, scene.nx);
+        glUniform1i(k.loc_ny, scene.ny);
+        glUniform1i(k.loc_nz, scene.nz);
+        for (int a = 0; a < 3; ++a) glUniform1i(k.loc_near_origin[a], nearOrigin[a]);
+        arrowField.dispatch();
+        arrowField.draw(viewProj);
+    }
+
+    // GPU timer summary, plus the per-frame dump when a path was given
+    void reportTimers(const std::string& path) {
+        if (!timers.enabled) return;
+        timers.finish();
+        timers.printSummary(scene.cells(), bytesPerCellUpdate());
+        if (!path.empty()) timers.dump(path, scene.cells(), bytesPerCellUpdate());
+    }
+
+    // ── Cleanup ─────────────────────────────────────────────────────────────
+
+    void cleanup() {
+        snapshots.cleanup();  // flushes pending snapshots to disk
+        recorder.close();
+        checkpoints.cleanup();
+        timers.cleanup();
+        probes.cleanup();
+        farField.cleanup();
+        memory.release(ssbo, 6);
+        memory.release(nearSSBO, 2);
+        memory.release(backSSBO, 6);
+        memory.release(materialIdSSBO);
+        voxelizer.cleanup();
+        memory.release(coeffTableSSBO);
+        memory.release(psiSSBO, 3);
+        memory.release(cpmlCoeffSSBO);
+        sourceTable.cleanup();
+        mediaState.cleanup();
+        activeTiles.cleanup();
+        mirror.cleanup();
+        arrowField.cleanup();
+        fieldStats.cleanup();
+        fieldImage.cleanup();
+        frameCache.cleanup();
+        presenter.cleanup();
+        colormaps.cleanup();
+        glDeleteBuffers(1, &simParamsUBO);
+        glDeleteVertexArrays(1, &quadVAO);
+        glDeleteBuffers(1, &quadVBO);
+        deletePrograms();
+    }
+};
+
+// Scene defaults of this solver, before --scene and the overrides
+inline config::Scene defaultScene() {
+    config::Scene s;
+    s.nx            = DEFAULT_NX;
+    s.ny            = DEFAULT_NY;
+    s.nz            = DEFAULT_NZ;
+    s.stepsPerFrame = DEFAULT_STEPS_PER_FRAME;
+    s.sourceFreq    = DEFAULT_SOURCE_FREQ;
+    s.sourceAmp     = DEFAULT_SOURCE_AMP;
+    return s;
+}
+
+} // namespace wave3d
@@ -0,0 +1,44 @@
+// Active-tile dispatch for the two-pass kernels (built with ACTIVE_TILES).
+// The dispatch is glDispatchComputeIndirect over a compacted list of active
+// tiles, one workgroup per tile. Fields start at zero and one Yee step only
+// reads cells within one cell (in every axis) of the cell being updated, so
+// a tile stays exactly zero until a neighbour has a nonzero cell on the
+// shared face. The E pass checks its final values and wakes those
+// neighbours for the next step; active_tiles.comp rebuilds the list.
+//
+// The host defines TILE_MASK_BINDING / TILE_LIST_BINDING.
+
+layout(std430, binding = TILE_MASK_BINDING) buffer TileMaskBuffer { uint tileMask[]; };
+layout(std430, binding = TILE_LIST_BINDING) readonly buffer TileListBuffer {
+    uvec4 tileArgs;  // (row, rows, 1) indirect dispatch arguments, listed count
+    uint  tiles[];   // active tile indices, x-fastest
+};
+
+// This workgroup's place in the list; the rows are `row` groups wide
+uint activeSlot() { return gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x; }
+
+// False for the padding groups of the last row (the whole group returns)
+bool activeTileListed() { return activeSlot() < tileArgs.w; }
+
+// Origin (in cells) of the tile this workgroup was assigned
+ivec3 activeTileOrigin(ivec3 tileSize, ivec3 tileGrid) {
+    int t = int(tiles[activeSlot()]);
+    ivec3 tile = ivec3(t % tileGrid.x, (t / tileGrid.x) % tileGrid.y, t / (tileGrid.x * tileGrid.y));
+    return tile * tileSize;
+}
+
+// Wake the tiles across every face, edge and corner the cell touches
+void markNeighbours(ivec3 cell, ivec3 tileSize, ivec3 tileGrid) {
+    ivec3 tile = cell / tileSize;
+    ivec3 l    = cell - tile * tileSize;
+    ivec3 lo   = -ivec3(equal(l, ivec3(0)));
+    ivec3 hi   = ivec3(equal(l, tileSize - 1));
+
+    for (int dz = lo.z; dz <= hi.z; ++dz)
+    for (int dy = lo.y; dy <= hi.y; ++dy)
+    for (int dx = lo.x; dx <= hi.x; ++dx) {
+        ivec3 n = tile + ivec3(dx, dy, dz);
+        if (any(lessThan(n, ivec3(0))) || any(greaterThanEqual(n, tileGrid))) continue;
+        tileMask[(n.z * tileGrid.y + n.y) * tileGrid.x + n.x] = 1u;
+    }
+}
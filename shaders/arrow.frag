@@ -0,0 +1,13 @@
+#version 430 core
+
+in  vec3 vNormal;
+in  vec3 vColor;
+out vec4 FragColor;
+
+const vec3 LIGHT = normalize(vec3(0.4, 0.8, 0.45));
+
+void main() {
+    // Two-sided diffuse plus ambient, so arrows stay readable from any side
+    float diffuse = abs(dot(normalize(vNormal), LIGHT));
+    FragColor = vec4(vColor * (0.35 + 0.65 * diffuse), 1.0);
+}
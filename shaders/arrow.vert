@@ -0,0 +1,35 @@
+#version 430 core
+
+// Vector view (arrows.h): the unit +z arrow mesh placed, turned and scaled
+// per instance from the cull pass's compacted list
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+
+struct Arrow {
+    vec4 posLength;     // world position of the tail, w = length
+    vec4 dirMagnitude;  // unit direction, w = displayed magnitude
+};
+
+layout(std430, binding = ARROW_INSTANCE_BINDING) readonly buffer InstanceBuffer {
+    Arrow arrows[];
+};
+
+uniform mat4 viewProj;
+
+out vec3 vNormal;
+out vec3 vColor;
+
+#include "colormap.glsl"
+
+void main() {
+    Arrow a  = arrows[gl_InstanceID];
+    vec3  d  = a.dirMagnitude.xyz;
+    vec3  up = (abs(d.z) < 0.9) ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3  u  = normalize(cross(up, d));
+    mat3  basis = mat3(u, cross(d, u), d);  // mesh +z onto the field direction
+
+    gl_Position = viewProj * vec4(a.posLength.xyz + basis * aPos * a.posLength.w, 1.0);
+    vNormal     = basis * aNormal;
+    vColor      = sequentialColor(sqrt(a.dirMagnitude.w));  // same compression as the length
+}
@@ -0,0 +1,20 @@
+// Colormaps of the views: lookup tables from assets/colormaps (colormap.h),
+// entries spread evenly over the mapped range, texel centres at its ends
+
+layout(binding = COLORMAP_DIVERGING_UNIT)  uniform sampler1D divergingMap;
+layout(binding = COLORMAP_SEQUENTIAL_UNIT) uniform sampler1D sequentialMap;
+
+vec3 lookup(sampler1D map, float t) {
+    float n = float(textureSize(map, 0));
+    return texture(map, (t * (n - 1.0) + 0.5) / n).rgb;
+}
+
+// Diverging: blue <- 0 -> red, for signed components in [-1, 1]
+vec3 divergingColor(float val) {
+    return lookup(divergingMap, clamp(val, -1.0, 1.0) * 0.5 + 0.5);
+}
+
+// Sequential: black -> magenta -> yellow, for magnitudes in [0, 1]
+vec3 sequentialColor(float val) {
+    return lookup(sequentialMap, clamp(val, 0.0, 1.0));
+}
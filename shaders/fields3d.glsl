@@ -0,0 +1,214 @@
+// Field storage for the 3D Yee grid, chosen at shader compile time. The host
+// injects the #defines below (shader::compile) so each layout is a separate
+// program variant with no runtime branching.
+//
+//   FIELD_LAYOUT     0 = SoA: six buffers Ex..Hz at bindings 0..5
+//                    1 = packed: E (Ex,Ey,Ez,_) at binding 0, H (Hx,Hy,Hz,_) at 1
+//   FIELD_INDEX      0 = linear, z-major (same as idx())
+//                    1 = 8^3 bricks, row-major inside each brick
+//                    2 = 8^3 bricks, Morton (Z-order) inside each brick
+//   FIELD_PRECISION  0 = fp32 storage
+//                    1 = fp16 storage (packHalf2x16), fp32 arithmetic
+//                    2 = fp16, except an fp32 box around the source
+//                        (edge FIELD_NEAR_N) at 16/17
+//
+// Include after nx/ny are declared (and, for FIELD_PRECISION 2, the box
+// origin near_x0/y0/z0 — a run-time value so a grid resize needs no rebuild). Optional switches set by the includer:
+//   FIELD_READONLY current-step buffers are readonly (no storeE/storeH)
+//   FIELD_OUTPUTS  also declare the ping-pong write set at bindings 6.. (fp32)
+//
+// EX(i)..HZ(i) read one component; with fp32 storage they are also lvalues.
+// Writers go through storeE/storeH, which take CELLS_X x-adjacent cells:
+// fp16 SoA packs two x-neighbours into one word, so the invocation that
+// writes a word must own both cells. Index order must match
+// grid::idx3dOrdered on the host.
+
+#ifndef FIELD_LAYOUT
+#define FIELD_LAYOUT 0
+#endif
+#ifndef FIELD_INDEX
+#define FIELD_INDEX 0
+#endif
+#ifndef FIELD_PRECISION
+#define FIELD_PRECISION 0
+#endif
+#ifdef FIELD_READONLY
+#define FIELD_ACCESS readonly
+#else
+#define FIELD_ACCESS
+#endif
+
+#if FIELD_PRECISION != 0 && FIELD_LAYOUT == 0
+#define CELLS_X 2
+#else
+#define CELLS_X 1
+#endif
+
+// ── fp32 storage ──
+#if FIELD_PRECISION == 0
+#if FIELD_LAYOUT == 0
+layout(std430, binding = 0) FIELD_ACCESS buffer ExBuffer { float Ex[]; };
+layout(std430, binding = 1) FIELD_ACCESS buffer EyBuffer { float Ey[]; };
+layout(std430, binding = 2) FIELD_ACCESS buffer EzBuffer { float Ez[]; };
+layout(std430, binding = 3) FIELD_ACCESS buffer HxBuffer { float Hx[]; };
+layout(std430, binding = 4) FIELD_ACCESS buffer HyBuffer { float Hy[]; };
+layout(std430, binding = 5) FIELD_ACCESS buffer HzBuffer { float Hz[]; };
+
+#define EX(i) Ex[i]
+#define EY(i) Ey[i]
+#define EZ(i) Ez[i]
+#define HX(i) Hx[i]
+#define HY(i) Hy[i]
+#define HZ(i) Hz[i]
+
+vec3 loadE(int i) { return vec3(Ex[i], Ey[i], Ez[i]); }
+vec3 loadH(int i) { return vec3(Hx[i], Hy[i], Hz[i]); }
+#else
+layout(std430, binding = 0) FIELD_ACCESS buffer EBuffer { vec4 E[]; };
+layout(std430, binding = 1) FIELD_ACCESS buffer HBuffer { vec4 H[]; };
+
+#define EX(i) E[i].x
+#define EY(i) E[i].y
+#define EZ(i) E[i].z
+#define HX(i) H[i].x
+#define HY(i) H[i].y
+#define HZ(i) H[i].z
+
+vec3 loadE(int i) { return E[i].xyz; }
+vec3 loadH(int i) { return H[i].xyz; }
+#endif
+
+#ifndef FIELD_READONLY
+void storeE(int i, vec3 v[CELLS_X]) { EX(i) = v[0].x; EY(i) = v[0].y; EZ(i) = v[0].z; }
+void storeH(int i, vec3 v[CELLS_X]) { HX(i) = v[0].x; HY(i) = v[0].y; HZ(i) = v[0].z; }
+#endif
+
+// ── fp16 storage (optionally with the fp32 near-source box) ──
+#else
+#if FIELD_PRECISION == 2
+layout(std430, binding = 16) FIELD_ACCESS buffer NearEBuffer { vec4 nearE[]; };
+layout(std430, binding = 17) FIELD_ACCESS buffer NearHBuffer { vec4 nearH[]; };
+#endif
+
+#if FIELD_LAYOUT == 0
+// One word = the same component of two x-adjacent cells (even index low)
+layout(std430, binding = 0) FIELD_ACCESS buffer ExBuffer { uint Ex[]; };
+layout(std430, binding = 1) FIELD_ACCESS buffer EyBuffer { uint Ey[]; };
+layout(std430, binding = 2) FIELD_ACCESS buffer EzBuffer { uint Ez[]; };
+layout(std430, binding = 3) FIELD_ACCESS buffer HxBuffer { uint Hx[]; };
+layout(std430, binding = 4) FIELD_ACCESS buffer HyBuffer { uint Hy[]; };
+layout(std430, binding = 5) FIELD_ACCESS buffer HzBuffer { uint Hz[]; };
+
+#define LOAD_HALF3(a, b, c, i) \
+    vec3(unpackHalf2x16(a[(i) >> 1])[(i) & 1], \
+         unpackHalf2x16(b[(i) >> 1])[(i) & 1], \
+         unpackHalf2x16(c[(i) >> 1])[(i) & 1])
+#define STORE_HALF3(a, b, c, i, v) \
+    a[(i) >> 1] = packHalf2x16(vec2(v[0].x, v[1].x)); \
+    b[(i) >> 1] = packHalf2x16(vec2(v[0].y, v[1].y)); \
+    c[(i) >> 1] = packHalf2x16(vec2(v[0].z, v[1].z))
+
+vec3 loadFarE(int i) { return LOAD_HALF3(Ex, Ey, Ez, i); }
+vec3 loadFarH(int i) { return LOAD_HALF3(Hx, Hy, Hz, i); }
+#ifndef FIELD_READONLY
+void storeFarE(int i, vec3 v[CELLS_X]) { STORE_HALF3(Ex, Ey, Ez, i, v); }
+void storeFarH(int i, vec3 v[CELLS_X]) { STORE_HALF3(Hx, Hy, Hz, i, v); }
+#endif
+#else
+// One uvec2 per cell: (x, y) halves, (z, 0) halves
+layout(std430, binding = 0) FIELD_ACCESS buffer EBuffer { uvec2 E[]; };
+layout(std430, binding = 1) FIELD_ACCESS buffer HBuffer { uvec2 H[]; };
+
+vec3  unpackHalf3(uvec2 w) { return vec3(unpackHalf2x16(w.x), unpackHalf2x16(w.y).x); }
+uvec2 packHalf3(vec3 v)    { return uvec2(packHalf2x16(v.xy), packHalf2x16(vec2(v.z, 0.0))); }
+
+vec3 loadFarE(int i) { return unpackHalf3(E[i]); }
+vec3 loadFarH(int i) { return unpackHalf3(H[i]); }
+#ifndef FIELD_READONLY
+void storeFarE(int i, vec3 v[CELLS_X]) { E[i] = packHalf3(v[0]); }
+void storeFarH(int i, vec3 v[CELLS_X]) { H[i] = packHalf3(v[0]); }
+#endif
+#endif
+
+// Near-box cells have negative indices (see fieldIdx); the box is aligned
+// to even x so a CELLS_X pair is never split across the two stores.
+#if FIELD_PRECISION == 2
+vec3 loadE(int i) { return (i < 0) ? nearE[-1 - i].xyz : loadFarE(i); }
+vec3 loadH(int i) { return (i < 0) ? nearH[-1 - i].xyz : loadFarH(i); }
+
+#ifndef FIELD_READONLY
+void storeE(int i, vec3 v[CELLS_X]) {
+    if (i >= 0) { storeFarE(i, v); return; }
+    for (int k = 0; k < CELLS_X; ++k) nearE[-1 - i + k] = vec4(v[k], 0.0);
+}
+void storeH(int i, vec3 v[CELLS_X]) {
+    if (i >= 0) { storeFarH(i, v); return; }
+    for (int k = 0; k < CELLS_X; ++k) nearH[-1 - i + k] = vec4(v[k], 0.0);
+}
+#endif
+#else
+vec3 loadE(int i) { return loadFarE(i); }
+vec3 loadH(int i) { return loadFarH(i); }
+#ifndef FIELD_READONLY
+void storeE(int i, vec3 v[CELLS_X]) { storeFarE(i, v); }
+void storeH(int i, vec3 v[CELLS_X]) { storeFarH(i, v); }
+#endif
+#endif
+
+// Component reads — unused lanes of loadE/loadH are dead code
+#define EX(i) loadE(i).x
+#define EY(i) loadE(i).y
+#define EZ(i) loadE(i).z
+#define HX(i) loadH(i).x
+#define HY(i) loadH(i).y
+#define HZ(i) loadH(i).z
+#endif
+
+#ifdef FIELD_OUTPUTS
+#if FIELD_LAYOUT == 0
+layout(std430, binding = 6)  writeonly buffer ExOutBuffer { float ExOut[]; };
+layout(std430, binding = 7)  writeonly buffer EyOutBuffer { float EyOut[]; };
+layout(std430, binding = 8)  writeonly buffer EzOutBuffer { float EzOut[]; };
+layout(std430, binding = 9)  writeonly buffer HxOutBuffer { float HxOut[]; };
+layout(std430, binding = 10) writeonly buffer HyOutBuffer { float HyOut[]; };
+layout(std430, binding = 11) writeonly buffer HzOutBuffer { float HzOut[]; };
+
+void storeEOut(int i, vec3 e) { ExOut[i] = e.x; EyOut[i] = e.y; EzOut[i] = e.z; }
+void storeHOut(int i, vec3 h) { HxOut[i] = h.x; HyOut[i] = h.y; HzOut[i] = h.z; }
+#else
+layout(std430, binding = 6) writeonly buffer EOutBuffer { vec4 EOut[]; };
+layout(std430, binding = 7) writeonly buffer HOutBuffer { vec4 HOut[]; };
+
+void storeEOut(int i, vec3 e) { EOut[i] = vec4(e, 0.0); }
+void storeHOut(int i, vec3 h) { HOut[i] = vec4(h, 0.0); }
+#endif
+#endif
+
+// Spread the low 3 bits of v so they occupy every third bit
+int spreadBits3(int v) {
+    return (v & 1) | ((v & 2) << 2) | ((v & 4) << 4);
+}
+
+// Storage index of cell (x, y, z); material IDs and psi stay on linear idx().
+// With FIELD_PRECISION 2, cells in the near-source box return -1 - (offset
+// into the fp32 box), which loadE/storeE route to nearE/nearH.
+int fieldIdx(int x, int y, int z) {
+#if FIELD_PRECISION == 2
+    ivec3 n = ivec3(x, y, z) - ivec3(near_x0, near_y0, near_z0);
+    if (all(greaterThanEqual(n, ivec3(0))) && all(lessThan(n, ivec3(FIELD_NEAR_N))))
+        return -1 - ((n.z * FIELD_NEAR_N + n.y) * FIELD_NEAR_N + n.x);
+#endif
+#if FIELD_INDEX == 0
+    return z * nx * ny + y * nx + x;
+#else
+    int bnx   = (nx + 7) >> 3;
+    int bny   = (ny + 7) >> 3;
+    int brick = ((z >> 3) * bny + (y >> 3)) * bnx + (x >> 3);
+#if FIELD_INDEX == 1
+    int inner = ((z & 7) << 6) | ((y & 7) << 3) | (x & 7);
+#else
+    int inner = spreadBits3(x & 7) | (spreadBits3(y & 7) << 1) | (spreadBits3(z & 7) << 2);
+#endif
+    return (brick << 9) | inner;
+#endif
+}
@@ -0,0 +1,70 @@
+// Sparse ADE state of the dispersive media (media.h): the cells of every
+// dispersive medium as (x, y, z, medium), sorted by medium, and per medium
+// its pole coefficients and where its cells' state starts. A cell holds
+// `slots` state vectors of MEDIA_COMPS floats: (P^{n+1}, P^n) per pole,
+// then E^n for Kerr media.
+
+struct Medium {
+    vec4  pole[MEDIA_MAX_POLES];  // c1, c2, c3, unused
+    vec4  kerr;                   // chi3, eps_inf, unused
+    uvec4 range;                  // first cell, first state float, poles, slots
+};
+
+layout(std430, binding = MEDIA_CELL_BINDING) readonly buffer MediumCellBuffer {
+    ivec4 mediumCells[];
+};
+layout(std430, binding = MEDIA_TABLE_BINDING) readonly buffer MediumTableBuffer {
+    Medium media[];
+};
+layout(std430, binding = MEDIA_STATE_BINDING) buffer MediumStateBuffer {
+    float mediumState[];
+};
+
+uniform int   cell_count;    // entries of mediumCells
+uniform uint  state_floats;  // per 2D batch scenario
+uniform float cb_scale;      // dx / dt: cb_scale * cb = 1 / (eps_inf (1 + loss))
+
+vec3 loadState(uint s) {
+    vec3 v = vec3(0.0);
+    for (int c = 0; c < MEDIA_COMPS; ++c) v[c] = mediumState[s + uint(c)];
+    return v;
+}
+
+void storeState(uint s, vec3 v) {
+    for (int c = 0; c < MEDIA_COMPS; ++c) mediumState[s + uint(c)] = v[c];
+}
+
+// First state float of cell `i` (of its medium m) in scenario `layer`
+uint stateOf(Medium m, int i, int layer) {
+    return uint(layer) * state_floats + m.range.y +
+           (uint(i) - m.range.x) * m.range.w * uint(MEDIA_COMPS);
+}
+
+// One ADE step (same as media::step): `e` is the cell's E after the E pass,
+// returned as E^{n+1}; `cb` the cell's E coefficient
+vec3 mediumStep(Medium m, uint s, vec3 e, float cb) {
+    const uint C     = uint(MEDIA_COMPS);
+    uint       poles = m.range.z;
+
+    vec3 dP = vec3(0.0);
+    for (uint q = 0u; q < poles; ++q)
+        dP += loadState(s + 2u * q * C) - loadState(s + (2u * q + 1u) * C);
+    e -= cb * cb_scale * dP;
+
+    if (m.kerr.x != 0.0) {
+        uint  k     = s + 2u * poles * C;
+        vec3  prev  = loadState(k);
+        float scale = m.kerr.y / (m.kerr.y + m.kerr.x * dot(prev, prev));
+        e = prev + scale * (e - prev);
+        storeState(k, e);
+    }
+
+    for (uint q = 0u; q < poles; ++q) {
+        vec3 pa = loadState(s + 2u * q * C);
+        vec3 pb = loadState(s + (2u * q + 1u) * C);
+        vec4 c  = m.pole[q];
+        storeState(s + 2u * q * C, c.x * pa + c.y * pb + c.z * e);
+        storeState(s + (2u * q + 1u) * C, pa);
+    }
+    return e;
+}
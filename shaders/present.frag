@@ -0,0 +1,30 @@
+#version 430 core
+
+// Shows a coloured field image (render_target.h) on the window quad, one
+// image texel per grid cell
+
+in  vec2 TexCoord;
+out vec4 FragColor;
+
+layout(binding = 0) uniform sampler2D image;
+
+uniform float aspect_ratio;  // window width / height
+uniform float image_ratio;   // width / height the image is shown at
+uniform vec2  view_center;   // camera pan offset
+uniform float view_zoom;     // camera zoom level
+
+void main() {
+    // Aspect-ratio correction, then the camera transform (pan & zoom)
+    vec2 uv = TexCoord;
+    uv.x = (uv.x - 0.5) * aspect_ratio / image_ratio + 0.5;
+    uv = (uv - 0.5) / view_zoom + view_center + 0.5;
+
+    // Out-of-bounds → black
+    if (uv.x < 0.0 || uv.x > 1.0 || uv.y < 0.0 || uv.y > 1.0) {
+        FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+    ivec2 size = textureSize(image, 0);
+    ivec2 cell = clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1);
+    FragColor  = vec4(texelFetch(image, cell, 0).rgb, 1.0);
+}
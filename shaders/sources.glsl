@@ -0,0 +1,42 @@
+// Source table (sources.h): records sorted into bins of SOURCE_BIN cells,
+// binStart[b] .. binStart[b + 1] the range of bin b. A cell reads its own
+// bin's range, so positions are only compared in bins holding a source.
+
+struct Source {
+    ivec4 cell;   // x, y, z (2D: batch layer), waveform
+    vec4  drive;  // amplitude x polarization
+    vec4  wave;   // omega, phase, pulse peak time, 1 / pulse width
+};
+
+layout(std430, binding = SOURCE_TABLE_BINDING) readonly buffer SourceTableBuffer {
+    Source sourceTable[];
+};
+layout(std430, binding = SOURCE_BIN_BINDING) readonly buffer SourceBinBuffer {
+    uint binStart[];
+};
+
+const int WAVE_SINE     = 0;
+const int WAVE_GAUSSIAN = 1;
+
+float sourceWave(Source s, float t) {
+    if (s.cell.w == WAVE_SINE) return sin(s.wave.x * t + s.wave.y);
+    float u        = (t - s.wave.z) * s.wave.w;
+    float envelope = exp(-u * u);
+    if (s.cell.w == WAVE_GAUSSIAN) return envelope;
+    return envelope * sin(s.wave.x * (t - s.wave.z) + s.wave.y);
+}
+
+// Soft (additive) drive of cell `c` at time `t` on a gridW x gridH grid
+// (not nx / ny: specialize.glsl may have made those macros)
+vec3 sourceDrive(ivec3 c, int gridW, int gridH, float t) {
+    ivec2 bins = (ivec2(gridW, gridH) + SOURCE_BIN.xy - 1) / SOURCE_BIN.xy;
+    ivec3 b    = c / SOURCE_BIN;
+    int   bin  = (b.z * bins.y + b.y) * bins.x + b.x;
+
+    vec3 drive = vec3(0.0);
+    for (uint i = binStart[bin]; i < binStart[bin + 1]; ++i) {
+        Source s = sourceTable[i];
+        if (all(equal(s.cell.xyz, c))) drive += s.drive.xyz * sourceWave(s, t);
+    }
+    return drive;
+}
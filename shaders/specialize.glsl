@@ -0,0 +1,14 @@
+// Compile-time grid constants. Include right after the SimParams block:
+// when the host builds a variant with GRID_NX / GRID_NY (/ GRID_NZ), the
+// UBO members are shadowed by literals, so indexing and bounds checks
+// constant-fold. Left out wherever one program serves grids of different
+// sizes (the refined patch, the programs kept across live resizes).
+#ifdef GRID_NX
+#define nx GRID_NX
+#endif
+#ifdef GRID_NY
+#define ny GRID_NY
+#endif
+#ifdef GRID_NZ
+#define nz GRID_NZ
+#endif
@@ -0,0 +1,59 @@
+// Workgroup reduction of the statistics passes (stats.h). Include first:
+// with STATS_SUBGROUPS it enables the subgroup extensions.
+//
+// reduceGroup() folds every invocation's sums (energy E, energy H, flux)
+// and maxima (|E|, |H|) into one invocation, for which it returns true:
+// subgroupAdd / subgroupMax inside each subgroup, then the first subgroup
+// over the per-subgroup results in shared memory; without subgroups a
+// shared-memory tree over the whole group.
+#if STATS_SUBGROUPS
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_arithmetic : require
+#endif
+
+layout(local_size_x = STATS_GROUP_SIZE) in;
+
+struct Partial {
+    vec4 sums;    // energy E, energy H, boundary flux, unused
+    vec4 maxima;  // max |E|, max |H|, unused x2
+};
+
+shared vec4 groupSums[STATS_GROUP_SIZE];  // subgroups: one entry per subgroup
+shared vec4 groupMaxima[STATS_GROUP_SIZE];
+
+bool reduceGroup(inout vec4 sums, inout vec4 maxima) {
+#if STATS_SUBGROUPS
+    sums   = subgroupAdd(sums);
+    maxima = subgroupMax(maxima);
+    if (subgroupElect()) {
+        groupSums[gl_SubgroupID]   = sums;
+        groupMaxima[gl_SubgroupID] = maxima;
+    }
+    barrier();
+    if (gl_SubgroupID != 0u) return false;
+    sums   = vec4(0.0);
+    maxima = vec4(0.0);
+    for (uint s = gl_SubgroupInvocationID; s < gl_NumSubgroups; s += gl_SubgroupSize) {
+        sums  += groupSums[s];
+        maxima = max(maxima, groupMaxima[s]);
+    }
+    sums   = subgroupAdd(sums);
+    maxima = subgroupMax(maxima);
+    return subgroupElect();
+#else
+    uint i = gl_LocalInvocationIndex;
+    groupSums[i]   = sums;
+    groupMaxima[i] = maxima;
+    barrier();
+    for (uint span = STATS_GROUP_SIZE / 2; span > 0u; span >>= 1) {
+        if (i < span) {
+            groupSums[i]  += groupSums[i + span];
+            groupMaxima[i] = max(groupMaxima[i], groupMaxima[i + span]);
+        }
+        barrier();
+    }
+    sums   = groupSums[0];
+    maxima = groupMaxima[0];
+    return i == 0u;
+#endif
+}
@@ -0,0 +1,75 @@
+#version 430 core
+
+// Volume view (volume.h): front-to-back raymarch of the mirror texture the
+// E pass wrote, one ray per pixel from the orbit camera. Samples use the
+// hardware trilinear filter; bricks the occupancy mask marks clear are
+// jumped over whole, and a ray stops once it is nearly opaque.
+
+in  vec2 TexCoord;
+out vec4 FragColor;
+
+layout(binding = 0) uniform sampler3D volumeTex;
+layout(std430, binding = VOLUME_OCCUPANCY_BINDING) readonly buffer OccupancyBuffer {
+    uint occupancy[];
+};
+
+uniform mat4  invViewProj;
+uniform vec3  boxHalf;      // world half-extents of the grid (largest axis 0.5)
+uniform vec3  clipLo;       // shown box in texture coordinates: inside the
+uniform vec3  clipHi;       //   absorbing layer
+uniform ivec3 dims;
+uniform ivec3 bricks;
+uniform float field_scale;
+uniform float stepLength;   // world units: half a cell
+uniform int   magnitude;    // 1 = |E| (sequential colormap), 0 = signed component
+
+const float DENSITY   = 0.08;  // opacity per cell at full brightness
+const float OPAQUE    = 0.98;  // early ray termination
+const int   MAX_STEPS = 4096;
+
+#include "colormap.glsl"
+
+void main() {
+    // View ray through this pixel, in texture coordinates (t in world units)
+    vec2 ndc  = TexCoord * 2.0 - 1.0;
+    vec4 near = invViewProj * vec4(ndc, -1.0, 1.0);
+    vec4 far  = invViewProj * vec4(ndc, 1.0, 1.0);
+    near.xyz /= near.w;
+    far.xyz  /= far.w;
+    vec3 dirWorld = normalize(far.xyz - near.xyz);
+    vec3 o = near.xyz / (2.0 * boxHalf) + 0.5;
+    vec3 d = dirWorld / (2.0 * boxHalf);
+    vec3 invD = 1.0 / mix(d, vec3(1e-8), lessThan(abs(d), vec3(1e-8)));
+
+    // Slab test against the shown box
+    vec3 t0 = (clipLo - o) * invD, t1 = (clipHi - o) * invD;
+    vec3 tMin = min(t0, t1), tMax = max(t0, t1);
+    float tNear = max(max(tMin.x, tMin.y), max(tMin.z, 0.0));
+    float tFar  = min(min(tMax.x, tMax.y), tMax.z);
+
+    vec4 acc = vec4(0.0);
+    float t = tNear;
+    for (int i = 0; i < MAX_STEPS && t < tFar; ++i) {
+        vec3  uvw  = o + d * t;
+        ivec3 cell = clamp(ivec3(uvw * vec3(dims)), ivec3(0), dims - 1);
+        ivec3 b    = cell / VOLUME_BRICK;
+        if (occupancy[(b.z * bricks.y + b.y) * bricks.x + b.x] == 0u) {
+            // Empty brick: continue from where the ray leaves it
+            vec3 lo = vec3(b * VOLUME_BRICK) / vec3(dims);
+            vec3 hi = vec3(min((b + 1) * VOLUME_BRICK, dims)) / vec3(dims);
+            vec3 exit = max((lo - o) * invD, (hi - o) * invD);
+            t = max(min(min(exit.x, exit.y), exit.z), t) + 1e-4 * stepLength;
+            continue;
+        }
+
+        float val   = texture(volumeTex, uvw).r * field_scale;
+        float a     = clamp(abs(val), 0.0, 1.0);
+        vec3  color = (magnitude != 0) ? sequentialColor(val) : divergingColor(val);
+        float alpha = a * a * DENSITY * 0.5;  // half-cell step
+        acc.rgb += (1.0 - acc.a) * alpha * color;
+        acc.a   += (1.0 - acc.a) * alpha;
+        if (acc.a > OPAQUE) break;
+        t += stepLength;
+    }
+    FragColor = vec4(acc.rgb, 1.0);
+}
@@ -0,0 +1,39 @@
+// Volume view mirror (volume.h) for E passes built with VOLUME_COMPONENT,
+// the displayed component (0=Ex,1=Ey,2=Ez,3=|E|,4=Hx,5=Hy,6=Hz). Each
+// updated cell is also written to the R16F mirror image. A cell bright
+// enough to show marks its occupancy brick, and across a brick face the
+// neighbour whose filtered samples still reach it, for empty-space skipping
+// in volume3d.frag. The host clears the mask before the pass.
+//
+// Include after nx/ny/nz are declared.
+
+layout(binding = VOLUME_IMAGE_UNIT, r16f) uniform writeonly image3D volumeImage;
+layout(std430, binding = VOLUME_OCCUPANCY_BINDING) buffer OccupancyBuffer { uint occupancy[]; };
+
+uniform float volumeCutoff;  // |value| a cell needs to mark its brick
+
+void mirrorCell(ivec3 cell, vec3 e, vec3 h) {
+#if VOLUME_COMPONENT == 3
+    float v = length(e);
+#elif VOLUME_COMPONENT < 3
+    float v = e[VOLUME_COMPONENT];
+#else
+    float v = h[VOLUME_COMPONENT - 4];
+#endif
+    imageStore(volumeImage, cell, vec4(v));
+    if (abs(v) < volumeCutoff) return;
+
+    ivec3 bricks = (ivec3(nx, ny, nz) + VOLUME_BRICK - 1) / VOLUME_BRICK;
+    ivec3 brick  = cell / VOLUME_BRICK;
+    ivec3 l      = cell - brick * VOLUME_BRICK;
+    ivec3 lo     = -ivec3(equal(l, ivec3(0)));
+    ivec3 hi     = ivec3(equal(l, ivec3(VOLUME_BRICK - 1)));
+
+    for (int dz = lo.z; dz <= hi.z; ++dz)
+    for (int dy = lo.y; dy <= hi.y; ++dy)
+    for (int dx = lo.x; dx <= hi.x; ++dx) {
+        ivec3 n = brick + ivec3(dx, dy, dz);
+        if (any(lessThan(n, ivec3(0))) || any(greaterThanEqual(n, bricks))) continue;
+        occupancy[(n.z * bricks.y + n.y) * bricks.x + n.x] = 1u;
+    }
+}